@@ -0,0 +1,25 @@
+# - Try to find liblz4
+# Once done this will define
+#  LZ4_FOUND - System has liblz4
+#  LZ4_INCLUDE_DIRS - The liblz4 include directories
+#  LZ4_LIBRARIES - The libraries needed to use liblz4
+
+FIND_LIBRARY(LZ4_LIBRARIES
+    NAMES lz4
+)
+
+FIND_PATH(LZ4_INCLUDE_DIRS
+    NAMES lz4frame.h
+)
+
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LZ4 DEFAULT_MSG
+    LZ4_LIBRARIES
+    LZ4_INCLUDE_DIRS
+)
+
+# Hide these vars from ccmake GUI
+MARK_AS_ADVANCED(
+	LZ4_LIBRARIES
+	LZ4_INCLUDE_DIRS
+)
@@ -0,0 +1,25 @@
+# - Try to find libzstd
+# Once done this will define
+#  Zstd_FOUND - System has libzstd
+#  Zstd_INCLUDE_DIRS - The libzstd include directories
+#  Zstd_LIBRARIES - The libraries needed to use libzstd
+
+FIND_LIBRARY(Zstd_LIBRARIES
+    NAMES zstd
+)
+
+FIND_PATH(Zstd_INCLUDE_DIRS
+    NAMES zstd.h
+)
+
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(Zstd DEFAULT_MSG
+    Zstd_LIBRARIES
+    Zstd_INCLUDE_DIRS
+)
+
+# Hide these vars from ccmake GUI
+MARK_AS_ADVANCED(
+	Zstd_LIBRARIES
+	Zstd_INCLUDE_DIRS
+)
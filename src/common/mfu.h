@@ -29,7 +29,10 @@ extern "C" {
 #include "mfu_pred.h"
 #include "mfu_proc.h"
 #include "mfu_progress.h"
+#include "mfu_trace.h"
+#include "mfu_mock.h"
 #include "mfu_bz2.h"
+#include "mfu_compress.h"
 
 #endif /* MFU_H */
 
@@ -29,8 +29,40 @@ int mfu_compress_bz2(const char* src_name, const char* dst_name, int b_size)
 }
 
 
+/* returns 1 if the file ends with the footer written by mfu_compress_bz2,
+ * collective */
+static int mfu_bz2_has_footer(const char* name)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int has_footer = 0;
+    if (rank == 0) {
+        int fd = mfu_open(name, O_RDONLY);
+        if (fd >= 0) {
+            struct stat st;
+            uint64_t magic;
+            if (fstat(fd, &st) == 0 && st.st_size >= 6 * 8 &&
+                mfu_pread(name, fd, &magic, 8, st.st_size - 8) == 8 &&
+                mfu_ntoh64(magic) == 0x3141314131413141)
+            {
+                has_footer = 1;
+            }
+            mfu_close(name, fd);
+        }
+    }
+    MPI_Bcast(&has_footer, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return has_footer;
+}
+
 int mfu_decompress_bz2(const char* src_name, const char* dst_name)
 {
+    /* files from other tools don't have our footer,
+     * so find their blocks by scanning */
+    if (! mfu_bz2_has_footer(src_name)) {
+        return mfu_decompress_bz2_scan(src_name, dst_name);
+    }
+
     //return mfu_decompress_bz2_libcircle(src_name, dst_name);
     return mfu_decompress_bz2_static(src_name, dst_name);
 }
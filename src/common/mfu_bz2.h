@@ -4,6 +4,13 @@
 int mfu_compress_bz2(const char* src_name, const char* dst_name, int b_size);
 int mfu_decompress_bz2(const char* src_name, const char* dst_name);
 
+/* decompress a bzip2 file written by any tool, finding its blocks by
+ * searching for their magic values in parallel, collective */
+int mfu_decompress_bz2_scan(const char* src_name, const char* dst_name);
+
+/* returns 1 if the file starts with a bzip2 stream header, collective */
+int mfu_bz2_is_stream(const char* name);
+
 /****************
  * Private internal functions
  ***************/
@@ -127,14 +127,26 @@ int mfu_compress_bz2_static(const char* src_name, const char* dst_name, int b_si
      * we use 2% to be on safe side */
     int64_t comp_buff_size = (int64_t) (1.02 * (double)block_size + 600.0);
 
-    /* define amount of memory to use for compressing data */
-    size_t bufsize = 128 * 1024 * 1024;
-    if (bufsize < (size_t)comp_buff_size) {
-        bufsize = (size_t)comp_buff_size;
+    /* bzip2 needs 400k plus 8 times the bwt size to compress a block,
+     * and we hold one uncompressed block, leaving the rest of half our
+     * memory budget for compressed blocks of two waves, since one wave
+     * is compressed while the previous one is written */
+    uint64_t budget = mfu_mem_budget(MPI_COMM_WORLD) / 2;
+    uint64_t fixed  = (uint64_t) (400 * 1024 + 8 * bwt_size + block_size);
+    uint64_t blocks_per_buffer = 1;
+    if (budget > fixed) {
+        blocks_per_buffer = (budget - fixed) / (2 * (uint64_t) comp_buff_size);
     }
 
-    /* compute number of blocks we can fit in buffer */
-    uint64_t blocks_per_buffer = bufsize / comp_buff_size;
+    /* no need for more than it takes to finish the file in one wave */
+    if (blocks_per_buffer > (uint64_t) blocks_per_rank) {
+        blocks_per_buffer = (uint64_t) blocks_per_rank;
+    }
+    if (blocks_per_buffer < 1) {
+        blocks_per_buffer = 1;
+    }
+    MFU_LOG(MFU_LOG_DBG, "Compressing %llu blocks per rank in each wave",
+        (unsigned long long) blocks_per_buffer);
 
     /* compute number of waves to finish file */
     int64_t blocks_per_wave = ranks * blocks_per_buffer;
@@ -148,45 +160,54 @@ int mfu_compress_bz2_static(const char* src_name, const char* dst_name, int b_si
     uint64_t* my_offsets = (uint64_t*) MFU_MALLOC(blocks_per_rank * sizeof(uint64_t));
     uint64_t* my_lengths = (uint64_t*) MFU_MALLOC(blocks_per_rank * sizeof(uint64_t));
 
-    /* array to store offsets and totals of each set of blocks */
-    uint64_t* block_lengths = (uint64_t*) MFU_MALLOC(blocks_per_buffer * sizeof(int64_t));
-    uint64_t* block_offsets = (uint64_t*) MFU_MALLOC(blocks_per_buffer * sizeof(int64_t));
-    uint64_t* block_totals  = (uint64_t*) MFU_MALLOC(blocks_per_buffer * sizeof(int64_t));
-
-    /* allocate a compression buffer for each block */
-    char** a = (char**) MFU_MALLOC(blocks_per_buffer * sizeof(char*));
-    for (int i = 0; i < blocks_per_buffer; i++) {
-        a[i] = (char*) MFU_MALLOC(comp_buff_size * sizeof(char));
+    /* arrays to store offsets and totals of each set of blocks,
+     * and a compression buffer for each block, for two waves */
+    uint64_t* block_lengths[2];
+    uint64_t* block_offsets[2];
+    uint64_t* block_totals[2];
+    char** a[2];
+    MPI_Request reqs[2][2];
+    for (int w = 0; w < 2; w++) {
+        block_lengths[w] = (uint64_t*) MFU_MALLOC(blocks_per_buffer * sizeof(int64_t));
+        block_offsets[w] = (uint64_t*) MFU_MALLOC(blocks_per_buffer * sizeof(int64_t));
+        block_totals[w]  = (uint64_t*) MFU_MALLOC(blocks_per_buffer * sizeof(int64_t));
+        a[w] = (char**) MFU_MALLOC(blocks_per_buffer * sizeof(char*));
+        for (int i = 0; i < blocks_per_buffer; i++) {
+            a[w][i] = (char*) MFU_MALLOC(comp_buff_size * sizeof(char));
+        }
     }
 
     /* allocate buffer to read data from source file */
     char* ibuf = (char*) MFU_MALLOC(sizeof(char) * block_size);
 
-    /* Call libcircle in a loop to work each wave as a single instance of libcircle */
+    /* work through the file in waves, the offsets of each wave are
+     * computed in the background while the next wave is compressed,
+     * and the wave is written after that, so ranks wait on each other
+     * one wave later rather than at the end of every wave */
     int64_t my_blocks = 0;
     int64_t last_offset = 0;
     int64_t blocks_processed = 0;
-    for (int64_t blocks_done = 0; blocks_done < tot_blocks; blocks_done += blocks_per_wave) {
-        /* initialize our counts to 0 for this wave */
-        for (int k = 0; k < blocks_per_buffer; k++) {
-            block_lengths[k] = 0;
-            block_offsets[k] = 0;
-        }
+    int cur = 0;
+    int pending = 0;
+    int64_t blocks_done = 0;
+    while (1) {
+        int compressed = 0;
+        if (blocks_done < tot_blocks) {
+            /* initialize our counts to 0 for this wave */
+            for (int k = 0; k < blocks_per_buffer; k++) {
+                block_lengths[cur][k] = 0;
+                block_offsets[cur][k] = 0;
+            }
 
-        /* compress blocks */
-        for (int k = 0; k < blocks_per_buffer; k++) {
-            /* compute block number for this process */
-            int64_t block_no = blocks_processed + rank;
-
-            /* compute starting offset in source file to read from */
-            off_t pos = block_no * block_size;
-            if (pos < filesize) {
-                /* seek to offset in source file for this block */
-                off_t lseek_rc = mfu_lseek(src_name, fd, pos, SEEK_SET);
-                if (lseek_rc == (off_t)-1) {
-                    MFU_LOG(MFU_LOG_ERR, "Failed to seek in source file: %s offset=%lx errno=%d (%s)",
-                        src_name, pos, errno, strerror(errno));
-                    rc = MFU_FAILURE;
+            /* compress blocks */
+            for (int k = 0; k < blocks_per_buffer; k++) {
+                /* compute block number for this process */
+                int64_t block_no = blocks_processed + rank;
+                blocks_processed += ranks;
+
+                /* compute starting offset in source file to read from */
+                off_t pos = block_no * block_size;
+                if (pos >= filesize) {
                     continue;
                 }
 
@@ -198,7 +219,7 @@ int mfu_compress_bz2_static(const char* src_name, const char* dst_name, int b_si
                 }
 
                 /* read block from input file */
-                ssize_t inSize = mfu_read(src_name, fd, ibuf, nread);
+                ssize_t inSize = mfu_pread(src_name, fd, ibuf, nread, pos);
                 if (inSize != nread) {
                     MFU_LOG(MFU_LOG_ERR, "Failed to read from source file: %s offset=%lx got=%d expected=%d errno=%d (%s)",
                         src_name, pos, inSize, nread, errno, strerror(errno));
@@ -210,7 +231,7 @@ int mfu_compress_bz2_static(const char* src_name, const char* dst_name, int b_si
                 unsigned int outSize = (unsigned int)comp_buff_size;
 
                 /* compress block from read buffer into next compression buffer */
-                int ret = BZ2_bzBuffToBuffCompress(a[k], &outSize, ibuf, (int)inSize, b_size, 0, 30);
+                int ret = BZ2_bzBuffToBuffCompress(a[cur][k], &outSize, ibuf, (int)inSize, b_size, 0, 30);
                 if (ret != 0) {
                     MFU_LOG(MFU_LOG_ERR, "Error in compression for rank %d", rank);
                     rc = MFU_FAILURE;
@@ -218,51 +239,64 @@ int mfu_compress_bz2_static(const char* src_name, const char* dst_name, int b_si
                 }
 
                 /* return size of buffer */
-                block_lengths[k] = (uint64_t) outSize;
+                block_lengths[cur][k] = (uint64_t) outSize;
             }
 
-            blocks_processed += ranks;
+            /* start scan and allreduce to compute offsets in compressed file
+             * for each of our blocks in this wave */
+            MPI_Iexscan(block_lengths[cur], block_offsets[cur], blocks_per_buffer,
+                MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD, &reqs[cur][0]);
+            MPI_Iallreduce(block_lengths[cur], block_totals[cur], blocks_per_buffer,
+                MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD, &reqs[cur][1]);
+            blocks_done += blocks_per_wave;
+            compressed = 1;
         }
 
-        /* execute scan and allreduce to compute offsets in compressed file
-         * for each of our blocks in this wave */
-        MPI_Exscan(block_lengths,    block_offsets, blocks_per_buffer, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-        MPI_Allreduce(block_lengths, block_totals,  blocks_per_buffer, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-
-        /* Each process writes out the blocks it processed in current wave at the correct offset */
-        for (int k = 0; k < blocks_per_buffer; k++) {
-            /* write out our block if we have one,
-             * this assumes a compressed block with consume
-             * at least 1 byte, which is ensured by BZ2 */
-            if (block_lengths[k] > 0) {
-                /* compute offset into compressed file for our block */
-                off_t pos = last_offset + block_offsets[k];
-
-                /* record our offset */
-                my_offsets[my_blocks] = mfu_hton64((uint64_t)pos);
-                my_lengths[my_blocks] = mfu_hton64(block_lengths[k]);
-                my_blocks++;
-
-                /* seek to position in destination file for this block */
-                off_t lseek_rc = mfu_lseek(dst_name, fd_out, pos, SEEK_SET);
-                if (lseek_rc == (off_t)-1) {
-                    MFU_LOG(MFU_LOG_ERR, "Failed to seek to compressed block in target file: %s offset=%lx errno=%d (%s)",
-                        dst_name, pos, errno, strerror(errno));
-                    rc = MFU_FAILURE;
+        /* write out the previous wave */
+        int prev = 1 - cur;
+        if (pending) {
+            MPI_Waitall(2, reqs[prev], MPI_STATUSES_IGNORE);
+            if (rank == 0) {
+                /* exscan leaves the result on rank 0 undefined */
+                for (int k = 0; k < blocks_per_buffer; k++) {
+                    block_offsets[prev][k] = 0;
                 }
+            }
 
-                /* write out block */
-                ssize_t nwritten = mfu_write(dst_name, fd_out, a[k], block_lengths[k]);
-                if (nwritten != block_lengths[k]) {
-                    MFU_LOG(MFU_LOG_ERR, "Failed to write compressed block to target file: %s offset=%lx got=%d expected=%d errno=%d (%s)",
-                        dst_name, pos, nwritten, block_lengths[k], errno, strerror(errno));
-                    rc = MFU_FAILURE;
+            /* Each process writes out the blocks it processed in this wave at the correct offset */
+            for (int k = 0; k < blocks_per_buffer; k++) {
+                /* write out our block if we have one,
+                 * this assumes a compressed block with consume
+                 * at least 1 byte, which is ensured by BZ2 */
+                if (block_lengths[prev][k] > 0) {
+                    /* compute offset into compressed file for our block */
+                    off_t pos = last_offset + block_offsets[prev][k];
+
+                    /* record our offset */
+                    my_offsets[my_blocks] = mfu_hton64((uint64_t)pos);
+                    my_lengths[my_blocks] = mfu_hton64(block_lengths[prev][k]);
+                    my_blocks++;
+
+                    /* write out block */
+                    ssize_t nwritten = mfu_pwrite(dst_name, fd_out, a[prev][k], block_lengths[prev][k], pos);
+                    if (nwritten != block_lengths[prev][k]) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to write compressed block to target file: %s offset=%lx got=%d expected=%d errno=%d (%s)",
+                            dst_name, pos, nwritten, block_lengths[prev][k], errno, strerror(errno));
+                        rc = MFU_FAILURE;
+                    }
                 }
+
+                /* update offset for next set of blocks */
+                last_offset += block_totals[prev][k];
             }
+        }
 
-            /* update offset for next set of blocks */
-            last_offset += block_totals[k];
+        /* the wave we just compressed is written next time around */
+        if (! compressed) {
+            break;
         }
+        pending = 1;
+        cur = prev;
     }
 
     /* End of all waves */
@@ -348,14 +382,16 @@ int mfu_compress_bz2_static(const char* src_name, const char* dst_name, int b_si
     mfu_free(&ibuf);
 
     /* free memory regions used to store compress blocks */
-    for (int i = 0; i < blocks_per_buffer; i++) {
-        mfu_free(&a[i]);
-    }
-    mfu_free(&a);
+    for (int w = 0; w < 2; w++) {
+        for (int i = 0; i < blocks_per_buffer; i++) {
+            mfu_free(&a[w][i]);
+        }
+        mfu_free(&a[w]);
 
-    mfu_free(&block_totals);
-    mfu_free(&block_offsets);
-    mfu_free(&block_lengths);
+        mfu_free(&block_totals[w]);
+        mfu_free(&block_offsets[w]);
+        mfu_free(&block_lengths[w]);
+    }
 
     mfu_free(&my_lengths);
     mfu_free(&my_offsets);
@@ -0,0 +1,1331 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define _LARGEFILE64_SOURCE
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <errno.h>
+
+#include <bzlib.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+#include "mpi.h"
+#include "mfu.h"
+#include "mfu_bz2.h"
+
+#define FILE_MODE (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)
+
+/* footer is eight 8-byte values in network order */
+#define MFU_COMPRESS_FOOTER_SIZE (8 * 8)
+
+/* version of footer and magic value to identify block format,
+ * the magic is the string "mfublock" */
+#define MFU_COMPRESS_VERSION (1)
+#define MFU_COMPRESS_MAGIC   (0x6d6675626c6f636bULL)
+
+/* largest block we allow, since some codecs count bytes with 32 bits */
+#define MFU_COMPRESS_BLOCK_MAX (1024 * 1024 * 1024)
+
+/* zstd and lz4 skip frames with a magic value from 0x184D2A50 to
+ * 0x184D2A5F followed by a 4-byte length, both little endian */
+#define MFU_COMPRESS_SKIPPABLE_MAGIC (0x184D2A5E)
+#define MFU_COMPRESS_SKIPPABLE_SIZE  (8)
+
+/* functions to work with a single block in one codec */
+typedef struct {
+    mfu_codec_t codec;  /* value stored in footer */
+    const char* name;   /* name given by user */
+    const char* ext;    /* extension of compressed file */
+    int level_min;      /* lowest compression level */
+    int level_max;      /* highest compression level */
+    int level_default;  /* level used if user doesn't specify one */
+    int skippable;      /* whether codec can skip a frame holding the index */
+    size_t (*bound)(size_t size);
+    size_t (*work)(int level, size_t size);
+    int (*compress)(int level, const void* src, size_t srclen, void* dst, size_t* dstlen);
+    int (*decompress)(const void* src, size_t srclen, void* dst, size_t* dstlen);
+} mfu_codec_desc;
+
+/* given original data of size B, BZ2 compressed data can take up
+ * to B * 1.01 + 600 bytes */
+static size_t mfu_codec_bz2_bound(size_t size)
+{
+    return size + size / 100 + 600;
+}
+
+/* bzip2 documents 400k plus 8 times the block size of the level
+ * (100k to 900k) for compression, regardless of input size */
+static size_t mfu_codec_bz2_work(int level, size_t size)
+{
+    return 400 * 1024 + 8 * (size_t) level * 100000;
+}
+
+static int mfu_codec_bz2_compress(int level, const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    unsigned int outsize = (*dstlen > UINT_MAX) ? UINT_MAX : (unsigned int) *dstlen;
+    int ret = BZ2_bzBuffToBuffCompress((char*) dst, &outsize, (char*) src, (unsigned int) srclen, level, 0, 30);
+    if (ret != BZ_OK) {
+        return MFU_FAILURE;
+    }
+    *dstlen = (size_t) outsize;
+    return MFU_SUCCESS;
+}
+
+static int mfu_codec_bz2_decompress(const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    unsigned int outsize = (*dstlen > UINT_MAX) ? UINT_MAX : (unsigned int) *dstlen;
+    int ret = BZ2_bzBuffToBuffDecompress((char*) dst, &outsize, (char*) src, (unsigned int) srclen, 0, 0);
+    if (ret != BZ_OK) {
+        return MFU_FAILURE;
+    }
+    *dstlen = (size_t) outsize;
+    return MFU_SUCCESS;
+}
+
+#ifdef HAVE_ZLIB
+/* compressBound is for the 6-byte zlib wrapper, gzip takes 18 */
+static size_t mfu_codec_gzip_bound(size_t size)
+{
+    return (size_t) compressBound((uLong) size) + 18;
+}
+
+/* deflate takes 2^(windowBits+2) + 2^(memLevel+9) bytes,
+ * with windowBits=15 and memLevel=8 as used below */
+static size_t mfu_codec_gzip_work(int level, size_t size)
+{
+    return (1 << 17) + (1 << 17) + 8 * 1024;
+}
+
+static int mfu_codec_gzip_compress(int level, const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    /* add 16 to window bits to write a gzip header and trailer */
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return MFU_FAILURE;
+    }
+
+    strm.next_in   = (Bytef*) src;
+    strm.avail_in  = (uInt) srclen;
+    strm.next_out  = (Bytef*) dst;
+    strm.avail_out = (uInt) *dstlen;
+    int ret = deflate(&strm, Z_FINISH);
+    *dstlen = (size_t) strm.total_out;
+    deflateEnd(&strm);
+
+    return (ret == Z_STREAM_END) ? MFU_SUCCESS : MFU_FAILURE;
+}
+
+static int mfu_codec_gzip_decompress(const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, 15 + 16) != Z_OK) {
+        return MFU_FAILURE;
+    }
+
+    strm.next_in   = (Bytef*) src;
+    strm.avail_in  = (uInt) srclen;
+    strm.next_out  = (Bytef*) dst;
+    strm.avail_out = (uInt) *dstlen;
+    int ret = inflate(&strm, Z_FINISH);
+    *dstlen = (size_t) strm.total_out;
+    inflateEnd(&strm);
+
+    return (ret == Z_STREAM_END) ? MFU_SUCCESS : MFU_FAILURE;
+}
+#endif /* HAVE_ZLIB */
+
+#ifdef HAVE_ZSTD
+static size_t mfu_codec_zstd_bound(size_t size)
+{
+    return ZSTD_compressBound(size);
+}
+
+/* ZSTD_estimateCCtxSize is only in the static API, zstd shrinks its
+ * window and tables to fit a block of known size, but the match finder
+ * tables of high levels still take several times the block size */
+static size_t mfu_codec_zstd_work(int level, size_t size)
+{
+    size_t factor = 3;
+    if (level >= 16) {
+        factor = 12;
+    } else if (level >= 8) {
+        factor = 6;
+    }
+    return factor * size + 1024 * 1024;
+}
+
+static int mfu_codec_zstd_compress(int level, const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    size_t ret = ZSTD_compress(dst, *dstlen, src, srclen, level);
+    if (ZSTD_isError(ret)) {
+        return MFU_FAILURE;
+    }
+    *dstlen = ret;
+    return MFU_SUCCESS;
+}
+
+static int mfu_codec_zstd_decompress(const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    size_t ret = ZSTD_decompress(dst, *dstlen, src, srclen);
+    if (ZSTD_isError(ret)) {
+        return MFU_FAILURE;
+    }
+    *dstlen = ret;
+    return MFU_SUCCESS;
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+/* use the lz4 frame format rather than raw blocks so that
+ * the lz4 command can read the file */
+static void mfu_codec_lz4_prefs(int level, size_t size, LZ4F_preferences_t* prefs)
+{
+    memset(prefs, 0, sizeof(*prefs));
+    prefs->compressionLevel      = level;
+    prefs->frameInfo.contentSize = (unsigned long long) size;
+}
+
+static size_t mfu_codec_lz4_bound(size_t size)
+{
+    LZ4F_preferences_t prefs;
+    mfu_codec_lz4_prefs(0, size, &prefs);
+    return LZ4F_compressFrameBound(size, &prefs);
+}
+
+/* the fast levels keep a 16k hash table, the HC levels from 3 up
+ * keep a 256k chain table as well */
+static size_t mfu_codec_lz4_work(int level, size_t size)
+{
+    return (level >= 3) ? 320 * 1024 : 64 * 1024;
+}
+
+static int mfu_codec_lz4_compress(int level, const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    LZ4F_preferences_t prefs;
+    mfu_codec_lz4_prefs(level, srclen, &prefs);
+    size_t ret = LZ4F_compressFrame(dst, *dstlen, src, srclen, &prefs);
+    if (LZ4F_isError(ret)) {
+        return MFU_FAILURE;
+    }
+    *dstlen = ret;
+    return MFU_SUCCESS;
+}
+
+static int mfu_codec_lz4_decompress(const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    LZ4F_dctx* dctx;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION))) {
+        return MFU_FAILURE;
+    }
+
+    /* call until the end of the frame, which is when it returns 0 */
+    int rc = MFU_SUCCESS;
+    size_t done_in  = 0;
+    size_t done_out = 0;
+    while (1) {
+        size_t insize  = srclen - done_in;
+        size_t outsize = *dstlen - done_out;
+        size_t ret = LZ4F_decompress(dctx, (char*) dst + done_out, &outsize,
+            (const char*) src + done_in, &insize, NULL);
+        if (LZ4F_isError(ret)) {
+            rc = MFU_FAILURE;
+            break;
+        }
+        done_in  += insize;
+        done_out += outsize;
+        if (ret == 0) {
+            break;
+        }
+        if (insize == 0 && outsize == 0) {
+            /* truncated frame or output buffer is too small */
+            rc = MFU_FAILURE;
+            break;
+        }
+    }
+
+    LZ4F_freeDecompressionContext(dctx);
+
+    *dstlen = done_out;
+    return rc;
+}
+#endif /* HAVE_LZ4 */
+
+/* codecs that were built in */
+static const mfu_codec_desc mfu_codecs[] = {
+    {MFU_CODEC_BZ2, "bz2", ".bz2", 1, 9, 9, 0,
+        mfu_codec_bz2_bound, mfu_codec_bz2_work, mfu_codec_bz2_compress, mfu_codec_bz2_decompress},
+#ifdef HAVE_ZLIB
+    {MFU_CODEC_GZIP, "gzip", ".gz", 1, 9, 6, 0,
+        mfu_codec_gzip_bound, mfu_codec_gzip_work, mfu_codec_gzip_compress, mfu_codec_gzip_decompress},
+#endif
+#ifdef HAVE_ZSTD
+    {MFU_CODEC_ZSTD, "zstd", ".zst", 1, 19, 3, 1,
+        mfu_codec_zstd_bound, mfu_codec_zstd_work, mfu_codec_zstd_compress, mfu_codec_zstd_decompress},
+#endif
+#ifdef HAVE_LZ4
+    {MFU_CODEC_LZ4, "lz4", ".lz4", 0, 12, 0, 1,
+        mfu_codec_lz4_bound, mfu_codec_lz4_work, mfu_codec_lz4_compress, mfu_codec_lz4_decompress},
+#endif
+};
+
+/* returns description of codec, or NULL if it was not built in */
+static const mfu_codec_desc* mfu_codec_lookup(mfu_codec_t codec)
+{
+    size_t i;
+    for (i = 0; i < sizeof(mfu_codecs) / sizeof(mfu_codecs[0]); i++) {
+        if (mfu_codecs[i].codec == codec) {
+            return &mfu_codecs[i];
+        }
+    }
+    return NULL;
+}
+
+int mfu_codec_parse(const char* name, mfu_codec_t* codec)
+{
+    size_t i;
+    for (i = 0; i < sizeof(mfu_codecs) / sizeof(mfu_codecs[0]); i++) {
+        if (strcmp(mfu_codecs[i].name, name) == 0) {
+            *codec = mfu_codecs[i].codec;
+            return MFU_SUCCESS;
+        }
+    }
+
+    /* accept a few common aliases */
+    if (strcmp(name, "bzip2") == 0) {
+        return mfu_codec_parse("bz2", codec);
+    }
+    if (strcmp(name, "gz") == 0) {
+        return mfu_codec_parse("gzip", codec);
+    }
+    if (strcmp(name, "zst") == 0) {
+        return mfu_codec_parse("zstd", codec);
+    }
+
+    *codec = MFU_CODEC_NONE;
+    return MFU_FAILURE;
+}
+
+const char* mfu_codec_name(mfu_codec_t codec)
+{
+    const mfu_codec_desc* desc = mfu_codec_lookup(codec);
+    return (desc != NULL) ? desc->name : NULL;
+}
+
+const char* mfu_codec_ext(mfu_codec_t codec)
+{
+    const mfu_codec_desc* desc = mfu_codec_lookup(codec);
+    return (desc != NULL) ? desc->ext : NULL;
+}
+
+int mfu_codec_default_level(mfu_codec_t codec)
+{
+    const mfu_codec_desc* desc = mfu_codec_lookup(codec);
+    return (desc != NULL) ? desc->level_default : 0;
+}
+
+size_t mfu_codec_bound(mfu_codec_t codec, size_t size)
+{
+    const mfu_codec_desc* desc = mfu_codec_lookup(codec);
+    return (desc != NULL) ? desc->bound(size) : 0;
+}
+
+size_t mfu_codec_work_size(mfu_codec_t codec, int level, size_t size)
+{
+    const mfu_codec_desc* desc = mfu_codec_lookup(codec);
+    if (desc == NULL) {
+        return 0;
+    }
+    if (level < 0) {
+        level = desc->level_default;
+    }
+    return desc->work(level, size);
+}
+
+int mfu_codec_compress(mfu_codec_t codec, int level,
+    const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    const mfu_codec_desc* desc = mfu_codec_lookup(codec);
+    if (desc == NULL) {
+        return MFU_FAILURE;
+    }
+
+    /* clamp level to the range of the codec */
+    if (level < desc->level_min) {
+        level = desc->level_min;
+    }
+    if (level > desc->level_max) {
+        level = desc->level_max;
+    }
+
+    return desc->compress(level, src, srclen, dst, dstlen);
+}
+
+int mfu_codec_decompress(mfu_codec_t codec,
+    const void* src, size_t srclen, void* dst, size_t* dstlen)
+{
+    const mfu_codec_desc* desc = mfu_codec_lookup(codec);
+    if (desc == NULL) {
+        return MFU_FAILURE;
+    }
+    return desc->decompress(src, srclen, dst, dstlen);
+}
+
+int mfu_compress_read_info(const char* name, int fd, mfu_compress_info* info)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* have rank 0 read the footer, the last value holds a flag
+     * to indicate whether the file is in block format */
+    uint64_t footer[9] = {0};
+    if (rank == 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= MFU_COMPRESS_FOOTER_SIZE) {
+            uint64_t file_footer[8];
+            off_t pos = st.st_size - MFU_COMPRESS_FOOTER_SIZE;
+            ssize_t nread = mfu_pread(name, fd, file_footer, MFU_COMPRESS_FOOTER_SIZE, pos);
+            if (nread == MFU_COMPRESS_FOOTER_SIZE) {
+                int i;
+                for (i = 0; i < 8; i++) {
+                    footer[i] = mfu_ntoh64(file_footer[i]);
+                }
+
+                /* check the magic, version, and that the index
+                 * ends where the footer starts */
+                uint64_t index_end = footer[0] + footer[1] * 16;
+                if (footer[7] == MFU_COMPRESS_MAGIC &&
+                    footer[6] == MFU_COMPRESS_VERSION &&
+                    footer[0] <= (uint64_t) pos &&
+                    index_end == (uint64_t) pos)
+                {
+                    footer[8] = 1;
+                }
+            }
+        }
+    }
+
+    /* broadcast footer to all ranks */
+    MPI_Bcast(footer, 9, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    if (! footer[8]) {
+        return MFU_FAILURE;
+    }
+
+    info->index_offset = footer[0];
+    info->blocks       = footer[1];
+    info->block_size   = footer[2];
+    info->size         = footer[3];
+    info->codec        = (mfu_codec_t) footer[4];
+    info->level        = (int) footer[5];
+    return MFU_SUCCESS;
+}
+
+int mfu_compress_read_index(const char* name, int fd, const mfu_compress_info* info,
+    uint64_t start, uint64_t count, uint64_t* offsets, uint64_t* lengths)
+{
+    if (count == 0) {
+        return MFU_SUCCESS;
+    }
+
+    /* read all entries with one read */
+    size_t bufsize = (size_t) count * 16;
+    uint64_t* buf = (uint64_t*) MFU_MALLOC(bufsize);
+    off_t pos = (off_t) (info->index_offset + start * 16);
+    ssize_t nread = mfu_pread(name, fd, buf, bufsize, pos);
+    if (nread != (ssize_t) bufsize) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to read block index: %s offset=%llx got=%lld expected=%llu errno=%d (%s)",
+            name, (unsigned long long) pos, (long long) nread, (unsigned long long) bufsize,
+            errno, strerror(errno));
+        mfu_free(&buf);
+        return MFU_FAILURE;
+    }
+
+    uint64_t i;
+    for (i = 0; i < count; i++) {
+        offsets[i] = mfu_ntoh64(buf[i * 2 + 0]);
+        lengths[i] = mfu_ntoh64(buf[i * 2 + 1]);
+    }
+
+    mfu_free(&buf);
+    return MFU_SUCCESS;
+}
+
+int mfu_compress_write_index(const char* name, int fd, const mfu_compress_info* info,
+    uint64_t count, const uint64_t* ids, const uint64_t* offsets, const uint64_t* lengths)
+{
+    int rc = MFU_SUCCESS;
+
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* pack (id, offset, length) of each of our blocks */
+    uint64_t* mine = (uint64_t*) MFU_MALLOC((size_t) count * 3 * sizeof(uint64_t));
+    uint64_t i;
+    for (i = 0; i < count; i++) {
+        mine[i * 3 + 0] = ids[i];
+        mine[i * 3 + 1] = offsets[i];
+        mine[i * 3 + 2] = lengths[i];
+    }
+
+    /* gather entries to rank 0, rather than having each rank
+     * write its own 16-byte entries into the index */
+    int mycount = (int) (count * 3);
+    int* counts = NULL;
+    int* displs = NULL;
+    uint64_t* all = NULL;
+    if (rank == 0) {
+        counts = (int*) MFU_MALLOC((size_t) ranks * sizeof(int));
+        displs = (int*) MFU_MALLOC((size_t) ranks * sizeof(int));
+    }
+    MPI_Gather(&mycount, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        int total = 0;
+        int r;
+        for (r = 0; r < ranks; r++) {
+            displs[r] = total;
+            total += counts[r];
+        }
+        all = (uint64_t*) MFU_MALLOC((size_t) total * sizeof(uint64_t));
+    }
+    MPI_Gatherv(mine, mycount, MPI_UINT64_T, all, counts, displs, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        /* wrap the index and footer in a skippable frame if the codec has one */
+        const mfu_codec_desc* desc = mfu_codec_lookup(info->codec);
+        uint64_t trailer_size = info->blocks * 16 + MFU_COMPRESS_FOOTER_SIZE;
+        size_t header_size = 0;
+        if (desc != NULL && desc->skippable && trailer_size <= UINT32_MAX) {
+            header_size = MFU_COMPRESS_SKIPPABLE_SIZE;
+        }
+
+        size_t bufsize = header_size + (size_t) trailer_size;
+        unsigned char* buf = (unsigned char*) MFU_CALLOC(bufsize, 1);
+
+        /* skippable frame header is magic and length, little endian */
+        if (header_size > 0) {
+            uint32_t magic = MFU_COMPRESS_SKIPPABLE_MAGIC;
+            uint32_t len   = (uint32_t) trailer_size;
+            int b;
+            for (b = 0; b < 4; b++) {
+                buf[b]     = (unsigned char) ((magic >> (8 * b)) & 0xff);
+                buf[4 + b] = (unsigned char) ((len   >> (8 * b)) & 0xff);
+            }
+        }
+
+        /* fill in index entries */
+        uint64_t* entries = (uint64_t*) (buf + header_size);
+        uint64_t total = (uint64_t) (displs[ranks - 1] + counts[ranks - 1]) / 3;
+        for (i = 0; i < total; i++) {
+            uint64_t id = all[i * 3 + 0];
+            if (id < info->blocks) {
+                entries[id * 2 + 0] = mfu_hton64(all[i * 3 + 1]);
+                entries[id * 2 + 1] = mfu_hton64(all[i * 3 + 2]);
+            }
+        }
+
+        /* index_offset on input is where the compressed data ends */
+        uint64_t index_offset = info->index_offset + header_size;
+
+        /* convert footer fields to network order */
+        uint64_t* footer = (uint64_t*) (buf + header_size + info->blocks * 16);
+        footer[0] = mfu_hton64(index_offset);              /* offset to start of index */
+        footer[1] = mfu_hton64(info->blocks);              /* number of blocks in the file */
+        footer[2] = mfu_hton64(info->block_size);          /* max size of uncompressed block */
+        footer[3] = mfu_hton64(info->size);                /* size with all blocks decompressed */
+        footer[4] = mfu_hton64((uint64_t) info->codec);    /* codec of blocks */
+        footer[5] = mfu_hton64((uint64_t) info->level);    /* level blocks were compressed with */
+        footer[6] = mfu_hton64(MFU_COMPRESS_VERSION);      /* file version number */
+        footer[7] = mfu_hton64(MFU_COMPRESS_MAGIC);        /* magic number */
+
+        /* write index and footer */
+        off_t pos = (off_t) info->index_offset;
+        ssize_t nwritten = mfu_pwrite(name, fd, buf, bufsize, pos);
+        if (nwritten != (ssize_t) bufsize) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to write block index to target file: %s offset=%llx got=%lld expected=%llu errno=%d (%s)",
+                name, (unsigned long long) pos, (long long) nwritten, (unsigned long long) bufsize,
+                errno, strerror(errno));
+            rc = MFU_FAILURE;
+        }
+
+        mfu_free(&buf);
+        mfu_free(&all);
+        mfu_free(&displs);
+        mfu_free(&counts);
+    }
+
+    mfu_free(&mine);
+
+    /* check that rank 0 wrote successfully */
+    MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return rc;
+}
+
+/* have rank 0 set mode, owner, and times on target from given stat */
+static void mfu_compress_set_meta(const char* name, const struct stat* st)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        /* set mode and group */
+        mfu_chmod(name, st->st_mode);
+        mfu_lchown(name, st->st_uid, st->st_gid);
+
+        /* set timestamps */
+        struct utimbuf uTimBuf;
+        uTimBuf.actime  = st->st_atime;
+        uTimBuf.modtime = st->st_mtime;
+        utime(name, &uTimBuf);
+    }
+}
+
+/* normalize block size given by caller */
+static size_t mfu_compress_block_size(size_t block_size)
+{
+    if (block_size == 0) {
+        block_size = MFU_COMPRESS_BLOCK_SIZE;
+    }
+    if (block_size > MFU_COMPRESS_BLOCK_MAX) {
+        block_size = MFU_COMPRESS_BLOCK_MAX;
+    }
+    return block_size;
+}
+
+uint64_t mfu_compress_wave_blocks(mfu_codec_t codec, int level,
+    size_t block_size, uint64_t size)
+{
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* each rank needs the codec state and a buffer for the uncompressed
+     * block, and buffers for the compressed blocks of two waves, since
+     * one wave is compressed while the previous one is written,
+     * leave the other half of the budget to the caller */
+    block_size = mfu_compress_block_size(block_size);
+    uint64_t comp_buff_size = (uint64_t) mfu_codec_bound(codec, block_size);
+    uint64_t fixed = (uint64_t) mfu_codec_work_size(codec, level, block_size) + block_size;
+    uint64_t budget = mfu_mem_budget(MPI_COMM_WORLD) / 2;
+    uint64_t blocks_per_buffer = 1;
+    if (comp_buff_size > 0 && budget > fixed) {
+        blocks_per_buffer = (budget - fixed) / (2 * comp_buff_size);
+    }
+
+    /* no need for runs longer than it takes to spread the stream over
+     * all ranks in a single wave */
+    uint64_t tot_blocks = size / block_size;
+    if (tot_blocks * block_size < size) {
+        tot_blocks++;
+    }
+    uint64_t share = tot_blocks / (uint64_t) ranks;
+    if (share * (uint64_t) ranks < tot_blocks) {
+        share++;
+    }
+    if (blocks_per_buffer > share) {
+        blocks_per_buffer = share;
+    }
+    if (blocks_per_buffer < 1) {
+        blocks_per_buffer = 1;
+    }
+
+    return blocks_per_buffer;
+}
+
+/* compressed blocks of one wave on the calling rank */
+typedef struct {
+    char** bufs;           /* compression buffer for each block */
+    uint64_t* lengths;     /* length of each compressed block, 0 if none */
+    uint64_t first_block;  /* id of first block in our run */
+    uint64_t bytes;        /* number of bytes in our run */
+    uint64_t start;        /* offset of our run within the wave */
+    uint64_t total;        /* number of bytes in the wave on all ranks */
+    MPI_Request reqs[2];   /* scan and allreduce computing start and total */
+} mfu_compress_wave;
+
+/* wait for offsets of a wave and write our run of blocks at
+ * *offset plus our start, records the blocks for the index,
+ * and advances *offset past the wave */
+static int mfu_compress_wave_write(const char* name, int fd,
+    mfu_compress_wave* w, uint64_t blocks_per_buffer, uint64_t* offset,
+    uint64_t* my_blocks, uint64_t* my_ids, uint64_t* my_offsets, uint64_t* my_lengths)
+{
+    int rc = MFU_SUCCESS;
+
+    MPI_Waitall(2, w->reqs, MPI_STATUSES_IGNORE);
+    if (mfu_rank == 0) {
+        /* exscan leaves the result on rank 0 undefined */
+        w->start = 0;
+    }
+
+    /* every codec writes at least one byte for a block */
+    uint64_t pos = *offset + w->start;
+    uint64_t k;
+    for (k = 0; k < blocks_per_buffer; k++) {
+        uint64_t len = w->lengths[k];
+        if (len == 0) {
+            continue;
+        }
+
+        /* record our offset */
+        my_ids[*my_blocks]     = w->first_block + k;
+        my_offsets[*my_blocks] = pos;
+        my_lengths[*my_blocks] = len;
+        (*my_blocks)++;
+
+        /* write out block */
+        ssize_t nwritten = mfu_pwrite(name, fd, w->bufs[k], (size_t) len, (off_t) pos);
+        if (nwritten != (ssize_t) len) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to write compressed block to target file: %s offset=%llx got=%lld expected=%llu errno=%d (%s)",
+                name, (unsigned long long) pos, (long long) nwritten, (unsigned long long) len,
+                errno, strerror(errno));
+            rc = MFU_FAILURE;
+        }
+        pos += len;
+    }
+
+    /* update offset for next wave */
+    *offset += w->total;
+
+    return rc;
+}
+
+int mfu_compress_stream(const char* name, int fd, mfu_codec_t codec, int level,
+    size_t block_size, uint64_t wave_blocks, uint64_t size,
+    mfu_compress_fill_fn fill, void* arg)
+{
+    int rc = MFU_SUCCESS;
+
+    /* get rank and size of communicator */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* check that we have the codec */
+    if (mfu_codec_lookup(codec) == NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Compression codec %d is not available", (int) codec);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* fill in defaults */
+    if (level < 0) {
+        level = mfu_codec_default_level(codec);
+    }
+    block_size = mfu_compress_block_size(block_size);
+
+    /* compute total number of blocks in the stream */
+    uint64_t tot_blocks = size / block_size;
+    if (tot_blocks * block_size < size) {
+        tot_blocks++;
+    }
+
+    /* each rank compresses a run of consecutive blocks in each wave */
+    size_t comp_buff_size = mfu_codec_bound(codec, block_size);
+    uint64_t blocks_per_buffer = wave_blocks;
+    if (blocks_per_buffer == 0) {
+        blocks_per_buffer = mfu_compress_wave_blocks(codec, level, block_size, size);
+    }
+    uint64_t blocks_per_wave = (uint64_t) ranks * blocks_per_buffer;
+
+    /* compute max number of blocks this process will handle */
+    uint64_t waves = tot_blocks / blocks_per_wave;
+    if (waves * blocks_per_wave < tot_blocks) {
+        waves++;
+    }
+    uint64_t blocks_per_rank = waves * blocks_per_buffer;
+
+    /* record id, offset, and length of each of our blocks for the index */
+    uint64_t* my_ids     = (uint64_t*) MFU_MALLOC(blocks_per_rank * sizeof(uint64_t));
+    uint64_t* my_offsets = (uint64_t*) MFU_MALLOC(blocks_per_rank * sizeof(uint64_t));
+    uint64_t* my_lengths = (uint64_t*) MFU_MALLOC(blocks_per_rank * sizeof(uint64_t));
+
+    /* allocate compression buffers for two waves, we compress into one
+     * while the offsets of the other are computed in the background,
+     * so ranks only wait on each other a wave later, not every wave */
+    mfu_compress_wave wave[2];
+    int i;
+    uint64_t k;
+    for (i = 0; i < 2; i++) {
+        wave[i].bufs    = (char**) MFU_MALLOC(blocks_per_buffer * sizeof(char*));
+        wave[i].lengths = (uint64_t*) MFU_MALLOC(blocks_per_buffer * sizeof(uint64_t));
+        for (k = 0; k < blocks_per_buffer; k++) {
+            wave[i].bufs[k] = (char*) MFU_MALLOC(comp_buff_size);
+        }
+    }
+
+    /* allocate buffer to hold uncompressed data */
+    char* ibuf = (char*) MFU_MALLOC(block_size);
+
+    /* work through the stream in waves, in each wave rank r compresses
+     * the r-th run of blocks_per_buffer blocks, the runs are written in
+     * rank order so that blocks land in the file in order, which lets
+     * serial tools read the result, a wave is written after the next
+     * one is compressed */
+    uint64_t my_blocks = 0;
+    uint64_t last_offset = 0;
+    int cur = 0;
+    int pending = 0;
+    uint64_t wave_start;
+    for (wave_start = 0; wave_start < tot_blocks; wave_start += blocks_per_wave) {
+        /* compress blocks */
+        mfu_compress_wave* w = &wave[cur];
+        w->first_block = wave_start + (uint64_t) rank * blocks_per_buffer;
+        w->bytes = 0;
+        for (k = 0; k < blocks_per_buffer; k++) {
+            w->lengths[k] = 0;
+        }
+        for (k = 0; k < blocks_per_buffer; k++) {
+            /* compute block number for this process */
+            uint64_t block_no = w->first_block + k;
+            if (block_no >= tot_blocks) {
+                break;
+            }
+
+            /* compute number of bytes in this block */
+            uint64_t pos = block_no * block_size;
+            size_t nread = block_size;
+            if (size - pos < (uint64_t) nread) {
+                nread = (size_t) (size - pos);
+            }
+
+            /* get uncompressed data from caller */
+            if (fill(ibuf, nread, pos, arg) != MFU_SUCCESS) {
+                rc = MFU_FAILURE;
+                continue;
+            }
+
+            /* compress block from read buffer into next compression buffer */
+            size_t outSize = comp_buff_size;
+            if (mfu_codec_compress(codec, level, ibuf, nread, w->bufs[k], &outSize) != MFU_SUCCESS) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to compress block %llu of %s",
+                    (unsigned long long) block_no, name);
+                rc = MFU_FAILURE;
+                continue;
+            }
+
+            w->lengths[k] = (uint64_t) outSize;
+            w->bytes += (uint64_t) outSize;
+        }
+
+        /* start scan and allreduce to compute where our run of
+         * blocks starts and where this wave ends in the compressed file */
+        w->start = 0;
+        w->total = 0;
+        MPI_Iexscan(&w->bytes, &w->start, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD, &w->reqs[0]);
+        MPI_Iallreduce(&w->bytes, &w->total, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD, &w->reqs[1]);
+
+        /* write out the previous wave while this one's offsets are computed */
+        if (pending) {
+            if (mfu_compress_wave_write(name, fd, &wave[1 - cur], blocks_per_buffer,
+                &last_offset, &my_blocks, my_ids, my_offsets, my_lengths) != MFU_SUCCESS)
+            {
+                rc = MFU_FAILURE;
+            }
+        }
+        pending = 1;
+        cur = 1 - cur;
+    }
+
+    /* write out the last wave */
+    if (pending) {
+        if (mfu_compress_wave_write(name, fd, &wave[1 - cur], blocks_per_buffer,
+            &last_offset, &my_blocks, my_ids, my_offsets, my_lengths) != MFU_SUCCESS)
+        {
+            rc = MFU_FAILURE;
+        }
+    }
+
+    /* write index and footer after the last block */
+    mfu_compress_info info;
+    info.index_offset = last_offset;
+    info.blocks       = tot_blocks;
+    info.block_size   = (uint64_t) block_size;
+    info.size         = size;
+    info.codec        = codec;
+    info.level        = level;
+    int index_rc = mfu_compress_write_index(name, fd, &info,
+        my_blocks, my_ids, my_offsets, my_lengths);
+    if (index_rc != MFU_SUCCESS) {
+        rc = MFU_FAILURE;
+    }
+
+    /* free memory regions used to store compress blocks */
+    mfu_free(&ibuf);
+    for (i = 0; i < 2; i++) {
+        for (k = 0; k < blocks_per_buffer; k++) {
+            mfu_free(&wave[i].bufs[k]);
+        }
+        mfu_free(&wave[i].bufs);
+        mfu_free(&wave[i].lengths);
+    }
+
+    mfu_free(&my_lengths);
+    mfu_free(&my_offsets);
+    mfu_free(&my_ids);
+
+    /* check that all processes wrote successfully */
+    if (! mfu_alltrue(rc == MFU_SUCCESS, MPI_COMM_WORLD)) {
+        rc = MFU_FAILURE;
+    }
+
+    return rc;
+}
+
+/* source file for mfu_compress_file_fill */
+typedef struct {
+    const char* name;
+    int fd;
+} mfu_compress_src;
+
+/* reads block of source file for mfu_compress_stream */
+static int mfu_compress_file_fill(void* buf, size_t len, uint64_t pos, void* arg)
+{
+    mfu_compress_src* src = (mfu_compress_src*) arg;
+    ssize_t inSize = mfu_pread(src->name, src->fd, buf, len, (off_t) pos);
+    if (inSize != (ssize_t) len) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to read from source file: %s offset=%llx got=%lld expected=%llu errno=%d (%s)",
+            src->name, (unsigned long long) pos, (long long) inSize, (unsigned long long) len,
+            errno, strerror(errno));
+        return MFU_FAILURE;
+    }
+    return MFU_SUCCESS;
+}
+
+int mfu_compress_file(const char* src_name, const char* dst_name,
+    mfu_codec_t codec, int level, size_t block_size)
+{
+    int rc = MFU_SUCCESS;
+
+    /* get rank of process */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* check that we have the codec */
+    if (mfu_codec_lookup(codec) == NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Compression codec %d is not available", (int) codec);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* read stat info for source file */
+    struct stat st;
+    int stat_flag = 1;
+    int64_t filesize = 0;
+    if (rank == 0) {
+        /* stat file to get file size */
+        int lstat_rc = mfu_lstat(src_name, &st);
+        if (lstat_rc == 0) {
+            filesize = (int64_t) st.st_size;
+        } else {
+            /* failed to stat file for file size */
+            stat_flag = 0;
+            MFU_LOG(MFU_LOG_ERR, "Failed to stat file: %s errno=%d (%s)",
+                src_name, errno, strerror(errno));
+        }
+    }
+
+    /* broadcast filesize to all ranks */
+    MPI_Bcast(&stat_flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&filesize, 1, MPI_INT64_T, 0, MPI_COMM_WORLD);
+
+    /* check that we could stat file */
+    if (! stat_flag) {
+        return MFU_FAILURE;
+    }
+
+    /* open the source file for reading */
+    int fd = mfu_open(src_name, O_RDONLY | O_LARGEFILE);
+    if (fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open file for reading: %s errno=%d (%s)",
+            src_name, errno, strerror(errno));
+    }
+
+    /* check that all processes were able to open the file */
+    if (! mfu_alltrue(fd >= 0, MPI_COMM_WORLD)) {
+        if (fd >= 0) {
+            mfu_close(src_name, fd);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* open destination file for writing */
+    int fd_out = mfu_create_fully_striped(dst_name, FILE_MODE);
+
+    /* check that all processes were able to open the file */
+    if (! mfu_alltrue(fd_out >= 0, MPI_COMM_WORLD)) {
+        if (fd_out >= 0) {
+            mfu_close(dst_name, fd_out);
+        }
+        mfu_close(src_name, fd);
+        return MFU_FAILURE;
+    }
+
+    /* compress the file */
+    mfu_trace_push("compress");
+    mfu_compress_src src;
+    src.name = src_name;
+    src.fd   = fd;
+    rc = mfu_compress_stream(dst_name, fd_out, codec, level, block_size, 0,
+        (uint64_t) filesize, mfu_compress_file_fill, &src);
+
+    /* close source and target files */
+    mfu_fsync(dst_name, fd_out);
+    mfu_close(dst_name, fd_out);
+    mfu_close(src_name, fd);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    mfu_compress_set_meta(dst_name, &st);
+
+    mfu_trace_pop();
+
+    return rc;
+}
+
+/* read block_no of the file open as fd, which is stored as length
+ * bytes at offset, into ibuf and decompress it into obuf, which holds
+ * info->block_size bytes, sets *outsize to the number of bytes it
+ * decompressed to */
+static int mfu_decompress_block(const char* name, int fd, const mfu_compress_info* info,
+    uint64_t block_no, uint64_t offset, uint64_t length, char* ibuf, char* obuf, size_t* outsize)
+{
+    /* a valid block is never larger than the bound of the codec */
+    size_t max_length = mfu_codec_bound(info->codec, (size_t) info->block_size);
+    if (length > max_length) {
+        MFU_LOG(MFU_LOG_ERR, "Block %llu has invalid length %llu in source file: %s",
+            (unsigned long long) block_no, (unsigned long long) length, name);
+        return MFU_FAILURE;
+    }
+
+    /* read compressed block from source file */
+    ssize_t inSize = mfu_pread(name, fd, ibuf, (size_t) length, (off_t) offset);
+    if (inSize != (ssize_t) length) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to read block from source file: %s offset=%llx got=%lld expected=%llu errno=%d (%s)",
+            name, (unsigned long long) offset, (long long) inSize, (unsigned long long) length,
+            errno, strerror(errno));
+        return MFU_FAILURE;
+    }
+
+    /* compute size we expect this block to decompress to */
+    uint64_t out_offset = block_no * info->block_size;
+    size_t expected = (size_t) info->block_size;
+    if (info->size - out_offset < info->block_size) {
+        expected = (size_t) (info->size - out_offset);
+    }
+
+    /* decompress block */
+    *outsize = (size_t) info->block_size;
+    if (mfu_codec_decompress(info->codec, ibuf, (size_t) inSize, obuf, outsize) != MFU_SUCCESS ||
+        *outsize != expected)
+    {
+        MFU_LOG(MFU_LOG_ERR, "Failed to decompress block %llu of %s",
+            (unsigned long long) block_no, name);
+        return MFU_FAILURE;
+    }
+
+    return MFU_SUCCESS;
+}
+
+/* check that we can decode blocks of a file with the given footer */
+static int mfu_decompress_check_info(const char* name, const mfu_compress_info* info)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* check that we have the codec the file was written with */
+    if (mfu_codec_lookup(info->codec) == NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Source file was compressed with codec %d, which is not available: %s",
+                (int) info->codec, name);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* check that block size is sane before we allocate buffers */
+    if (info->block_size == 0 || info->block_size > MFU_COMPRESS_BLOCK_MAX) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Source file has invalid block size %llu: %s",
+                (unsigned long long) info->block_size, name);
+        }
+        return MFU_FAILURE;
+    }
+
+    return MFU_SUCCESS;
+}
+
+int mfu_decompress_file(const char* src_name, const char* dst_name)
+{
+    int rc = MFU_SUCCESS;
+
+    /* get rank and size of communicator */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* open compressed file for reading */
+    int fd = mfu_open(src_name, O_RDONLY | O_LARGEFILE);
+    if (fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open file for reading: %s errno=%d (%s)",
+            src_name, errno, strerror(errno));
+    }
+
+    /* check that all processes were able to open the file */
+    if (! mfu_alltrue(fd >= 0, MPI_COMM_WORLD)) {
+        if (fd >= 0) {
+            mfu_close(src_name, fd);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* read the footer, a bzip2 file from another tool has none,
+     * but we can still find its blocks */
+    mfu_compress_info info;
+    if (mfu_compress_read_info(src_name, fd, &info) != MFU_SUCCESS) {
+        mfu_close(src_name, fd);
+        if (mfu_bz2_is_stream(src_name)) {
+            return mfu_decompress_bz2_scan(src_name, dst_name);
+        }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Source file is not in block compressed format: %s",
+                src_name);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* check that we can decode its blocks */
+    if (mfu_decompress_check_info(src_name, &info) != MFU_SUCCESS) {
+        mfu_close(src_name, fd);
+        return MFU_FAILURE;
+    }
+
+    /* get stat info to copy to the target */
+    struct stat st;
+    if (rank == 0) {
+        mfu_lstat(src_name, &st);
+    }
+
+    /* open destination file for writing */
+    int fd_out = mfu_create_fully_striped(dst_name, FILE_MODE);
+
+    /* check that all processes were able to open the file */
+    if (! mfu_alltrue(fd_out >= 0, MPI_COMM_WORLD)) {
+        if (fd_out >= 0) {
+            mfu_close(dst_name, fd_out);
+        }
+        mfu_close(src_name, fd);
+        return MFU_FAILURE;
+    }
+
+    mfu_trace_push("decompress");
+
+    /* since any rank can decode any block, give each rank
+     * a contiguous range of blocks so that it reads its part
+     * of the index and the compressed data sequentially */
+    uint64_t base  = info.blocks / (uint64_t) ranks;
+    uint64_t extra = info.blocks % (uint64_t) ranks;
+    uint64_t start = base * (uint64_t) rank + (((uint64_t) rank < extra) ? (uint64_t) rank : extra);
+    uint64_t count = base + (((uint64_t) rank < extra) ? 1 : 0);
+
+    /* read our part of the index */
+    uint64_t* offsets = (uint64_t*) MFU_MALLOC(count * sizeof(uint64_t));
+    uint64_t* lengths = (uint64_t*) MFU_MALLOC(count * sizeof(uint64_t));
+    if (mfu_compress_read_index(src_name, fd, &info, start, count, offsets, lengths) != MFU_SUCCESS) {
+        rc = MFU_FAILURE;
+        count = 0;
+    }
+
+    /* allocate buffers for a compressed and a decompressed block */
+    size_t max_length = mfu_codec_bound(info.codec, (size_t) info.block_size);
+    char* ibuf = (char*) MFU_MALLOC(max_length);
+    char* obuf = (char*) MFU_MALLOC((size_t) info.block_size);
+
+    uint64_t i;
+    for (i = 0; i < count; i++) {
+        /* read and decompress block */
+        uint64_t block_no = start + i;
+        size_t outSize;
+        if (mfu_decompress_block(src_name, fd, &info, block_no, offsets[i], lengths[i],
+            ibuf, obuf, &outSize) != MFU_SUCCESS)
+        {
+            rc = MFU_FAILURE;
+            break;
+        }
+
+        /* write decompressed block to target file */
+        uint64_t out_offset = block_no * info.block_size;
+        ssize_t nwritten = mfu_pwrite(dst_name, fd_out, obuf, outSize, (off_t) out_offset);
+        if (nwritten != (ssize_t) outSize) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to write block in target file: %s offset=%llx got=%lld expected=%llu errno=%d (%s)",
+                dst_name, (unsigned long long) out_offset, (long long) nwritten, (unsigned long long) outSize,
+                errno, strerror(errno));
+            rc = MFU_FAILURE;
+            break;
+        }
+    }
+
+    /* free buffers */
+    mfu_free(&obuf);
+    mfu_free(&ibuf);
+    mfu_free(&lengths);
+    mfu_free(&offsets);
+
+    /* close source and target files */
+    mfu_fsync(dst_name, fd_out);
+    mfu_close(dst_name, fd_out);
+    mfu_close(src_name, fd);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    mfu_compress_set_meta(dst_name, &st);
+
+    mfu_trace_pop();
+
+    /* check that all processes wrote successfully */
+    if (! mfu_alltrue(rc == MFU_SUCCESS, MPI_COMM_WORLD)) {
+        rc = MFU_FAILURE;
+    }
+
+    return rc;
+}
+
+int mfu_decompress_reader_open(const char* name, mfu_decompress_reader* reader)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* mark reader as closed until we succeed */
+    reader->name = NULL;
+
+    /* open compressed file for reading */
+    int fd = mfu_open(name, O_RDONLY | O_LARGEFILE);
+    if (fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open file for reading: %s errno=%d (%s)",
+            name, errno, strerror(errno));
+    }
+    if (! mfu_alltrue(fd >= 0, MPI_COMM_WORLD)) {
+        if (fd >= 0) {
+            mfu_close(name, fd);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* read the footer and check that we can decode its blocks */
+    mfu_compress_info info;
+    if (mfu_compress_read_info(name, fd, &info) != MFU_SUCCESS ||
+        mfu_decompress_check_info(name, &info) != MFU_SUCCESS)
+    {
+        mfu_close(name, fd);
+        return MFU_FAILURE;
+    }
+
+    /* rank 0 reads the full index and sends it to the others */
+    uint64_t* offsets = (uint64_t*) MFU_MALLOC(info.blocks * sizeof(uint64_t));
+    uint64_t* lengths = (uint64_t*) MFU_MALLOC(info.blocks * sizeof(uint64_t));
+    int rc = MFU_SUCCESS;
+    if (rank == 0) {
+        rc = mfu_compress_read_index(name, fd, &info, 0, info.blocks, offsets, lengths);
+    }
+    MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rc != MFU_SUCCESS) {
+        mfu_free(&lengths);
+        mfu_free(&offsets);
+        mfu_close(name, fd);
+        return MFU_FAILURE;
+    }
+    MPI_Bcast(offsets, (int) info.blocks, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    MPI_Bcast(lengths, (int) info.blocks, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    reader->name      = MFU_STRDUP(name);
+    reader->fd        = fd;
+    reader->info      = info;
+    reader->offsets   = offsets;
+    reader->lengths   = lengths;
+    reader->ibuf      = (char*) MFU_MALLOC(mfu_codec_bound(info.codec, (size_t) info.block_size));
+    reader->obuf      = (char*) MFU_MALLOC((size_t) info.block_size);
+    reader->block     = info.blocks;
+    reader->block_len = 0;
+    reader->decoded   = 0;
+
+    return MFU_SUCCESS;
+}
+
+int mfu_decompress_reader_block(mfu_decompress_reader* reader, uint64_t block,
+    const char** data, size_t* size)
+{
+    if (block >= reader->info.blocks) {
+        return MFU_FAILURE;
+    }
+
+    /* decode block unless we have it already */
+    if (reader->block != block) {
+        reader->block = reader->info.blocks;
+        if (mfu_decompress_block(reader->name, reader->fd, &reader->info, block,
+            reader->offsets[block], reader->lengths[block],
+            reader->ibuf, reader->obuf, &reader->block_len) != MFU_SUCCESS)
+        {
+            return MFU_FAILURE;
+        }
+        reader->block = block;
+        reader->decoded++;
+    }
+
+    *data = reader->obuf;
+    *size = reader->block_len;
+    return MFU_SUCCESS;
+}
+
+ssize_t mfu_decompress_reader_pread(mfu_decompress_reader* reader, void* buf,
+    size_t count, uint64_t pos)
+{
+    /* copy bytes from each block that overlaps the range */
+    size_t total = 0;
+    while (total < count && pos < reader->info.size) {
+        uint64_t block = pos / reader->info.block_size;
+        const char* data;
+        size_t size;
+        if (mfu_decompress_reader_block(reader, block, &data, &size) != MFU_SUCCESS) {
+            return -1;
+        }
+
+        size_t start = (size_t) (pos - block * reader->info.block_size);
+        size_t n = size - start;
+        if (n > count - total) {
+            n = count - total;
+        }
+        memcpy((char*) buf + total, data + start, n);
+        total += n;
+        pos   += (uint64_t) n;
+    }
+    return (ssize_t) total;
+}
+
+void mfu_decompress_reader_close(mfu_decompress_reader* reader)
+{
+    if (reader->name == NULL) {
+        return;
+    }
+    mfu_close(reader->name, reader->fd);
+    mfu_free(&reader->obuf);
+    mfu_free(&reader->ibuf);
+    mfu_free(&reader->lengths);
+    mfu_free(&reader->offsets);
+    mfu_free(&reader->name);
+}
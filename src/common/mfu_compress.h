@@ -0,0 +1,179 @@
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MFU_COMPRESS_H
+#define MFU_COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Parallel block compression.
+ *
+ * A file is split into fixed-size blocks that are compressed
+ * independently by different ranks and written back to back,
+ * followed by an index that records the offset and length of each
+ * compressed block and a footer that locates the index:
+ *
+ *   [block 0][block 1]...[block N-1][index][footer]
+ *
+ * Each index entry is two 8-byte values in network order (offset and
+ * length of the compressed block), and the footer is eight 8-byte
+ * values in network order (see mfu_compress_info).  Every block is a
+ * complete stream of its codec, so any rank can decode any block
+ * given the index, and the usual command line tools can decompress
+ * the blocks one after another.  For zstd and lz4, the index and
+ * footer are wrapped in a skippable frame so those tools accept the
+ * whole file.
+ *
+ * Codecs are described in a table in mfu_compress.c, adding one
+ * means adding an entry with functions to bound, compress, and
+ * decompress a single block. */
+
+/* codec used to compress blocks, values are stored in the footer */
+typedef enum {
+    MFU_CODEC_NONE = 0,
+    MFU_CODEC_BZ2  = 1,
+    MFU_CODEC_GZIP = 2,
+    MFU_CODEC_ZSTD = 3,
+    MFU_CODEC_LZ4  = 4,
+} mfu_codec_t;
+
+/* default number of uncompressed bytes in a block */
+#define MFU_COMPRESS_BLOCK_SIZE (4 * 1024 * 1024)
+
+/* describes a file in block format, as recorded in its footer */
+typedef struct {
+    uint64_t index_offset; /* offset of the first index entry */
+    uint64_t blocks;       /* number of blocks */
+    uint64_t block_size;   /* uncompressed size of each block but the last */
+    uint64_t size;         /* uncompressed size of the file */
+    mfu_codec_t codec;     /* codec used to compress blocks */
+    int level;             /* compression level blocks were written with */
+} mfu_compress_info;
+
+/* look up a codec by name ("bz2", "gzip", "zstd", "lz4"),
+ * returns MFU_SUCCESS if it is known and was built in */
+int mfu_codec_parse(const char* name, mfu_codec_t* codec);
+
+/* returns name of codec, or NULL if it was not built in */
+const char* mfu_codec_name(mfu_codec_t codec);
+
+/* returns file extension for codec including the leading dot, e.g., ".zst" */
+const char* mfu_codec_ext(mfu_codec_t codec);
+
+/* returns level used when caller doesn't specify one */
+int mfu_codec_default_level(mfu_codec_t codec);
+
+/* returns max number of bytes needed to compress size bytes into one block */
+size_t mfu_codec_bound(mfu_codec_t codec, size_t size);
+
+/* returns approximate number of bytes of state codec allocates to
+ * compress one block of size bytes at level (-1 for default),
+ * not counting the source and destination buffers */
+size_t mfu_codec_work_size(mfu_codec_t codec, int level, size_t size);
+
+/* compress srclen bytes from src into one block in dst,
+ * dstlen gives the size of dst on input, which should be at least
+ * mfu_codec_bound, and the size of the block on output,
+ * returns MFU_SUCCESS or MFU_FAILURE */
+int mfu_codec_compress(mfu_codec_t codec, int level,
+    const void* src, size_t srclen, void* dst, size_t* dstlen);
+
+/* decompress the block of srclen bytes in src into dst,
+ * dstlen gives the size of dst on input and the number of bytes
+ * decompressed on output, returns MFU_SUCCESS or MFU_FAILURE */
+int mfu_codec_decompress(mfu_codec_t codec,
+    const void* src, size_t srclen, void* dst, size_t* dstlen);
+
+/* called by mfu_compress_stream to fill buf with the len bytes of
+ * the uncompressed stream that start at offset pos,
+ * returns MFU_SUCCESS or MFU_FAILURE */
+typedef int (*mfu_compress_fill_fn)(void* buf, size_t len, uint64_t pos, void* arg);
+
+/* returns number of consecutive blocks each rank compresses in one wave
+ * of mfu_compress_stream for a stream of size bytes, so that block b is
+ * filled by rank (b / count) % ranks, block_size of 0 selects the
+ * default, two waves of compressed blocks and the codec state must fit
+ * in half of mfu_mem_budget, collective */
+uint64_t mfu_compress_wave_blocks(mfu_codec_t codec, int level,
+    size_t block_size, uint64_t size);
+
+/* compress a stream of size bytes into the file open as fd in block
+ * format, starting at offset 0, using codec at level (-1 for default)
+ * with blocks of block_size bytes (0 for default), each rank compresses
+ * wave_blocks blocks per wave (0 for mfu_compress_wave_blocks), fill is
+ * called with arg to get the data of each block in order of increasing
+ * offset on each rank, writes the index and footer, collective */
+int mfu_compress_stream(const char* name, int fd, mfu_codec_t codec, int level,
+    size_t block_size, uint64_t wave_blocks, uint64_t size,
+    mfu_compress_fill_fn fill, void* arg);
+
+/* compress src_name into dst_name in block format using codec at level
+ * (-1 for default) with blocks of block_size bytes (0 for default),
+ * copies mode, owner, and times of source, collective */
+int mfu_compress_file(const char* src_name, const char* dst_name,
+    mfu_codec_t codec, int level, size_t block_size);
+
+/* decompress src_name in block format into dst_name, collective */
+int mfu_decompress_file(const char* src_name, const char* dst_name);
+
+/* read footer of file open as fd, returns MFU_SUCCESS and fills
+ * in info if the file is in block format, collective */
+int mfu_compress_read_info(const char* name, int fd, mfu_compress_info* info);
+
+/* read count index entries starting with block start into
+ * offsets and lengths, converted to host order */
+int mfu_compress_read_index(const char* name, int fd, const mfu_compress_info* info,
+    uint64_t start, uint64_t count, uint64_t* offsets, uint64_t* lengths);
+
+/* write index and footer of file open as fd starting at
+ * info->index_offset, which is where the compressed data ends,
+ * each rank gives the ids, offsets, and lengths of the count blocks it
+ * wrote, all other fields of info must be the same on all ranks,
+ * collective */
+int mfu_compress_write_index(const char* name, int fd, const mfu_compress_info* info,
+    uint64_t count, const uint64_t* ids, const uint64_t* offsets, const uint64_t* lengths);
+
+/* reads the uncompressed data of a file in block format at any offset,
+ * decoding only the blocks that hold the bytes being read, the last
+ * block decoded is kept so nearby reads don't decode it again */
+typedef struct {
+    char* name;             /* name of compressed file */
+    int fd;                 /* compressed file open for reading */
+    mfu_compress_info info; /* footer of compressed file */
+    uint64_t* offsets;      /* offset of each compressed block */
+    uint64_t* lengths;      /* length of each compressed block */
+    char* ibuf;             /* buffer to read a compressed block */
+    char* obuf;             /* buffer holding the last decoded block */
+    uint64_t block;         /* id of block in obuf, info.blocks if none */
+    size_t block_len;       /* number of bytes in obuf */
+    uint64_t decoded;       /* number of blocks decoded so far */
+} mfu_decompress_reader;
+
+/* open name in block format for reading with reader, returns MFU_FAILURE
+ * if the file is not in block format or can't be decoded, collective */
+int mfu_decompress_reader_open(const char* name, mfu_decompress_reader* reader);
+
+/* decode block and set *data and *size to its uncompressed bytes,
+ * which stay valid until the next call with reader */
+int mfu_decompress_reader_block(mfu_decompress_reader* reader, uint64_t block,
+    const char** data, size_t* size);
+
+/* read up to count bytes of uncompressed data starting at pos into buf,
+ * returns number of bytes read, which is less than count at the end
+ * of the data, or -1 on error */
+ssize_t mfu_decompress_reader_pread(mfu_decompress_reader* reader, void* buf,
+    size_t count, uint64_t pos);
+
+/* close file and free buffers of reader */
+void mfu_decompress_reader_close(mfu_decompress_reader* reader);
+
+#endif /* MFU_COMPRESS_H */
+
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -151,46 +151,38 @@ static void DBz2_Dequeue(CIRCLE_handle* handle)
     mfu_free(&ibuf);
 }
 
-static void find_wave_size(int64_t size, int opts_memory)
+static void find_wave_size(int64_t size, ssize_t opts_memory)
 {
-    /* get process memory limit from rlimit, if one is set */
-    struct rlimit limit;
-    getrlimit(RLIMIT_DATA, &limit);
-    MFU_LOG(MFU_LOG_INFO, "The limit is %lld %lld\n", (long long)limit.rlim_cur, (long long)limit.rlim_max);
-
-    /* identify free memory on the node */
-    struct sysinfo info;
-    sysinfo(&info);
-    MFU_LOG(MFU_LOG_INFO, "The free and total ram are:%lu,%lu", info.freeram, info.totalram);
-    MFU_LOG(MFU_LOG_INFO, "The block size is:%" PRId64, size);
-
-    /* TODO: what about other procs on the same node? */
-
-    /* set our memory limit to minimum of rlimit and free memory */
-    int64_t mem_limit = info.freeram;
-    if ((unsigned long)limit.rlim_cur < info.freeram) {
-        mem_limit = (int64_t)limit.rlim_cur;
-    }
+    /* get memory we may use, this accounts for cgroup limits,
+     * other procs on the node, and rlimits */
+    int64_t mem_limit = (int64_t) mfu_mem_budget(MPI_COMM_WORLD);
 
     /* go lower still if user gave us a lower limit */
-    if (opts_memory > 0 && opts_memory < mem_limit) {
+    if (opts_memory > 0 && (int64_t)opts_memory < mem_limit) {
         mem_limit = (int64_t)opts_memory;
     }
+    MFU_LOG(MFU_LOG_DBG, "Memory budget %lld bytes, block size %" PRId64,
+        (long long)mem_limit, size);
+
+    /* 8*size + 400*1024 is the memory required to do compression,
+     * the block itself must be in memory before compression,
+     * and we keep two block_info structs for each block in the file */
+    int64_t fixed = 8 * size + 400 * 1024 + size + 2 * tot_blocks * (int64_t)sizeof(struct block_info);
+    blocks_pn_pw = 1;
+    if (mem_limit > fixed) {
+        blocks_pn_pw = (mem_limit - fixed) / comp_buff_size;
+    }
 
-    /* memory is computed as the mem_limit is max memory for a process.
-     * We leave 2% of totalram free, then 8*size +400*1024 is the
-     * memory required to do compression, keep 128B for variables,etc.
-     * The block itself must be in memory before compression. */
-    int64_t wave_size_approx = mem_limit - (int64_t)info.totalram * 2 / 100 - 8 * size - 400 * 1024 - 128 - size;
-    int64_t wave_size = wave_size_approx - 2 * tot_blocks * sizeof(struct block_info);
-    blocks_pn_pw = (int64_t)(0.4 * wave_size / comp_buff_size);
-    if (blocks_pn_pw > 800) {
-        blocks_pn_pw = 800;
+    /* no need for a wave larger than the file */
+    if (blocks_pn_pw > tot_blocks) {
+        blocks_pn_pw = tot_blocks;
+    }
+    if (blocks_pn_pw < 1) {
+        blocks_pn_pw = 1;
     }
-    //int blocks_n_w=(int)blocks_pn_pw;
 
     /* find minimum across all processes */
-    MPI_Allreduce(&blocks_pn_pw, &wave_blocks, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    MPI_Allreduce(&blocks_pn_pw, &wave_blocks, 1, MPI_INT64_T, MPI_MIN, MPI_COMM_WORLD);
 }
 
 int mfu_compress_bz2_libcircle(const char* src, const char* dst, int b_size, ssize_t opts_memory)
@@ -335,7 +327,7 @@ int mfu_compress_bz2_libcircle(const char* src, const char* dst, int b_size, ssi
     MPI_Type_create_struct(3, blockcounts, offsets, oldtypes, &metatype);
     MPI_Type_commit(&metatype);
 
-    struct block_info rbuf[wave_blocks];
+    struct block_info* rbuf = (struct block_info*)MFU_MALLOC(sizeof(struct block_info) * wave_blocks);
 
     /* allocate a compression buffer for each block */
     a = (char**)MFU_MALLOC(sizeof(char*) * wave_blocks);
@@ -397,7 +389,7 @@ int mfu_compress_bz2_libcircle(const char* src, const char* dst, int b_size, ssi
         }
 
         /* provide info about the offset of coressponding blocks to process that processed it */
-        MPI_Scatterv(&rbuf, rcount, displs, metatype, &my_blocks[my_prev_blocks], blocks_processed, metatype, 0, MPI_COMM_WORLD);
+        MPI_Scatterv(rbuf, rcount, displs, metatype, &my_blocks[my_prev_blocks], blocks_processed, metatype, 0, MPI_COMM_WORLD);
 
         /* Each process writes out the blocks it processed in current wave at the correct offset */
         for (int k = 0; k < blocks_processed; k++) {
@@ -503,6 +495,7 @@ int mfu_compress_bz2_libcircle(const char* src, const char* dst, int b_size, ssi
     MPI_Barrier(MPI_COMM_WORLD);
 
     /* free memory for compress blocks */
+    mfu_free(&rbuf);
     mfu_free(&this_wave_blocks);
     mfu_free(&my_blocks);
 
@@ -0,0 +1,619 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define _LARGEFILE64_SOURCE
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <bzlib.h>
+#include <errno.h>
+
+#include "mpi.h"
+#include "mfu.h"
+#include "mfu_bz2.h"
+
+/* Parallel decompression of bzip2 files written by other tools.
+ *
+ * A bzip2 stream is a 4-byte header ("BZh" and a level digit)
+ * followed by blocks that each start with a 48-bit magic value and the
+ * CRC of the block, and ends with another 48-bit magic and the CRC of
+ * the stream.  Blocks are not byte aligned, so each rank searches its
+ * part of the file for the two magic values at every bit offset.  The
+ * bits of each block, from its magic up to the next magic, are then
+ * wrapped in a header and end of stream marker to form a stream of one
+ * block, which any rank can decompress on its own.  Output offsets come
+ * from a prefix sum of the decompressed sizes.
+ *
+ * The magic values may also occur by chance in compressed data.  A
+ * block split at such a place fails its CRC check, in which case we
+ * fall back to decompressing the whole file on rank 0. */
+
+#define FILE_MODE (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)
+
+/* magic values that start a block and end a stream */
+#define BZ2_BLOCK_MAGIC  (0x314159265359ULL)
+#define BZ2_EOS_MAGIC    (0x177245385090ULL)
+#define BZ2_MAGIC_MASK   (0xffffffffffffULL)
+#define BZ2_MAGIC_BYTES  (6)
+
+/* size of the stream header "BZh9" */
+#define BZ2_HEADER_BYTES (4)
+
+/* bytes each rank reads at a time while searching for blocks */
+#define BZ2_SCAN_BUFSIZE (4 * 1024 * 1024)
+
+/* number of blocks each rank decompresses in one wave */
+#define BZ2_WAVE_BLOCKS (16)
+
+/* a block decompresses to at most 900000 bytes after the initial run
+ * length encoding, each 5 bytes of which expand to at most 259 */
+#define BZ2_OUTPUT_MAX (900000 / 5 * 259)
+
+/* returns 1 if the file open as fd starts with a bzip2 stream header */
+static int bz2_has_header(const char* name, int fd)
+{
+    unsigned char header[BZ2_HEADER_BYTES];
+    ssize_t nread = mfu_pread(name, fd, header, sizeof(header), 0);
+    return (nread == (ssize_t) sizeof(header) &&
+        header[0] == 'B' && header[1] == 'Z' && header[2] == 'h' &&
+        header[3] >= '1' && header[3] <= '9');
+}
+
+int mfu_bz2_is_stream(const char* name)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int is_stream = 0;
+    if (rank == 0) {
+        int fd = mfu_open(name, O_RDONLY | O_LARGEFILE);
+        if (fd >= 0) {
+            is_stream = bz2_has_header(name, fd);
+            mfu_close(name, fd);
+        }
+    }
+    MPI_Bcast(&is_stream, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return is_stream;
+}
+
+/* Search bytes [start, start+count) of the file for the bit offsets
+ * of the magic values that begin there, records each as twice its bit
+ * offset, plus one for the end of a stream, in a newly allocated list */
+static int bz2_find_magic(
+    const char* name,
+    int fd,
+    uint64_t file_size,
+    uint64_t start,
+    uint64_t count,
+    uint64_t* out_num,
+    uint64_t** out_marks)
+{
+    int rc = MFU_SUCCESS;
+
+    uint64_t num = 0;
+    uint64_t max = 1024;
+    uint64_t* marks = (uint64_t*) MFU_MALLOC(max * sizeof(uint64_t));
+
+    /* read a few bytes past each piece to find a magic that starts
+     * at its end */
+    size_t bufsize = BZ2_SCAN_BUFSIZE + BZ2_MAGIC_BYTES;
+    unsigned char* buf = (unsigned char*) MFU_MALLOC(bufsize);
+
+    uint64_t end = start + count;
+    uint64_t pos = start;
+    while (pos < end) {
+        uint64_t piece = end - pos;
+        if (piece > BZ2_SCAN_BUFSIZE) {
+            piece = BZ2_SCAN_BUFSIZE;
+        }
+        uint64_t len = piece + BZ2_MAGIC_BYTES;
+        if (len > file_size - pos) {
+            len = file_size - pos;
+        }
+
+        ssize_t nread = mfu_pread(name, fd, buf, (size_t) len, (off_t) pos);
+        if (nread != (ssize_t) len) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to read source file: %s offset=%llu errno=%d (%s)",
+                name, (unsigned long long) pos, errno, strerror(errno));
+            rc = MFU_FAILURE;
+            break;
+        }
+
+        /* shift each byte into a window and test the 48 bits ending
+         * at each of its 8 bit positions, from the highest to keep
+         * the offsets in order */
+        uint64_t window = 0;
+        uint64_t limit = piece * 8;
+        uint64_t i;
+        for (i = 0; i < len; i++) {
+            window = (window << 8) | buf[i];
+            if (i + 1 < BZ2_MAGIC_BYTES) {
+                continue;
+            }
+            int shift;
+            for (shift = 7; shift >= 0; shift--) {
+                /* skip magic values that would start before this piece */
+                if ((i + 1) * 8 < (uint64_t) shift + 48) {
+                    continue;
+                }
+                uint64_t bit = (i + 1) * 8 - (uint64_t) shift - 48;
+                if (bit >= limit) {
+                    continue;
+                }
+                uint64_t value = (window >> shift) & BZ2_MAGIC_MASK;
+                if (value == BZ2_BLOCK_MAGIC || value == BZ2_EOS_MAGIC) {
+                    if (num == max) {
+                        max *= 2;
+                        marks = (uint64_t*) realloc(marks, max * sizeof(uint64_t));
+                        if (marks == NULL) {
+                            MFU_ABORT(-1, "Failed to allocate list of bzip2 blocks");
+                        }
+                    }
+                    uint64_t offset = pos * 8 + bit;
+                    marks[num] = offset * 2 + (value == BZ2_EOS_MAGIC);
+                    num++;
+                }
+            }
+        }
+
+        pos += piece;
+    }
+
+    mfu_free(&buf);
+
+    *out_num   = num;
+    *out_marks = marks;
+    return rc;
+}
+
+/* gather the lists of marks from all ranks in rank order,
+ * which sorts them by offset */
+static void bz2_gather_marks(
+    uint64_t num,
+    uint64_t* marks,
+    uint64_t* out_total,
+    uint64_t** out_all)
+{
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    int* counts = (int*) MFU_MALLOC(ranks * sizeof(int));
+    int* disps  = (int*) MFU_MALLOC(ranks * sizeof(int));
+
+    int num_int = (int) num;
+    MPI_Allgather(&num_int, 1, MPI_INT, counts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    uint64_t total = 0;
+    int i;
+    for (i = 0; i < ranks; i++) {
+        disps[i] = (int) total;
+        total += (uint64_t) counts[i];
+    }
+
+    uint64_t* all = (uint64_t*) MFU_MALLOC((total + 1) * sizeof(uint64_t));
+    MPI_Allgatherv(marks, num_int, MPI_UINT64_T,
+        all, counts, disps, MPI_UINT64_T, MPI_COMM_WORLD);
+
+    mfu_free(&counts);
+    mfu_free(&disps);
+
+    *out_total = total;
+    *out_all   = all;
+}
+
+/* returns n bits of buf starting at bit offset bit, n <= 32 */
+static uint32_t bz2_get_bits(const unsigned char* buf, uint64_t bit, int n)
+{
+    uint32_t value = 0;
+    int i;
+    for (i = 0; i < n; i++) {
+        uint64_t b = bit + (uint64_t) i;
+        value = (value << 1) | ((buf[b / 8] >> (7 - b % 8)) & 1);
+    }
+    return value;
+}
+
+/* writes the low n bits of value to buf at bit offset bit */
+static void bz2_put_bits(unsigned char* buf, uint64_t bit, uint64_t value, int n)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        uint64_t b = bit + (uint64_t) i;
+        unsigned char mask = (unsigned char) (1 << (7 - b % 8));
+        if ((value >> (n - 1 - i)) & 1) {
+            buf[b / 8] |= mask;
+        } else {
+            buf[b / 8] &= (unsigned char) ~mask;
+        }
+    }
+}
+
+/* read the block between bit offsets start and end and decompress it
+ * into a newly allocated buffer */
+static int bz2_decompress_block(
+    const char* name,
+    int fd,
+    uint64_t file_size,
+    uint64_t start,
+    uint64_t end,
+    char** out_buf,
+    size_t* out_size)
+{
+    /* read the bytes that hold the block, and one more so we can
+     * shift bits from the next byte while copying */
+    uint64_t first = start / 8;
+    uint64_t last  = (end + 7) / 8 + 1;
+    if (last > file_size) {
+        last = file_size;
+    }
+    size_t len = (size_t) (last - first);
+    unsigned char* in = (unsigned char*) MFU_MALLOC(len + 1);
+    in[len] = 0;
+    ssize_t nread = mfu_pread(name, fd, in, len, (off_t) first);
+    if (nread != (ssize_t) len) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to read block from source file: %s offset=%llu errno=%d (%s)",
+            name, (unsigned long long) first, errno, strerror(errno));
+        mfu_free(&in);
+        return MFU_FAILURE;
+    }
+
+    /* build a stream of one block, the header uses the largest level
+     * since that only sets an upper bound on the block size */
+    uint64_t nbits = end - start;
+    size_t stream_size = BZ2_HEADER_BYTES + (size_t) ((nbits + 7) / 8) + 11;
+    unsigned char* stream = (unsigned char*) MFU_MALLOC(stream_size);
+    memset(stream, 0, stream_size);
+    memcpy(stream, "BZh9", BZ2_HEADER_BYTES);
+
+    /* copy block bits a byte at a time, the bits past the end
+     * of the block are overwritten by the end of stream marker */
+    int shift = (int) (start % 8);
+    size_t nbytes = (size_t) ((nbits + 7) / 8);
+    size_t i;
+    for (i = 0; i < nbytes; i++) {
+        unsigned int hi = in[i];
+        unsigned int lo = (i + 1 < len) ? in[i + 1] : 0;
+        stream[BZ2_HEADER_BYTES + i] = (unsigned char) ((hi << shift) | (shift ? (lo >> (8 - shift)) : 0));
+    }
+
+    /* a stream of one block has the CRC of its block as its CRC */
+    uint32_t crc = bz2_get_bits(in, (uint64_t) shift + 48, 32);
+    uint64_t bit = BZ2_HEADER_BYTES * 8 + nbits;
+    bz2_put_bits(stream, bit, BZ2_EOS_MAGIC, 48);
+    bz2_put_bits(stream, bit + 48, crc, 32);
+    bit += 80;
+    unsigned int stream_len = (unsigned int) ((bit + 7) / 8);
+    if (bit % 8) {
+        bz2_put_bits(stream, bit, 0, (int) (8 - bit % 8));
+    }
+
+    mfu_free(&in);
+
+    /* decompress into a buffer of the largest size a block can expand to,
+     * then trim it to what the block actually held */
+    int rc = MFU_SUCCESS;
+    unsigned int size = BZ2_OUTPUT_MAX;
+    char* buf = (char*) MFU_MALLOC(size);
+    int ret = BZ2_bzBuffToBuffDecompress(buf, &size, (char*) stream, stream_len, 0, 0);
+    if (ret == BZ_OK) {
+        if (size == 0) {
+            mfu_free(&buf);
+        } else {
+            char* trimmed = (char*) realloc(buf, size);
+            if (trimmed != NULL) {
+                buf = trimmed;
+            }
+        }
+        *out_size = (size_t) size;
+    } else {
+        mfu_free(&buf);
+        rc = MFU_FAILURE;
+    }
+
+    mfu_free(&stream);
+
+    *out_buf = buf;
+    return rc;
+}
+
+/* decompress all streams in the file on rank 0 with the bzip2 library,
+ * used when blocks can't be decompressed on their own */
+static int bz2_decompress_serial(const char* src_name, int fd, const char* dst_name, int fd_out)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int rc = MFU_SUCCESS;
+    if (rank == 0) {
+        size_t bufsize = BZ2_SCAN_BUFSIZE;
+        char* ibuf = (char*) MFU_MALLOC(bufsize);
+        char* obuf = (char*) MFU_MALLOC(bufsize);
+
+        bz_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        int ret = BZ2_bzDecompressInit(&strm, 0, 0);
+        int open = (ret == BZ_OK);
+        if (! open) {
+            rc = MFU_FAILURE;
+        }
+
+        off_t pos_in  = 0;
+        off_t pos_out = 0;
+        int eof = 0;
+        while (rc == MFU_SUCCESS) {
+            /* refill input */
+            if (strm.avail_in == 0 && ! eof) {
+                ssize_t nread = mfu_pread(src_name, fd, ibuf, bufsize, pos_in);
+                if (nread < 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to read source file: %s errno=%d (%s)",
+                        src_name, errno, strerror(errno));
+                    rc = MFU_FAILURE;
+                    break;
+                }
+                eof = (nread == 0);
+                pos_in += nread;
+                strm.next_in  = ibuf;
+                strm.avail_in = (unsigned int) nread;
+            }
+
+            /* the previous stream ended, start the next if there is more data */
+            if (! open) {
+                if (strm.avail_in == 0 && eof) {
+                    break;
+                }
+                char* next_in = strm.next_in;
+                unsigned int avail_in = strm.avail_in;
+                memset(&strm, 0, sizeof(strm));
+                if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) {
+                    rc = MFU_FAILURE;
+                    break;
+                }
+                strm.next_in  = next_in;
+                strm.avail_in = avail_in;
+                open = 1;
+            }
+
+            strm.next_out  = obuf;
+            strm.avail_out = (unsigned int) bufsize;
+            ret = BZ2_bzDecompress(&strm);
+            if (ret != BZ_OK && ret != BZ_STREAM_END) {
+                MFU_LOG(MFU_LOG_ERR, "Error in decompression: %s (%d)", src_name, ret);
+                rc = MFU_FAILURE;
+                break;
+            }
+
+            /* write what we got */
+            size_t have = bufsize - strm.avail_out;
+            if (have > 0) {
+                ssize_t nwrite = mfu_pwrite(dst_name, fd_out, obuf, have, pos_out);
+                if (nwrite != (ssize_t) have) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to write target file: %s errno=%d (%s)",
+                        dst_name, errno, strerror(errno));
+                    rc = MFU_FAILURE;
+                    break;
+                }
+                pos_out += nwrite;
+            }
+
+            if (ret == BZ_STREAM_END) {
+                BZ2_bzDecompressEnd(&strm);
+                open = 0;
+            } else if (eof && strm.avail_in == 0 && have == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Unexpected end of source file: %s", src_name);
+                rc = MFU_FAILURE;
+                break;
+            }
+        }
+        if (open) {
+            BZ2_bzDecompressEnd(&strm);
+        }
+
+        mfu_free(&ibuf);
+        mfu_free(&obuf);
+    }
+
+    MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return rc;
+}
+
+int mfu_decompress_bz2_scan(const char* src_name, const char* dst_name)
+{
+    int rc = MFU_SUCCESS;
+
+    /* get rank and size of communicator */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* open compressed file for reading */
+    int fd = mfu_open(src_name, O_RDONLY | O_LARGEFILE);
+    if (fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open file for reading: %s errno=%d (%s)",
+            src_name, errno, strerror(errno));
+    }
+
+    /* check that all processes were able to open the file */
+    if (! mfu_alltrue(fd >= 0, MPI_COMM_WORLD)) {
+        if (fd >= 0) {
+            mfu_close(src_name, fd);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* have rank 0 check the header and get the file size */
+    uint64_t file_size = 0;
+    struct stat st;
+    if (rank == 0) {
+        if (bz2_has_header(src_name, fd) && fstat(fd, &st) == 0) {
+            file_size = (uint64_t) st.st_size;
+        }
+    }
+    MPI_Bcast(&file_size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    if (file_size == 0) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Source file does not seem to be a bzip2 file: %s",
+                src_name);
+        }
+        mfu_close(src_name, fd);
+        return MFU_FAILURE;
+    }
+
+    /* open destination file for writing */
+    int fd_out = mfu_create_fully_striped(dst_name, FILE_MODE);
+
+    /* check that all processes were able to open the file */
+    if (! mfu_alltrue(fd_out >= 0, MPI_COMM_WORLD)) {
+        if (fd_out >= 0) {
+            mfu_close(dst_name, fd_out);
+        }
+        mfu_close(src_name, fd);
+        return MFU_FAILURE;
+    }
+
+    /* search our part of the file for blocks */
+    uint64_t start, count;
+    mfu_get_start_count(rank, ranks, file_size, &start, &count);
+    uint64_t num;
+    uint64_t* marks;
+    rc = bz2_find_magic(src_name, fd, file_size, start, count, &num, &marks);
+    if (! mfu_alltrue(rc == MFU_SUCCESS, MPI_COMM_WORLD)) {
+        mfu_free(&marks);
+        mfu_close(dst_name, fd_out);
+        mfu_close(src_name, fd);
+        return MFU_FAILURE;
+    }
+
+    /* build the block table, each block ends where the next
+     * block or the end of its stream starts */
+    uint64_t total;
+    uint64_t* all;
+    bz2_gather_marks(num, marks, &total, &all);
+    mfu_free(&marks);
+
+    uint64_t blocks = 0;
+    uint64_t* starts = (uint64_t*) MFU_MALLOC((total + 1) * sizeof(uint64_t));
+    uint64_t* ends   = (uint64_t*) MFU_MALLOC((total + 1) * sizeof(uint64_t));
+    int parallel = (total > 0);
+    uint64_t i;
+    for (i = 0; i < total; i++) {
+        if (all[i] & 1) {
+            /* end of a stream */
+            continue;
+        }
+        if (i + 1 == total) {
+            /* the last block has no end, the file is truncated or
+             * the magic we found is not really a block */
+            parallel = 0;
+            break;
+        }
+        starts[blocks] = all[i] / 2;
+        ends[blocks]   = all[i + 1] / 2;
+        blocks++;
+    }
+    mfu_free(&all);
+
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Found %llu bzip2 blocks in %s",
+            (unsigned long long) blocks, src_name);
+    }
+
+    /* decompress blocks in waves, each rank holds the output of its
+     * blocks until the prefix sum gives their offsets */
+    uint64_t wave_blocks = (uint64_t) ranks * BZ2_WAVE_BLOCKS;
+    char* bufs[BZ2_WAVE_BLOCKS];
+    size_t sizes[BZ2_WAVE_BLOCKS];
+    uint64_t wave_offset = 0;
+    uint64_t wave_start;
+    for (wave_start = 0; wave_start < blocks && parallel; wave_start += wave_blocks) {
+        int ok = 1;
+        uint64_t bytes = 0;
+        int k;
+        for (k = 0; k < BZ2_WAVE_BLOCKS; k++) {
+            bufs[k]  = NULL;
+            sizes[k] = 0;
+            uint64_t b = wave_start + (uint64_t) rank * BZ2_WAVE_BLOCKS + (uint64_t) k;
+            if (b >= blocks || ! ok) {
+                continue;
+            }
+            if (bz2_decompress_block(src_name, fd, file_size, starts[b], ends[b], &bufs[k], &sizes[k]) != MFU_SUCCESS) {
+                ok = 0;
+                continue;
+            }
+            bytes += sizes[k];
+        }
+
+        /* if any block fails to decompress, fall back to a serial pass */
+        if (! mfu_alltrue(ok, MPI_COMM_WORLD)) {
+            parallel = 0;
+        } else {
+            /* compute offset of our output and the size of the wave */
+            uint64_t offset = 0;
+            MPI_Exscan(&bytes, &offset, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+            if (rank == 0) {
+                offset = 0;
+            }
+            uint64_t wave_bytes;
+            MPI_Allreduce(&bytes, &wave_bytes, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+            offset += wave_offset;
+            for (k = 0; k < BZ2_WAVE_BLOCKS; k++) {
+                if (sizes[k] == 0) {
+                    continue;
+                }
+                ssize_t nwrite = mfu_pwrite(dst_name, fd_out, bufs[k], sizes[k], (off_t) offset);
+                if (nwrite != (ssize_t) sizes[k]) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to write target file: %s offset=%llu errno=%d (%s)",
+                        dst_name, (unsigned long long) offset, errno, strerror(errno));
+                    rc = MFU_FAILURE;
+                }
+                offset += sizes[k];
+            }
+            wave_offset += wave_bytes;
+        }
+
+        for (k = 0; k < BZ2_WAVE_BLOCKS; k++) {
+            mfu_free(&bufs[k]);
+        }
+    }
+
+    mfu_free(&starts);
+    mfu_free(&ends);
+
+    if (parallel) {
+        if (! mfu_alltrue(rc == MFU_SUCCESS, MPI_COMM_WORLD)) {
+            rc = MFU_FAILURE;
+        }
+    } else {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Could not split %s into blocks, decompressing with one process",
+                src_name);
+            mfu_ftruncate(fd_out, 0);
+        }
+        rc = bz2_decompress_serial(src_name, fd, dst_name, fd_out);
+    }
+
+    /* close source and target files */
+    mfu_fsync(dst_name, fd_out);
+    mfu_close(dst_name, fd_out);
+    mfu_close(src_name, fd);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    /* have rank 0 set meta data on target file */
+    if (rank == 0) {
+        mfu_chmod(dst_name, st.st_mode);
+        mfu_lchown(dst_name, st.st_uid, st.st_gid);
+
+        struct utimbuf uTimBuf;
+        uTimBuf.actime  = st.st_atime;
+        uTimBuf.modtime = st.st_mtime;
+        utime(dst_name, &uTimBuf);
+    }
+
+    return rc;
+}
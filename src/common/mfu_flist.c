@@ -125,7 +125,7 @@ static size_t list_elem_pack2_size(int detail, uint64_t chars, const elem_t* ele
 {
     size_t size;
     if (detail) {
-        size = 2 * 4 + chars + 0 * 4 + 10 * 8;
+        size = 2 * 4 + chars + 0 * 4 + 13 * 8;
     }
     else {
         size = 2 * 4 + chars + 1 * 4;
@@ -178,6 +178,9 @@ static size_t list_elem_pack2(void* buf, int detail, uint64_t chars, const elem_
         mfu_pack_uint64(&ptr, elem->ctime);
         mfu_pack_uint64(&ptr, elem->ctime_nsec);
         mfu_pack_uint64(&ptr, elem->size);
+        mfu_pack_uint64(&ptr, elem->dev);
+        mfu_pack_uint64(&ptr, elem->ino);
+        mfu_pack_uint64(&ptr, elem->nlink);
     }
     else {
         /* just have the file type */
@@ -233,6 +236,9 @@ static size_t list_elem_unpack2(const void* buf, elem_t* elem)
         mfu_unpack_uint64(&ptr, &elem->ctime);
         mfu_unpack_uint64(&ptr, &elem->ctime_nsec);
         mfu_unpack_uint64(&ptr, &elem->size);
+        mfu_unpack_uint64(&ptr, &elem->dev);
+        mfu_unpack_uint64(&ptr, &elem->ino);
+        mfu_unpack_uint64(&ptr, &elem->nlink);
         /* use mode to set file type */
         elem->type = mfu_flist_mode_to_filetype((mode_t)elem->mode);
     }
@@ -241,6 +247,9 @@ static size_t list_elem_unpack2(const void* buf, elem_t* elem)
         uint32_t type;
         mfu_unpack_uint32(&ptr, &type);
         elem->type = (mfu_filetype) type;
+        elem->dev   = 0;
+        elem->ino   = 0;
+        elem->nlink = 0;
     }
 
     size_t bytes = (size_t)(ptr - start);
@@ -346,6 +355,9 @@ static void list_insert_copy(flist_t* flist, elem_t* src)
     elem->ctime      = src->ctime;
     elem->ctime_nsec = src->ctime_nsec;
     elem->size       = src->size;
+    elem->dev        = src->dev;
+    elem->ino        = src->ino;
+    elem->nlink      = src->nlink;
 
     /* append element to tail of linked list */
     mfu_flist_insert_elem(flist, elem);
@@ -389,11 +401,17 @@ void mfu_flist_insert_stat(flist_t* flist, const char* fpath, mode_t mode, const
         elem->ctime_nsec = nsecs;
 
         elem->size  = (uint64_t) sb->st_size;
+        elem->dev   = (uint64_t) sb->st_dev;
+        elem->ino   = (uint64_t) sb->st_ino;
+        elem->nlink = (uint64_t) sb->st_nlink;
 
         /* TODO: link to user and group names? */
     }
     else {
         elem->detail = 0;
+        elem->dev    = 0;
+        elem->ino    = 0;
+        elem->nlink  = 0;
     }
 
     /* append element to tail of linked list */
@@ -517,8 +535,12 @@ static void list_compute_summary(flist_t* flist)
     flist->min_depth = global_min_depth;
     flist->max_depth = global_max_depth;
 
-    /* set summary on users and groups */
+    /* set summary on users and groups, looking up
+     * names of any ids we have not seen before */
     if (flist->detail) {
+        if (flist->have_users && flist->have_groups) {
+            mfu_flist_usrgrp_resolve(flist);
+        }
         flist->total_users    = flist->users.count;
         flist->total_groups   = flist->groups.count;
         flist->max_user_name  = flist->users.chars;
@@ -987,6 +1009,39 @@ uint64_t mfu_flist_file_get_size(mfu_flist bflist, uint64_t idx)
     return ret;
 }
 
+uint64_t mfu_flist_file_get_dev(mfu_flist bflist, uint64_t idx)
+{
+    uint64_t ret = (uint64_t) - 1;
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL && flist->detail) {
+        ret = elem->dev;
+    }
+    return ret;
+}
+
+uint64_t mfu_flist_file_get_ino(mfu_flist bflist, uint64_t idx)
+{
+    uint64_t ret = (uint64_t) - 1;
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL && flist->detail) {
+        ret = elem->ino;
+    }
+    return ret;
+}
+
+uint64_t mfu_flist_file_get_nlink(mfu_flist bflist, uint64_t idx)
+{
+    uint64_t ret = (uint64_t) - 1;
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL && flist->detail) {
+        ret = elem->nlink;
+    }
+    return ret;
+}
+
 const char* mfu_flist_file_get_username(mfu_flist bflist, uint64_t idx)
 {
     const char* ret = NULL;
@@ -1171,6 +1226,36 @@ void mfu_flist_file_set_size(mfu_flist bflist, uint64_t idx, uint64_t size)
     return;
 }
 
+void mfu_flist_file_set_dev(mfu_flist bflist, uint64_t idx, uint64_t dev)
+{
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL) {
+        elem->dev = dev;
+    }
+    return;
+}
+
+void mfu_flist_file_set_ino(mfu_flist bflist, uint64_t idx, uint64_t ino)
+{
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL) {
+        elem->ino = ino;
+    }
+    return;
+}
+
+void mfu_flist_file_set_nlink(mfu_flist bflist, uint64_t idx, uint64_t nlink)
+{
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL) {
+        elem->nlink = nlink;
+    }
+    return;
+}
+
 mfu_flist mfu_flist_subset(mfu_flist src)
 {
     /* allocate a new file list */
@@ -1353,6 +1438,9 @@ uint64_t mfu_flist_file_create(mfu_flist bflist)
     elem->ctime      = 0;
     elem->ctime_nsec = 0;
     elem->size       = 0;
+    elem->dev        = 0;
+    elem->ino        = 0;
+    elem->nlink      = 0;
 
     /* for DAOS */
 #ifdef DAOS_SUPPORT
@@ -1612,6 +1700,315 @@ mfu_flist mfu_flist_spread(mfu_flist flist)
     return newlist;
 }
 
+/* return rank that holds the table entry for key in mfu_release_register */
+int mfu_release_key_rank(const char* key, int ranks)
+{
+    size_t len = strlen(key);
+    uint32_t hash = mfu_hash_jenkins(key, len);
+    return (int)(hash % (uint32_t)ranks);
+}
+
+void mfu_release_init(mfu_release_t* rel, uint64_t size)
+{
+    MPI_Comm_dup(MPI_COMM_WORLD, &rel->comm);
+    MPI_Comm_rank(rel->comm, &rel->rank);
+    MPI_Comm_size(rel->comm, &rel->ranks);
+
+    rel->ready       = (uint64_t*)  MFU_MALLOC(size * sizeof(uint64_t));
+    rel->ready_count = 0;
+    rel->out         = (uint64_t**) MFU_CALLOC((size_t)rel->ranks, sizeof(uint64_t*));
+    rel->out_count   = (uint64_t*)  MFU_CALLOC((size_t)rel->ranks, sizeof(uint64_t));
+    rel->out_max     = (uint64_t*)  MFU_CALLOC((size_t)rel->ranks, sizeof(uint64_t));
+    rel->reqs        = NULL;
+    rel->bufs        = NULL;
+    rel->reqs_count  = 0;
+    rel->reqs_max    = 0;
+    rel->recv        = NULL;
+    rel->recv_max    = 0;
+    rel->deps_start  = NULL;
+    rel->deps        = NULL;
+}
+
+/* copy buffer of old_size bytes into a new one of new_size bytes */
+static void* release_grow(void* buf, size_t old_size, size_t new_size)
+{
+    void* newbuf = MFU_MALLOC(new_size);
+    if (old_size > 0) {
+        memcpy(newbuf, buf, old_size);
+    }
+    mfu_free(&buf);
+    return newbuf;
+}
+
+void mfu_release_push(mfu_release_t* rel, int dest, uint64_t idx)
+{
+    /* items on our own rank go straight to the ready stack */
+    if (dest == rel->rank) {
+        rel->ready[rel->ready_count] = idx;
+        rel->ready_count++;
+        return;
+    }
+
+    /* otherwise queue it up to be sent */
+    if (rel->out_count[dest] == rel->out_max[dest]) {
+        uint64_t max = rel->out_max[dest] * 2;
+        if (max < 64) {
+            max = 64;
+        }
+        rel->out[dest] = (uint64_t*) release_grow(rel->out[dest],
+            rel->out_count[dest] * sizeof(uint64_t), max * sizeof(uint64_t));
+        rel->out_max[dest] = max;
+    }
+    rel->out[dest][rel->out_count[dest]] = idx;
+    rel->out_count[dest]++;
+}
+
+/* key of a table entry and its position in the caller's table */
+typedef struct {
+    const char* key;
+    uint64_t entry;
+} release_key_t;
+
+static int release_key_cmp(const void* a, const void* b)
+{
+    const release_key_t* x = (const release_key_t*) a;
+    const release_key_t* y = (const release_key_t*) b;
+    return strcmp(x->key, y->key);
+}
+
+void mfu_release_register(
+    mfu_release_t* rel,
+    uint64_t count,
+    char** keys,
+    char** table,
+    uint64_t table_size)
+{
+    int i;
+    int ranks = rel->ranks;
+    uint64_t idx;
+
+    /* sort our table entries by key to look up requests */
+    release_key_t* sorted = (release_key_t*) MFU_MALLOC(table_size * sizeof(release_key_t));
+    for (idx = 0; idx < table_size; idx++) {
+        sorted[idx].key   = table[idx];
+        sorted[idx].entry = idx;
+    }
+    qsort(sorted, (size_t)table_size, sizeof(release_key_t), release_key_cmp);
+
+    /* each request is the index of the item on our rank followed by
+     * the key it waits on, items without a key are ready right away */
+    int* sendcounts = (int*) MFU_CALLOC((size_t)ranks, sizeof(int));
+    int* senddisps  = (int*) MFU_CALLOC((size_t)ranks, sizeof(int));
+    int* recvcounts = (int*) MFU_CALLOC((size_t)ranks, sizeof(int));
+    int* recvdisps  = (int*) MFU_CALLOC((size_t)ranks, sizeof(int));
+    for (idx = 0; idx < count; idx++) {
+        if (keys[idx] == NULL) {
+            mfu_release_push(rel, rel->rank, idx);
+        } else {
+            int dest = mfu_release_key_rank(keys[idx], ranks);
+            sendcounts[dest] += (int)(sizeof(uint64_t) + strlen(keys[idx]) + 1);
+        }
+    }
+
+    int send_total = 0;
+    for (i = 0; i < ranks; i++) {
+        senddisps[i] = send_total;
+        send_total += sendcounts[i];
+    }
+
+    char* sendbuf = (char*) MFU_MALLOC((size_t)send_total);
+    int* offsets = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    memcpy(offsets, senddisps, (size_t)ranks * sizeof(int));
+    for (idx = 0; idx < count; idx++) {
+        const char* key = keys[idx];
+        if (key != NULL) {
+            int dest = mfu_release_key_rank(key, ranks);
+            char* ptr = sendbuf + offsets[dest];
+            mfu_pack_uint64(&ptr, idx);
+            size_t len = strlen(key) + 1;
+            memcpy(ptr, key, len);
+            offsets[dest] += (int)(sizeof(uint64_t) + len);
+        }
+    }
+    mfu_free(&offsets);
+
+    MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, rel->comm);
+
+    int recv_total = 0;
+    for (i = 0; i < ranks; i++) {
+        recvdisps[i] = recv_total;
+        recv_total += recvcounts[i];
+    }
+    char* recvbuf = (char*) MFU_MALLOC((size_t)recv_total);
+
+    MPI_Alltoallv(
+        sendbuf, sendcounts, senddisps, MPI_BYTE,
+        recvbuf, recvcounts, recvdisps, MPI_BYTE, rel->comm
+    );
+    mfu_free(&sendbuf);
+
+    /* record (rank, index) of each dependent with its table entry,
+     * first counting dependents of each entry and then filling them
+     * in, requests for keys not in our table are released now */
+    uint64_t* deps_count = (uint64_t*) MFU_CALLOC(table_size + 1, sizeof(uint64_t));
+    int pass;
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < ranks; i++) {
+            const char* ptr = recvbuf + recvdisps[i];
+            const char* end = ptr + recvcounts[i];
+            while (ptr < end) {
+                uint64_t item;
+                mfu_unpack_uint64(&ptr, &item);
+                release_key_t lookup;
+                lookup.key = ptr;
+                ptr += strlen(ptr) + 1;
+
+                release_key_t* found = (release_key_t*) bsearch(&lookup, sorted,
+                    (size_t)table_size, sizeof(release_key_t), release_key_cmp);
+                if (found == NULL) {
+                    if (pass == 0) {
+                        mfu_release_push(rel, i, item);
+                    }
+                    continue;
+                }
+
+                uint64_t entry = found->entry;
+                if (pass == 1) {
+                    uint64_t slot = rel->deps_start[entry] + deps_count[entry];
+                    rel->deps[slot * 2 + 0] = (uint64_t) i;
+                    rel->deps[slot * 2 + 1] = item;
+                }
+                deps_count[entry]++;
+            }
+        }
+
+        if (pass == 0) {
+            /* convert counts into offsets and reset counts for the fill */
+            rel->deps_start = (uint64_t*) MFU_MALLOC((table_size + 1) * sizeof(uint64_t));
+            uint64_t total = 0;
+            for (idx = 0; idx < table_size; idx++) {
+                rel->deps_start[idx] = total;
+                total += deps_count[idx];
+                deps_count[idx] = 0;
+            }
+            rel->deps_start[table_size] = total;
+            rel->deps = (uint64_t*) MFU_MALLOC(total * 2 * sizeof(uint64_t));
+        }
+    }
+
+    mfu_free(&deps_count);
+    mfu_free(&recvbuf);
+    mfu_free(&sendcounts);
+    mfu_free(&senddisps);
+    mfu_free(&recvcounts);
+    mfu_free(&recvdisps);
+    mfu_free(&sorted);
+
+    /* send releases for keys not in the table now, since a rank
+     * with no items of its own never gets to flush them later */
+    mfu_release_flush(rel);
+}
+
+void mfu_release_done(mfu_release_t* rel, uint64_t entry)
+{
+    uint64_t j;
+    for (j = rel->deps_start[entry]; j < rel->deps_start[entry + 1]; j++) {
+        int dest = (int) rel->deps[j * 2 + 0];
+        mfu_release_push(rel, dest, rel->deps[j * 2 + 1]);
+    }
+}
+
+void mfu_release_flush(mfu_release_t* rel)
+{
+    int i;
+    for (i = 0; i < rel->ranks; i++) {
+        uint64_t count = rel->out_count[i];
+        if (count == 0) {
+            continue;
+        }
+
+        /* grow list of outstanding sends if needed */
+        if (rel->reqs_count == rel->reqs_max) {
+            int max = rel->reqs_max * 2;
+            if (max < 64) {
+                max = 64;
+            }
+            size_t reqs = (size_t)rel->reqs_count;
+            rel->reqs = (MPI_Request*) release_grow(rel->reqs,
+                reqs * sizeof(MPI_Request), (size_t)max * sizeof(MPI_Request));
+            rel->bufs = (uint64_t**) release_grow(rel->bufs,
+                reqs * sizeof(uint64_t*), (size_t)max * sizeof(uint64_t*));
+            rel->reqs_max = max;
+        }
+
+        /* hand our buffer to the send and start a new one */
+        int k = rel->reqs_count;
+        rel->bufs[k] = rel->out[i];
+        MPI_Isend(rel->bufs[k], (int)count, MPI_UINT64_T, i, 0, rel->comm, &rel->reqs[k]);
+        rel->reqs_count++;
+
+        rel->out[i]       = NULL;
+        rel->out_count[i] = 0;
+        rel->out_max[i]   = 0;
+    }
+}
+
+int mfu_release_pop(mfu_release_t* rel, uint64_t* idx)
+{
+    if (rel->ready_count == 0) {
+        return 0;
+    }
+    rel->ready_count--;
+    *idx = rel->ready[rel->ready_count];
+    return 1;
+}
+
+void mfu_release_wait(mfu_release_t* rel)
+{
+    MPI_Status status;
+    MPI_Probe(MPI_ANY_SOURCE, 0, rel->comm, &status);
+
+    int count;
+    MPI_Get_count(&status, MPI_UINT64_T, &count);
+    if (count > rel->recv_max) {
+        rel->recv_max = count;
+        mfu_free(&rel->recv);
+        rel->recv = (uint64_t*) MFU_MALLOC((size_t)count * sizeof(uint64_t));
+    }
+    MPI_Recv(rel->recv, count, MPI_UINT64_T, status.MPI_SOURCE, 0, rel->comm, MPI_STATUS_IGNORE);
+
+    int k;
+    for (k = 0; k < count; k++) {
+        rel->ready[rel->ready_count] = rel->recv[k];
+        rel->ready_count++;
+    }
+}
+
+void mfu_release_free(mfu_release_t* rel)
+{
+    /* wait for our releases to be delivered */
+    MPI_Waitall(rel->reqs_count, rel->reqs, MPI_STATUSES_IGNORE);
+
+    int i;
+    for (i = 0; i < rel->reqs_count; i++) {
+        mfu_free(&rel->bufs[i]);
+    }
+    for (i = 0; i < rel->ranks; i++) {
+        mfu_free(&rel->out[i]);
+    }
+    mfu_free(&rel->reqs);
+    mfu_free(&rel->bufs);
+    mfu_free(&rel->out);
+    mfu_free(&rel->out_count);
+    mfu_free(&rel->out_max);
+    mfu_free(&rel->ready);
+    mfu_free(&rel->recv);
+    mfu_free(&rel->deps_start);
+    mfu_free(&rel->deps);
+
+    MPI_Comm_free(&rel->comm);
+}
+
 /* print information about a file given the index and rank (used in print_files) */
 static void print_file(mfu_flist flist, uint64_t idx)
 {
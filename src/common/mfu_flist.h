@@ -43,6 +43,7 @@ extern "C" {
 #include <ctype.h>
 #include <stdbool.h>
 #include "mpi.h"
+#include "mfu_compress.h"
 
 #if DCOPY_USE_XATTRS
 #include <sys/xattr.h>
@@ -67,6 +68,19 @@ extern "C" {
 #define MFU_BUFFER_SIZE_STR "4MB"
 #define MFU_BUFFER_SIZE (4*1024*1024)
 
+/* default number of files each rank keeps open for reading and for
+ * writing while copying or comparing data */
+#define MFU_OPEN_FILES_STR "16"
+#define MFU_OPEN_FILES (16)
+
+/* default limit below which regular files are copied whole in a single
+ * create / write / set metadata pass rather than through the chunk list,
+ * and default number of such files written before they are flushed */
+#define MFU_SMALL_FILE_SIZE_STR "1MB"
+#define MFU_SMALL_FILE_SIZE (1024*1024)
+#define MFU_SMALL_FILE_WINDOW_STR "64"
+#define MFU_SMALL_FILE_WINDOW (64)
+
 /*
  * FIXME: Is this description correct?
  *
@@ -395,6 +409,9 @@ uint64_t mfu_flist_file_get_mtime_nsec(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_ctime(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_ctime_nsec(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_size(mfu_flist flist, uint64_t index);
+uint64_t mfu_flist_file_get_dev(mfu_flist flist, uint64_t index);
+uint64_t mfu_flist_file_get_ino(mfu_flist flist, uint64_t index);
+uint64_t mfu_flist_file_get_nlink(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_perm(mfu_flist flist, uint64_t index);
 #if DCOPY_USE_XATTRS
 void *mfu_flist_file_get_acl(mfu_flist bflist, uint64_t idx, ssize_t *acl_size, char *type);
@@ -420,6 +437,9 @@ void mfu_flist_file_set_mtime_nsec(mfu_flist flist, uint64_t index, uint64_t mti
 void mfu_flist_file_set_ctime(mfu_flist flist, uint64_t index, uint64_t ctime);
 void mfu_flist_file_set_ctime_nsec(mfu_flist flist, uint64_t index, uint64_t ctime_nsec);
 void mfu_flist_file_set_size(mfu_flist flist, uint64_t index, uint64_t size);
+void mfu_flist_file_set_dev(mfu_flist flist, uint64_t index, uint64_t dev);
+void mfu_flist_file_set_ino(mfu_flist flist, uint64_t index, uint64_t ino);
+void mfu_flist_file_set_nlink(mfu_flist flist, uint64_t index, uint64_t nlink);
 #if DCOPY_USE_XATTRS
 //void *mfu_flist_file_set_acl(mfu_flist bflist, uint64_t idx, ssize_t *acl_size, char *type);
 #endif
@@ -527,27 +547,48 @@ mfu_create_opts_t* mfu_create_opts_new(void);
 /* free create options allocated from mfu_create_opts_new */
 void mfu_create_opts_delete(mfu_create_opts_t** popts);
 
+/* function called on a directory in a list by mfu_flist_dirs_top_down,
+ * returns 0 on success and -1 on error */
+typedef int (*mfu_flist_dir_fn)(mfu_flist flist, uint64_t index, void* args);
+
+/* call fn on each directory in flist, a directory is processed only
+ * after its parent directory has been processed if the parent is also
+ * in the list, but otherwise without waiting on directories at the same
+ * depth, the list passed to fn holds directories redistributed across
+ * ranks, returns 0 on success and -1 if any call to fn failed */
+int mfu_flist_dirs_top_down(mfu_flist flist, mfu_flist_dir_fn fn, void* args);
+
 /* create all directories in flist */
 void mfu_flist_mkdir(
     mfu_flist flist,
-    mfu_create_opts_t* opts
+    mfu_create_opts_t* opts,
+    mfu_file_t* mfu_file     /* IN - I/O filesystem functions to use */
 );
 
 /* create inodes for all regular files in flist, assumes directories exist */
 void mfu_flist_mknod(
     mfu_flist flist,
-    mfu_create_opts_t* opts
+    mfu_create_opts_t* opts,
+    mfu_file_t* mfu_file     /* IN - I/O filesystem functions to use */
 );
 
 /* apply metadata updates to items in list */
 void mfu_flist_metadata_apply(
     mfu_flist flist,
-    mfu_create_opts_t* opts
+    mfu_create_opts_t* opts,
+    mfu_file_t* mfu_file     /* IN - I/O filesystem functions to use */
 );
 
 /* unlink all items in flist,
- * if traceless=1, restore timestamps on parent directories after unlinking children */
-void mfu_flist_unlink(mfu_flist flist, bool traceless, mfu_file_t* mfu_file);
+ * if traceless=1, restore timestamps on parent directories after unlinking children,
+ * returns 0 on success and -1 if any item could not be removed */
+int mfu_flist_unlink(mfu_flist flist, bool traceless, mfu_file_t* mfu_file);
+
+/* remove each path and everything below it while reading directories,
+ * files are unlinked as their entries are read and directories are
+ * removed once empty, no list of items is built,
+ * returns 0 on success and -1 if any item could not be removed */
+int mfu_flist_purge_param_paths(uint64_t num, const mfu_param_path* params, mfu_file_t* mfu_file);
 
 typedef struct {
     uid_t uid;      /* new user id for item's owner, -1 for no change */
@@ -637,6 +678,12 @@ typedef struct {
     size_t  header_size;
     int     create_libcircle;
     int     extract_libarchive;
+    bool    update;
+    mfu_codec_t codec;
+    int     level;
+    uint64_t num_members;
+    char**  members;
+    mfu_pred* member_pred;
 } mfu_archive_opts_t;
 
 /* return a newly allocated archive_opts structure, set default values on its fields */
@@ -647,30 +694,49 @@ void mfu_archive_opts_delete(mfu_archive_opts_t** popts);
 
 /* check that source paths exist and that parent directory for destination
  * is writable, sets dest_path field in opts, must be called before calling
- * mfu_flist_archive_create */
+ * mfu_flist_archive_create, an existing archive is deleted unless
+ * opts->update is set, in which case it must be writable */
 void mfu_param_path_check_archive(
     int numparams,             /* number of parameter paths in srcparams list */
     mfu_param_path* srcparams, /* list of source paths to be included in archived */
     mfu_param_path destparam,  /* parameter path for archive name */
     mfu_archive_opts_t* opts,  /* archive options, call set dest_path field */
-    int* valid                 /* valid = 1 if all paths check out, 0 otherwise */
+    int* valid,                /* valid = 1 if all paths check out, 0 otherwise */
+    mfu_file_t* mfu_file       /* file system that holds the source paths */
 );
 
-/* write items in file list to tar archive */
+/* write items in file list to tar archive, if opts->update is set and
+ * the archive exists, only items that are not in the archive or whose
+ * type, size, or mtime differ from their entry are appended after its
+ * last entry, and the index is rewritten to name the latest entry of
+ * each item */
 int mfu_flist_archive_create(
     mfu_flist flist,               /* list of items to be written to archive */
     const char* filename,          /* name of target archive file */
     int numpaths,                  /* number of source paths */
     const mfu_param_path* paths,   /* list of source paths */
     const mfu_param_path* cwdpath, /* current working directory used to construct relative path to each item in flist */
-    mfu_archive_opts_t* opts       /* options to configure archive operation */
+    mfu_archive_opts_t* opts,      /* options to configure archive operation */
+    mfu_file_t* mfu_file           /* IN - I/O filesystem functions to read items with */
 );
 
 /* extract named archive file to disk into the given current working directory */
 int mfu_flist_archive_extract(
     const char* filename,          /* name of archive file to be extracted */
     const mfu_param_path* cwdpath, /* current working dir used to construct absolute path of each item */
-    mfu_archive_opts_t* opts       /* options to configure archive extraction operation */
+    mfu_archive_opts_t* opts,      /* options to configure archive extraction operation */
+    mfu_file_t* mfu_file           /* IN - I/O filesystem functions to create items with */
+);
+
+/* list entries of named archive file in flist from its index and entry
+ * headers without extracting them, entries are named as they would be
+ * extracted under cwdpath and can be selected with opts->members and
+ * opts->member_pred */
+int mfu_flist_archive_list(
+    const char* filename,          /* name of archive file to be listed */
+    const mfu_param_path* cwdpath, /* current working dir used to construct absolute path of each item */
+    mfu_archive_opts_t* opts,      /* options to configure archive list operation */
+    mfu_flist flist                /* list in which to insert entries */
 );
 
 #endif /* MFU_FLIST_H */
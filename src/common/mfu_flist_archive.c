@@ -26,6 +26,7 @@
 #include <archive_entry.h>
 #include <string.h>
 #include <getopt.h>
+#include <fnmatch.h>
 
 /* gettimeofday */
 #include <sys/time.h>
@@ -44,6 +45,7 @@
 #define DTAR_MAGIC (0x445441525F494458)
 
 #include "mfu.h"
+#include "strmap.h"
 
 /* libcircle work operation types */
 typedef enum {
@@ -77,6 +79,7 @@ mfu_file_chunk* DTAR_data_chunks = NULL; /* linked list of chunks from mfu_file_
 int* DTAR_rank_disps             = NULL; /* given a rank, get offset into data offsets array for its files */
 uint64_t* DTAR_data_offsets      = NULL; /* byte offset within archive file for start of data of each entry */
 mfu_archive_opts_t* DTAR_opts    = NULL; /* pointer to archive options */
+mfu_file_t* DTAR_mfu_file        = NULL; /* I/O filesystem functions for items being archived or extracted */
 
 static int DTAR_err = 0; /* whether a process encounters an error while executing libcircle ops */
 
@@ -104,10 +107,10 @@ static void DTAR_exit(int code)
 /* cache open file descriptor to avoid
  * opening / closing the same file */
 typedef struct {
-    char* name; /* name of open file (NULL if none) */
-    int   read; /* whether file is open for read-only (1) or write (0) */
-    int   sync; /* whether to fsync file on close (1) or not (0) */
-    int   fd;   /* file descriptor */
+    char* name;      /* name of open file (NULL if none) */
+    int   read;      /* whether file is open for read-only (1) or write (0) */
+    int   sync;      /* whether to fsync file on close (1) or not (0) */
+    mfu_file_t file; /* open file */
 } mfu_archive_file_cache_t;
 
 /* close a file that opened with mfu_copy_open_file */
@@ -119,17 +122,15 @@ static int mfu_archive_close_file(
     /* close file if we have one */
     char* name = cache->name;
     if (name != NULL) {
-        int fd = cache->fd;
-
         /* if open for write, fsync */
         int read_flag = cache->read;
         int sync_flag = cache->sync;
-        if (! read_flag && sync_flag) {
-            rc = mfu_fsync(name, fd);
+        if (! read_flag && sync_flag && cache->file.type == POSIX) {
+            rc = mfu_fsync(name, cache->file.fd);
         }
 
         /* close the file and delete the name string */
-        rc = mfu_close(name, fd);
+        rc = mfu_file_close(name, &cache->file);
         mfu_free(&cache->name);
     }
 
@@ -143,13 +144,13 @@ static int mfu_archive_open_file(
     int read_flag,                   /* set to 1 to open in read only, 0 for write */
     int sync_flag,                   /* set to 1 to sync file on close (if opned for write) */
     int noatime_flag,                /* set to 1 to open file with O_NOATIME */
-    mfu_archive_file_cache_t* cache) /* cache the open file to avoid repetitive open/close of the same file */
+    mfu_archive_file_cache_t* cache, /* cache the open file to avoid repetitive open/close of the same file */
+    mfu_file_t* mfu_file)            /* I/O filesystem functions to open file with */
 {
     /* see if we have a cached file descriptor */
     char* name = cache->name;
     if (name != NULL) {
         /* we have a cached file descriptor */
-        int fd = cache->fd;
         if (strcmp(name, file) == 0 && cache->read == read_flag) {
             /* the file we're trying to open matches name and read/write mode,
              * so just return the cached descriptor */
@@ -162,24 +163,24 @@ static int mfu_archive_open_file(
     }
 
     /* open the new file */
-    int fd;
+    int open_rc;
+    cache->file = *mfu_file;
     if (read_flag) {
         int flags = O_RDONLY;
         if (noatime_flag) {
             flags |= O_NOATIME;
         }
-        fd = mfu_open(file, flags);
+        open_rc = mfu_file_open(file, flags, &cache->file);
     } else {
         int flags = O_WRONLY | O_CREAT;
-        fd = mfu_open(file, flags, DCOPY_DEF_PERMS_FILE);
+        open_rc = mfu_file_open(file, flags, &cache->file, DCOPY_DEF_PERMS_FILE);
     }
-    if (fd < 0) {
+    if (open_rc < 0) {
         return -1;
     }
 
     /* cache the file descriptor */
     cache->name = MFU_STRDUP(file);
-    cache->fd   = fd;
     cache->read = read_flag;
     cache->sync = sync_flag;
 
@@ -375,6 +376,7 @@ static int encode_header(
     void* buf,                     /* buffer in which to store encoded header */
     size_t bufsize,                /* size of input buffer */
     mfu_archive_opts_t* opts,      /* archive options, which may affect encoding */
+    mfu_file_t* mfu_file,          /* I/O filesystem functions to query item with */
     size_t* outsize)               /* number of bytes consumed to encode header */
 {
     /* assume we'll succeed */
@@ -460,7 +462,7 @@ static int encode_header(
     } else {
         /* TODO: read stat info from mfu_flist */
         struct stat stbuf;
-        mfu_lstat(fname, &stbuf);
+        mfu_file_lstat(fname, &stbuf, mfu_file);
         archive_entry_copy_stat(entry, &stbuf);
 
         /* set user name of owner */
@@ -477,7 +479,7 @@ static int encode_header(
             /* got a symlink, read its target */
             char target[PATH_MAX + 1];              /* make space to add a trailing NUL */
             size_t targetsize = sizeof(target) - 1; /* leave space for a NUL */
-            ssize_t readlink_rc = mfu_readlink(fname, target, targetsize);
+            ssize_t readlink_rc = mfu_file_readlink(fname, target, targetsize, mfu_file);
             if (readlink_rc != -1) {
                 /* readlink call succeeded, but check we didn't truncate the target */
                 if (readlink_rc < (ssize_t)targetsize) {
@@ -521,6 +523,7 @@ static int write_header(
     void* buf,                     /* buffer in which to store encoded header */
     size_t bufsize,                /* size of input buffer */
     mfu_archive_opts_t* opts,      /* archive options, which may affect encoding */
+    mfu_file_t* mfu_file,          /* I/O filesystem functions to query item with */
     const char* filename,          /* filename of archive to write header to */
     int fd,                        /* open file descriptor to write header to */
     uint64_t offset)               /* byte offset in archive at which to write header */
@@ -531,7 +534,7 @@ static int write_header(
     /* encode header for this entry in our buffer */
     size_t header_size;
     int encode_rc = encode_header(flist, idx, cwdpath,
-        buf, bufsize, opts, &header_size
+        buf, bufsize, opts, mfu_file, &header_size
     );
     if (encode_rc != MFU_SUCCESS) {
         MFU_LOG(MFU_LOG_ERR, "Failed to encode header for `%s'",
@@ -748,13 +751,12 @@ static void DTAR_perform_copy(CIRCLE_handle* handle)
     int read_flag = 1;
     int sync_flag = 0;
     int noatime_flag = DTAR_opts->open_noatime;
-    int open_rc = mfu_archive_open_file(in_name, read_flag, sync_flag, noatime_flag, &mfu_archive_src_cache);
-    int in_fd = mfu_archive_src_cache.fd;
+    int open_rc = mfu_archive_open_file(in_name, read_flag, sync_flag, noatime_flag,
+        &mfu_archive_src_cache, DTAR_mfu_file);
     if (open_rc == -1) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open source file '%s' errno=%d %s",
             in_name, errno, strerror(errno));
         DTAR_err = 1;
-        in_fd = -1;
     }
 
     /* get name and opened file descriptor to archive file */
@@ -764,18 +766,12 @@ static void DTAR_perform_copy(CIRCLE_handle* handle)
     /* file are sliced up in units of chunk_size bytes */
     uint64_t chunk_size = DTAR_opts->chunk_size;
 
-    /* seek to proper offset in input file */
+    /* offset in input file, which we read with pread */
     uint64_t in_offset = chunk_size * op->chunk_index;
-    off_t lseek_rc = mfu_lseek(in_name, in_fd, in_offset, SEEK_SET);
-    if (lseek_rc == (off_t)-1) {
-        MFU_LOG(MFU_LOG_ERR, "Failed to seek in source file '%s' errno=%d %s",
-            in_name, errno, strerror(errno));
-        DTAR_err = 1;
-    }
 
     /* seek to position within archive file to write this data */
     uint64_t out_offset = op->offset + in_offset;
-    lseek_rc = mfu_lseek(out_name, out_fd, out_offset, SEEK_SET);
+    off_t lseek_rc = mfu_lseek(out_name, out_fd, out_offset, SEEK_SET);
     if (lseek_rc == (off_t)-1) {
         MFU_LOG(MFU_LOG_ERR, "Failed to seek in destination file '%s' errno=%d %s",
             out_name, errno, strerror(errno));
@@ -793,7 +789,9 @@ static void DTAR_perform_copy(CIRCLE_handle* handle)
         }
 
         /* read data from the source file */
-        ssize_t nread = mfu_read(in_name, in_fd, DTAR_writer.io_buf, num_to_read);
+        off_t pos_read = (off_t) (in_offset + total_bytes_written);
+        ssize_t nread = mfu_file_pread(in_name, DTAR_writer.io_buf, num_to_read, pos_read,
+            &mfu_archive_src_cache.file);
         if (nread == 0) {
             /* hit end of file, we check below that we didn't end early */
             break;
@@ -936,13 +934,12 @@ static void DTAR_perform_extract(CIRCLE_handle* handle)
     int read_flag = 0; /* write */
     int sync_flag = DTAR_opts->sync_on_close;
     int noatime_flag = DTAR_opts->open_noatime;
-    int open_rc = mfu_archive_open_file(out_name, read_flag, sync_flag, noatime_flag, &mfu_archive_dst_cache);
-    int out_fd = mfu_archive_dst_cache.fd;
+    int open_rc = mfu_archive_open_file(out_name, read_flag, sync_flag, noatime_flag,
+        &mfu_archive_dst_cache, DTAR_mfu_file);
     if (open_rc == -1) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open destination file '%s' errno=%d %s",
             out_name, errno, strerror(errno));
         DTAR_err = 1;
-        out_fd = -1;
     }
 
     /* get name and opened file descriptor to archive file */
@@ -952,18 +949,12 @@ static void DTAR_perform_extract(CIRCLE_handle* handle)
     /* file are sliced up in units of chunk_size bytes */
     uint64_t chunk_size = DTAR_opts->chunk_size;
 
-    /* seek to proper offset in output file */
+    /* offset in output file, which we write with pwrite */
     uint64_t out_offset = chunk_size * op->chunk_index;
-    off_t lseek_rc = mfu_lseek(out_name, out_fd, out_offset, SEEK_SET);
-    if (lseek_rc == (off_t)-1) {
-        MFU_LOG(MFU_LOG_ERR, "Failed to seek in destination file '%s' errno=%d %s",
-            out_name, errno, strerror(errno));
-        DTAR_err = 1;
-    }
 
     /* seek to position within archive file to read this data */
     uint64_t in_offset = op->offset + out_offset;
-    lseek_rc = mfu_lseek(in_name, in_fd, in_offset, SEEK_SET);
+    off_t lseek_rc = mfu_lseek(in_name, in_fd, in_offset, SEEK_SET);
     if (lseek_rc == (off_t)-1) {
         MFU_LOG(MFU_LOG_ERR, "Failed to seek in archive file '%s' errno=%d %s",
             in_name, errno, strerror(errno));
@@ -1008,13 +999,23 @@ static void DTAR_perform_extract(CIRCLE_handle* handle)
             break;
         }
 
-        /* read some bytes, write out what we read */
-        ssize_t nwritten = mfu_write(out_name, out_fd, DTAR_writer.io_buf, nread);
+        /* read some bytes, write out what we read,
+         * we loop to account for short writes */
+        ssize_t nwritten = 0;
+        while (nwritten < nread) {
+            off_t pos_write = (off_t) (out_offset + total_bytes_written + (uint64_t) nwritten);
+            ssize_t n = mfu_file_pwrite(out_name, (char*) DTAR_writer.io_buf + nwritten,
+                (size_t) (nread - nwritten), pos_write, &mfu_archive_dst_cache.file);
+            if (n <= 0) {
+                /* some form of write error */
+                MFU_LOG(MFU_LOG_ERR, "Failed to write to '%s' errno=%d %s",
+                    out_name, errno, strerror(errno));
+                DTAR_err = 1;
+                break;
+            }
+            nwritten += n;
+        }
         if (nwritten != nread) {
-            /* some form of write error */
-            MFU_LOG(MFU_LOG_ERR, "Failed to write to '%s' errno=%d %s",
-                out_name, errno, strerror(errno));
-            DTAR_err = 1;
             break;
         }
 
@@ -1057,7 +1058,8 @@ void mfu_param_path_check_archive(
     mfu_param_path* srcparams,
     mfu_param_path destparam,
     mfu_archive_opts_t* opts,
-    int* valid)
+    int* valid,
+    mfu_file_t* mfu_file)
 {
     /* assume paths are valid */
     *valid = 1;
@@ -1071,7 +1073,7 @@ void mfu_param_path_check_archive(
         int num_readable = 0;
         for (i = 0; i < numparams; i++) {
             char* path = srcparams[i].path;
-            if (mfu_access(path, R_OK) == 0) {
+            if (mfu_file_access(path, R_OK, mfu_file) == 0) {
                 /* found one that we can read */
                 num_readable++;
             } else {
@@ -1093,7 +1095,14 @@ void mfu_param_path_check_archive(
         opts->dest_path = MFU_STRDUP(destparam.path);
 
         /* check destination */
-        if (destparam.path_stat_valid) {
+        if (destparam.path_stat_valid && opts->update) {
+            /* we'll add to the existing archive */
+            if (mfu_access(opts->dest_path, R_OK | W_OK) < 0) {
+                MFU_LOG(MFU_LOG_ERR, "Archive file is not writable: '%s' errno=%d %s",
+                    opts->dest_path, errno, strerror(errno));
+                *valid = 0;
+            }
+        } else if (destparam.path_stat_valid) {
             /* archive file already exists, let's delete it,
              * we're goind to overwrite the existing file, but we delete it now before we walk
              * so that we don't try to include the archive file as part of the archive */
@@ -1158,6 +1167,7 @@ static void index_pack(
     void* buf,             /* pointer to start of buffer in which to pack the index */
     size_t bufsize,        /* size of memory buffer */
     uint64_t archive_size, /* size of archive file in bytes (entries only) if known, 0 otherwise */
+    uint64_t archive_mtime, /* mtime of archive file in seconds if known, 0 otherwise */
     uint64_t entry_size,   /* size of index entry in the archive file if known, 0 otherwise */
     uint64_t count,        /* number of entries */
     uint64_t* offsets)     /* byte offset of each entry */
@@ -1179,7 +1189,7 @@ static void index_pack(
     uint64_t* footer = (uint64_t*)((char*)buf + bufsize - footer_size);
     footer[0] = mfu_hton64(count);        /* number of entries in the archive */
     footer[1] = mfu_hton64(archive_size); /* archive size in bytes (entries only) */
-    footer[2] = mfu_hton64(0);            /* max header size */
+    footer[2] = mfu_hton64(archive_mtime); /* archive mtime in seconds */
     footer[3] = mfu_hton64(entry_size);   /* index size to seek back to header of index */
     footer[4] = mfu_hton64(1);            /* index version number */
     footer[5] = mfu_hton64(DTAR_MAGIC);   /* magic value */
@@ -1192,6 +1202,7 @@ static int index_unpack(
     const void* buf,            /* pointer to start of buffer in which to pack the index */
     size_t bufsize,             /* size of memory buffer */
     uint64_t* out_archive_size, /* returns size of archive file in bytes (entries only) if known, 0 otherwise */
+    uint64_t* out_archive_mtime, /* returns mtime of archive file in seconds if known, 0 otherwise */
     uint64_t* out_entry_size,   /* returns size of index entry in the archive file if known, 0 otherwise */
     uint64_t* out_count,        /* returns number of entries */
     uint64_t** out_offsets)     /* returns byte offset of each entry in newly allocated array */
@@ -1221,7 +1232,7 @@ static int index_unpack(
     /* got a match, pull values from footer, including number of entries */
     uint64_t count        = mfu_ntoh64(footer[0]); /* number of entries in the archive */
     uint64_t archive_size = mfu_ntoh64(footer[1]); /* archive size in bytes (entries only) */
-    uint64_t max_header   = mfu_ntoh64(footer[2]); /* max header size */
+    uint64_t archive_mtime = mfu_ntoh64(footer[2]); /* archive mtime in seconds */
     uint64_t entry_size   = mfu_ntoh64(footer[3]); /* index size to seek back to header of index */
 
     /* allocate memory to hold offsets */
@@ -1238,8 +1249,9 @@ static int index_unpack(
     }
 
     /* set output parameters */
-    *out_archive_size = archive_size;
-    *out_entry_size   = entry_size;
+    *out_archive_size  = archive_size;
+    *out_archive_mtime = archive_mtime;
+    *out_entry_size    = entry_size;
     *out_count        = count;
     *out_offsets      = offsets;
 
@@ -1249,7 +1261,8 @@ static int index_unpack(
 static int write_entry_index_file(
     const char* file,  /* name of archive file */
     uint64_t count,    /* number of items in offsets list */
-    uint64_t* offsets) /* byte offset to each item in the archive file */
+    uint64_t* offsets, /* byte offset to each item in the archive file */
+    bool writing)      /* whether we are still writing the archive */
 {
     /* assume we'll succeed */
     int rc = MFU_SUCCESS;
@@ -1264,6 +1277,22 @@ static int write_entry_index_file(
 
     /* have rank 0 write the index file */
     if (mfu_rank == 0) {
+        /* record the size and mtime of the archive, so that a reader
+         * can tell if the archive has changed since, the archive has
+         * its final size when we write the index during create, but
+         * its mtime will still change as we copy data into it */
+        uint64_t archive_size  = 0;
+        uint64_t archive_mtime = 0;
+        struct stat st;
+        if (mfu_stat(file, &st) == 0) {
+            uint64_t mtime_nsec;
+            archive_size = (uint64_t) st.st_size;
+            mfu_stat_get_mtimes(&st, &archive_mtime, &mtime_nsec);
+            if (writing) {
+                archive_mtime = 0;
+            }
+        }
+
         int fd = mfu_open(name, O_WRONLY | O_CREAT | O_TRUNC, 0660);
         if (fd >= 0) {
             /* compute size of memory buffer holding header and offsets */
@@ -1271,7 +1300,7 @@ static int write_entry_index_file(
             char* buf = (char*) MFU_MALLOC(bufsize);
 
             /* pack index into buffer */
-            index_pack(buf, bufsize, 0, 0, count, offsets);
+            index_pack(buf, bufsize, archive_size, archive_mtime, 0, count, offsets);
 
             /* write offsets to the index file */
             size_t total_written = 0;
@@ -1337,7 +1366,7 @@ static int write_entry_index_xattr(
         char* buf = (char*) MFU_MALLOC(bufsize);
     
         /* pack index into buffer */
-        index_pack(buf, bufsize, 0, 0, count, offsets);
+        index_pack(buf, bufsize, 0, 0, 0, count, offsets);
 
         /* we remove the index first so that we don't end up with an
          * old (inconsistent) value in case we fail to apply the new value */
@@ -1417,6 +1446,76 @@ static int encode_index_header(
     return rc;
 }
 
+/* encodes the index as an archive entry that starts at archive_size,
+ * returns an allocated buffer holding the entry and its size */
+static int encode_entry_index_footer(
+    const char* file,         /* name of archive file */
+    uint64_t count,           /* number of items in offsets list */
+    uint64_t* offsets,        /* byte offset to each item in the archive file */
+    mfu_archive_opts_t* opts, /* archive options, which may affect encoding */
+    uint64_t archive_size,    /* size of archive in bytes (last byte after last entry) */
+    char** out_buf,           /* allocated buffer holding the encoded entry */
+    size_t* out_size)         /* size of encoded entry in bytes */
+{
+    /* assume we'll succeed */
+    int rc = MFU_SUCCESS;
+
+    /* compute file name of index file from archive file name,
+     * dropping the extension of a compressed archive so the entry
+     * is named after the tar file it indexes */
+    size_t filelen = strlen(file);
+    if (opts->codec != MFU_CODEC_NONE) {
+        const char* ext = mfu_codec_ext(opts->codec);
+        size_t extlen = (ext != NULL) ? strlen(ext) : 0;
+        if (extlen > 0 && filelen > extlen && strcmp(file + filelen - extlen, ext) == 0) {
+            filelen -= extlen;
+        }
+    }
+    size_t namelen = filelen + strlen(DTAR_INDEX_FILENAME_SUFFIX) + 1;
+    char* name = (char*) MFU_MALLOC(namelen);
+    snprintf(name, namelen, "%.*s%s", (int) filelen, file, DTAR_INDEX_FILENAME_SUFFIX);
+
+    /* use basename of archve file for the index entry */
+    mfu_path* path = mfu_path_from_str(name);
+    mfu_path_basename(path);
+    char* entry_name = mfu_path_strdup(path);
+    mfu_path_delete(&path);
+
+    /* assume 1MB is sufficient for the header for the index */
+    size_t max_header_size = 1024 * 1024;
+
+    /* compute data size of the index */
+    size_t data_size = index_data_size(count);
+
+    /* allocate space to prepare index data */
+    size_t bufsize = max_header_size + data_size;
+    char* buf = (char*) MFU_MALLOC(bufsize);
+
+    /* zero out the buffer so bytes we don't write are well-defined */
+    memset(buf, 0, bufsize);
+
+    /* write header for our index file */
+    uint64_t header_size = 0;
+    int tmp_rc = encode_index_header(entry_name, data_size, buf, max_header_size, opts, &header_size);
+    if (tmp_rc != MFU_SUCCESS) {
+        rc = tmp_rc;
+    }
+
+    /* get pointer to start of data section of entry,
+     * and pack index into data section */
+    uint64_t entry_size = header_size + (uint64_t)data_size;
+    char* ptr = buf + header_size;
+    index_pack(ptr, data_size, archive_size, 0, entry_size, count, offsets);
+
+    *out_buf  = buf;
+    *out_size = (size_t)entry_size;
+
+    mfu_free(&entry_name);
+    mfu_free(&name);
+
+    return rc;
+}
+
 /* writes the index as the last entry in the archive */
 static int write_entry_index_footer(
     const char* file,         /* name of archive file */
@@ -1436,17 +1535,6 @@ static int write_entry_index_footer(
     /* get current size of the archive */
     uint64_t archive_size = *inout_size;
 
-    /* compute file name of index file from archive file name */
-    size_t namelen = strlen(file) + strlen(DTAR_INDEX_FILENAME_SUFFIX) + 1;
-    char* name = (char*) MFU_MALLOC(namelen);
-    snprintf(name, namelen, "%s%s", file, DTAR_INDEX_FILENAME_SUFFIX);
-
-    /* use basename of archve file for the index entry */
-    mfu_path* path = mfu_path_from_str(name);
-    mfu_path_basename(path);
-    char* entry_name = mfu_path_strdup(path);
-    mfu_path_delete(&path);
-
     /* let user know what we're doing */
     if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
         MFU_LOG(MFU_LOG_INFO, "Writing index as last entry in %s", file);
@@ -1467,40 +1555,20 @@ static int write_entry_index_footer(
                rc = MFU_FAILURE;
             }
 
-            /* assume 1MB is sufficient for the header for the index */
-            size_t max_header_size = 1024 * 1024;
-
-            /* compute data size of the index */
-            size_t data_size = index_data_size(count);
-
-            /* allocate space to prepare index data */
-            size_t bufsize = max_header_size + data_size;
-            char* buf = (char*) MFU_MALLOC(bufsize);
-
-            /* zero out the buffer so bytes we don't write are well-defined */
-            memset(buf, 0, bufsize);
-
-            /* write header for our index file */
-            uint64_t header_size = 0;
-            int tmp_rc = encode_index_header(entry_name, data_size, buf, max_header_size, opts, &header_size);
+            /* encode the index entry */
+            char* buf = NULL;
+            size_t bufsize = 0;
+            int tmp_rc = encode_entry_index_footer(file, count, offsets, opts,
+                archive_size, &buf, &bufsize);
             if (tmp_rc != MFU_SUCCESS) {
                 rc = tmp_rc;
             }
-
-            /* update bufsize to record smaller size with actual encoded header */
-            uint64_t entry_size = header_size + (uint64_t)data_size;
-            bufsize = (size_t)entry_size;
-
-            /* get pointer to start of data section of entry,
-             * and pack index into data section */
-            char* ptr = buf + header_size;
-            index_pack(ptr, data_size, archive_size, entry_size, count, offsets);
     
             /* write offsets to the index file */
             size_t total_written = 0;
             while (total_written < bufsize && rc == MFU_SUCCESS) {
                 size_t bytes_to_write = bufsize - total_written;
-                ptr = buf + total_written;
+                char* ptr = buf + total_written;
                 ssize_t nwritten = mfu_write(file, fd, ptr, bytes_to_write);
                 if (nwritten < 0) {
                     /* failed to write to the file */
@@ -1530,9 +1598,6 @@ static int write_entry_index_footer(
         }
     }
 
-    mfu_free(&entry_name);
-    mfu_free(&name);
-
     /* determine whether everyone succeeded */
     if (! mfu_alltrue(rc == MFU_SUCCESS, MPI_COMM_WORLD)) {
         rc = MFU_FAILURE;
@@ -1541,22 +1606,57 @@ static int write_entry_index_footer(
 }
 
 typedef enum {
+    INDEX_NONE,  /* do not write an index */
     INDEX_FILE,  /* write index as a separate file from the archive */
     INDEX_XATTR, /* write index as xattr */
     INDEX_FOOTER /* write index as footer entry in archive */
 } mfu_flist_archive_index_algo;
 
-static mfu_flist_archive_index_algo select_index_algo(void)
+/* returns true if a file can be created in the directory holding file,
+ * collective */
+static bool dir_writable(const char* file)
 {
-    mfu_flist_archive_index_algo algo = INDEX_FOOTER;
+    int writable = 0;
+    if (mfu_rank == 0) {
+        char* dir = MFU_STRDUP(file);
+        char* slash = strrchr(dir, '/');
+        if (slash == NULL) {
+            strcpy(dir, ".");
+        } else if (slash == dir) {
+            slash[1] = '\0';
+        } else {
+            *slash = '\0';
+        }
+        writable = (mfu_access(dir, W_OK) == 0);
+        mfu_free(&dir);
+    }
+    MPI_Bcast(&writable, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return (bool) writable;
+}
 
+/* The footer is the default when we are writing the archive and know
+ * where it ends.  Otherwise, as after scanning an archive to extract
+ * it, the index goes to a file next to the archive so the next
+ * extraction can skip the scan, or nowhere if we can't create one. */
+static mfu_flist_archive_index_algo select_index_algo(
+    const char* file, /* name of archive file */
+    bool have_size)   /* whether we know the size of the archive */
+{
     /* see if the user is trying to request a specific create algorithm */
     const char varname[] = "MFU_FLIST_ARCHIVE_INDEX";
     const char* value = getenv(varname);
     if (value == NULL) {
-        return algo;
+        if (have_size) {
+            return INDEX_FOOTER;
+        }
+        if (dir_writable(file)) {
+            return INDEX_FILE;
+        }
+        return INDEX_NONE;
     }
 
+    mfu_flist_archive_index_algo algo = INDEX_FOOTER;
+
     /* user is trying to request a specific algorithm */
     if (strcmp(value, "FILE") == 0) {
         algo = INDEX_FILE;
@@ -1587,14 +1687,13 @@ static mfu_flist_archive_index_algo select_index_algo(void)
 }
 
 /* Each process calls with the byte offset for each entry
- * it owns.  These are gathered in order and written into
- * an index file that is created for specified archive file. */
-static int write_entry_index(
-    const char* file,  /* name of archive file */
-    uint64_t count,    /* number of items in offsets list */
-    uint64_t* offsets, /* byte offset to each item in the archive file */
-    mfu_archive_opts_t* opts, /* archive options, which may affect encoding */
-    uint64_t* inout_size) /* size of archive in bytes */
+ * it owns.  These are gathered in order to rank 0, which
+ * gets the total count and an allocated array of offsets. */
+static void gather_entry_index(
+    uint64_t count,          /* number of items in offsets list */
+    uint64_t* offsets,       /* byte offset to each item in the archive file */
+    uint64_t* out_total,     /* total number of items across ranks */
+    uint64_t** out_offsets)  /* allocated list of all offsets on rank 0, NULL elsewhere */
 {
     /* let user know what we're doing */
     if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
@@ -1637,13 +1736,38 @@ static int write_entry_index(
         all_offsets, rank_counts, rank_disps, MPI_UINT64_T,
         0, MPI_COMM_WORLD
     );
-    
-    mfu_flist_archive_index_algo algo = select_index_algo();
+
+    /* free memory buffers */
+    mfu_free(&rank_counts);
+    mfu_free(&rank_disps);
+
+    *out_total   = total;
+    *out_offsets = all_offsets;
+}
+
+/* Each process calls with the byte offset for each entry
+ * it owns.  These are gathered in order and written into
+ * an index file that is created for specified archive file. */
+static int write_entry_index(
+    const char* file,  /* name of archive file */
+    uint64_t count,    /* number of items in offsets list */
+    uint64_t* offsets, /* byte offset to each item in the archive file */
+    mfu_archive_opts_t* opts, /* archive options, which may affect encoding */
+    uint64_t* inout_size) /* size of archive in bytes */
+{
+    /* gather offsets to rank 0 */
+    uint64_t total;
+    uint64_t* all_offsets;
+    gather_entry_index(count, offsets, &total, &all_offsets);
+
+    mfu_flist_archive_index_algo algo = select_index_algo(file, inout_size != NULL);
 
     /* have rank 0 write the file */
     int rc = MFU_FAILURE;
-    if (algo == INDEX_FILE) {
-        rc = write_entry_index_file(file, total, all_offsets);
+    if (algo == INDEX_NONE) {
+        rc = MFU_SUCCESS;
+    } else if (algo == INDEX_FILE) {
+        rc = write_entry_index_file(file, total, all_offsets, inout_size != NULL);
     }
 #if DCOPY_USE_XATTRS
     else if (algo == INDEX_XATTR) {
@@ -1656,8 +1780,6 @@ static int write_entry_index(
 
     /* free memory buffers */
     mfu_free(&all_offsets);
-    mfu_free(&rank_counts);
-    mfu_free(&rank_disps);
 
     return rc;
 }
@@ -1749,9 +1871,28 @@ static int read_entry_index_file(
 
             /* if we read the header, check magic and version numbers */
             if (rc == MFU_SUCCESS) {
-                uint64_t archive_size = 0;
-                uint64_t entry_size   = 0;
-                rc = index_unpack(buf, bufsize, &archive_size, &entry_size, &count, &offsets);
+                uint64_t archive_size  = 0;
+                uint64_t archive_mtime = 0;
+                uint64_t entry_size    = 0;
+                rc = index_unpack(buf, bufsize, &archive_size, &archive_mtime, &entry_size, &count, &offsets);
+
+                /* the index file is separate from the archive, so the
+                 * archive may have been replaced or changed since we
+                 * wrote the index, ignore the index if the archive
+                 * no longer has the size and mtime we recorded */
+                struct stat st;
+                if (rc == MFU_SUCCESS && mfu_stat(filename, &st) == 0) {
+                    uint64_t mtime, mtime_nsec;
+                    mfu_stat_get_mtimes(&st, &mtime, &mtime_nsec);
+                    if (archive_size != (uint64_t) st.st_size ||
+                        (archive_mtime != 0 && archive_mtime != mtime))
+                    {
+                        MFU_LOG(MFU_LOG_WARN, "Ignoring index '%s' that does not match archive '%s'",
+                            name, filename
+                        );
+                        rc = MFU_FAILURE;
+                    }
+                }
             }
 
             mfu_close(name, fd);
@@ -1842,9 +1983,10 @@ static int read_entry_index_xattr(
 
             /* extract count and offset array from packed index */
             if (rc == MFU_SUCCESS) {
-                uint64_t archive_size = 0;
-                uint64_t entry_size   = 0;
-                rc = index_unpack(buf, bufsize, &archive_size, &entry_size, &count, &offsets);
+                uint64_t archive_size  = 0;
+                uint64_t archive_mtime = 0;
+                uint64_t entry_size    = 0;
+                rc = index_unpack(buf, bufsize, &archive_size, &archive_mtime, &entry_size, &count, &offsets);
             }
 
             /* free buffer holding xattr value */
@@ -1998,9 +2140,10 @@ static int read_entry_index_footer(
 
                 /* extract count and offset array from packed index */
                 if (rc == MFU_SUCCESS) {
-                    uint64_t archive_size = 0;
-                    uint64_t entry_size   = 0;
-                    rc = index_unpack(buf, bufsize, &archive_size, &entry_size, &count, &offsets);
+                    uint64_t archive_size  = 0;
+                    uint64_t archive_mtime = 0;
+                    uint64_t entry_size    = 0;
+                    rc = index_unpack(buf, bufsize, &archive_size, &archive_mtime, &entry_size, &count, &offsets);
                 }
     
                 /* free buffer holding the index data */
@@ -2078,89 +2221,455 @@ static int read_entry_index(
     return rc; 
 }
 
-/* set lustre stripe parameters on a file */
-static void mfu_set_stripes(
-    const char* file,    /* path of file to be striped */
-    const char* cwd,     /* current working dir to prepend to file if not absolute */
-    size_t stripe_bytes, /* width of a single stripe in bytes */
-    int stripe_count)    /* number of stripes, -1 for all */
+/****************************************
+ * Read block compressed archives through a sparse copy
+ ***************************************/
+
+/* An archive compressed in block format (dtar -j) is read through a
+ * sparse copy of its uncompressed data, in which only the blocks that
+ * hold bytes we read are decompressed.  Listing an archive or
+ * extracting a few members then decodes the blocks that hold the
+ * index, the entry headers, and the selected entries, and the rest of
+ * the code reads the copy like any other archive. */
+typedef struct {
+    char* name;                   /* name of sparse copy */
+    int fd;                       /* sparse copy open for reading and writing */
+    mfu_decompress_reader reader; /* decodes blocks of the compressed archive */
+    uint8_t* staged;              /* flag for each block, set once it is in the copy */
+} archive_stage_t;
+
+/* set while reading an archive in block format */
+static archive_stage_t* DTAR_stage = NULL;
+
+static void stage_close(void);
+
+/* decompress block into the sparse copy unless it is there already */
+static int stage_block(archive_stage_t* st, uint64_t block)
 {
-    /* get our rank */
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (st->staged[block]) {
+        return MFU_SUCCESS;
+    }
 
-    /* if file is on lustre, set striping parameters */
-    if (rank == 0) {
-        /* get absoluate path to file */
-        mfu_path* dirpath = mfu_path_from_str(file);
-        if (! mfu_path_is_absolute(dirpath)) {
-            mfu_path_prepend_str(dirpath, cwd);
-        }
-        mfu_path_reduce(dirpath);
+    const char* data;
+    size_t size;
+    if (mfu_decompress_reader_block(&st->reader, block, &data, &size) != MFU_SUCCESS) {
+        return MFU_FAILURE;
+    }
 
-        /* get full path of item */
-        const char* name = mfu_path_strdup(dirpath);
+    off_t pos = (off_t) (block * st->reader.info.block_size);
+    ssize_t nwritten = mfu_pwrite(st->name, st->fd, data, size, pos);
+    if (nwritten != (ssize_t) size) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to write block to '%s' errno=%d %s",
+            st->name, errno, strerror(errno)
+        );
+        return MFU_FAILURE;
+    }
 
-        /* get parent directory of item */
-        mfu_path_dirname(dirpath);
-        const char* dir = mfu_path_strdup(dirpath);
+    st->staged[block] = 1;
+    return MFU_SUCCESS;
+}
 
-        /* if path is in lustre, configure the stripe parameters */
-        if (mfu_is_lustre(dir)) {
-            /* delete file incase it already exists
-             * to reassign existing stripe settings */
-            mfu_unlink(name);
+/* decompress the blocks that hold len bytes starting at pos */
+static int stage_range(archive_stage_t* st, uint64_t pos, uint64_t len)
+{
+    uint64_t size = st->reader.info.size;
+    if (len == 0 || pos >= size) {
+        return MFU_SUCCESS;
+    }
+    if (len > size - pos) {
+        len = size - pos;
+    }
 
-            /* set striping parameters */
-            mfu_stripe_set(name, stripe_bytes, stripe_count);
+    uint64_t block_size = st->reader.info.block_size;
+    uint64_t block;
+    for (block = pos / block_size; block <= (pos + len - 1) / block_size; block++) {
+        if (stage_block(st, block) != MFU_SUCCESS) {
+            return MFU_FAILURE;
         }
+    }
+    return MFU_SUCCESS;
+}
 
-        /* free temporary buffers */
-        mfu_free(&name);
-        mfu_free(&dir);
-        mfu_path_delete(&dirpath);
+/* returns value of a numeric field in a tar header,
+ * which is either octal or base-256 */
+static uint64_t stage_header_number(const char* field, size_t len)
+{
+    uint64_t val = 0;
+    size_t i = 0;
+    if ((unsigned char) field[0] & 0x80) {
+        val = (unsigned char) field[0] & 0x7f;
+        for (i = 1; i < len; i++) {
+            val = (val << 8) | (unsigned char) field[i];
+        }
+        return val;
+    }
+    while (i < len && field[i] == ' ') {
+        i++;
     }
+    while (i < len && field[i] >= '0' && field[i] <= '7') {
+        val = val * 8 + (uint64_t) (field[i] - '0');
+        i++;
+    }
+    return val;
+}
 
-    /* wait for rank 0 to set the striping parameters */
-    MPI_Barrier(MPI_COMM_WORLD);
+/* decompress the blocks that hold the header of the entry at offset,
+ * following any pax or GNU long name records that come before it */
+static int stage_header(archive_stage_t* st, uint64_t offset)
+{
+    uint64_t pos = offset;
+    while (1) {
+        char header[512];
+        if (stage_range(st, pos, sizeof(header)) != MFU_SUCCESS) {
+            return MFU_FAILURE;
+        }
+        ssize_t nread = mfu_pread(st->name, st->fd, header, sizeof(header), (off_t) pos);
+        if (nread != (ssize_t) sizeof(header)) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to read header at offset %llu in '%s'",
+                (unsigned long long) pos, st->name
+            );
+            return MFU_FAILURE;
+        }
+        pos += sizeof(header);
 
-    return;
+        /* records that extend the next header carry their data after
+         * them, padded to 512 bytes, anything else is the entry itself */
+        char type = header[156];
+        if (type != 'x' && type != 'g' && type != 'L' && type != 'K') {
+            break;
+        }
+        uint64_t size = get_filesize_padded(stage_header_number(header + 124, 12));
+        if (stage_range(st, pos, size) != MFU_SUCCESS) {
+            return MFU_FAILURE;
+        }
+        pos += size;
+    }
+    return MFU_SUCCESS;
 }
 
-static int compute_entry_sizes(
-    mfu_flist flist,
-    const mfu_param_path* cwdpath, /* current working directory used to compute relative path to each item */
-    mfu_archive_opts_t* opts,      /* options to configure archive operation */
-    void* buf,
-    size_t bufsize,
-    uint64_t* out_bytes,
-    uint64_t* out_data_bytes,
-    uint64_t* header_sizes,
-    uint64_t* entry_sizes,
-    uint64_t* offsets)
+/* decompress the blocks that hold any of the count ranges given by
+ * starts and lengths on any rank, the blocks are divided among ranks,
+ * collective */
+static int stage_ranges(uint64_t count, const uint64_t* starts, const uint64_t* lengths)
 {
     int rc = MFU_SUCCESS;
 
-    /* total bytes required to pack our part of the list */
-    uint64_t bytes = 0;
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-    /* number of data bytes (including padding) for our part of the list */
-    uint64_t data_bytes = 0;
+    archive_stage_t* st = DTAR_stage;
+    uint64_t blocks     = st->reader.info.blocks;
+    uint64_t block_size = st->reader.info.block_size;
+    uint64_t size       = st->reader.info.size;
 
-    uint64_t idx;
-    uint64_t size = mfu_flist_size(flist);
-    for (idx = 0; idx < size; idx++) {
-        /* assume the item takes no space */
-        header_sizes[idx] = 0;
-        entry_sizes[idx]  = 0;
+    /* mark the blocks we need */
+    uint8_t* need = (uint8_t*) MFU_MALLOC((size_t) blocks);
+    memset(need, 0, (size_t) blocks);
+    uint64_t i;
+    for (i = 0; i < count; i++) {
+        uint64_t pos = starts[i];
+        uint64_t len = lengths[i];
+        if (len == 0 || pos >= size) {
+            continue;
+        }
+        if (len > size - pos) {
+            len = size - pos;
+        }
+        uint64_t block;
+        for (block = pos / block_size; block <= (pos + len - 1) / block_size; block++) {
+            need[block] = 1;
+        }
+    }
 
-        /* identify item type to compute its size in the archive */
-        mfu_filetype type = mfu_flist_file_get_type(flist, idx);
-        if (type == MFU_TYPE_DIR || type == MFU_TYPE_LINK) {
-            /* directories and symlinks only need the header */
+    /* merge the blocks needed and the blocks already in the copy */
+    MPI_Allreduce(MPI_IN_PLACE, need, (int) blocks, MPI_UINT8_T, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, st->staged, (int) blocks, MPI_UINT8_T, MPI_MAX, MPI_COMM_WORLD);
+
+    /* deal out the missing blocks round robin */
+    uint64_t missing = 0;
+    uint64_t block;
+    for (block = 0; block < blocks; block++) {
+        if (! need[block] || st->staged[block]) {
+            continue;
+        }
+        if (missing % (uint64_t) ranks == (uint64_t) mfu_rank) {
+            if (stage_block(st, block) != MFU_SUCCESS) {
+                rc = MFU_FAILURE;
+            }
+        }
+        missing++;
+    }
+    mfu_fsync(st->name, st->fd);
+
+    /* all needed blocks are now in the copy */
+    for (block = 0; block < blocks; block++) {
+        if (need[block]) {
+            st->staged[block] = 1;
+        }
+    }
+    mfu_free(&need);
+
+    if (! mfu_alltrue(rc == MFU_SUCCESS, MPI_COMM_WORLD)) {
+        rc = MFU_FAILURE;
+    }
+    return rc;
+}
+
+/* decompress every block, collective */
+static int stage_all(void)
+{
+    uint64_t start = 0;
+    uint64_t len   = DTAR_stage->reader.info.size;
+    uint64_t count = (mfu_rank == 0) ? 1 : 0;
+    return stage_ranges(count, &start, &len);
+}
+
+/* if filename is in block format, set up DTAR_stage to read it
+ * through a sparse copy and decompress the tail of the archive that
+ * holds its index, collective */
+static int stage_open(const char* filename)
+{
+    /* rank 0 checks for a footer */
+    int fd = -1;
+    if (mfu_rank == 0) {
+        fd = mfu_open(filename, O_RDONLY);
+    }
+    mfu_compress_info info;
+    int compressed = (mfu_compress_read_info(filename, fd, &info) == MFU_SUCCESS);
+    if (fd >= 0) {
+        mfu_close(filename, fd);
+    }
+
+    /* nothing to do if the archive is not in block format */
+    if (! compressed) {
+        return MFU_SUCCESS;
+    }
+
+    archive_stage_t* st = (archive_stage_t*) MFU_MALLOC(sizeof(archive_stage_t));
+    if (mfu_decompress_reader_open(filename, &st->reader) != MFU_SUCCESS) {
+        mfu_free(&st);
+        return MFU_FAILURE;
+    }
+
+    /* rank 0 creates the copy next to the archive,
+     * with the size of the uncompressed data */
+    int rc = MFU_SUCCESS;
+    char* name = MFU_STRDUPF("%s.XXXXXX", filename);
+    if (mfu_rank == 0) {
+        int tmpfd = mkstemp(name);
+        if (tmpfd < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to create '%s' errno=%d %s",
+                name, errno, strerror(errno)
+            );
+            rc = MFU_FAILURE;
+        } else {
+            if (mfu_ftruncate(tmpfd, (off_t) st->reader.info.size) != 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to truncate '%s' errno=%d %s",
+                    name, errno, strerror(errno)
+                );
+                mfu_unlink(name);
+                rc = MFU_FAILURE;
+            }
+            mfu_close(name, tmpfd);
+        }
+    }
+    MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rc != MFU_SUCCESS) {
+        mfu_free(&name);
+        mfu_decompress_reader_close(&st->reader);
+        mfu_free(&st);
+        return MFU_FAILURE;
+    }
+    MPI_Bcast(name, (int) strlen(name) + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    st->name = name;
+    st->fd   = mfu_open(name, O_RDWR);
+    if (st->fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open '%s' errno=%d %s",
+            name, errno, strerror(errno)
+        );
+        rc = MFU_FAILURE;
+    }
+    st->staged = (uint8_t*) MFU_MALLOC((size_t) st->reader.info.blocks);
+    memset(st->staged, 0, (size_t) st->reader.info.blocks);
+    DTAR_stage = st;
+
+    if (mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Decompressing blocks of %s archive into '%s' as they are needed",
+            mfu_codec_name(st->reader.info.codec), name
+        );
+    }
+
+    /* rank 0 decompresses the tail that holds the footer of the index,
+     * if there is one, and then the index itself */
+    if (rc == MFU_SUCCESS && mfu_rank == 0) {
+        uint64_t size = st->reader.info.size;
+        uint64_t footer[6];
+        uint64_t tail = 2 * 512 + sizeof(footer);
+        if (size >= tail &&
+            mfu_decompress_reader_pread(&st->reader, footer, sizeof(footer), size - tail) == (ssize_t) sizeof(footer) &&
+            mfu_ntoh64(footer[5]) == DTAR_MAGIC)
+        {
+            uint64_t count = mfu_ntoh64(footer[0]);
+            uint64_t bytes = (uint64_t) index_data_size(count) + 2 * 512;
+            if (bytes <= size) {
+                rc = stage_range(st, size - bytes, bytes);
+            }
+        }
+    }
+    if (! mfu_alltrue(rc == MFU_SUCCESS, MPI_COMM_WORLD)) {
+        stage_close();
+        rc = MFU_FAILURE;
+    }
+
+    return rc;
+}
+
+/* decompress the blocks that hold the header and data of each
+ * entry in our part of flist, collective */
+static int stage_entries(
+    mfu_flist flist,         /* list of our entries */
+    uint64_t entry_start,    /* global index of our first entry */
+    const uint64_t* offsets, /* offset to header of each entry */
+    const uint64_t* data)    /* offset to data of each entry */
+{
+    uint64_t size = mfu_flist_size(flist);
+    uint64_t* starts  = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t* lengths = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t idx;
+    for (idx = 0; idx < size; idx++) {
+        uint64_t end = data[entry_start + idx];
+        if (mfu_flist_file_get_type(flist, idx) == MFU_TYPE_FILE) {
+            end += mfu_flist_file_get_size(flist, idx);
+        }
+        starts[idx]  = offsets[entry_start + idx];
+        lengths[idx] = end - starts[idx];
+    }
+    int rc = stage_ranges(size, starts, lengths);
+    mfu_free(&lengths);
+    mfu_free(&starts);
+    return rc;
+}
+
+/* delete the sparse copy and report how many blocks we decompressed,
+ * collective */
+static void stage_close(void)
+{
+    archive_stage_t* st = DTAR_stage;
+    if (st == NULL) {
+        return;
+    }
+
+    /* count blocks decompressed by any rank */
+    uint64_t blocks = st->reader.info.blocks;
+    MPI_Allreduce(MPI_IN_PLACE, st->staged, (int) blocks, MPI_UINT8_T, MPI_MAX, MPI_COMM_WORLD);
+    uint64_t staged = 0;
+    uint64_t block;
+    for (block = 0; block < blocks; block++) {
+        staged += st->staged[block];
+    }
+
+    if (st->fd >= 0) {
+        mfu_close(st->name, st->fd);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (mfu_rank == 0) {
+        mfu_unlink(st->name);
+        MFU_LOG(MFU_LOG_INFO, "Decompressed %llu of %llu blocks",
+            (unsigned long long) staged, (unsigned long long) blocks
+        );
+    }
+
+    mfu_decompress_reader_close(&st->reader);
+    mfu_free(&st->staged);
+    mfu_free(&st->name);
+    mfu_free(&DTAR_stage);
+}
+
+/* set lustre stripe parameters on a file */
+static void mfu_set_stripes(
+    const char* file,    /* path of file to be striped */
+    const char* cwd,     /* current working dir to prepend to file if not absolute */
+    size_t stripe_bytes, /* width of a single stripe in bytes */
+    int stripe_count)    /* number of stripes, -1 for all */
+{
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* if file is on lustre, set striping parameters */
+    if (rank == 0) {
+        /* get absoluate path to file */
+        mfu_path* dirpath = mfu_path_from_str(file);
+        if (! mfu_path_is_absolute(dirpath)) {
+            mfu_path_prepend_str(dirpath, cwd);
+        }
+        mfu_path_reduce(dirpath);
+
+        /* get full path of item */
+        const char* name = mfu_path_strdup(dirpath);
+
+        /* get parent directory of item */
+        mfu_path_dirname(dirpath);
+        const char* dir = mfu_path_strdup(dirpath);
+
+        /* if path is in lustre, configure the stripe parameters */
+        if (mfu_is_lustre(dir)) {
+            /* delete file incase it already exists
+             * to reassign existing stripe settings */
+            mfu_unlink(name);
+
+            /* set striping parameters */
+            mfu_stripe_set(name, stripe_bytes, stripe_count);
+        }
+
+        /* free temporary buffers */
+        mfu_free(&name);
+        mfu_free(&dir);
+        mfu_path_delete(&dirpath);
+    }
+
+    /* wait for rank 0 to set the striping parameters */
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    return;
+}
+
+static int compute_entry_sizes(
+    mfu_flist flist,
+    const mfu_param_path* cwdpath, /* current working directory used to compute relative path to each item */
+    mfu_archive_opts_t* opts,      /* options to configure archive operation */
+    mfu_file_t* mfu_file,          /* I/O filesystem functions to query items with */
+    void* buf,
+    size_t bufsize,
+    uint64_t* out_bytes,
+    uint64_t* out_data_bytes,
+    uint64_t* header_sizes,
+    uint64_t* entry_sizes,
+    uint64_t* offsets)
+{
+    int rc = MFU_SUCCESS;
+
+    /* total bytes required to pack our part of the list */
+    uint64_t bytes = 0;
+
+    /* number of data bytes (including padding) for our part of the list */
+    uint64_t data_bytes = 0;
+
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(flist);
+    for (idx = 0; idx < size; idx++) {
+        /* assume the item takes no space */
+        header_sizes[idx] = 0;
+        entry_sizes[idx]  = 0;
+
+        /* identify item type to compute its size in the archive */
+        mfu_filetype type = mfu_flist_file_get_type(flist, idx);
+        if (type == MFU_TYPE_DIR || type == MFU_TYPE_LINK) {
+            /* directories and symlinks only need the header */
             uint64_t header_size;
             encode_header(flist, idx, cwdpath,
-                buf, bufsize, opts, &header_size);
+                buf, bufsize, opts, mfu_file, &header_size);
             header_sizes[idx] = header_size;
             entry_sizes[idx]  = header_size;
         } else if (type == MFU_TYPE_FILE) {
@@ -2168,7 +2677,7 @@ static int compute_entry_sizes(
              * and things are packed into blocks of 512 bytes */
             uint64_t header_size;
             encode_header(flist, idx, cwdpath,
-                buf, bufsize, opts, &header_size);
+                buf, bufsize, opts, mfu_file, &header_size);
             header_sizes[idx] = header_size;
 
             /* get file size of this item */
@@ -2252,7 +2761,8 @@ static int mfu_flist_archive_create_copy_libcircle(
     size_t bufsize,
     int* rank_disps,
     uint64_t* data_offsets,
-    mfu_archive_opts_t* opts)
+    mfu_archive_opts_t* opts,
+    mfu_file_t* mfu_file)
 {
     int rc = MFU_SUCCESS;
 
@@ -2261,8 +2771,9 @@ static int mfu_flist_archive_create_copy_libcircle(
     mfu_file_chunk* data_chunks = mfu_file_chunk_list_alloc(flist, opts->chunk_size);
 
     /* copy handles to objects into global variables used in libcircle callback functions */
-    DTAR_flist = flist;
-    DTAR_opts  = opts;
+    DTAR_flist    = flist;
+    DTAR_opts     = opts;
+    DTAR_mfu_file = mfu_file;
 
     DTAR_writer.name = filename;
     DTAR_writer.fd   = fd;
@@ -2336,7 +2847,8 @@ static int mfu_flist_archive_create_copy_chunk(
     size_t bufsize,
     int* rank_disps,
     uint64_t* data_offsets,
-    mfu_archive_opts_t* opts)
+    mfu_archive_opts_t* opts,
+    mfu_file_t* mfu_file)
 {
     int rc = MFU_SUCCESS;
 
@@ -2364,8 +2876,8 @@ static int mfu_flist_archive_create_copy_chunk(
         if (opts->open_noatime) {
             flags |= O_NOATIME;
         }
-        int in_fd = mfu_open(in_name, flags);
-        if (in_fd < 0) {
+        mfu_file_t in_file = *mfu_file;
+        if (mfu_file_open(in_name, flags, &in_file) < 0) {
             MFU_LOG(MFU_LOG_ERR, "Failed to open source file '%s' errno=%d %s",
                 in_name, errno, strerror(errno));
             DTAR_err = 1;
@@ -2385,7 +2897,7 @@ static int mfu_flist_archive_create_copy_chunk(
 
             /* read data from source file */
             off_t pos_read = (off_t)p->offset + (off_t)bytes_copied;
-            ssize_t nread = mfu_pread(p->name, in_fd, buf, bytes_to_read, pos_read);
+            ssize_t nread = mfu_file_pread(p->name, buf, bytes_to_read, pos_read, &in_file);
             if (nread < 0) {
                 MFU_LOG(MFU_LOG_ERR, "Failed to read source file '%s' errno=%d %s",
                     in_name, errno, strerror(errno));
@@ -2411,7 +2923,7 @@ static int mfu_flist_archive_create_copy_chunk(
             mfu_progress_update(reduce_buf, create_prog);
         }
 
-        int close_rc = mfu_close(p->name, in_fd);
+        int close_rc = mfu_file_close(p->name, &in_file);
         if (close_rc == -1) {
            /* worth reporting, don't consider this a fatal error */
            MFU_LOG(MFU_LOG_ERR, "Failed to close source file '%s' errno=%d %s",
@@ -2431,6 +2943,476 @@ static int mfu_flist_archive_create_copy_chunk(
     return rc;
 }
 
+/* a piece of the uncompressed archive that one rank needs to fill in
+ * its blocks, either bytes of a header we received or a range of a
+ * source file that it reads itself */
+typedef struct {
+    uint64_t pos;       /* offset of piece in the uncompressed archive */
+    uint64_t len;       /* length of piece in bytes */
+    uint64_t file_off;  /* offset within source file */
+    const char* data;   /* header bytes, or NULL if read from file */
+    const char* name;   /* name of source file, or NULL for header bytes */
+} DTAR_segment;
+
+/* describes how pieces are routed to the ranks that compress them */
+typedef struct {
+    int ranks;        /* number of ranks */
+    uint64_t run;     /* bytes in one run of blocks compressed by a rank */
+    int pack;         /* whether to count bytes (0) or pack them (1) */
+    size_t* sizes;    /* number of bytes to send to each rank */
+    char* buf;        /* send buffer when packing */
+    size_t* disps;    /* next position in buf for each rank when packing */
+} DTAR_router;
+
+/* state passed to compress_fill */
+typedef struct {
+    DTAR_segment* segs;             /* pieces we received, sorted by position */
+    uint64_t count;                 /* number of pieces */
+    mfu_archive_opts_t* opts;       /* archive options */
+    mfu_file_t* mfu_file;           /* I/O filesystem functions to read source files with */
+    mfu_archive_file_cache_t cache; /* source file we last read from */
+    mfu_progress* prg;              /* progress messages */
+} DTAR_compress_state;
+
+/* each record is a header of three 8-byte values and a 4-byte name
+ * length, followed by the name or by the data for a header */
+#define DTAR_SEGMENT_RECORD (3 * sizeof(uint64_t) + sizeof(uint32_t))
+
+/* split a piece of the archive at boundaries of runs of blocks,
+ * and count or pack a record for each part to the rank compressing it */
+static void route_segment(
+    DTAR_router* r,
+    uint64_t pos,
+    uint64_t len,
+    const char* data,
+    const char* name,
+    uint64_t file_off)
+{
+    uint32_t namelen = 0;
+    if (name != NULL) {
+        namelen = (uint32_t) (strlen(name) + 1);
+    }
+
+    while (len > 0) {
+        /* compute length of part that stays within this run */
+        uint64_t piece = r->run - (pos % r->run);
+        if (piece > len) {
+            piece = len;
+        }
+
+        /* runs are assigned to ranks round robin */
+        int dest = (int) ((pos / r->run) % (uint64_t) r->ranks);
+        size_t size = DTAR_SEGMENT_RECORD + ((name != NULL) ? namelen : (size_t) piece);
+
+        if (r->pack) {
+            char* ptr = r->buf + r->disps[dest];
+            uint64_t vals[3] = {pos, piece, file_off};
+            memcpy(ptr, vals, sizeof(vals));
+            memcpy(ptr + sizeof(vals), &namelen, sizeof(namelen));
+            ptr += DTAR_SEGMENT_RECORD;
+            if (name != NULL) {
+                memcpy(ptr, name, namelen);
+            } else {
+                memcpy(ptr, data, (size_t) piece);
+            }
+            r->disps[dest] += size;
+        } else {
+            r->sizes[dest] += size;
+        }
+
+        /* advance to next part */
+        pos      += piece;
+        file_off += piece;
+        if (data != NULL) {
+            data += piece;
+        }
+        len -= piece;
+    }
+}
+
+static int compare_segments(const void* a, const void* b)
+{
+    const DTAR_segment* x = (const DTAR_segment*) a;
+    const DTAR_segment* y = (const DTAR_segment*) b;
+    if (x->pos < y->pos) {
+        return -1;
+    } else if (x->pos > y->pos) {
+        return 1;
+    }
+    return 0;
+}
+
+/* fill a block of the uncompressed archive for mfu_compress_stream */
+static int compress_fill(void* buf, size_t len, uint64_t pos, void* arg)
+{
+    int rc = MFU_SUCCESS;
+
+    DTAR_compress_state* st = (DTAR_compress_state*) arg;
+
+    /* anything not covered by a piece is padding */
+    memset(buf, 0, len);
+
+    /* binary search for first piece that ends after pos */
+    uint64_t low  = 0;
+    uint64_t high = st->count;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (st->segs[mid].pos + st->segs[mid].len <= pos) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    /* copy in each piece that overlaps the block */
+    uint64_t end = pos + (uint64_t) len;
+    uint64_t i;
+    for (i = low; i < st->count && st->segs[i].pos < end; i++) {
+        DTAR_segment* seg = &st->segs[i];
+
+        /* compute overlap of piece and block */
+        uint64_t start = (seg->pos > pos) ? seg->pos : pos;
+        uint64_t stop  = seg->pos + seg->len;
+        if (stop > end) {
+            stop = end;
+        }
+        char* dst = (char*) buf + (start - pos);
+        size_t count = (size_t) (stop - start);
+        uint64_t skip = start - seg->pos;
+
+        /* header bytes were sent to us */
+        if (seg->name == NULL) {
+            memcpy(dst, seg->data + skip, count);
+            continue;
+        }
+
+        /* otherwise read file data */
+        int open_rc = mfu_archive_open_file(seg->name, 1, 0, st->opts->open_noatime,
+            &st->cache, st->mfu_file);
+        if (open_rc != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open source file '%s' errno=%d %s",
+                seg->name, errno, strerror(errno));
+            rc = MFU_FAILURE;
+            continue;
+        }
+
+        size_t total = 0;
+        while (total < count) {
+            off_t off = (off_t) (seg->file_off + skip + total);
+            ssize_t nread = mfu_file_pread(seg->name, dst + total, count - total, off, &st->cache.file);
+            if (nread <= 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to read source file '%s' errno=%d %s",
+                    seg->name, errno, strerror(errno));
+                rc = MFU_FAILURE;
+                break;
+            }
+            total += (size_t) nread;
+        }
+
+        /* update number of bytes we have read for progress messages */
+        reduce_buf[REDUCE_BYTES] += total;
+        mfu_progress_update(reduce_buf, st->prg);
+    }
+
+    return rc;
+}
+
+/* compress the archive as it is written, headers, data, index, and
+ * final blocks are laid out as in an uncompressed archive, split into
+ * blocks, and compressed in parallel with mfu_compress_stream,
+ * each rank sends the headers and file ranges of its entries to the
+ * ranks that compress the blocks they fall in */
+static int mfu_flist_archive_create_compress(
+    mfu_flist flist,
+    const char* filename,
+    int fd,
+    const mfu_param_path* cwdpath,
+    uint64_t archive_size,    /* size of archive entries in bytes */
+    const uint64_t* header_sizes,
+    uint64_t* entry_offsets,
+    const uint64_t* data_offsets,
+    void* header_buf,
+    size_t header_bufsize,
+    mfu_archive_opts_t* opts,
+    mfu_file_t* mfu_file,
+    uint64_t* out_size)       /* size of uncompressed archive */
+{
+    int rc = MFU_SUCCESS;
+
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    size_t block_size = MFU_COMPRESS_BLOCK_SIZE;
+
+    /* rank 0 encodes the index as the last entry */
+    uint64_t total;
+    uint64_t* all_offsets;
+    gather_entry_index(mfu_flist_size(flist), entry_offsets, &total, &all_offsets);
+
+    char* index_buf = NULL;
+    uint64_t index_size = 0;
+    if (mfu_rank == 0) {
+        size_t size = 0;
+        if (encode_entry_index_footer(filename, total, all_offsets, opts,
+            archive_size, &index_buf, &size) != MFU_SUCCESS)
+        {
+            rc = MFU_FAILURE;
+        }
+        index_size = (uint64_t) size;
+    }
+    MPI_Bcast(&index_size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    mfu_free(&all_offsets);
+
+    /* archive ends with the index entry and two 512-byte blocks of NUL */
+    uint64_t size = archive_size + index_size + 2 * 512;
+
+    /* each rank compresses runs of consecutive blocks, fix the length
+     * of a run here since it decides where we send the data */
+    uint64_t wave_blocks = mfu_compress_wave_blocks(opts->codec, opts->level, block_size, size);
+    uint64_t run = wave_blocks * (uint64_t) block_size;
+
+    /* encode our headers once into a single buffer */
+    uint64_t idx;
+    uint64_t listsize = mfu_flist_size(flist);
+    uint64_t header_bytes = 0;
+    for (idx = 0; idx < listsize; idx++) {
+        header_bytes += header_sizes[idx];
+    }
+    char* headers = (char*) MFU_MALLOC((size_t) header_bytes);
+    uint64_t header_pos = 0;
+    for (idx = 0; idx < listsize; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(flist, idx);
+        if (type == MFU_TYPE_FILE || type == MFU_TYPE_DIR || type == MFU_TYPE_LINK) {
+            uint64_t header_size = 0;
+            encode_header(flist, idx, cwdpath, header_buf, header_bufsize, opts, mfu_file, &header_size);
+            if (header_size != header_sizes[idx]) {
+                MFU_LOG(MFU_LOG_ERR, "Header size changed for '%s'",
+                    mfu_flist_file_get_name(flist, idx));
+                DTAR_err = 1;
+                header_size = header_sizes[idx];
+            }
+            memcpy(headers + header_pos, header_buf, (size_t) header_size);
+        } else {
+            /* print a warning that we did not archive this item */
+            const char* item_name = mfu_flist_file_get_name(flist, idx);
+            MFU_LOG(MFU_LOG_WARN, "Unsupported type, cannot archive `%s'", item_name);
+        }
+        header_pos += header_sizes[idx];
+    }
+
+    /* count and then pack the pieces we send to each rank */
+    DTAR_router r;
+    r.ranks = ranks;
+    r.run   = run;
+    r.sizes = (size_t*) MFU_MALLOC(ranks * sizeof(size_t));
+    r.disps = (size_t*) MFU_MALLOC(ranks * sizeof(size_t));
+    r.buf   = NULL;
+    int i;
+    for (i = 0; i < ranks; i++) {
+        r.sizes[i] = 0;
+    }
+    for (r.pack = 0; r.pack < 2; r.pack++) {
+        if (r.pack) {
+            size_t send_total = 0;
+            for (i = 0; i < ranks; i++) {
+                r.disps[i] = send_total;
+                send_total += r.sizes[i];
+            }
+            r.buf = (char*) MFU_MALLOC(send_total);
+        }
+
+        header_pos = 0;
+        for (idx = 0; idx < listsize; idx++) {
+            uint64_t entry_offset = entry_offsets[idx];
+            route_segment(&r, entry_offset, header_sizes[idx], headers + header_pos, NULL, 0);
+            header_pos += header_sizes[idx];
+
+            mfu_filetype type = mfu_flist_file_get_type(flist, idx);
+            if (type == MFU_TYPE_FILE) {
+                const char* name = mfu_flist_file_get_name(flist, idx);
+                uint64_t fsize = mfu_flist_file_get_size(flist, idx);
+                route_segment(&r, data_offsets[idx], fsize, NULL, name, 0);
+            }
+        }
+
+        if (index_buf != NULL) {
+            route_segment(&r, archive_size, index_size, index_buf, NULL, 0);
+        }
+    }
+    mfu_free(&headers);
+    mfu_free(&index_buf);
+
+    /* get number of bytes we receive from each rank */
+    uint64_t* send_sizes = (uint64_t*) MFU_MALLOC(ranks * sizeof(uint64_t));
+    uint64_t* recv_sizes = (uint64_t*) MFU_MALLOC(ranks * sizeof(uint64_t));
+    uint64_t max_size = 0;
+    for (i = 0; i < ranks; i++) {
+        send_sizes[i] = (uint64_t) r.sizes[i];
+        if (send_sizes[i] > max_size) {
+            max_size = send_sizes[i];
+        }
+    }
+    MPI_Alltoall(send_sizes, 1, MPI_UINT64_T, recv_sizes, 1, MPI_UINT64_T, MPI_COMM_WORLD);
+    size_t recv_total = 0;
+    for (i = 0; i < ranks; i++) {
+        recv_total += (size_t) recv_sizes[i];
+    }
+    char* recvbuf = (char*) MFU_MALLOC(recv_total);
+
+    /* MPI counts and displacements are ints, so exchange pieces in rounds
+     * that send at most limit bytes to each rank, the pieces of a round
+     * are copied through temporary buffers unless one round moves all */
+    uint64_t limit = (uint64_t) INT_MAX / (uint64_t) ranks;
+    uint64_t rounds = 1;
+    MPI_Allreduce(MPI_IN_PLACE, &max_size, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+    if (max_size > limit) {
+        rounds = (max_size + limit - 1) / limit;
+    }
+    char* sendtmp = r.buf;
+    char* recvtmp = recvbuf;
+    if (rounds > 1) {
+        /* the first round moves the most, min(size, limit) per rank,
+         * so size the temporary buffers to hold that much */
+        uint64_t send_max = 0;
+        uint64_t recv_max = 0;
+        for (i = 0; i < ranks; i++) {
+            send_max += (send_sizes[i] < limit) ? send_sizes[i] : limit;
+            recv_max += (recv_sizes[i] < limit) ? recv_sizes[i] : limit;
+        }
+        sendtmp = (char*) MFU_MALLOC((size_t) send_max);
+        recvtmp = (char*) MFU_MALLOC((size_t) recv_max);
+    }
+
+    int* send_counts = (int*) MFU_MALLOC(ranks * sizeof(int));
+    int* send_disps  = (int*) MFU_MALLOC(ranks * sizeof(int));
+    int* recv_counts = (int*) MFU_MALLOC(ranks * sizeof(int));
+    int* recv_disps  = (int*) MFU_MALLOC(ranks * sizeof(int));
+    uint64_t round;
+    for (round = 0; round < rounds; round++) {
+        uint64_t start = round * limit;
+        int send_total = 0;
+        int recv_count = 0;
+        size_t send_off = 0;
+        for (i = 0; i < ranks; i++) {
+            uint64_t n = (send_sizes[i] > start) ? send_sizes[i] - start : 0;
+            if (n > limit) {
+                n = limit;
+            }
+            send_counts[i] = (int) n;
+            send_disps[i]  = send_total;
+            if (rounds > 1 && n > 0) {
+                memcpy(sendtmp + send_total, r.buf + send_off + start, (size_t) n);
+            }
+            send_total += send_counts[i];
+            send_off   += (size_t) send_sizes[i];
+
+            n = (recv_sizes[i] > start) ? recv_sizes[i] - start : 0;
+            if (n > limit) {
+                n = limit;
+            }
+            recv_counts[i] = (int) n;
+            recv_disps[i]  = recv_count;
+            recv_count += recv_counts[i];
+        }
+
+        MPI_Alltoallv(
+            sendtmp, send_counts, send_disps, MPI_BYTE,
+            recvtmp, recv_counts, recv_disps, MPI_BYTE,
+            MPI_COMM_WORLD);
+
+        /* copy what we received to its place in the full buffer */
+        if (rounds > 1) {
+            size_t recv_off = 0;
+            for (i = 0; i < ranks; i++) {
+                if (recv_counts[i] > 0) {
+                    memcpy(recvbuf + recv_off + start, recvtmp + recv_disps[i], (size_t) recv_counts[i]);
+                }
+                recv_off += (size_t) recv_sizes[i];
+            }
+        }
+    }
+    if (rounds > 1) {
+        mfu_free(&sendtmp);
+        mfu_free(&recvtmp);
+    }
+    mfu_free(&recv_sizes);
+    mfu_free(&send_sizes);
+
+    mfu_free(&recv_disps);
+    mfu_free(&recv_counts);
+    mfu_free(&send_disps);
+    mfu_free(&send_counts);
+    mfu_free(&r.buf);
+    mfu_free(&r.disps);
+    mfu_free(&r.sizes);
+
+    /* unpack pieces we received, first counting them */
+    DTAR_compress_state st;
+    st.count = 0;
+    size_t off = 0;
+    while (off < recv_total) {
+        uint64_t vals[3];
+        uint32_t namelen;
+        memcpy(vals, recvbuf + off, sizeof(vals));
+        memcpy(&namelen, recvbuf + off + sizeof(vals), sizeof(namelen));
+        off += DTAR_SEGMENT_RECORD + ((namelen > 0) ? namelen : (size_t) vals[1]);
+        st.count++;
+    }
+    st.segs = (DTAR_segment*) MFU_MALLOC(st.count * sizeof(DTAR_segment));
+    off = 0;
+    for (idx = 0; idx < st.count; idx++) {
+        uint64_t vals[3];
+        uint32_t namelen;
+        memcpy(vals, recvbuf + off, sizeof(vals));
+        memcpy(&namelen, recvbuf + off + sizeof(vals), sizeof(namelen));
+        off += DTAR_SEGMENT_RECORD;
+
+        DTAR_segment* seg = &st.segs[idx];
+        seg->pos      = vals[0];
+        seg->len      = vals[1];
+        seg->file_off = vals[2];
+        seg->data     = NULL;
+        seg->name     = NULL;
+        if (namelen > 0) {
+            seg->name = recvbuf + off;
+            off += namelen;
+        } else {
+            seg->data = recvbuf + off;
+            off += (size_t) seg->len;
+        }
+    }
+    qsort(st.segs, (size_t) st.count, sizeof(DTAR_segment), compare_segments);
+
+    /* print message to user that we're starting */
+    if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Compressing archive with %s", mfu_codec_name(opts->codec));
+    }
+
+    /* compress blocks as we fill them */
+    reduce_buf[REDUCE_BYTES] = 0;
+    st.opts = opts;
+    st.mfu_file = mfu_file;
+    st.cache.name = NULL;
+    st.prg = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, create_progress_fn);
+    int stream_rc = mfu_compress_stream(filename, fd, opts->codec, opts->level,
+        block_size, wave_blocks, size, compress_fill, &st);
+    if (stream_rc != MFU_SUCCESS) {
+        rc = MFU_FAILURE;
+    }
+    mfu_progress_complete(reduce_buf, &st.prg);
+    mfu_archive_close_file(&st.cache);
+
+    mfu_free(&st.segs);
+    mfu_free(&recvbuf);
+
+    if (rc != MFU_SUCCESS) {
+        DTAR_err = 1;
+    }
+
+    *out_size = size;
+    return rc;
+}
+
 /* each process calls with the count and a list of local offset values it has,
  * returns the global count and a newly allocated list of the global list of offsets */
 static void allgather_offsets(
@@ -2485,6 +3467,73 @@ static void allgather_offsets(
     return;
 }
 
+/* File data is copied as a list of chunks of the regular files, which
+ * is either split evenly by count across ranks (CHUNK) or balanced
+ * dynamically with libcircle (LIBCIRCLE).  A static split does as well
+ * with less overhead when chunks take about the same time, so estimate
+ * the cost of each chunk as its length plus a fixed cost to open its
+ * file, and balance dynamically only when those costs vary widely and
+ * there are enough chunks per rank for stealing to help.
+ * Returns true to balance dynamically, collective. */
+static bool balance_chunks_dynamically(
+    mfu_flist flist,     /* list of items whose data is copied */
+    uint64_t chunk_size, /* size of chunks files are split into */
+    const char* path)    /* path on the file system whose files we open */
+{
+    /* opening a file costs about as much as reading 64KB,
+     * on lustre each open is a round trip to the MDS, so count it as 1MB */
+    int is_lustre = 0;
+    if (mfu_rank == 0) {
+        is_lustre = (int) mfu_is_lustre(path);
+    }
+    MPI_Bcast(&is_lustre, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    double open_cost = is_lustre ? 1024.0 * 1024.0 : 64.0 * 1024.0;
+
+    /* sum the number of chunks and the first two moments of their cost,
+     * following how mfu_file_chunk_list_alloc splits files */
+    double sums[3] = {0.0, 0.0, 0.0};
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(flist);
+    for (idx = 0; idx < size; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(flist, idx);
+        if (type != MFU_TYPE_FILE) {
+            continue;
+        }
+
+        /* each full chunk, then a partial chunk for any remainder
+         * or for a file of 0 bytes */
+        uint64_t file_size = mfu_flist_file_get_size(flist, idx);
+        uint64_t full = file_size / chunk_size;
+        uint64_t rem  = file_size - full * chunk_size;
+        double cost = (double) chunk_size + open_cost;
+        sums[0] += (double) full;
+        sums[1] += (double) full * cost;
+        sums[2] += (double) full * cost * cost;
+        if (rem > 0 || file_size == 0) {
+            cost = (double) rem + open_cost;
+            sums[0] += 1.0;
+            sums[1] += cost;
+            sums[2] += cost * cost;
+        }
+    }
+    double all_sums[3];
+    MPI_Allreduce(sums, all_sums, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* with a few chunks per rank, there is nothing to balance */
+    double chunks = all_sums[0];
+    if (chunks <= 2.0 * (double) ranks) {
+        return false;
+    }
+
+    /* balance when the standard deviation of chunk cost exceeds half its mean */
+    double mean = all_sums[1] / chunks;
+    double var  = all_sums[2] / chunks - mean * mean;
+    return (var > 0.25 * mean * mean);
+}
+
 typedef enum {
     CREATE_DEFAULT,  /* attempt to dynamically choose best option */
     CREATE_CHUNK,    /* direct write of data, chunk list */
@@ -2527,18 +3576,25 @@ static mfu_flist_archive_create_algo select_create_algo(void)
     return algo;
 }
 
-int mfu_flist_archive_create(
+/* write items in inflist as entries of the archive starting at byte
+ * offset base, which is 0 for a new archive and the end of the last
+ * entry when adding to an existing one, on rank 0 prev_offsets lists
+ * the prev_count entries before base to keep in the index */
+static int archive_write(
     mfu_flist inflist,
     const char* filename,
-    int numpaths,
-    const mfu_param_path* paths,
     const mfu_param_path* cwdpath,
-    mfu_archive_opts_t* opts)
+    mfu_archive_opts_t* opts,
+    mfu_file_t* mfu_file,
+    uint64_t base,
+    uint64_t prev_count,
+    const uint64_t* prev_offsets)
 {
     /* assume we'll succeed */
     int rc = MFU_SUCCESS;
 
-    /* allow override algorithm choice via environment variable */
+    /* allow override algorithm choice via environment variable,
+     * otherwise pick one once we know the size of each file */
     mfu_flist_archive_create_algo algo = select_create_algo();
     if (algo == CREATE_LIBCIRCLE) {
         opts->create_libcircle = 1;
@@ -2566,8 +3622,11 @@ int mfu_flist_archive_create(
     /* we'll flip this to 1 if any process hits any error writing the archive */
     DTAR_err = 0;
 
-    /* if archive file will be on lustre, set max striping since this should be big */
-    mfu_set_stripes(filename, cwdpath->path, opts->chunk_size, -1);
+    /* if archive file will be on lustre, set max striping since this should be big,
+     * this deletes an existing file, so only do it when starting a new archive */
+    if (base == 0) {
+        mfu_set_stripes(filename, cwdpath->path, opts->chunk_size, -1);
+    }
 
     /* create the archive file */
     int flags = O_WRONLY | O_CREAT | O_CLOEXEC | O_LARGEFILE;
@@ -2605,7 +3664,7 @@ int mfu_flist_archive_create(
     uint64_t idx;
     uint64_t bytes = 0;
     uint64_t data_bytes = 0;
-    compute_entry_sizes(flist, cwdpath, opts,
+    compute_entry_sizes(flist, cwdpath, opts, mfu_file,
         header_buf, header_bufsize,
         &bytes, &data_bytes, header_sizes, entry_sizes, entry_offsets);
 
@@ -2613,14 +3672,16 @@ int mfu_flist_archive_create(
     uint64_t total_items = mfu_flist_global_size(flist);
     MPI_Allreduce(&data_bytes, &DTAR_total_bytes, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
 
-    /* compute total archive size */
+    /* compute total archive size, new entries start at base */
     uint64_t archive_size = 0;
     MPI_Allreduce(&bytes, &archive_size, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    archive_size += base;
 
     /* execute scan to figure our global base offset in the archive file */
     uint64_t global_offset = 0;
     MPI_Scan(&bytes, &global_offset, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
     global_offset -= bytes;
+    global_offset += base;
 
     /* update offsets for each of our file to their global offset */
     for (idx = 0; idx < listsize; idx++) {
@@ -2635,24 +3696,59 @@ int mfu_flist_archive_create(
 
     /* TODO: delete any existing index */
 
+    /* global list of data offsets, used when copying data */
+    uint64_t* all_offsets = NULL;
+    int* rank_disps = NULL;
+
+    /* a compressed archive is written in a single pass,
+     * with the index and final blocks compressed with the entries */
+    if (opts->codec != MFU_CODEC_NONE) {
+        /* truncate to 0 to delete any existing file contents */
+        if (mfu_rank == 0) {
+            mfu_ftruncate(fd, 0);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        mfu_flist_archive_create_compress(flist, filename, fd, cwdpath,
+            archive_size, header_sizes, entry_offsets, data_offsets,
+            header_buf, header_bufsize, opts, mfu_file, &archive_size);
+
+        goto close;
+    }
+
     /* truncate file to correct size to overwrite existing file
      * and to preallocate space on the file system */
     if (mfu_rank == 0) {
-        /* truncate to 0 to delete any existing file contents */
-        mfu_ftruncate(fd, 0);
+        /* truncate to 0 to delete any existing file contents,
+         * or to base to drop the old index and end of an archive
+         * we're adding to */
+        mfu_ftruncate(fd, base);
 
         /* truncate to proper size and preallocate space,
          * archive size represents the space to hold all entries,
          * then add on final two 512-blocks that mark the end of the archive */
         off_t final_size = archive_size + 2 * 512;
         mfu_ftruncate(fd, final_size);
-        posix_fallocate(fd, 0, final_size);
+        posix_fallocate(fd, base, final_size - base);
     }
     MPI_Barrier(MPI_COMM_WORLD);
 
+    /* entries we keep from an existing archive come first in the index */
+    uint64_t index_count = listsize;
+    uint64_t* index_offsets = entry_offsets;
+    if (prev_count > 0) {
+        index_count += prev_count;
+        index_offsets = (uint64_t*) MFU_MALLOC(index_count * sizeof(uint64_t));
+        memcpy(index_offsets, prev_offsets, prev_count * sizeof(uint64_t));
+        memcpy(index_offsets + prev_count, entry_offsets, listsize * sizeof(uint64_t));
+    }
+
     /* TODO: include index as entry when truncating/preallocating file above */
     /* record global offsets in index */
-    write_entry_index(filename, listsize, entry_offsets, opts, &archive_size);
+    write_entry_index(filename, index_count, index_offsets, opts, &archive_size);
+    if (index_offsets != entry_offsets) {
+        mfu_free(&index_offsets);
+    }
 
     /* print message to user that we're starting */
     if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
@@ -2667,7 +3763,7 @@ int mfu_flist_archive_create(
             /* write header for this item to the archive,
              * this sets DTAR_err on any error */
             write_header(flist, idx, cwdpath,
-                header_buf, header_bufsize, opts,
+                header_buf, header_bufsize, opts, mfu_file,
                 filename, fd, entry_offsets[idx]);
         } else {
             /* print a warning that we did not archive this item */
@@ -2683,23 +3779,30 @@ int mfu_flist_archive_create(
 
     /* gather global list of offset values */
     uint64_t total_count;
-    uint64_t* all_offsets;
-    int* rank_disps;
     allgather_offsets(listsize, data_offsets, &total_count, &all_offsets, &rank_disps);
 
+    /* balance data copy dynamically if chunks of source files vary in cost */
+    if (algo == CREATE_DEFAULT) {
+        opts->create_libcircle = balance_chunks_dynamically(flist, opts->chunk_size, cwdpath->path);
+        if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Selected %s algorithm to copy file data",
+                opts->create_libcircle ? "LIBCIRCLE" : "CHUNK");
+        }
+    }
+
     /* copy data from files into archive */
     if (opts->create_libcircle) {
         /* distribute flist into chunk list across procs,
          * then insert work items into libcircle */
         mfu_flist_archive_create_copy_libcircle(flist, filename, fd,
             header_buf, header_bufsize, buf, bufsize,
-            rank_disps, all_offsets, opts);
+            rank_disps, all_offsets, opts, mfu_file);
     } else {
         /* this splits the flist into a chunk list,
          * and each process directly copies its chunks */
         mfu_flist_archive_create_copy_chunk(flist, filename, fd,
             header_buf, header_bufsize, buf, bufsize,
-            rank_disps, all_offsets, opts);
+            rank_disps, all_offsets, opts, mfu_file);
     }
 
     /* rank 0 finalizes the archive by writing two 512-byte blocks of NUL
@@ -2721,6 +3824,7 @@ int mfu_flist_archive_create(
 
 //    lock_rc = llapi_group_unlock(fd, 23);
 
+close:
     /* close archive file */
     int close_rc = mfu_close(filename, fd);
     if (close_rc == -1) {
@@ -2741,6 +3845,12 @@ int mfu_flist_archive_create(
     /* free sorted list */
     mfu_flist_free(&flist);
 
+    /* get size of compressed archive */
+    uint64_t compressed_size = 0;
+    if (opts->codec != MFU_CODEC_NONE) {
+        get_filesize(filename, &compressed_size);
+    }
+
     /* stop overall time */
     time_t time_ended;
     time(&time_ended);
@@ -2757,36 +3867,327 @@ int mfu_flist_archive_create(
         struct tm* localend = localtime(&time_ended);
         strftime(endtime_str, 256, "%b-%d-%Y, %H:%M:%S", localend);
 
-        /* convert size to units */
-        double size_tmp;
-        const char* size_units;
-        mfu_format_bytes(archive_size, &size_tmp, &size_units);
+        /* convert size to units */
+        double size_tmp;
+        const char* size_units;
+        mfu_format_bytes(archive_size, &size_tmp, &size_units);
+
+        /* convert bandwidth to unit, counting only what we wrote */
+        uint64_t written = archive_size - base;
+        double agg_rate_tmp;
+        double agg_rate = (double)written / secs;
+        const char* agg_rate_units;
+        mfu_format_bw(agg_rate, &agg_rate_tmp, &agg_rate_units);
+
+        MFU_LOG(MFU_LOG_INFO, "Started:   %s", starttime_str);
+        MFU_LOG(MFU_LOG_INFO, "Completed: %s", endtime_str);
+        MFU_LOG(MFU_LOG_INFO, "Seconds: %.3lf", secs);
+        MFU_LOG(MFU_LOG_INFO, "Archive size: %.3lf %s", size_tmp, size_units);
+        MFU_LOG(MFU_LOG_INFO, "Rate: %.3lf %s " \
+                "(%.3" PRIu64 " bytes in %.3lf seconds)", \
+                agg_rate_tmp, agg_rate_units, written, secs);
+
+        if (opts->codec != MFU_CODEC_NONE) {
+            mfu_format_bytes(compressed_size, &size_tmp, &size_units);
+            MFU_LOG(MFU_LOG_INFO, "Compressed size: %.3lf %s (%s)",
+                size_tmp, size_units, mfu_codec_name(opts->codec));
+        }
+    }
+
+    /* clean up */
+    mfu_free(&all_offsets);
+    mfu_free(&rank_disps);
+    mfu_free(&header_buf);
+    mfu_free(&buf);
+    mfu_free(&data_offsets);
+    mfu_free(&entry_offsets);
+    mfu_free(&entry_sizes);
+    mfu_free(&header_sizes);
+
+    return rc;
+}
+
+static int read_entry_offsets(const char* filename, mfu_archive_opts_t* opts,
+    uint64_t* out_count, uint64_t** out_offsets, bool* out_have_index);
+static int extract_flist_offsets(const char* filename, const mfu_param_path* cwdpath,
+    uint64_t entries, uint64_t entry_start, uint64_t entry_count,
+    uint64_t* offsets, uint64_t** data_offsets, mfu_flist flist);
+
+/* maps an item to a rank by hashing its name */
+static int map_name_hash(mfu_flist flist, uint64_t idx, int ranks, const void* args)
+{
+    const char* name = mfu_flist_file_get_name(flist, idx);
+    uint32_t hash = mfu_hash_jenkins(name, strlen(name));
+    return (int) (hash % (uint32_t) ranks);
+}
+
+/* returns 1 if item i in src differs from the archive entry j in arc
+ * in type, mtime, or for regular files, size, tar headers only keep
+ * whole seconds of mtime, and directories and links have no size */
+static int entry_changed(mfu_flist src, uint64_t i, mfu_flist arc, uint64_t j)
+{
+    mfu_filetype type = mfu_flist_file_get_type(src, i);
+    if (type != mfu_flist_file_get_type(arc, j)) {
+        return 1;
+    }
+    if (mfu_flist_file_get_mtime(src, i) != mfu_flist_file_get_mtime(arc, j)) {
+        return 1;
+    }
+    if (type == MFU_TYPE_FILE &&
+        mfu_flist_file_get_size(src, i) != mfu_flist_file_get_size(arc, j))
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/* Add items of inflist that are new or changed since they were last
+ * written to the existing archive.  Entries are appended after the
+ * last entry, where the index and end of archive marker were, and a
+ * new index is written that drops the older entry of each item we
+ * append, so that no path is named twice and parallel extraction
+ * never writes the same file from two entries.  Serial tools still
+ * see every entry and keep the last one of each path. */
+static int archive_update(
+    mfu_flist inflist,
+    const char* filename,
+    const mfu_param_path* cwdpath,
+    mfu_archive_opts_t* opts,
+    mfu_file_t* mfu_file)
+{
+    int rc = MFU_SUCCESS;
+
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* compressed archives are written in a single pass */
+    if (opts->codec != MFU_CODEC_NONE) {
+        if (mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Cannot update a compressed archive '%s'", filename);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* indicate to user what phase we're in */
+    if (mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Updating %s", filename);
+    }
+
+    /* get offset to each entry */
+    uint64_t entries  = 0;
+    uint64_t* offsets = NULL;
+    bool have_index   = false;
+    int ret = read_entry_offsets(filename, opts, &entries, &offsets, &have_index);
+    if (ret != MFU_SUCCESS) {
+        if (mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Updating requires an uncompressed archive '%s'", filename);
+        }
+        return MFU_FAILURE;
+    }
+
+    /* read the header of each entry */
+    uint64_t entry_start, entry_count;
+    mfu_get_start_count(mfu_rank, ranks, entries, &entry_start, &entry_count);
+    uint64_t* data_offsets = NULL;
+    mfu_flist entry_list = mfu_flist_new();
+    ret = extract_flist_offsets(filename, cwdpath, entries, entry_start, entry_count,
+        offsets, &data_offsets, entry_list);
+    if (ret != MFU_SUCCESS) {
+        mfu_flist_free(&entry_list);
+        mfu_free(&data_offsets);
+        mfu_free(&offsets);
+        return MFU_FAILURE;
+    }
+
+    /* new entries go after the end of the last entry, tag each entry
+     * with its position in the archive, which we keep in its inode
+     * field since entries have none */
+    uint64_t end = 0;
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(entry_list);
+    for (idx = 0; idx < size; idx++) {
+        uint64_t pos = entry_start + idx;
+        mfu_flist_file_set_ino(entry_list, idx, pos);
+
+        uint64_t data_size = 0;
+        if (mfu_flist_file_get_type(entry_list, idx) == MFU_TYPE_FILE) {
+            data_size = get_filesize_padded(mfu_flist_file_get_size(entry_list, idx));
+        }
+        if (data_offsets[pos] + data_size > end) {
+            end = data_offsets[pos] + data_size;
+        }
+    }
+    uint64_t base;
+    MPI_Allreduce(&end, &base, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+
+    /* full path of the archive and its index file,
+     * which we don't add to the archive */
+    mfu_path* archive_path = mfu_path_from_str(filename);
+    if (! mfu_path_is_absolute(archive_path)) {
+        mfu_path_prepend_str(archive_path, cwdpath->path);
+    }
+    mfu_path_reduce(archive_path);
+    char* archive_name = mfu_path_strdup(archive_path);
+    char* index_name   = archive_index_filename(archive_name);
+    mfu_path_delete(&archive_path);
+
+    /* send each item and each entry to a rank by its name, so the
+     * rank can compare an item with its entry */
+    mfu_flist src = mfu_flist_remap(inflist, map_name_hash, NULL);
+    mfu_flist arc = mfu_flist_remap(entry_list, map_name_hash, NULL);
+    mfu_flist_free(&entry_list);
+
+    /* index the entries by name, if an archive has more than one
+     * entry for a path, only the last one counts */
+    uint64_t arc_size = mfu_flist_size(arc);
+    uint64_t* dropped = (uint64_t*) MFU_MALLOC(arc_size * sizeof(uint64_t));
+    uint64_t dropped_count = 0;
+    strmap* map = strmap_new();
+    for (idx = 0; idx < arc_size; idx++) {
+        const char* name = mfu_flist_file_get_name(arc, idx);
+        uint64_t pos = mfu_flist_file_get_ino(arc, idx);
+        const char* val = strmap_get(map, name);
+        if (val != NULL) {
+            uint64_t j = strtoull(val, NULL, 10);
+            uint64_t jpos = mfu_flist_file_get_ino(arc, j);
+            if (jpos > pos) {
+                dropped[dropped_count++] = pos;
+                continue;
+            }
+            dropped[dropped_count++] = jpos;
+        }
+        /* set the key directly, strmap_setf would split a name that
+         * holds an '=' at that character */
+        char idxbuf[32];
+        snprintf(idxbuf, sizeof(idxbuf), "%llu", (unsigned long long) idx);
+        strmap_set(map, name, idxbuf);
+    }
+
+    /* pick out items that are new or have changed, and drop the
+     * entry each changed item replaces */
+    mfu_flist changed = mfu_flist_subset(src);
+    uint64_t src_size = mfu_flist_size(src);
+    for (idx = 0; idx < src_size; idx++) {
+        const char* name = mfu_flist_file_get_name(src, idx);
+        if (strcmp(name, archive_name) == 0 || strcmp(name, index_name) == 0) {
+            continue;
+        }
+
+        const char* val = strmap_get(map, name);
+        if (val == NULL) {
+            mfu_flist_file_copy(src, idx, changed);
+            continue;
+        }
+
+        uint64_t j = strtoull(val, NULL, 10);
+        if (entry_changed(src, idx, arc, j)) {
+            mfu_flist_file_copy(src, idx, changed);
+            dropped[dropped_count++] = mfu_flist_file_get_ino(arc, j);
+        }
+    }
+    mfu_flist_summarize(changed);
+    strmap_delete(&map);
+    mfu_flist_free(&arc);
+    mfu_flist_free(&src);
+    mfu_free(&index_name);
+    mfu_free(&archive_name);
+
+    /* collect positions of dropped entries */
+    uint64_t dropped_total;
+    uint64_t* all_dropped;
+    int* rank_disps;
+    allgather_offsets(dropped_count, dropped, &dropped_total, &all_dropped, &rank_disps);
+    mfu_free(&rank_disps);
+    mfu_free(&dropped);
+
+    uint64_t changed_total = mfu_flist_global_size(changed);
+    if (mfu_rank == 0) {
+        if (changed_total > 0) {
+            MFU_LOG(MFU_LOG_INFO, "Adding %llu new or changed items to %llu entries",
+                (unsigned long long) changed_total, (unsigned long long) entries);
+        } else {
+            MFU_LOG(MFU_LOG_INFO, "Archive is up to date");
+        }
+    }
+
+    if (changed_total > 0) {
+        /* keep offsets of entries we don't replace, in archive order */
+        uint64_t prev_count = 0;
+        uint64_t* prev_offsets = NULL;
+        if (mfu_rank == 0) {
+            char* keep = (char*) MFU_MALLOC(entries > 0 ? entries : 1);
+            memset(keep, 1, entries);
+            for (idx = 0; idx < dropped_total; idx++) {
+                keep[all_dropped[idx]] = 0;
+            }
+            prev_offsets = (uint64_t*) MFU_MALLOC(entries * sizeof(uint64_t));
+            for (idx = 0; idx < entries; idx++) {
+                if (keep[idx]) {
+                    prev_offsets[prev_count++] = offsets[idx];
+                }
+            }
+            mfu_free(&keep);
+
+            /* an index file or xattr would now be stale, the new index
+             * replaces it */
+            char* idxfile = archive_index_filename(filename);
+            mfu_unlink(idxfile);
+            mfu_free(&idxfile);
+#if DCOPY_USE_XATTRS
+            removexattr(filename, "user.dtar.idx");
+#endif /* DCOPY_USE_XATTRS */
+        }
+
+        rc = archive_write(changed, filename, cwdpath, opts, mfu_file, base, prev_count, prev_offsets);
+        mfu_free(&prev_offsets);
+    }
+
+    mfu_flist_free(&changed);
+    mfu_free(&all_dropped);
+    mfu_free(&data_offsets);
+    mfu_free(&offsets);
+
+    return rc;
+}
+
+int mfu_flist_archive_create(
+    mfu_flist inflist,
+    const char* filename,
+    int numpaths,
+    const mfu_param_path* paths,
+    const mfu_param_path* cwdpath,
+    mfu_archive_opts_t* opts,
+    mfu_file_t* mfu_file)
+{
+    mfu_trace_push("archive create");
 
-        /* convert bandwidth to unit */
-        double agg_rate_tmp;
-        double agg_rate = (double)archive_size / secs;
-        const char* agg_rate_units;
-        mfu_format_bw(agg_rate, &agg_rate_tmp, &agg_rate_units);
+    /* libarchive reads xattrs, ACLs, and flags from a POSIX file descriptor */
+    bool preserve = (opts->preserve_xattrs || opts->preserve_acls || opts->preserve_fflags);
+    if (preserve && mfu_file->type != POSIX) {
+        if (mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Preserving xattrs, ACLs, or flags requires POSIX source files");
+        }
+        mfu_trace_pop();
+        return MFU_FAILURE;
+    }
 
-        MFU_LOG(MFU_LOG_INFO, "Started:   %s", starttime_str);
-        MFU_LOG(MFU_LOG_INFO, "Completed: %s", endtime_str);
-        MFU_LOG(MFU_LOG_INFO, "Seconds: %.3lf", secs);
-        MFU_LOG(MFU_LOG_INFO, "Archive size: %.3lf %s", size_tmp, size_units);
-        MFU_LOG(MFU_LOG_INFO, "Rate: %.3lf %s " \
-                "(%.3" PRIu64 " bytes in %.3lf seconds)", \
-                agg_rate_tmp, agg_rate_units, archive_size, secs);
+    /* add to the archive if asked to update one that exists */
+    int exists = 0;
+    if (opts->update) {
+        if (mfu_rank == 0) {
+            exists = (mfu_access(filename, F_OK) == 0);
+        }
+        MPI_Bcast(&exists, 1, MPI_INT, 0, MPI_COMM_WORLD);
     }
 
-    /* clean up */
-    mfu_free(&all_offsets);
-    mfu_free(&rank_disps);
-    mfu_free(&header_buf);
-    mfu_free(&buf);
-    mfu_free(&data_offsets);
-    mfu_free(&entry_offsets);
-    mfu_free(&entry_sizes);
-    mfu_free(&header_sizes);
+    int rc;
+    if (exists) {
+        rc = archive_update(inflist, filename, cwdpath, opts, mfu_file);
+    } else {
+        rc = archive_write(inflist, filename, cwdpath, opts, mfu_file, 0, 0, NULL);
+    }
 
+    mfu_trace_pop();
     return rc;
 }
 
@@ -2839,13 +4240,30 @@ typedef enum {
     SCAN_PARALLEL, /* distributed read, with parallel scan (experimental, requires a well-formed archive) */
 } mfu_flist_archive_scan_algo;
 
-static mfu_flist_archive_scan_algo select_scan_algo(void)
+/* A single process scans by reading each header and seeking past the
+ * data of its entry, while the distributed scans read the whole archive.
+ * Reading in parallel only pays off with more than one rank and when
+ * there is at least a full buffer for each rank to read, so the default
+ * is a linear scan in that case and a single process otherwise.  The
+ * parallel scan is never chosen on its own since it can be fooled by
+ * an archive stored as a file in the archive. */
+static mfu_flist_archive_scan_algo select_scan_algo(
+    const char* filename,     /* name of archive to scan */
+    mfu_archive_opts_t* opts) /* options to configure scan */
 {
     mfu_flist_archive_scan_algo algo = SCAN_LINEAR;
 
     const char varname[] = "MFU_FLIST_ARCHIVE_SCAN";
     const char* value = getenv(varname);
     if (value == NULL) {
+        int ranks;
+        MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+        uint64_t file_size = 0;
+        if (get_filesize(filename, &file_size) == MFU_SUCCESS &&
+            (ranks == 1 || file_size < (uint64_t) ranks * opts->buf_size))
+        {
+            algo = SCAN_SINGLE;
+        }
         return algo;
     }
 
@@ -3937,6 +5355,13 @@ static int extract_flist_offsets(
         /* compute offset and seek to this entry */
         uint64_t idx = entry_start + count;
         off_t offset = (off_t) offsets[idx];
+
+        /* decompress the header of an entry in a compressed archive */
+        if (DTAR_stage != NULL && stage_header(DTAR_stage, offsets[idx]) != MFU_SUCCESS) {
+            rc = MFU_FAILURE;
+            break;
+        }
+
         off_t pos = mfu_lseek(filename, fd, offset, SEEK_SET);
         if (pos == (off_t)-1) {
             MFU_LOG(MFU_LOG_ERR, "Failed to lseek to offset %llu in %s (errno=%d %s)",
@@ -4485,7 +5910,8 @@ static int extract_files_offsets_chunk_libcircle(
     uint64_t entry_count,     /* number of consecutive items this process is responsible for */
     uint64_t* data_offsets,   /* offset to start of data for each entry */
     mfu_flist flist,          /* file list whose local elements correspond to items to extract */
-    mfu_archive_opts_t* opts) /* options to configure extract operation */
+    mfu_archive_opts_t* opts, /* options to configure extract operation */
+    mfu_file_t* mfu_file)     /* I/O filesystem functions to write items with */
 {
     /* assume we'll succeed */
     int rc = MFU_SUCCESS;
@@ -4545,6 +5971,7 @@ static int extract_files_offsets_chunk_libcircle(
 
     /* save list to global for encode */
     DTAR_opts         = opts;
+    DTAR_mfu_file     = mfu_file;
     DTAR_data_offsets = data_offsets;
     DTAR_rank_disps   = rank_disps;
     DTAR_data_chunks  = data_chunks;
@@ -4609,7 +6036,8 @@ static int extract_files_offsets_chunk(
     uint64_t entry_count,     /* number of consecutive items this process is responsible for */
     uint64_t* data_offsets,   /* offset to start of data for each entry */
     mfu_flist flist,          /* file list whose local elements correspond to items to extract */
-    mfu_archive_opts_t* opts) /* options to configure extract operation */
+    mfu_archive_opts_t* opts, /* options to configure extract operation */
+    mfu_file_t* mfu_file)     /* I/O filesystem functions to write items with */
 {
     /* assume we'll succeed */
     int rc = MFU_SUCCESS;
@@ -4674,8 +6102,8 @@ static int extract_files_offsets_chunk(
 
         /* open the destination file for writing */
         const char* out_name = p->name;
-        int out_fd = mfu_open(out_name, O_WRONLY);
-        if (out_fd < 0) {
+        mfu_file_t out_file = *mfu_file;
+        if (mfu_file_open(out_name, O_WRONLY, &out_file) < 0) {
             MFU_LOG(MFU_LOG_ERR, "Failed to open destination file '%s' errno=%d %s",
                 out_name, errno, strerror(errno));
             rc = MFU_FAILURE;
@@ -4712,7 +6140,7 @@ static int extract_files_offsets_chunk(
 
             /* write data to the file */
             off_t pos_write = (off_t)p->offset + (off_t)bytes_copied;
-            ssize_t nwritten = mfu_pwrite(out_name, out_fd, buf, nread, pos_write);
+            ssize_t nwritten = mfu_file_pwrite(out_name, buf, nread, pos_write, &out_file);
             if (nwritten < 0) {
                 MFU_LOG(MFU_LOG_ERR, "Failed to write to destination file '%s' errno=%d %s",
                     out_name, errno, strerror(errno));
@@ -4730,7 +6158,7 @@ static int extract_files_offsets_chunk(
         }
 
         /* close the user file being written */
-        int close_rc = mfu_close(out_name, out_fd);
+        int close_rc = mfu_file_close(out_name, &out_file);
         if (close_rc == -1) {
            /* worth reporting, don't consider this a fatal error */
            MFU_LOG(MFU_LOG_ERR, "Failed to close destination file '%s' errno=%d %s",
@@ -4962,7 +6390,8 @@ static int extract_symlinks(
     const char* filename,     /* name of archive file */
     mfu_flist flist,          /* file list of items */
     uint64_t* offsets,        /* offset of each item in the archive */
-    mfu_archive_opts_t* opts) /* options to configure extraction operation */
+    mfu_archive_opts_t* opts, /* options to configure extraction operation */
+    mfu_file_t* mfu_file)     /* I/O filesystem functions to create links with */
 {
     int rc = MFU_SUCCESS;
 
@@ -5092,14 +6521,14 @@ static int extract_symlinks(
         }
 
         /* create the link on the file system */
-        int symlink_rc = mfu_symlink(target, name);
+        int symlink_rc = mfu_file_symlink(target, name, mfu_file);
         if (symlink_rc != 0) {
             /* TODO: check whether user wants overwrite */
             if (errno == EEXIST) {
                 /* failed because something exists,
                  * attempt to delete item and try again */
-                mfu_unlink(name);
-                symlink_rc = mfu_symlink(target, name);
+                mfu_file_unlink(name, mfu_file);
+                symlink_rc = mfu_file_symlink(target, name, mfu_file);
             }
 
             /* if we still failed, give up */
@@ -5397,11 +6826,263 @@ static mfu_flist flist_get_dirs(mfu_flist flist)
     return flist_dirs;
 }
 
-/* given an archive file name, extract items into cwdpath according to options */
-int mfu_flist_archive_extract(
+/* get offset of each entry in the archive, from its index if it has one,
+ * and otherwise by scanning the archive, returns MFU_SUCCESS if found */
+static int read_entry_offsets(
+    const char* filename,     /* name of archive file */
+    mfu_archive_opts_t* opts, /* options to configure scan */
+    uint64_t* out_count,      /* number of entries in archive */
+    uint64_t** out_offsets,   /* allocated list of offsets to each entry */
+    bool* out_have_index)     /* whether offsets came from an index */
+{
+    /* attempt to read offsets from our index if we can find it */
+    *out_have_index = true;
+    int ret = read_entry_index(filename, out_count, out_offsets);
+    if (ret != MFU_SUCCESS) {
+        /* don't have an index file */
+        *out_have_index = false;
+
+        /* scanning a compressed archive reads all of it */
+        if (DTAR_stage != NULL && stage_all() != MFU_SUCCESS) {
+            return MFU_FAILURE;
+        }
+
+        /* Next best option is to scan the archive
+         * and see if we can extract entry offsets. */
+        mfu_flist_archive_scan_algo scan_algo = select_scan_algo(filename, opts);
+        if (scan_algo == SCAN_LINEAR || scan_algo == SCAN_PARALLEL) {
+            /* Read the full archive and execute the scan in memory. */
+            ret = index_entries_distread(filename, opts, scan_algo, out_count, out_offsets);
+        } else {
+            /* Fall back to scan archive with a single process */
+            ret = index_entries(filename, out_count, out_offsets);
+        }
+
+        /* failed to get entry offsets if this fails,
+         * perhaps we have a compressed archive? */
+    }
+    return ret;
+}
+
+/* returns 1 if the entry at path relative to the extract directory,
+ * or one of its parent directories, matches one of the member patterns */
+static int match_member(const char* relpath, uint64_t count, char** members)
+{
+    /* work on a copy of the path that we can shorten to its parents */
+    char* path = MFU_STRDUP(relpath);
+    int match = 0;
+    while (! match) {
+        /* check the current path against each pattern */
+        uint64_t i;
+        for (i = 0; i < count; i++) {
+            /* ignore a trailing slash on a pattern that names a directory */
+            const char* pattern = members[i];
+            size_t len = strlen(pattern);
+            while (len > 1 && pattern[len - 1] == '/') {
+                len--;
+            }
+            char* pat = (char*) MFU_MALLOC(len + 1);
+            memcpy(pat, pattern, len);
+            pat[len] = '\0';
+            if (fnmatch(pat, path, 0) == 0) {
+                match = 1;
+            }
+            mfu_free(&pat);
+            if (match) {
+                break;
+            }
+        }
+
+        /* move up to the parent directory */
+        char* slash = strrchr(path, '/');
+        if (slash == NULL || slash == path) {
+            break;
+        }
+        *slash = '\0';
+    }
+    mfu_free(&path);
+    return match;
+}
+
+/* returns 1 if item idx in flist was selected by opts->members and
+ * opts->member_pred, cwd is the directory entries are placed under
+ * and prefix is the length to strip from a full path to get the
+ * name of the entry in the archive */
+static int member_selected(
+    mfu_flist flist,
+    uint64_t idx,
+    const char* cwd,
+    size_t prefix,
+    const mfu_archive_opts_t* opts)
+{
+    const char* name = mfu_flist_file_get_name(flist, idx);
+    const char* relpath = name;
+    if (strlen(name) >= prefix && strncmp(name, cwd, strlen(cwd)) == 0) {
+        relpath = name + prefix;
+    }
+
+    if (opts->num_members > 0 && ! match_member(relpath, opts->num_members, opts->members)) {
+        return 0;
+    }
+    if (opts->member_pred != NULL && ! mfu_pred_execute(flist, idx, opts->member_pred)) {
+        return 0;
+    }
+    return 1;
+}
+
+/* returns length of prefix to strip from a full path under cwd
+ * to get the name of the entry in the archive */
+static size_t member_prefix(const char* cwd)
+{
+    size_t prefix = strlen(cwd);
+    if (prefix > 0 && cwd[prefix - 1] != '/') {
+        prefix++;
+    }
+    return prefix;
+}
+
+/* create any missing directories leading up to the given item,
+ * starting below the extract directory of length prefix */
+static int create_parents(const char* name, size_t prefix, mfu_file_t* mfu_file)
+{
+    int rc = MFU_SUCCESS;
+
+    char* path = MFU_STRDUP(name);
+    char* p = path + prefix;
+    while ((p = strchr(p + 1, '/')) != NULL) {
+        *p = '\0';
+        int mkdir_rc = mfu_file_mkdir(path, DCOPY_DEF_PERMS_DIR, mfu_file);
+        if (mkdir_rc < 0 && errno != EEXIST) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to create directory `%s' (errno=%d %s)",
+                path, errno, strerror(errno)
+            );
+            rc = MFU_FAILURE;
+        }
+        *p = '/';
+    }
+    mfu_free(&path);
+
+    return rc;
+}
+
+/* Narrow the list of entries read from the archive down to those
+ * selected by opts->members and opts->member_pred, and create the
+ * parent directories of the selected entries.  The list, offsets,
+ * and entry range are replaced with those of the selected entries,
+ * so that the rest of the extract only touches those entries. */
+static int select_members(
+    const mfu_param_path* cwdpath, /* path entries are extracted under */
+    mfu_archive_opts_t* opts,      /* options naming members to select */
+    mfu_file_t* mfu_file,          /* I/O filesystem functions to create directories with */
+    mfu_flist* pflist,             /* list of our entries, replaced with selected entries */
+    uint64_t** poffsets,           /* offset to each entry, replaced with selected entries */
+    uint64_t** pdata_offsets,      /* offset to data of each entry, replaced with selected entries */
+    uint64_t* pentries,            /* total number of entries, updated */
+    uint64_t* pentry_start,        /* global index of our first entry, updated */
+    uint64_t* pentry_count)        /* number of our entries, updated */
+{
+    int rc = MFU_SUCCESS;
+
+    /* indicate to user what phase we're in */
+    if (mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Selecting members");
+    }
+
+    mfu_flist flist = *pflist;
+    uint64_t* offsets = *poffsets;
+    uint64_t* data_offsets = *pdata_offsets;
+    uint64_t entry_start = *pentry_start;
+
+    /* compute length of prefix to strip from a full path
+     * to get the name of the entry in the archive */
+    const char* cwd = cwdpath->path;
+    size_t prefix = member_prefix(cwd);
+
+    /* copy selected items into a new list, and record their offsets */
+    mfu_flist selected = mfu_flist_subset(flist);
+    uint64_t size = mfu_flist_size(flist);
+    uint64_t* sel_offsets = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t* sel_data    = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t count = 0;
+    const char* last_parent = NULL;
+    size_t last_parent_len = 0;
+    uint64_t idx;
+    for (idx = 0; idx < size; idx++) {
+        /* check the item against the member list and the predicate */
+        const char* name = mfu_flist_file_get_name(flist, idx);
+        if (! member_selected(flist, idx, cwd, prefix, opts)) {
+            continue;
+        }
+
+        /* create parent directories, skipping the common case of
+         * consecutive items in the same directory */
+        const char* slash = strrchr(name, '/');
+        size_t parent_len = (slash != NULL) ? (size_t) (slash - name) : 0;
+        if (parent_len > prefix &&
+            (last_parent == NULL || parent_len != last_parent_len ||
+             strncmp(name, last_parent, parent_len) != 0))
+        {
+            if (create_parents(name, prefix, mfu_file) != MFU_SUCCESS) {
+                rc = MFU_FAILURE;
+            }
+            last_parent     = name;
+            last_parent_len = parent_len;
+        }
+
+        mfu_flist_file_copy(flist, idx, selected);
+        sel_offsets[count] = offsets[entry_start + idx];
+        sel_data[count]    = data_offsets[entry_start + idx];
+        count++;
+    }
+    mfu_flist_summarize(selected);
+    uint64_t all_entries = mfu_flist_global_size(flist);
+
+    /* gather offsets of selected entries to all ranks */
+    uint64_t total;
+    int* rank_disps;
+    uint64_t* all_offsets;
+    uint64_t* all_data;
+    allgather_offsets(count, sel_offsets, &total, &all_offsets, &rank_disps);
+    mfu_free(&rank_disps);
+    allgather_offsets(count, sel_data, &total, &all_data, &rank_disps);
+    mfu_free(&rank_disps);
+    mfu_free(&sel_data);
+    mfu_free(&sel_offsets);
+
+    /* replace list and offsets with those of selected entries,
+     * the list is not spread since entries must stay in archive order
+     * to match their offsets, file data is still balanced across
+     * ranks since it is split into chunks */
+    mfu_flist_free(pflist);
+    mfu_free(poffsets);
+    mfu_free(pdata_offsets);
+    *pflist        = selected;
+    *poffsets      = all_offsets;
+    *pdata_offsets = all_data;
+    *pentries      = total;
+    *pentry_start  = mfu_flist_global_offset(selected);
+    *pentry_count  = mfu_flist_size(selected);
+
+    if (mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Selected %llu of %llu entries",
+            (unsigned long long) total, (unsigned long long) all_entries);
+    }
+
+    /* check that all ranks created their parent directories */
+    if (! mfu_alltrue(rc == MFU_SUCCESS, MPI_COMM_WORLD)) {
+        rc = MFU_FAILURE;
+    }
+
+    return rc;
+}
+
+/* extract items from an uncompressed archive file, or the sparse copy
+ * of a compressed one, into cwdpath according to options */
+static int archive_extract(
     const char* filename,          /* name of archive file */
     const mfu_param_path* cwdpath, /* path to prepend to entries in archive to build full path */
-    mfu_archive_opts_t* opts)      /* options to configure extract operation */
+    mfu_archive_opts_t* opts,      /* options to configure extract operation */
+    mfu_file_t* mfu_file)          /* I/O filesystem functions to create items with */
 {
     int rc = MFU_SUCCESS;
 
@@ -5414,11 +7095,6 @@ int mfu_flist_archive_extract(
     time(&time_started);
     double wtime_started = MPI_Wtime();
 
-    /* indicate to user what phase we're in */
-    if (mfu_rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Extracting %s", filename);
-    }
-
     /* get extraction algorithm */
     mfu_flist_archive_extract_algo algo = select_extract_algo();
 
@@ -5471,32 +7147,8 @@ int mfu_flist_archive_extract(
     uint64_t entries  = 0;     /* number of entries */
     uint64_t* offsets = NULL;  /* byte offset within archive for each entry */
     if (algo != LIBARCHIVE) {
-        /* optimistically assume we'll get offsets from and index file */
-        have_offsets = true;
-        have_index   = true;
-
-        /* attempt to read offsets from our index if we can find it */
-        int ret = read_entry_index(filename, &entries, &offsets);
-        if (ret != MFU_SUCCESS) {
-            /* don't have an index file */
-            have_index = false;
-
-            /* Next best option is to scan the archive
-             * and see if we can extract entry offsets. */
-            mfu_flist_archive_scan_algo scan_algo = select_scan_algo();
-            if (scan_algo == SCAN_LINEAR || scan_algo == SCAN_PARALLEL) {
-                /* Read the full archive and execute the scan in memory. */
-                ret = index_entries_distread(filename, opts, scan_algo, &entries, &offsets);
-            } else {
-                /* Fall back to scan archive with a single process */
-                ret = index_entries(filename, &entries, &offsets);
-            }
-            if (ret != MFU_SUCCESS) {
-                /* failed to get entry offsets,
-                 * perhaps we have a compressed archive? */
-                have_offsets = false;
-            }
-        }
+        int ret = read_entry_offsets(filename, opts, &entries, &offsets, &have_index);
+        have_offsets = (ret == MFU_SUCCESS);
     }
 
     /* bail out if user requested an algorithm that requires offsets
@@ -5513,6 +7165,17 @@ int mfu_flist_archive_extract(
         return MFU_FAILURE;
     }
 
+    /* selecting members requires offsets to seek to each entry */
+    bool select = (opts->num_members > 0 || opts->member_pred != NULL);
+    if (select && !have_offsets) {
+        if (mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Extracting selected members requires an index or an uncompressed archive");
+        }
+        mfu_create_opts_delete(&create_opts);
+        mfu_free(&offsets);
+        return MFU_FAILURE;
+    }
+
     /* to preserve ACLs and XATTRs, we need to extract with libarchive for now */
     bool extract_with_libarchive = (opts->preserve_acls || opts->preserve_fflags);
     if (extract_with_libarchive) {
@@ -5523,7 +7186,7 @@ int mfu_flist_archive_extract(
                 MFU_LOG(MFU_LOG_ERR, "To extract ACLs, one must extract with libarchive: LIBARCHIVE or LIBARCHIVE_IDX");
             }
             mfu_create_opts_delete(&create_opts);
-            return MFU_FAILURE;
+                return MFU_FAILURE;
         }
 
         /* force to an algorithm that extracts items with libarchive */
@@ -5534,17 +7197,32 @@ int mfu_flist_archive_extract(
         }
     }
 
+    /* libarchive writes items and xattrs through POSIX calls,
+     * so other file systems need offsets to write data directly */
+    if (mfu_file->type != POSIX) {
+        bool posix_only = (algo == LIBARCHIVE || algo == LIBARCHIVE_IDX ||
+            opts->preserve_xattrs || !have_offsets);
+        if (posix_only) {
+            if (mfu_rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Extracting to a non-POSIX file system requires an index "
+                    "and the CHUNK or LIBCIRCLE algorithm without xattrs, ACLs, or flags");
+            }
+            mfu_create_opts_delete(&create_opts);
+            mfu_free(&offsets);
+                return MFU_FAILURE;
+        }
+    }
+
     /* divide entries among ranks */
     uint64_t entry_start, entry_count;
     mfu_get_start_count(mfu_rank, ranks, entries, &entry_start, &entry_count);
 
     /* if we constructed an offset list by scanning the archive,
      * save it to an index in case we need to extract again
-     * since scanning can be expensive */
-    if (have_offsets && !have_index) {
-        /* TODO: when encoding index as the last entry, we need to know the archive size,
-         * and we'll need to rewrite the two trailing 512-byte blocks */
-        //write_entry_index(filename, entry_count, &offsets[entry_start], opts, &archive_size);
+     * since scanning can be expensive, this goes to a file next
+     * to the archive by default since we don't rewrite the archive
+     * to add a footer */
+    if (have_offsets && !have_index && DTAR_stage == NULL) {
         write_entry_index(filename, entry_count, &offsets[entry_start], opts, NULL);
     }
 
@@ -5573,6 +7251,24 @@ int mfu_flist_archive_extract(
         return MFU_FAILURE;
     }
 
+    /* narrow the list down to the members the user asked for,
+     * so only their data is read from the archive */
+    if (select) {
+        ret = select_members(cwdpath, opts, mfu_file, &flist, &offsets, &data_offsets,
+            &entries, &entry_start, &entry_count);
+        if (ret != MFU_SUCCESS) {
+            rc = MFU_FAILURE;
+        }
+    }
+
+    /* decompress the blocks that hold the selected entries */
+    if (select && DTAR_stage != NULL) {
+        ret = stage_entries(flist, entry_start, offsets, data_offsets);
+        if (ret != MFU_SUCCESS) {
+            rc = MFU_FAILURE;
+        }
+    }
+
     /* sum up bytes and items in list for tracking progress */
     DTAR_total_bytes = flist_sum_bytes(flist);
     DTAR_total_items = mfu_flist_global_size(flist);
@@ -5580,11 +7276,21 @@ int mfu_flist_archive_extract(
     /* print summary of what's in archive before extracting items */
     mfu_flist_print_summary(flist);
 
+    /* when reading data directly from the archive, balance the copy
+     * dynamically if chunks of the files vary in cost */
+    if (have_offsets && algo == DEFAULT) {
+        algo = balance_chunks_dynamically(flist, opts->chunk_size, cwdpath->path) ? LIBCIRCLE : CHUNK;
+        if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Selected %s algorithm to extract file data",
+                (algo == LIBCIRCLE) ? "LIBCIRCLE" : "CHUNK");
+        }
+    }
+
     /* Create all directories in advance to avoid races between a process trying to create
      * a child item and another process responsible for the parent directory.
      * The libarchive code does not remove existing directories,
      * even in normal mode with overwrite. */
-    mfu_flist_mkdir(flist, create_opts);
+    mfu_flist_mkdir(flist, create_opts, mfu_file);
 
     /* extract files from archive */
     if (have_offsets) {
@@ -5602,10 +7308,10 @@ int mfu_flist_archive_extract(
 
             /* since more than one process may write to the same file,
              * create the files in advance */
-            mfu_flist_mknod(flist, create_opts);
+            mfu_flist_mknod(flist, create_opts, mfu_file);
 
             /* create symlinks */
-            int tmp_rc = extract_symlinks(filename, flist, offsets, opts);
+            int tmp_rc = extract_symlinks(filename, flist, offsets, opts, mfu_file);
             if (tmp_rc != MFU_SUCCESS) {
                 /* tried but failed to get some symlink, so mark as failure */
                 ret = tmp_rc;
@@ -5627,10 +7333,10 @@ int mfu_flist_archive_extract(
             /* extract file data from archive */
             if (algo == CHUNK) {
                 ret = extract_files_offsets_chunk(filename, flags,
-                    entries, entry_start, entry_count, data_offsets, flist, opts);
-            } else { /* LIBCIRCLE or DEFAULT */
+                    entries, entry_start, entry_count, data_offsets, flist, opts, mfu_file);
+            } else { /* LIBCIRCLE */
                 ret = extract_files_offsets_chunk_libcircle(filename, flags,
-                    entries, entry_start, entry_count, data_offsets, flist, opts);
+                    entries, entry_start, entry_count, data_offsets, flist, opts, mfu_file);
             }
 
             /* set timestamps and permissions on everything */
@@ -5638,7 +7344,7 @@ int mfu_flist_archive_extract(
             if (mfu_rank == 0) {
                 MFU_LOG(MFU_LOG_INFO, "Updating timestamps and permissions");
             }
-            mfu_flist_metadata_apply(flist, create_opts);
+            mfu_flist_metadata_apply(flist, create_opts, mfu_file);
         }
     } else {
         /* If we don't have offsets, have each process read the archive from the start.
@@ -5671,7 +7377,7 @@ int mfu_flist_archive_extract(
 
         /* set timestamps on the directories, do this after writing all items
          * since creating items in a directory will have changed its timestamp */
-        mfu_flist_metadata_apply(flist_dirs, create_opts);
+        mfu_flist_metadata_apply(flist_dirs, create_opts, mfu_file);
 
         /* free the list of directories */
         mfu_flist_free(&flist_dirs);
@@ -5755,6 +7461,128 @@ int mfu_flist_archive_extract(
     return rc;
 }
 
+/* given an archive file name, extract items into cwdpath according to options */
+int mfu_flist_archive_extract(
+    const char* filename,          /* name of archive file */
+    const mfu_param_path* cwdpath, /* path to prepend to entries in archive to build full path */
+    mfu_archive_opts_t* opts,      /* options to configure extract operation */
+    mfu_file_t* mfu_file)          /* I/O filesystem functions to create items with */
+{
+    mfu_trace_push("archive extract");
+
+    /* indicate to user what phase we're in */
+    if (mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Extracting %s", filename);
+    }
+
+    /* read an archive in block format through a sparse copy,
+     * all of which is needed unless we select some members */
+    if (stage_open(filename) != MFU_SUCCESS) {
+        mfu_trace_pop();
+        return MFU_FAILURE;
+    }
+    bool select = (opts->num_members > 0 || opts->member_pred != NULL);
+    if (DTAR_stage != NULL && !select && stage_all() != MFU_SUCCESS) {
+        stage_close();
+        mfu_trace_pop();
+        return MFU_FAILURE;
+    }
+
+    const char* name = (DTAR_stage != NULL) ? DTAR_stage->name : filename;
+    int rc = archive_extract(name, cwdpath, opts, mfu_file);
+
+    stage_close();
+
+    mfu_trace_pop();
+    return rc;
+}
+
+/* build a list of the entries of an uncompressed archive, or the
+ * sparse copy of a compressed one, from its index */
+static int archive_list(
+    const char* filename,          /* name of archive file */
+    const mfu_param_path* cwdpath, /* path to prepend to entries in archive to build full path */
+    mfu_archive_opts_t* opts,      /* options to configure list operation */
+    mfu_flist flist)               /* list in which to insert entries */
+{
+    int rc = MFU_SUCCESS;
+
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* get offset to each entry */
+    uint64_t entries  = 0;
+    uint64_t* offsets = NULL;
+    bool have_index   = false;
+    int ret = read_entry_offsets(filename, opts, &entries, &offsets, &have_index);
+    if (ret != MFU_SUCCESS) {
+        if (mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Listing requires an index or an uncompressed archive");
+        }
+        return MFU_FAILURE;
+    }
+
+    /* divide entries among ranks, and read the header of each one */
+    uint64_t entry_start, entry_count;
+    mfu_get_start_count(mfu_rank, ranks, entries, &entry_start, &entry_count);
+    uint64_t* data_offsets = NULL;
+    mfu_flist entry_list = mfu_flist_new();
+    ret = extract_flist_offsets(filename, cwdpath, entries, entry_start, entry_count,
+        offsets, &data_offsets, entry_list);
+    if (ret != MFU_SUCCESS) {
+        rc = MFU_FAILURE;
+    }
+
+    /* copy entries selected by the caller to the output list */
+    const char* cwd = cwdpath->path;
+    size_t prefix = member_prefix(cwd);
+    mfu_flist_set_detail(flist, 1);
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(entry_list);
+    for (idx = 0; idx < size; idx++) {
+        if (member_selected(entry_list, idx, cwd, prefix, opts)) {
+            mfu_flist_file_copy(entry_list, idx, flist);
+        }
+    }
+    mfu_flist_summarize(flist);
+
+    mfu_flist_free(&entry_list);
+    mfu_free(&data_offsets);
+    mfu_free(&offsets);
+
+    return rc;
+}
+
+/* build a list of the entries of an archive from its index without extracting anything */
+int mfu_flist_archive_list(
+    const char* filename,          /* name of archive file */
+    const mfu_param_path* cwdpath, /* path to prepend to entries in archive to build full path */
+    mfu_archive_opts_t* opts,      /* options to configure list operation */
+    mfu_flist flist)               /* list in which to insert entries */
+{
+    mfu_trace_push("archive list");
+
+    /* indicate to user what phase we're in */
+    if (mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Listing %s", filename);
+    }
+
+    /* read an archive in block format through a sparse copy,
+     * in which we only need the index and the entry headers */
+    if (stage_open(filename) != MFU_SUCCESS) {
+        mfu_trace_pop();
+        return MFU_FAILURE;
+    }
+
+    const char* name = (DTAR_stage != NULL) ? DTAR_stage->name : filename;
+    int rc = archive_list(name, cwdpath, opts, flist);
+
+    stage_close();
+
+    mfu_trace_pop();
+    return rc;
+}
+
 /* return a newly allocated archive_opts structure, set default values on its fields */
 mfu_archive_opts_t* mfu_archive_opts_new(void)
 {
@@ -5812,6 +7640,23 @@ mfu_archive_opts_t* mfu_archive_opts_new(void)
     /* whether to extract items with libarchive (1) or read data from archive directly (0) */
     opts->extract_libarchive = 0;
 
+    /* whether to add new and changed items to an existing archive
+     * rather than overwrite it */
+    opts->update = false;
+
+    /* when extracting, patterns of members to extract (all if none),
+     * and a predicate items must also satisfy (all if NULL),
+     * neither is freed with the options */
+    opts->num_members = 0;
+    opts->members     = NULL;
+    opts->member_pred = NULL;
+
+    /* codec to compress blocks of the archive as it is created, if any */
+    opts->codec = MFU_CODEC_NONE;
+
+    /* compression level, -1 selects the default of the codec */
+    opts->level = -1;
+
     return opts;
 }
 
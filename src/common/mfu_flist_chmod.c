@@ -1133,6 +1133,8 @@ void mfu_flist_chmod(
     const mfu_perms* head,
     mfu_chmod_opts_t* opts)
 {
+    mfu_trace_push("chmod");
+
     /* get global size of list */
     uint64_t all_count = mfu_flist_global_size(flist);
 
@@ -1159,6 +1161,7 @@ void mfu_flist_chmod(
             if (rank == 0) {
                 MFU_LOG(MFU_LOG_ERR, "Failed to find uid for user name `%s'", usrname);
             }
+            mfu_trace_pop();
             return;
         }
     }
@@ -1171,6 +1174,7 @@ void mfu_flist_chmod(
             if (rank == 0) {
                 MFU_LOG(MFU_LOG_ERR, "Failed to find gid for group name `%s'", grname);
             }
+            mfu_trace_pop();
             return;
         }
     }
@@ -1194,6 +1198,8 @@ void mfu_flist_chmod(
     chmod_count = 0;
     chmod_count_total = all_count;
     chmod_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, chmod_progress_fn);
+    const char* chmod_names[1] = {"items"};
+    mfu_progress_describe("chmod", chmod_names, &chmod_count_total, chmod_prog);
 
     /* variable to track total stats across levels */
     uint64_t total_stats[7] = {0};
@@ -1256,6 +1262,7 @@ void mfu_flist_chmod(
                (unsigned long)global_stats[CHMOD_SKIPPED], (unsigned long)global_stats[CHMOD_SUCCESS], (unsigned long)global_stats[CHMOD_FAILURE]);
     }
 
+    mfu_trace_pop();
     return;
 }
 
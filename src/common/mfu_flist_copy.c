@@ -40,7 +40,6 @@
 #include <sys/param.h>
 
 #include <linux/fs.h>
-#include <linux/fiemap.h>
 
 /* define PRI64 */
 #include <inttypes.h>
@@ -88,17 +87,53 @@ typedef struct {
     double   wtime_ended;        /* time when dcp command ended */
 } mfu_copy_stats_t;
 
+/* byte range of a sparse file that holds data */
+typedef struct {
+    off_t start; /* offset of first byte of data */
+    off_t end;   /* offset one past last byte of data */
+} mfu_copy_extent_t;
+
 /* cache open file descriptor to avoid
  * opening / closing the same file */
 typedef struct {
     char* name;    /* name of open file (NULL if none) */
+    int   flags;   /* flags file was opened with */
     int   read;    /* whether file is open for read-only (1) or write (0) */
     int   fd;      /* file descriptor */
 #ifdef DAOS_SUPPORT
     dfs_obj_t* obj; /* open object */
 #endif
+    uint64_t last_use; /* value of cache clock at last access */
+
+    /* data extents of the open file found with SEEK_DATA / SEEK_HOLE,
+     * kept while the file stays open so that later chunks of the
+     * same file can reuse them, covers bytes in [map_start, map_end) */
+    mfu_copy_extent_t* extents; /* list of data extents in offset order */
+    uint64_t extents_count;     /* number of entries in extents */
+    uint64_t extents_max;       /* allocated length of extents */
+    off_t map_start;            /* offset where mapped range starts */
+    off_t map_end;              /* offset where mapped range ends */
+    int   no_punch;             /* set once fallocate(PUNCH_HOLE) is not supported */
 } mfu_copy_file_cache_t;
 
+/* least-recently-used cache of open files, keyed by path and open flags,
+ * lets a rank switch between files without closing and reopening them */
+typedef struct {
+    mfu_copy_file_cache_t* files; /* cache entries, allocated on first open */
+    int      max;                 /* number of entries in files */
+    uint64_t clock;               /* advances on each lookup */
+} mfu_copy_cache_t;
+
+/* destination file in the window of small files a rank has
+ * created and written but not yet flushed and closed */
+typedef struct {
+    uint64_t   idx;  /* index of source item in list */
+    char*      dest; /* path to destination file */
+    mfu_file_t file; /* open destination file */
+    int        open; /* whether file is open */
+    int        rc;   /* 0 if file was created and written, -1 on error */
+} mfu_copy_small_t;
+
 /****************************************
  * Define globals
  ***************************************/
@@ -146,62 +181,114 @@ static void mkdir_progress_fn(const uint64_t* vals, int count, int complete, int
     }
 }
 
-/** Cache most recent open file descriptor to avoid opening / closing the same file */
-static mfu_copy_file_cache_t mfu_copy_src_cache;
-static mfu_copy_file_cache_t mfu_copy_dst_cache;
-
-/* open and cache a file.
- * Returns 0 on success; -1 otherwise */
-static int mfu_copy_open_file(
-    const char* file,             /* path to file to be opened */
-    int read_flag,                /* set to 1 to open in read only, 0 for write */
-    mfu_copy_file_cache_t* cache, /* cache the open file to avoid repetitive open/close of the same file */
-    mfu_copy_opts_t* copy_opts,   /* options configuring the copy operation */
-    mfu_file_t* mfu_file)         /* whether the file is in POSIX/DAOS */
+/** Cache recently opened files to avoid opening / closing the same file,
+ * one cache for files we read from and one for files we write to */
+static mfu_copy_cache_t mfu_copy_src_cache;
+static mfu_copy_cache_t mfu_copy_dst_cache;
+
+/* close file held in cache entry, fsync first if open for write */
+static int mfu_copy_cache_evict(
+    mfu_copy_file_cache_t* entry,
+    mfu_file_t* mfu_file)
 {
-    /* see if we have a cached file descriptor */
-    char* name = cache->name;
+    int rc = 0;
+
+    /* close file if we have one */
+    char* name = entry->name;
     if (name != NULL) {
-        /* we have a cached file descriptor */
-        if (strcmp(name, file) == 0 && cache->read == read_flag) {
-            /* the file we're trying to open matches name and read/write mode,
-             * so just return the cached descriptor */
-            return 0;
-        } else {
-            /* the file we're trying to open is different,
-             * close the old file and delete the name */
-            mfu_file_close(name, mfu_file);
-            mfu_free(&cache->name);
+        /* point I/O handle at the cached descriptor */
+        mfu_file_t file = *mfu_file;
+        file.fd = entry->fd;
+#ifdef DAOS_SUPPORT
+        file.obj = entry->obj;
+#endif
+
+        /* if open for write, fsync */
+        if (! entry->read && file.type == POSIX) {
+            rc = mfu_fsync(name, entry->fd);
+        }
+
+        /* close the file and delete the name string */
+        if (mfu_file_close(name, &file) != 0) {
+            rc = -1;
         }
+        mfu_free(&entry->name);
     }
 
-    /* open the new file, this sets mfu_file->fd/obj */
-    if (read_flag) {
-        int flags = O_RDONLY;
-        if (copy_opts->open_noatime) {
-            flags |= O_NOATIME;
+    /* forget extents of the old file */
+    entry->extents_count = 0;
+    entry->map_start     = 0;
+    entry->map_end       = 0;
+    entry->no_punch      = 0;
+
+    return rc;
+}
+
+/* open a file through the cache, sets fd/obj in mfu_file to refer
+ * to the open file and returns its cache entry, returns NULL on error */
+static mfu_copy_file_cache_t* mfu_copy_cache_open(
+    mfu_copy_cache_t* cache,    /* cache to look up file in */
+    const char* file,           /* path to file to be opened */
+    int flags,                  /* flags to open file with */
+    mfu_copy_opts_t* copy_opts, /* options configuring the copy operation */
+    mfu_file_t* mfu_file)       /* whether the file is in POSIX/DAOS */
+{
+    /* allocate cache entries on first use */
+    if (cache->files == NULL) {
+        cache->max = copy_opts->open_files;
+        if (cache->max < 1) {
+            cache->max = 1;
         }
-        if (copy_opts->direct) {
-            flags |= O_DIRECT;
+        cache->files = (mfu_copy_file_cache_t*) MFU_CALLOC((size_t) cache->max, sizeof(mfu_copy_file_cache_t));
+        cache->clock = 0;
+    }
+    cache->clock++;
+
+    /* look for this file in the cache, and track the
+     * least recently used entry in case we need to replace it */
+    int i;
+    mfu_copy_file_cache_t* victim = &cache->files[0];
+    for (i = 0; i < cache->max; i++) {
+        mfu_copy_file_cache_t* entry = &cache->files[i];
+        if (entry->name == NULL) {
+            /* prefer an empty slot over evicting an open file */
+            if (victim->name != NULL) {
+                victim = entry;
+            }
+            continue;
         }
-        mfu_file_open(file, flags, mfu_file);
-    } else {
-        int flags = O_WRONLY | O_CREAT;
-        if (copy_opts->direct) {
-            flags |= O_DIRECT;
+
+        if (strcmp(entry->name, file) == 0 && entry->flags == flags) {
+            /* the file we're trying to open matches name and mode,
+             * so just return the cached descriptor */
+            entry->last_use = cache->clock;
+            mfu_file->fd = entry->fd;
+#ifdef DAOS_SUPPORT
+            mfu_file->obj = entry->obj;
+#endif
+            return entry;
+        }
+
+        if (victim->name != NULL && entry->last_use < victim->last_use) {
+            victim = entry;
         }
-        mfu_file_open(file, flags, mfu_file, DCOPY_DEF_PERMS_FILE);
     }
 
+    /* not found, close the least recently used file to make room */
+    mfu_copy_cache_evict(victim, mfu_file);
+
+    /* open the new file, this sets mfu_file->fd/obj */
+    mfu_file_open(file, flags, mfu_file, DCOPY_DEF_PERMS_FILE);
+
     /* cache the file descriptor */
+    int read_flag = ((flags & O_ACCMODE) == O_RDONLY);
     if (mfu_file->type == POSIX) {
         if (mfu_file->fd < 0) {
-            return -1;
+            return NULL;
         }
 
-        cache->name = MFU_STRDUP(file);
-        cache->fd   = mfu_file->fd;
-        cache->read = read_flag;
+        victim->name = MFU_STRDUP(file);
+        victim->fd   = mfu_file->fd;
 
 #ifdef LUSTRE_SUPPORT
         /* Zero is an invalid ID for grouplock. */
@@ -224,43 +311,289 @@ static int mfu_copy_open_file(
 #ifdef DAOS_SUPPORT
     if (mfu_file->type == DFS) {
         if (mfu_file->obj == NULL) {
-            return -1;
+            return NULL;
         }
-        
-        cache->name = MFU_STRDUP(file);
-        cache->read = read_flag;
-        cache->obj  = mfu_file->obj;
+
+        victim->name = MFU_STRDUP(file);
+        victim->obj  = mfu_file->obj;
     }
 #endif
 
-    return 0;
+    if (mfu_file->type == MOCK) {
+        if (mfu_file->fd < 0) {
+            return NULL;
+        }
+
+        victim->name = MFU_STRDUP(file);
+        victim->fd   = mfu_file->fd;
+    }
+
+    victim->flags    = flags;
+    victim->read     = read_flag;
+    victim->last_use = cache->clock;
+
+    return victim;
 }
 
-/* close a file that opened with mfu_copy_open_file */
-static int mfu_copy_close_file(
-    mfu_copy_file_cache_t* cache,
+/* close all files in cache, fsync those open for write,
+ * returns 0 on success and -1 if any close failed */
+static int mfu_copy_cache_close_all(
+    mfu_copy_cache_t* cache,
     mfu_file_t* mfu_file)
 {
     int rc = 0;
 
-    /* close file if we have one */
-    char* name = cache->name;
-    if (name != NULL) {
-        int fd = cache->fd;
-        /* if open for write, fsync */
-        int read_flag = cache->read;
-        if (! read_flag && mfu_file->type == POSIX) {
-            rc = mfu_fsync(name, fd);
+#ifdef SYNC_FILE_RANGE_WRITE
+    /* start writeback on every file open for write before waiting
+     * on any of them, so their data is flushed concurrently */
+    int i;
+    for (i = 0; i < cache->max; i++) {
+        mfu_copy_file_cache_t* entry = &cache->files[i];
+        if (entry->name != NULL && ! entry->read && mfu_file->type == POSIX) {
+            sync_file_range(entry->fd, 0, 0, SYNC_FILE_RANGE_WRITE);
         }
+    }
+#endif
 
-        /* close the file and delete the name string */
-        rc = mfu_file_close(name, mfu_file);
-        mfu_free(&cache->name);
+    /* fsync and close each file, free extent maps */
+    int j;
+    for (j = 0; j < cache->max; j++) {
+        mfu_copy_file_cache_t* entry = &cache->files[j];
+        if (mfu_copy_cache_evict(entry, mfu_file) != 0) {
+            rc = -1;
+        }
+        mfu_free(&entry->extents);
+        entry->extents_max = 0;
+    }
+
+    /* free the entries, the next open sizes the cache from its options */
+    mfu_free(&cache->files);
+    cache->max = 0;
+
+    return rc;
+}
+
+/* return flags to open a source (read_flag=1) or destination
+ * (read_flag=0) file with given the copy options */
+static int mfu_copy_open_flags(
+    int read_flag,
+    mfu_copy_opts_t* copy_opts)
+{
+    int flags;
+    if (read_flag) {
+        flags = O_RDONLY;
+        if (copy_opts->open_noatime) {
+            flags |= O_NOATIME;
+        }
+        if (copy_opts->direct) {
+            flags |= O_DIRECT;
+        }
+    } else {
+        flags = O_WRONLY | O_CREAT;
+        if (copy_opts->direct) {
+            flags |= O_DIRECT;
+        }
+    }
+
+    return flags;
+}
+
+/* open and cache a file,
+ * returns cache entry on success and NULL otherwise */
+static mfu_copy_file_cache_t* mfu_copy_open_file(
+    const char* file,           /* path to file to be opened */
+    int read_flag,              /* set to 1 to open in read only, 0 for write */
+    mfu_copy_cache_t* cache,    /* cache the open file to avoid repetitive open/close of the same file */
+    mfu_copy_opts_t* copy_opts, /* options configuring the copy operation */
+    mfu_file_t* mfu_file)       /* whether the file is in POSIX/DAOS */
+{
+    int flags = mfu_copy_open_flags(read_flag, copy_opts);
+    return mfu_copy_cache_open(cache, file, flags, copy_opts, mfu_file);
+}
+
+/* open file for mfu_compare_contents through the source (src=1)
+ * or destination (src=0) open file cache */
+int mfu_copy_cache_open_file(
+    int src,
+    const char* file,
+    int flags,
+    mfu_copy_opts_t* copy_opts,
+    mfu_file_t* mfu_file)
+{
+    mfu_copy_cache_t* cache = src ? &mfu_copy_src_cache : &mfu_copy_dst_cache;
+    mfu_copy_file_cache_t* entry = mfu_copy_cache_open(cache, file, flags, copy_opts, mfu_file);
+    return (entry != NULL) ? 0 : -1;
+}
+
+/* close all files held in the source and destination open file caches */
+int mfu_copy_cache_close_files(
+    mfu_file_t* mfu_src_file,
+    mfu_file_t* mfu_dst_file)
+{
+    int rc = 0;
+    if (mfu_copy_cache_close_all(&mfu_copy_src_cache, mfu_src_file) != 0) {
+        rc = -1;
+    }
+    if (mfu_copy_cache_close_all(&mfu_copy_dst_cache, mfu_dst_file) != 0) {
+        rc = -1;
+    }
+    return rc;
+}
+
+/* buffers this rank reuses to read extended attributes and ACLs,
+ * they grow as needed and are freed at the end of the copy */
+typedef struct {
+    char*   list;         /* names of extended attributes of current item */
+    size_t  list_bufsize; /* number of bytes allocated for list */
+    void*   val;          /* value of current attribute */
+    size_t  val_bufsize;  /* number of bytes allocated for val */
+    void*   acl;          /* GPFS ACL of current item */
+    size_t  acl_bufsize;  /* number of bytes allocated for acl */
+    strmap* skip;         /* records whether each name seen so far is skipped ("1") or copied ("0") */
+} mfu_copy_xattr_bufs_t;
+
+static mfu_copy_xattr_bufs_t mfu_copy_xattr_bufs;
+
+/* free buffers used to copy extended attributes */
+static void mfu_copy_xattr_bufs_free(void)
+{
+    mfu_copy_xattr_bufs_t* bufs = &mfu_copy_xattr_bufs;
+    mfu_free(&bufs->list);
+    bufs->list_bufsize = 0;
+    mfu_free(&bufs->val);
+    bufs->val_bufsize = 0;
+    mfu_free(&bufs->acl);
+    bufs->acl_bufsize = 0;
+    if (bufs->skip != NULL) {
+        strmap_delete(&bufs->skip);
+    }
+}
+
+#if DCOPY_USE_XATTRS
+/* returns 1 if attribute name should not be copied, 0 otherwise,
+ * the decision for each name is made once and then remembered */
+static int mfu_copy_xattr_skip(
+    const char* name,
+    mfu_copy_opts_t* copy_opts)
+{
+    mfu_copy_xattr_bufs_t* bufs = &mfu_copy_xattr_bufs;
+    if (bufs->skip == NULL) {
+        bufs->skip = strmap_new();
+    }
+
+    const char* val = strmap_get(bufs->skip, name);
+    if (val != NULL) {
+        return (val[0] == '1');
+    }
+
+    int skip = 0;
+    if (copy_opts->copy_xattrs == XATTR_USE_LIBATTR) {
+#ifdef HAVE_LIBATTR
+        if (attr_copy_action(name, NULL) == ATTR_ACTION_SKIP) {
+            skip = 1;
+        }
+#endif /* HAVE_LIBATTR */
+    } else if (copy_opts->copy_xattrs == XATTR_SKIP_LUSTRE) {
+        /* ignore xattrs lustre treats specially */
+        /* list from lustre source file lustre_idl.h */
+        if (    strncmp(name,"lustre.",strlen("lustre.")) == 0 ||
+                strcmp(name,"trusted.som") == 0 || strcmp(name,"trusted.lov") == 0 ||
+                strcmp(name,"trusted.lma") == 0 || strcmp(name,"trusted.lmv") == 0 ||
+                strcmp(name,"trusted.dmv") == 0 || strcmp(name,"trusted.link") == 0 ||
+                strcmp(name,"trusted.fid") == 0 || strcmp(name,"trusted.version") == 0 ||
+                strcmp(name,"trusted.hsm") == 0 || strcmp(name,"trusted.lfsck_bitmap") == 0 ||
+                strcmp(name,"trusted.dummy") == 0)
+        {
+            skip = 1;
+        }
     }
 
+    strmap_set(bufs->skip, name, skip ? "1" : "0");
+    return skip;
+}
+
+/* list names (name == NULL) or get value of name on the source item,
+ * through its open file if use_fd is set */
+static ssize_t mfu_copy_xattr_call(
+    const char* src_path,
+    const char* name,
+    int use_fd,
+    void* buf,
+    size_t size,
+    mfu_copy_opts_t* copy_opts,
+    mfu_file_t* mfu_src_file)
+{
+    ssize_t rc;
+    if (name == NULL) {
+        if (use_fd) {
+            rc = mfu_file_flistxattr(src_path, (char*) buf, size, mfu_src_file);
+        } else if (copy_opts->dereference) {
+            /* listxattr of dereferenced symbolic link */
+            rc = mfu_file_listxattr(src_path, (char*) buf, size, mfu_src_file);
+        } else {
+            /* llistxattr of the symbolic link itself */
+            rc = mfu_file_llistxattr(src_path, (char*) buf, size, mfu_src_file);
+        }
+    } else {
+        if (use_fd) {
+            rc = mfu_file_fgetxattr(src_path, name, buf, size, mfu_src_file);
+        } else if (copy_opts->dereference) {
+            /* getxattr of dereferenced symbolic links */
+            rc = mfu_file_getxattr(src_path, name, buf, size, mfu_src_file);
+        } else {
+            /* lgetxattr of symbolic the link itself */
+            rc = mfu_file_lgetxattr(src_path, name, buf, size, mfu_src_file);
+        }
+    }
     return rc;
 }
 
+/* read list of names (name == NULL) or value of name into buffer,
+ * only asks for the size needed if the buffer turns out to be too
+ * small, in which case the buffer is grown for this and later items,
+ * returns number of bytes read or -1 with errno set on error */
+static ssize_t mfu_copy_xattr_read(
+    const char* src_path,
+    const char* name,
+    int use_fd,
+    void** buf,
+    size_t* bufsize,
+    mfu_copy_opts_t* copy_opts,
+    mfu_file_t* mfu_src_file)
+{
+    if (*bufsize == 0) {
+        *bufsize = 4096;
+        *buf = MFU_MALLOC(*bufsize);
+    }
+
+    while (1) {
+        errno = 0;
+        ssize_t size = mfu_copy_xattr_call(src_path, name, use_fd,
+                *buf, *bufsize, copy_opts, mfu_src_file);
+        if (size >= 0 || errno != ERANGE) {
+            return size;
+        }
+
+        /* buffer is too small, get size we need, which may have
+         * changed again by the time we read so loop to check */
+        errno = 0;
+        size = mfu_copy_xattr_call(src_path, name, use_fd,
+                NULL, 0, copy_opts, mfu_src_file);
+        if (size < 0) {
+            return size;
+        }
+
+        size_t newsize = *bufsize * 2;
+        if (newsize < (size_t) size) {
+            newsize = (size_t) size;
+        }
+        mfu_free(buf);
+        *buf = MFU_MALLOC(newsize);
+        *bufsize = newsize;
+    }
+}
+#endif /* DCOPY_USE_XATTRS */
+
 /* copy all extended attributes from op->operand to dest_path,
  * returns 0 on success and -1 on failure */
 static int mfu_copy_xattrs(
@@ -275,151 +608,68 @@ static int mfu_copy_xattrs(
     int rc = 0;
 
 #if DCOPY_USE_XATTRS
+    mfu_copy_xattr_bufs_t* bufs = &mfu_copy_xattr_bufs;
+
     /* get source file name */
     const char* src_path = mfu_flist_file_get_name(flist, idx);
 
-    /* start with a reasonable buffer, we'll allocate more as needed */
-    size_t list_bufsize = 1024;
-    char* list = (char*) MFU_MALLOC(list_bufsize);
-
-    /* get list, if list_size == ERANGE, try again */
-    ssize_t list_size;
-    int got_list = 0;
-
-    /* get current estimate for list size */
-    while(! got_list) {
-        errno = 0;
-        if (copy_opts->dereference) {
-            /* listxattr of dereferenced symbolic link */
-            list_size = mfu_file_listxattr(src_path, list, list_bufsize, mfu_src_file);
-        } else {
-            /* llistxattr of the symbolic link itself */
-            list_size = mfu_file_llistxattr(src_path, list, list_bufsize, mfu_src_file);
+    /* read attributes of regular files through the source file cache,
+     * so we look up the path once rather than once per attribute,
+     * and the descriptor is still open when we copy the data */
+    int use_fd = 0;
+    mfu_filetype type = mfu_flist_file_get_type(flist, idx);
+    if (type == MFU_TYPE_FILE && mfu_src_file->type == POSIX) {
+        mfu_copy_file_cache_t* entry = mfu_copy_open_file(src_path, 1,
+                &mfu_copy_src_cache, copy_opts, mfu_src_file);
+        if (entry != NULL) {
+            use_fd = 1;
         }
+    }
 
-        if(list_size < 0) {
-            if(errno == ERANGE) {
-                /* buffer is too small, free our current buffer
-                 * and call it again with size==0 to get new size */
-                mfu_free(&list);
-                list_bufsize = 0;
-            }
-            else if(errno == ENOTSUP) {
-                /* this is common enough that we silently ignore it */
-                break;
-            }
-            else {
-                /* this is a real error */
-                MFU_LOG(MFU_LOG_ERR, "Failed to get list of extended attributes on `%s' llistxattr() (errno=%d %s)",
-                    src_path, errno, strerror(errno)
-                   );
-                rc = -1;
-                break;
-            }
-        }
-        else {
-            if(list_size > 0 && list_bufsize == 0) {
-                /* called mfu_file_llistxattr with size==0 and got back positive
-                 * number indicating size of buffer we need to allocate */
-                list_bufsize = (size_t) list_size;
-                list = (char*) MFU_MALLOC(list_bufsize);
-            }
-            else {
-                /* got our list, it's size is in list_size, which may be 0 */
-                got_list = 1;
-            }
+    /* get list of attribute names */
+    ssize_t list_size = mfu_copy_xattr_read(src_path, NULL, use_fd,
+            (void**) &bufs->list, &bufs->list_bufsize, copy_opts, mfu_src_file);
+    if (list_size < 0) {
+        if (errno == ENOTSUP) {
+            /* this is common enough that we silently ignore it */
+            return 0;
         }
-    }
 
-    /* iterate over list and copy values to new object lgetxattr/lsetxattr */
-    if(got_list) {
-        char* name = list;
-        while(name < list + list_size) {
-            /* start with a reasonable buffer,
-             * allocate something bigger as needed */
-            size_t val_bufsize = 1024;
-            void* val = (void*) MFU_MALLOC(val_bufsize);
-            int copy_xattr;
+        /* this is a real error */
+        MFU_LOG(MFU_LOG_ERR, "Failed to get list of extended attributes on `%s' llistxattr() (errno=%d %s)",
+            src_path, errno, strerror(errno)
+           );
+        return -1;
+    }
 
+    /* iterate over list and copy values to new object lgetxattr/lsetxattr,
+     * note the list buffer is not reused until we're done with this item */
+    const char* list = bufs->list;
+    const char* name = list;
+    while(name < list + list_size) {
+        if (! mfu_copy_xattr_skip(name, copy_opts)) {
             /* lookup value for name */
-            ssize_t val_size;
-            int got_val = 0;
-
-            copy_xattr = 1; /* copy unless indicated below not to */
-            if (copy_opts->copy_xattrs == XATTR_USE_LIBATTR) {
-#ifdef HAVE_LIBATTR
-                if (attr_copy_action(name, NULL) == ATTR_ACTION_SKIP) {
-                    copy_xattr = 0;
-                }
-#endif /* HAVE_LIBATTR */
-            } else if (copy_opts->copy_xattrs == XATTR_SKIP_LUSTRE) {
-                /* ignore xattrs lustre treats specially */
-                /* list from lustre source file lustre_idl.h */
-                if (    strncmp(name,"lustre.",strlen("lustre.")) == 0 ||
-                        strcmp(name,"trusted.som") == 0 || strcmp(name,"trusted.lov") == 0 ||
-                        strcmp(name,"trusted.lma") == 0 || strcmp(name,"trusted.lmv") == 0 ||
-                        strcmp(name,"trusted.dmv") == 0 || strcmp(name,"trusted.link") == 0 ||
-                        strcmp(name,"trusted.fid") == 0 || strcmp(name,"trusted.version") == 0 ||
-                        strcmp(name,"trusted.hsm") == 0 || strcmp(name,"trusted.lfsck_bitmap") == 0 ||
-                        strcmp(name,"trusted.dummy") == 0)
-                {
-                    copy_xattr = 0;
-                }
-            }
-
-            while(! got_val && copy_xattr) {
-                errno = 0;
-                if (copy_opts->dereference) {
-                    /* getxattr of dereferenced symbolic links */
-                    val_size = mfu_file_getxattr(src_path, name, val, val_bufsize, mfu_src_file);
+            ssize_t val_size = mfu_copy_xattr_read(src_path, name, use_fd,
+                    &bufs->val, &bufs->val_bufsize, copy_opts, mfu_src_file);
+            if (val_size < 0) {
+                if (errno == ENOATTR) {
+                    /* source object no longer has this attribute,
+                     * maybe deleted out from under us, ignore but print warning */
+                    MFU_LOG(MFU_LOG_WARN, "Attribute does not exist for name=%s on `%s' lgetxattr() (errno=%d %s)",
+                        name, src_path, errno, strerror(errno)
+                       );
                 } else {
-                    /* lgetxattr of symbolic the link itself */
-                    val_size = mfu_file_lgetxattr(src_path, name, val, val_bufsize, mfu_src_file);
-                }
-
-                if(val_size < 0) {
-                    if(errno == ERANGE) {
-                        /* buffer is too small, free our current buffer
-                         * and call it again with size==0 to get new size */
-                        mfu_free(&val);
-                        val_bufsize = 0;
-                    }
-                    else if(errno == ENOATTR) {
-                        /* source object no longer has this attribute,
-                         * maybe deleted out from under us, ignore but print warning */
-                        MFU_LOG(MFU_LOG_WARN, "Attribute does not exist for name=%s on `%s' lgetxattr() (errno=%d %s)",
-                            name, src_path, errno, strerror(errno)
-                           );
-                        break;
-                    }
-                    else {
-                        /* this is a real error */
-                        MFU_LOG(MFU_LOG_ERR, "Failed to get value for name=%s on `%s' lgetxattr() (errno=%d %s)",
-                            name, src_path, errno, strerror(errno)
-                           );
-                        rc = -1;
-                        break;
-                    }
-                }
-                else {
-                    if(val_size > 0 && val_bufsize == 0) {
-                        /* called mfu_file_lgetxattr with size==0 and got back positive
-                         * number indicating size of buffer we need to allocate */
-                        val_bufsize = (size_t) val_size;
-                        val = (void*) MFU_MALLOC(val_bufsize);
-                    }
-                    else {
-                        /* got our value, it's size is in val_size, which may be 0 */
-                        got_val = 1;
-                    }
+                    /* this is a real error */
+                    MFU_LOG(MFU_LOG_ERR, "Failed to get value for name=%s on `%s' lgetxattr() (errno=%d %s)",
+                        name, src_path, errno, strerror(errno)
+                       );
+                    rc = -1;
                 }
-            }
-
-            /* set attribute on destination object */
-            if(got_val && copy_xattr) {
+            } else {
+                /* set attribute on destination object */
                 errno = 0;
                 /* lsetxattr of symbolic link itself. No need to dereference here */
-                int setrc = mfu_file_lsetxattr(dest_path, name, val, (size_t) val_size, 0, mfu_dst_file);
+                int setrc = mfu_file_lsetxattr(dest_path, name, bufs->val, (size_t) val_size, 0, mfu_dst_file);
                 if(setrc != 0) {
                     /* failed to set attribute */
                     MFU_LOG(MFU_LOG_ERR, "Failed to set value for name=%s on `%s' lsetxattr() (errno=%d %s)",
@@ -428,20 +678,12 @@ static int mfu_copy_xattrs(
                     rc = -1;
                 }
             }
-
-            /* free value string */
-            mfu_free(&val);
-            val_bufsize = 0;
-
-            /* jump to next name */
-            size_t namelen = strlen(name) + 1;
-            name += namelen;
         }
-    }
 
-    /* free space allocated for list */
-    mfu_free(&list);
-    list_bufsize = 0;
+        /* jump to next name */
+        size_t namelen = strlen(name) + 1;
+        name += namelen;
+    }
 
 #endif /* DCOPY_USE_XATTR */
 
@@ -533,14 +775,20 @@ static int mfu_copy_acls(
          int aclflags = 0;
          unsigned char acltype = GPFS_ACL_TYPE_ACCESS;
 
-         /* initial size of the struct for gpfs_opaque_acl, 512 bytes should
-          * be large enough for a fairly large ACL anyway */
-         size_t bufsize = 512;
+         /* start with the buffer we used for the last item, which is
+          * likely large enough since items tend to have similar ACLs,
+          * 512 bytes should be large enough for a fairly large ACL anyway */
+         mfu_copy_xattr_bufs_t* bufs = &mfu_copy_xattr_bufs;
+         if (bufs->acl_bufsize == 0) {
+             bufs->acl_bufsize = 512;
+             bufs->acl = MFU_MALLOC(bufs->acl_bufsize);
+         }
+         size_t bufsize = bufs->acl_bufsize;
 
-         /* gpfs_getacl needs a *void for where it will place the data, so we need
-          * to allocate some memory and then place a gpfs_opaque_acl into the
-          * memory as aclflags is set to 0 to indicate gpfs_opaque_acl_t */
-         void* aclbufmem = MFU_MALLOC(bufsize);
+         /* gpfs_getacl needs a *void for where it will place the data, so we
+          * place a gpfs_opaque_acl into the memory as aclflags is set to 0
+          * to indicate gpfs_opaque_acl_t */
+         void* aclbufmem = bufs->acl;
          memset(aclbufmem, 0, bufsize);
 
          /* set fields in structure to define acl query */
@@ -562,9 +810,12 @@ static int mfu_copy_acls(
            MFU_LOG(MFU_LOG_DBG, "GPFS ACL buffer too small, needs to be %d",
                    (int) bufsize);
 
-           /* free the old buffer, then malloc the new size */
-           mfu_free(&aclbufmem);
-           aclbufmem = MFU_MALLOC(bufsize);
+           /* free the old buffer, then malloc the new size,
+            * which we keep for later items */
+           mfu_free(&bufs->acl);
+           bufs->acl = MFU_MALLOC(bufsize);
+           bufs->acl_bufsize = bufsize;
+           aclbufmem = bufs->acl;
            memset(aclbufmem, 0, bufsize);
 
            /* set fields in structure to define acl query */
@@ -597,9 +848,6 @@ static int mfu_copy_acls(
            }
          }
 
-         /* free the memory from the buffer */
-         mfu_free(&aclbufmem);
-
     }
 #endif /* GPFS_SUPPORT */
 
@@ -678,109 +926,358 @@ static void meta_progress_fn(const uint64_t* vals, int count, int complete, int
     }
 }
 
-/* iterate through list of files and set ownership, timestamps,
- * and permissions starting from deepest level and working upwards,
- * we go in this direction in case updating a file updates its
- * parent directory */
-static int mfu_copy_set_metadata(
-    int levels,                     /* number of levels */
-    int minlevel,                   /* value of minimum level */
-    mfu_flist* lists,               /* list of items at each level */
-    int numpaths,                   /* number of items in paths list */
-    const mfu_param_path* paths,    /* list of source paths */
-    const mfu_param_path* destpath, /* path items are being copied to */
-    mfu_copy_opts_t* copy_opts,     /* options to configure copy operation */
-    mfu_file_t* mfu_src_file,       /* abstract whether source items are in POSIX/DAOS */
-    mfu_file_t* mfu_dst_file)       /* abstract whether destination is in POSIX/DAOS */
+/* set ownership, permissions, and timestamps on a single destination
+ * item when preserving attributes, otherwise just fix its permissions,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_set_metadata_item(
+    mfu_flist list,
+    uint64_t idx,
+    const char* dest,
+    mfu_copy_opts_t* copy_opts,
+    mfu_file_t* mfu_dst_file)
 {
-    /* assume we'll succeed */
     int rc = 0;
+    int tmp_rc;
 
-    /* determine whether we should print status messages */
-    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
-
-    /* get current rank */
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-
-    if (rank == 0) {
-        if(copy_opts->preserve) {
-            MFU_LOG(MFU_LOG_INFO, "Setting ownership, permissions, and timestamps.");
+    if(copy_opts->preserve) {
+        tmp_rc = mfu_copy_ownership(list, idx, dest, mfu_dst_file);
+        if (tmp_rc < 0) {
+            rc = -1;
         }
-        else {
-            MFU_LOG(MFU_LOG_INFO, "Fixing permissions.");
+        tmp_rc = mfu_copy_permissions(list, idx, dest, mfu_dst_file);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+        tmp_rc = mfu_copy_acls(list, idx, dest);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+        tmp_rc = mfu_copy_timestamps(list, idx, dest, mfu_dst_file);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
+    else {
+        /* TODO: set permissions based on source permissons
+         * masked by umask */
+        tmp_rc = mfu_copy_permissions(list, idx, dest, mfu_dst_file);
+        if (tmp_rc < 0) {
+            rc = -1;
         }
     }
 
-    /* start timer for entie operation */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_start = MPI_Wtime();
-    uint64_t total_count = 0;
+    return rc;
+}
 
-    /* start progress messages while setting metadata */
-    mfu_progress* meta_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, meta_progress_fn);
+/* destination of an item whose metadata is to be set, the name
+ * is split into its parent directory and its name within it */
+typedef struct {
+    char*       dest;       /* full destination path */
+    const char* base;       /* name of item within parent, points into dest */
+    size_t      parent_len; /* length of parent directory prefix in dest */
+    uint64_t    idx;        /* index of source item in list */
+} mfu_copy_meta_t;
+
+/* order items by parent directory, then by name within the parent */
+static int mfu_copy_meta_cmp(const void* a, const void* b)
+{
+    const mfu_copy_meta_t* x = (const mfu_copy_meta_t*) a;
+    const mfu_copy_meta_t* y = (const mfu_copy_meta_t*) b;
 
-    /* now set timestamps on files starting from deepest level */
-    int tmp_rc;
-    int level;
-    for (level = levels-1; level >= 0; level--) {
-        /* get list at this level */
-        mfu_flist list = lists[level];
+    size_t len = (x->parent_len < y->parent_len) ? x->parent_len : y->parent_len;
+    int cmp = strncmp(x->dest, y->dest, len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (x->parent_len != y->parent_len) {
+        return (x->parent_len < y->parent_len) ? -1 : 1;
+    }
+    return strcmp(x->base, y->base);
+}
 
-        /* cycle through our list of items and set timestamps
-         * for each one at this level */
-        uint64_t idx;
-        uint64_t size = mfu_flist_size(list);
-        for (idx = 0; idx < size; idx++) {
-            /* TODO: skip file if it's not readable */
+/* set metadata on an item relative to an open parent directory,
+ * stats the item first and only issues the calls needed to change
+ * values that differ from the source, returns 0 on success and -1 on
+ * error, and sets fallback if the path-based calls should be used */
+static int mfu_copy_set_metadata_at(
+    mfu_flist list,
+    uint64_t idx,
+    int dirfd,
+    const mfu_copy_meta_t* meta,
+    mfu_copy_opts_t* copy_opts,
+    int* fallback)
+{
+    int rc = 0;
+    const char* base = meta->base;
 
-            /* get source name of item */
-            const char* name = mfu_flist_file_get_name(list, idx);
+    struct stat st;
+    if (mfu_fstatat(dirfd, base, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        *fallback = 1;
+        return 0;
+    }
 
-            /* get destination name of item */
-            char* dest = mfu_param_path_copy_dest(name, numpaths,
-                    paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
+    mfu_filetype type = mfu_flist_file_get_type(list, idx);
+    mode_t mode = (mode_t) mfu_flist_file_get_mode(list, idx);
+
+    if (copy_opts->preserve) {
+        /* change ownership, this may clear setuid/setgid bits */
+        int chowned = 0;
+        uid_t uid = (uid_t) mfu_flist_file_get_uid(list, idx);
+        gid_t gid = (gid_t) mfu_flist_file_get_gid(list, idx);
+        if (st.st_uid != uid || st.st_gid != gid) {
+            if (mfu_fchownat(dirfd, base, uid, gid, AT_SYMLINK_NOFOLLOW) != 0) {
+                /* as with lchown, don't report EPERM since the user
+                 * running the copy may not own the file */
+                if (errno != EPERM) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to change ownership on `%s' fchownat() (errno=%d %s)",
+                        meta->dest, errno, strerror(errno)
+                       );
+                }
+                rc = -1;
+            } else {
+                chowned = 1;
+            }
+        }
 
-            /* No need to copy it */
-            if (dest == NULL) {
+        /* change mode */
+        if (type != MFU_TYPE_LINK &&
+            ((st.st_mode & 07777) != (mode & 07777) ||
+             (chowned && (mode & (S_ISUID | S_ISGID)))))
+        {
+            if (mfu_fchmodat(dirfd, base, mode, 0) != 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to change permissions on `%s' fchmodat() (errno=%d %s)",
+                    meta->dest, errno, strerror(errno));
+                rc = -1;
+            }
+        }
+
+        if (mfu_copy_acls(list, idx, meta->dest) < 0) {
+            rc = -1;
+        }
+
+        /* set times with nanosecond precision on the item itself */
+        struct timespec times[2];
+        times[0].tv_sec  = (time_t) mfu_flist_file_get_atime(list, idx);
+        times[0].tv_nsec = (long)   mfu_flist_file_get_atime_nsec(list, idx);
+        times[1].tv_sec  = (time_t) mfu_flist_file_get_mtime(list, idx);
+        times[1].tv_nsec = (long)   mfu_flist_file_get_mtime_nsec(list, idx);
+        if (st.st_atim.tv_sec != times[0].tv_sec || st.st_atim.tv_nsec != times[0].tv_nsec ||
+            st.st_mtim.tv_sec != times[1].tv_sec || st.st_mtim.tv_nsec != times[1].tv_nsec)
+        {
+            if (mfu_utimensat(dirfd, base, times, AT_SYMLINK_NOFOLLOW) != 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to change timestamps on `%s' utimensat() (errno=%d %s)",
+                    meta->dest, errno, strerror(errno)
+                   );
+                rc = -1;
+            }
+        }
+    } else {
+        /* TODO: set permissions based on source permissons
+         * masked by umask */
+        if (type != MFU_TYPE_LINK && (st.st_mode & 07777) != (mode & 07777)) {
+            if (mfu_fchmodat(dirfd, base, mode, 0) != 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to change permissions on `%s' fchmodat() (errno=%d %s)",
+                    meta->dest, errno, strerror(errno));
+                rc = -1;
+            }
+        }
+    }
+
+    return rc;
+}
+
+/* set metadata on destination of each item in list, or only on
+ * directories if dirs_only is set, items are grouped by parent
+ * directory so that each parent is opened once and items are updated
+ * relative to it, falls back to path-based calls if the destination
+ * is not POSIX or a parent can't be opened,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_set_metadata_list(
+    mfu_flist list,                 /* list of items at one level */
+    int dirs_only,                  /* whether to only update directories */
+    int numpaths,                   /* number of items in paths list */
+    const mfu_param_path* paths,    /* list of source paths */
+    const mfu_param_path* destpath, /* path items are being copied to */
+    mfu_copy_opts_t* copy_opts,     /* options to configure copy operation */
+    mfu_file_t* mfu_src_file,       /* abstract whether source items are in POSIX/DAOS */
+    mfu_file_t* mfu_dst_file,       /* abstract whether destination is in POSIX/DAOS */
+    uint64_t* count,                /* running count of items updated */
+    mfu_progress* prg)              /* progress messages to update */
+{
+    int rc = 0;
+
+    /* get destination of each item we need to update */
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    mfu_copy_meta_t* metas = (mfu_copy_meta_t*) MFU_MALLOC(size * sizeof(mfu_copy_meta_t));
+    uint64_t nmetas = 0;
+    for (idx = 0; idx < size; idx++) {
+        /* TODO: skip file if it's not readable */
+
+        if (dirs_only) {
+            mfu_filetype type = mfu_flist_file_get_type(list, idx);
+            if (type != MFU_TYPE_DIR) {
                 continue;
             }
+        }
 
-            /* update our running total */
-            total_count++;
+        /* get destination name of item */
+        const char* name = mfu_flist_file_get_name(list, idx);
+        char* dest = mfu_param_path_copy_dest(name, numpaths,
+                paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
 
-            if(copy_opts->preserve) {
-                tmp_rc = mfu_copy_ownership(list, idx, dest, mfu_dst_file);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_permissions(list, idx, dest, mfu_dst_file);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_acls(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_timestamps(list, idx, dest, mfu_dst_file);
-                if (tmp_rc < 0) {
-                    rc = -1;
+        /* No need to copy it */
+        if (dest == NULL) {
+            continue;
+        }
+
+        mfu_copy_meta_t* meta = &metas[nmetas];
+        meta->dest = dest;
+        meta->idx  = idx;
+        char* slash = strrchr(dest, '/');
+        if (slash != NULL) {
+            meta->base       = slash + 1;
+            meta->parent_len = (size_t)(slash - dest);
+        } else {
+            meta->base       = dest;
+            meta->parent_len = 0;
+        }
+        nmetas++;
+    }
+
+    /* group items by parent */
+    qsort(metas, (size_t)nmetas, sizeof(mfu_copy_meta_t), mfu_copy_meta_cmp);
+
+    uint64_t i = 0;
+    while (i < nmetas) {
+        /* find the end of the items that share this parent */
+        uint64_t end = i + 1;
+        while (end < nmetas &&
+               metas[end].parent_len == metas[i].parent_len &&
+               strncmp(metas[end].dest, metas[i].dest, metas[i].parent_len) == 0)
+        {
+            end++;
+        }
+
+        /* open the parent directory, the root directory is the
+         * empty prefix of an absolute path */
+        int dirfd = -1;
+        char* parent = NULL;
+        if (mfu_dst_file->type == POSIX) {
+            if (metas[i].base == metas[i].dest) {
+                dirfd = AT_FDCWD;
+            } else {
+                size_t len = metas[i].parent_len;
+                if (len > 0) {
+                    parent = (char*) MFU_MALLOC(len + 1);
+                    memcpy(parent, metas[i].dest, len);
+                    parent[len] = '\0';
+                } else {
+                    parent = MFU_STRDUP("/");
                 }
+#ifdef O_PATH
+                dirfd = mfu_open(parent, O_PATH | O_DIRECTORY);
+#else
+                dirfd = mfu_open(parent, O_RDONLY | O_DIRECTORY);
+#endif
             }
-            else {
-                /* TODO: set permissions based on source permissons
-                 * masked by umask */
-                tmp_rc = mfu_copy_permissions(list, idx, dest, mfu_dst_file);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
+        }
+
+        for (; i < end; i++) {
+            mfu_copy_meta_t* meta = &metas[i];
+
+            int fallback = (dirfd == -1);
+            int tmp_rc = 0;
+            if (! fallback) {
+                tmp_rc = mfu_copy_set_metadata_at(list, meta->idx, dirfd, meta,
+                    copy_opts, &fallback);
+            }
+            if (fallback) {
+                tmp_rc = mfu_copy_set_metadata_item(list, meta->idx, meta->dest,
+                    copy_opts, mfu_dst_file);
+            }
+            if (tmp_rc < 0) {
+                rc = -1;
             }
 
             /* free destination item */
-            mfu_free(&dest);
+            mfu_free(&meta->dest);
 
             /* update number of items we have completed for progress messages */
-            mfu_progress_update(&total_count, meta_prog);
+            (*count)++;
+            mfu_progress_update(count, prg);
+        }
+
+        if (dirfd >= 0) {
+            mfu_close(parent, dirfd);
+        }
+        mfu_free(&parent);
+    }
+
+    mfu_free(&metas);
+
+    return rc;
+}
+
+/* iterate through list of files and set ownership, timestamps,
+ * and permissions starting from deepest level and working upwards,
+ * we go in this direction in case updating a file updates its
+ * parent directory */
+static int mfu_copy_set_metadata(
+    int levels,                     /* number of levels */
+    int minlevel,                   /* value of minimum level */
+    mfu_flist* lists,               /* list of items at each level */
+    int numpaths,                   /* number of items in paths list */
+    const mfu_param_path* paths,    /* list of source paths */
+    const mfu_param_path* destpath, /* path items are being copied to */
+    mfu_copy_opts_t* copy_opts,     /* options to configure copy operation */
+    mfu_file_t* mfu_src_file,       /* abstract whether source items are in POSIX/DAOS */
+    mfu_file_t* mfu_dst_file)       /* abstract whether destination is in POSIX/DAOS */
+{
+    mfu_trace_push("set metadata");
+
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        if(copy_opts->preserve) {
+            MFU_LOG(MFU_LOG_INFO, "Setting ownership, permissions, and timestamps.");
+        }
+        else {
+            MFU_LOG(MFU_LOG_INFO, "Fixing permissions.");
+        }
+    }
+
+    /* start timer for entie operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+    uint64_t total_count = 0;
+
+    /* start progress messages while setting metadata */
+    mfu_progress* meta_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, meta_progress_fn);
+    const char* meta_names[1] = {"items"};
+    mfu_progress_describe("set metadata", meta_names, NULL, meta_prog);
+
+    /* now set timestamps on files starting from deepest level */
+    int tmp_rc;
+    int level;
+    for (level = levels-1; level >= 0; level--) {
+        /* get list at this level */
+        mfu_flist list = lists[level];
+
+        /* set metadata on each item at this level */
+        tmp_rc = mfu_copy_set_metadata_list(list, 0, numpaths, paths,
+                destpath, copy_opts, mfu_src_file, mfu_dst_file,
+                &total_count, meta_prog);
+        if (tmp_rc < 0) {
+            rc = -1;
         }
 
         /* wait for all procs to finish before we start
@@ -811,6 +1308,7 @@ static int mfu_copy_set_metadata(
         }
     }
 
+    mfu_trace_pop();
     return rc;
 }
 
@@ -829,6 +1327,8 @@ static int mfu_copy_set_metadata_dirs(
     mfu_file_t* mfu_src_file,       /* abstract whether source items are in POSIX/DAOS */
     mfu_file_t* mfu_dst_file)       /* abstract whether destination is in POSIX/DAOS */
 {
+    mfu_trace_push("set metadata");
+
     /* assume we'll succeed */
     int rc = 0;
 
@@ -860,63 +1360,12 @@ static int mfu_copy_set_metadata_dirs(
         /* get list at this level */
         mfu_flist list = lists[level];
 
-        /* cycle through our list of items and set timestamps
-         * for each one at this level */
-        uint64_t idx;
-        uint64_t size = mfu_flist_size(list);
-        for (idx = 0; idx < size; idx++) {
-            /* TODO: skip file if it's not readable */
-
-            /* get source name of item */
-            const char* name = mfu_flist_file_get_name(list, idx);
-
-            /* get destination name of item */
-            char* dest = mfu_param_path_copy_dest(name, numpaths,
-                    paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
-
-            /* No need to copy it */
-            if (dest == NULL) {
-                continue;
-            }
-
-            /* only need to set metadata on directories */
-            mfu_filetype type = mfu_flist_file_get_type(list, idx);
-            if (type != MFU_TYPE_DIR) {
-                continue;
-            }
-
-            /* update our running total */
-            total_count++;
-
-            if(copy_opts->preserve) {
-                tmp_rc = mfu_copy_ownership(list, idx, dest, mfu_dst_file);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_permissions(list, idx, dest, mfu_dst_file);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_acls(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_timestamps(list, idx, dest, mfu_dst_file);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-            }
-            else {
-                /* TODO: set permissions based on source permissons
-                 * masked by umask */
-                tmp_rc = mfu_copy_permissions(list, idx, dest, mfu_dst_file);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-            }
-
-            /* free destination item */
-            mfu_free(&dest);
+        /* only need to set metadata on directories */
+        tmp_rc = mfu_copy_set_metadata_list(list, 1, numpaths, paths,
+                destpath, copy_opts, mfu_src_file, mfu_dst_file,
+                &total_count, NULL);
+        if (tmp_rc < 0) {
+            rc = -1;
         }
 
         /* wait for all procs to finish before we start
@@ -944,6 +1393,7 @@ static int mfu_copy_set_metadata_dirs(
         }
     }
 
+    mfu_trace_pop();
     return rc;
 }
 
@@ -1035,14 +1485,38 @@ static int mfu_create_directory(
     return rc;
 }
 
-/* create directories, we work from shallowest level to the deepest
- * with a barrier in between levels, so that we don't try to create
- * a child directory until the parent exists,
+/* arguments passed to mfu_create_directory_fn while creating directories */
+typedef struct {
+    int numpaths;                   /* number of items in paths list */
+    const mfu_param_path* paths;    /* list of source paths */
+    const mfu_param_path* destpath; /* path items are being copied to */
+    mfu_copy_opts_t* copy_opts;     /* options to configure copy operation */
+    mfu_file_t* mfu_src_file;       /* abstract whether source items are in POSIX/DAOS */
+    mfu_file_t* mfu_dst_file;       /* abstract whether destination is in POSIX/DAOS */
+    uint64_t count;                 /* number of directories created so far */
+    mfu_progress* prg;              /* progress messages */
+} mfu_create_directory_args_t;
+
+static int mfu_create_directory_fn(mfu_flist list, uint64_t idx, void* args)
+{
+    mfu_create_directory_args_t* a = (mfu_create_directory_args_t*) args;
+
+    /* create the directory */
+    int rc = mfu_create_directory(list, idx, a->numpaths, a->paths,
+            a->destpath, a->copy_opts, a->mfu_src_file, a->mfu_dst_file);
+
+    /* update our running count for progress messages */
+    a->count++;
+    mfu_progress_update(&a->count, a->prg);
+
+    return rc;
+}
+
+/* create directories, a directory is created as soon as its parent
+ * exists, so that ranks don't wait on each other at every level,
  * returns 0 on success and -1 on failure */
 static int mfu_create_directories(
-    int levels,                     /* number of levels */
-    int minlevel,                   /* value of minimum level */
-    mfu_flist* lists,               /* list of items at each level */
+    mfu_flist list,                 /* list of items */
     int numpaths,                   /* number of items in paths list */
     const mfu_param_path* paths,    /* list of source paths */
     const mfu_param_path* destpath, /* path items are being copied to */
@@ -1050,6 +1524,8 @@ static int mfu_create_directories(
     mfu_file_t* mfu_src_file,       /* abstract whether source items are in POSIX/DAOS */
     mfu_file_t* mfu_dst_file)       /* abstract whether destination is in POSIX/DAOS */
 {
+    mfu_trace_push("create dirs");
+
     /* assume we'll succeed */
     int rc = 0;
 
@@ -1058,21 +1534,15 @@ static int mfu_create_directories(
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
     /* count total number of directories to be created */
-    int level;
     uint64_t mkdir_local_count = 0;
-    for (level = 0; level < levels; level++) {
-        /* get list of items for this level */
-        mfu_flist list = lists[level];
-
-        uint64_t idx;
-        uint64_t size = mfu_flist_size(list);
-        for (idx = 0; idx < size; idx++) {
-           /* check whether we have a directory */
-           mfu_filetype type = mfu_flist_file_get_type(list, idx);
-           if (type == MFU_TYPE_DIR) {
-               mkdir_local_count++;
-           }
-        }
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+       /* check whether we have a directory */
+       mfu_filetype type = mfu_flist_file_get_type(list, idx);
+       if (type == MFU_TYPE_DIR) {
+           mkdir_local_count++;
+       }
     }
 
     /* get total for print percent progress while creating */
@@ -1081,6 +1551,7 @@ static int mfu_create_directories(
 
     /* bail early if there is no work to do */
     if (mkdir_total_count == 0) {
+        mfu_trace_pop();
         return rc;
     }
 
@@ -1090,42 +1561,28 @@ static int mfu_create_directories(
     }
 
     /* start progress messages while setting metadata */
-    mfu_progress* mkdir_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, mkdir_progress_fn);
+    mfu_create_directory_args_t args;
+    args.numpaths     = numpaths;
+    args.paths        = paths;
+    args.destpath     = destpath;
+    args.copy_opts    = copy_opts;
+    args.mfu_src_file = mfu_src_file;
+    args.mfu_dst_file = mfu_dst_file;
+    args.count        = 0;
+    args.prg          = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, mkdir_progress_fn);
+    const char* mkdir_names[1] = {"items"};
+    mfu_progress_describe("create dirs", mkdir_names, &mkdir_total_count, args.prg);
+
+    /* create each directory once its parent exists */
+    int tmp_rc = mfu_flist_dirs_top_down(list, mfu_create_directory_fn, &args);
+    if (tmp_rc < 0) {
+        rc = -1;
+    }
 
-    /* work from shallowest level to deepest level */
-    uint64_t reduce_count = 0;
-    for (level = 0; level < levels; level++) {
-        /* get list of items for this level */
-        mfu_flist list = lists[level];
-
-        /* create each directory we have at this level */
-        uint64_t idx;
-        uint64_t size = mfu_flist_size(list);
-        for (idx = 0; idx < size; idx++) {
-            /* check whether we have a directory */
-            mfu_filetype type = mfu_flist_file_get_type(list, idx);
-            if (type == MFU_TYPE_DIR) {
-                /* create the directory */
-                int tmp_rc = mfu_create_directory(list, idx, numpaths,
-                        paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-
-                /* update our running count for progress messages */
-                reduce_count++;
-                mfu_progress_update(&reduce_count, mkdir_prog);
-            }
-        }
-
-        /* wait for all procs to finish before we start
-         * creating directories at next level */
-        MPI_Barrier(MPI_COMM_WORLD);
-    }
-
-    /* finalize progress messages */
-    mfu_progress_complete(&reduce_count, &mkdir_prog);
+    /* finalize progress messages */
+    mfu_progress_complete(&args.count, &args.prg);
 
+    mfu_trace_pop();
     return rc;
 }
 
@@ -1452,6 +1909,8 @@ static int mfu_create_files(
     mfu_file_t* mfu_src_file,
     mfu_file_t* mfu_dst_file)
 {
+    mfu_trace_push("create files");
+
     int rc = 0;
 
     /* get current rank */
@@ -1484,6 +1943,7 @@ static int mfu_create_files(
 
     /* bail early if there is no work to do */
     if (mknod_total_count == 0) {
+        mfu_trace_pop();
         return rc;
     }
 
@@ -1494,6 +1954,8 @@ static int mfu_create_files(
 
     /* start progress messages for creating files */
     mfu_progress* create_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, create_progress_fn);
+    const char* create_names[1] = {"items"};
+    mfu_progress_describe("create files", create_names, &mknod_total_count, create_prog);
 
     uint64_t total_count = 0;
     for (level = 0; level < levels; level++) {
@@ -1538,6 +2000,7 @@ static int mfu_create_files(
     /* finalize progress messages */
     mfu_progress_complete(&total_count, &create_prog); 
 
+    mfu_trace_pop();
     return rc;
 }
 
@@ -1593,6 +2056,8 @@ static int mfu_create_hardlinks(
 
     /* start progress messages for creating files */
     mfu_progress* create_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, create_progress_fn);
+    const char* link_names[1] = {"items"};
+    mfu_progress_describe("link", link_names, &mknod_total_count, create_prog);
 
     uint64_t total_count = 0;
     for (level = 0; level < levels; level++) {
@@ -1684,19 +2149,6 @@ static void copy_progress_fn(const uint64_t* vals, int count, int complete, int
     }
 }
 
-/* return 1 if entire buffer is 0, return 0 if any byte is not 0,
- * we avoid writing NULL blocks when supporting sparse files */
-static int mfu_is_all_null(const char* buf, uint64_t buf_size)
-{
-    uint64_t i;
-    for (i = 0; i < buf_size; i++) {
-        if (buf[i] != 0) {
-            return 0;
-        }
-    }
-    return 1;
-}
-
 static int mfu_copy_file_normal(
     const char* src,
     const char* dest,
@@ -1798,7 +2250,7 @@ static int mfu_copy_file_normal(
          * If this hole is at the end of the file, the truncate below will
          * set the file size correctly. */
         int skip_write = 0;
-        if (copy_opts->sparse && mfu_is_all_null(buf, bytes_to_write)) {
+        if (copy_opts->sparse && mfu_mem_is_zero(buf, bytes_to_write)) {
             skip_write = 1;
         }
 
@@ -1864,7 +2316,112 @@ static int mfu_copy_file_normal(
     return 0;
 }
 
-static int mfu_copy_file_fiemap(
+/* add extents of data found with SEEK_DATA / SEEK_HOLE to the extent
+ * map of the file in cache until the map covers all bytes before end,
+ * returns 0 on success and -1 if data and holes can't be located */
+static int mfu_copy_map_extents(
+    const char* src,
+    off_t start,
+    off_t end,
+    off_t file_size,
+    mfu_copy_file_cache_t* cache)
+{
+    /* start a new map if this range is not contiguous with the
+     * range we already have */
+    if (start < cache->map_start || start > cache->map_end) {
+        cache->extents_count = 0;
+        cache->map_start     = start;
+        cache->map_end       = start;
+    }
+
+    off_t pos = cache->map_end;
+    while (pos < end) {
+        /* find start of next data extent at or after pos */
+        off_t data = mfu_lseek(src, cache->fd, pos, SEEK_DATA);
+        if (data == (off_t)-1) {
+            if (errno == ENXIO) {
+                /* no more data, the rest of the file is a hole */
+                pos = file_size;
+                break;
+            }
+
+            /* SEEK_DATA not supported, silently fall back to a normal copy */
+            if (errno != EINVAL && errno != ENOTSUP && errno != EOPNOTSUPP) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to seek data in `%s' (errno=%d %s)",
+                    src, errno, strerror(errno));
+            }
+            return -1;
+        }
+
+        /* find end of this data extent */
+        off_t hole = mfu_lseek(src, cache->fd, data, SEEK_HOLE);
+        if (hole == (off_t)-1) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to seek hole in `%s' (errno=%d %s)",
+                src, errno, strerror(errno));
+            return -1;
+        }
+
+        /* grow the extent list if needed */
+        if (cache->extents_count == cache->extents_max) {
+            uint64_t max = cache->extents_max * 2;
+            if (max == 0) {
+                max = 16;
+            }
+            mfu_copy_extent_t* extents = (mfu_copy_extent_t*) MFU_MALLOC(max * sizeof(mfu_copy_extent_t));
+            if (cache->extents_count > 0) {
+                memcpy(extents, cache->extents, cache->extents_count * sizeof(mfu_copy_extent_t));
+            }
+            mfu_free(&cache->extents);
+            cache->extents     = extents;
+            cache->extents_max = max;
+        }
+
+        /* record the extent and continue from the hole that follows */
+        cache->extents[cache->extents_count].start = data;
+        cache->extents[cache->extents_count].end   = hole;
+        cache->extents_count++;
+        pos = hole;
+    }
+
+    if (pos < end) {
+        pos = end;
+    }
+    cache->map_end = pos;
+
+    return 0;
+}
+
+/* deallocate the given range of the destination file so that stale
+ * data in an existing file does not show through a hole */
+static int mfu_copy_punch_hole(
+    const char* dest,
+    off_t start,
+    off_t end,
+    mfu_copy_file_cache_t* cache)
+{
+    if (cache->no_punch || start >= end) {
+        return 0;
+    }
+
+    if (mfu_punch_hole(dest, cache->fd, start, end - start) < 0) {
+        if (errno == EOPNOTSUPP || errno == ENOSYS) {
+            /* file system can't punch holes, since we only skip over
+             * holes, the range is left as is as with a new file */
+            cache->no_punch = 1;
+            return 0;
+        }
+        MFU_LOG(MFU_LOG_ERR, "Failed to punch hole in `%s' at offset %llx (errno=%d %s)",
+            dest, (unsigned long long) start, errno, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/* copy only the data extents of a sparse source file in the range
+ * [offset, offset+length) and leave holes in the destination elsewhere,
+ * sets normal_copy_required if data and holes can't be located */
+static int mfu_copy_file_sparse(
     const char* src,
     const char* dest,
     uint64_t offset,
@@ -1872,239 +2429,475 @@ static int mfu_copy_file_fiemap(
     uint64_t file_size,
     bool* normal_copy_required,
     mfu_copy_opts_t* copy_opts,
+    mfu_copy_file_cache_t* src_entry,
+    mfu_copy_file_cache_t* dst_entry,
     mfu_file_t* mfu_src_file,
     mfu_file_t* mfu_dst_file)
 {
     *normal_copy_required = true;
-    if (copy_opts->direct) {
-        goto fail_normal_copy;
+
+    /* O_DIRECT needs aligned writes, and DAOS has no SEEK_DATA */
+    if (copy_opts->direct || mfu_src_file->type != POSIX || mfu_dst_file->type != POSIX) {
+        return -1;
     }
 
-#ifdef DAOS_SUPPORT
-    /* Not yet supported */
-    if (mfu_src_file->type == DFS) {
-        goto fail_normal_copy;
+    /* locate data extents in this chunk, reusing any extents already
+     * found for earlier chunks of the same file */
+    off_t chunk_start = (off_t) offset;
+    off_t chunk_end   = (off_t) (offset + length);
+    if (chunk_end > (off_t) file_size) {
+        chunk_end = (off_t) file_size;
+    }
+    if (mfu_copy_map_extents(src, chunk_start, chunk_end, (off_t) file_size, src_entry) != 0) {
+        return -1;
     }
-#endif
 
-    size_t last_ext_start = offset;
-    size_t last_ext_len = 0;
+    /* from here on, we have committed to the sparse copy */
+    *normal_copy_required = false;
 
-    struct fiemap *fiemap = (struct fiemap*)malloc(sizeof(struct fiemap));
-    if (fiemap == NULL) {
-        MFU_LOG(MFU_LOG_ERR, "Out of memory allocating fiemap");
-        goto fail_normal_copy;
-    }
-    memset(fiemap, 0, sizeof(struct fiemap));
+    /* copy each extent that overlaps the chunk, leave holes in between */
+    bool truncated = false;
+    off_t pos = chunk_start;
+    uint64_t i;
+    for (i = 0; i < src_entry->extents_count; i++) {
+        off_t start = src_entry->extents[i].start;
+        off_t end   = src_entry->extents[i].end;
+        if (end <= chunk_start) {
+            continue;
+        }
+        if (start >= chunk_end) {
+            break;
+        }
+        if (start < chunk_start) {
+            start = chunk_start;
+        }
+        if (end > chunk_end) {
+            end = chunk_end;
+        }
 
-    fiemap->fm_start  = offset;
-    fiemap->fm_length = length;
-    fiemap->fm_flags  = FIEMAP_FLAG_SYNC;
-    fiemap->fm_extent_count   = 0;
-    fiemap->fm_mapped_extents = 0;
+        /* carry hole before this extent through to the destination */
+        if (mfu_copy_punch_hole(dest, pos, start, dst_entry) != 0) {
+            return -1;
+        }
+        mfu_copy_stats.total_size += (int64_t) (start - pos);
+        copy_count += (uint64_t) (start - pos);
+
+        /* copy data, this also truncates the file if the extent ends the file */
+        int rc = mfu_copy_file_normal(src, dest, (uint64_t) start, (uint64_t) (end - start),
+                                      file_size, copy_opts, mfu_src_file, mfu_dst_file);
+        if (rc != 0) {
+            return rc;
+        }
+        if (end >= (off_t) file_size) {
+            truncated = true;
+        }
 
-    struct stat sb;
-    if (fstat(mfu_src_file->fd, &sb) < 0) {
-        goto fail_fiemap;
+        pos = end;
     }
 
-    if (ioctl(mfu_src_file->fd, FS_IOC_FIEMAP, fiemap) < 0) {
-        if (errno == ENOTSUP) {
-            /* silently ignore */
-        } else {
-            MFU_LOG(MFU_LOG_ERR, "fiemap ioctl() failed for src '%s' (errno=%d %s)",
-                    src, errno, strerror(errno));
+    /* carry any trailing hole in the chunk */
+    if (mfu_copy_punch_hole(dest, pos, chunk_end, dst_entry) != 0) {
+        return -1;
+    }
+    mfu_copy_stats.total_size += (int64_t) (chunk_end - pos);
+    copy_count += (uint64_t) (chunk_end - pos);
+    mfu_progress_update(&copy_count, copy_prog);
+
+    /* if we have the last chunk, set the file size,
+     * which also extends the file over a trailing hole */
+    if (chunk_end >= (off_t) file_size && ! truncated) {
+        if (mfu_file_ftruncate(mfu_dst_file, (off_t) file_size) < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
+                dest, errno, strerror(errno));
+            return -1;
         }
-        goto fail_fiemap;
     }
 
-    size_t extents_size = sizeof(struct fiemap_extent) * (fiemap->fm_mapped_extents);
+    return 0;
+}
+
+static int mfu_copy_file(
+    const char* src,
+    const char* dest,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* copy_opts,
+    mfu_file_t* mfu_src_file,
+    mfu_file_t* mfu_dst_file)
+{
+    int ret;
 
-    /* reallocate the fiemap.
-     * If realloc returns NULL, the original fiemap is left malloc'ed */
-    struct fiemap* new_fiemap = (struct fiemap*) realloc(fiemap, sizeof(struct fiemap) + extents_size);
-    if (new_fiemap == NULL) {
-        MFU_LOG(MFU_LOG_ERR, "Out of memory reallocating fiemap");
-        goto fail_fiemap;
+    /* open the input file */
+    mfu_copy_file_cache_t* src_entry = mfu_copy_open_file(src, 1, &mfu_copy_src_cache,
+                                                          copy_opts, mfu_src_file);
+    if (src_entry == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open input file `%s' (errno=%d %s)",
+            src, errno, strerror(errno));
+        return -1;
     }
-    fiemap = new_fiemap;
 
-    memset(fiemap->fm_extents, 0, extents_size);
-    fiemap->fm_extent_count   = fiemap->fm_mapped_extents;
-    fiemap->fm_mapped_extents = 0;
+    /* open the output file */
+    mfu_copy_file_cache_t* dst_entry = mfu_copy_open_file(dest, 0, &mfu_copy_dst_cache,
+                                                          copy_opts, mfu_dst_file);
+    if (dst_entry == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
+                dest, errno, strerror(errno));
+        return -1;
+    }
 
-    if (ioctl(mfu_src_file->fd, FS_IOC_FIEMAP, fiemap) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "fiemap ioctl() failed for src '%s' (errno=%d %s)",
-                src, errno, strerror(errno));
-        goto fail_fiemap;
+    if (copy_opts->sparse) {
+        bool normal_copy_required;
+        ret = mfu_copy_file_sparse(src, dest, offset, length, file_size,
+                               &normal_copy_required, copy_opts,
+                               src_entry, dst_entry, mfu_src_file, mfu_dst_file);
+        if (!ret || !normal_copy_required) {
+            return ret;
+        }
     }
 
-    uint64_t last_byte = offset + length;
+    ret = mfu_copy_file_normal(src, dest, offset, length, file_size,
+                               copy_opts, mfu_src_file, mfu_dst_file);
 
-    if (fiemap->fm_mapped_extents > 0) {
-        uint64_t fe_logical = fiemap->fm_extents[0].fe_logical;
-        uint64_t fe_length  = fiemap->fm_extents[0].fe_length;
-        if (fe_logical < offset) {
-            fiemap->fm_extents[0].fe_length -= (offset - fe_logical);
-            fiemap->fm_extents[0].fe_logical = offset;
-        }
+    return ret;
+}
+
+/* slices files in list at boundaries of chunk size, evenly distributes
+ * chunks, and copies data from source to destination file,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_files(
+    mfu_flist list,
+    int numpaths,
+    const mfu_param_path* paths,
+    const mfu_param_path* destpath,
+    mfu_copy_opts_t* copy_opts,
+    mfu_file_t* mfu_src_file,
+    mfu_file_t* mfu_dst_file)
+{
+    mfu_trace_push("copy data");
+
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-        fe_logical = fiemap->fm_extents[fiemap->fm_mapped_extents - 1].fe_logical;
-        fe_length  = fiemap->fm_extents[fiemap->fm_mapped_extents - 1].fe_length;
-        if (fe_logical + fe_length > last_byte) {
-           fiemap->fm_extents[fiemap->fm_mapped_extents - 1].fe_length -=
-           fe_logical + fe_length - last_byte;
+    /* first, count number of items to create in the list of the current process */
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    uint64_t bytes = 0;
+    for (idx = 0; idx < size; idx++) {
+        /* count regular files and symlinks */
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
+        if (type == MFU_TYPE_FILE) {
+            bytes += mfu_flist_file_get_size(list, idx);
         }
     }
 
-    *normal_copy_required = false;
+    /* get total for print percent progress while creating */
+    copy_total_count = 0;
+    MPI_Allreduce(&bytes, &copy_total_count, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
 
-    /* seek to offset in source file */
-    if (mfu_file_lseek(src, mfu_src_file, (off_t)last_ext_start, SEEK_SET) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in source path `%s' (errno=%d %s)",
-            src, errno, strerror(errno));
-        goto fail_fiemap;
+    /* barrier to ensure all procs are ready to start copy */
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    /* indicate which phase we're in to user */
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Copying data.");
     }
 
-    /* seek to offset in destination file */
-    if (mfu_file_lseek(dest, mfu_dst_file, (off_t)last_ext_start, SEEK_SET) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
-            dest, errno, strerror(errno));
-        goto fail_fiemap;
+    /* start timer for entie operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+    uint64_t total_count = 0;
+
+    /* start up progress messages for the copy */
+    copy_count = 0;
+    copy_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, copy_progress_fn);
+    const char* copy_names[1] = {"bytes"};
+    mfu_progress_describe("copy data", copy_names, &copy_total_count, copy_prog);
+
+    /* split file list into a linked list of file sections,
+     * this evenly spreads the file sections across processes */
+    mfu_file_chunk* head = mfu_file_chunk_list_alloc(list, copy_opts->chunk_size);
+
+    /* get a count of how many items are the chunk list */
+    uint64_t list_count = mfu_file_chunk_list_size(head);
+
+    /* allocate a flag for each element in chunk list,
+     * will store 0 to mean copy of this chunk succeeded and 1 otherwise
+     * to be used as input to logical OR to determine state of entire file */
+    int* vals = (int*) MFU_MALLOC(list_count * sizeof(int));
+
+    /* loop over and copy data for each file section we're responsible for */
+    uint64_t i;
+    const mfu_file_chunk* p = head;
+    for (i = 0; i < list_count; i++) {
+         /* assume we'll succeed in copying this chunk */
+         vals[i] = 0;
+
+        /* get name of destination file */
+        char* dest = mfu_param_path_copy_dest(p->name, numpaths,
+                paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
+        if (dest == NULL) {
+            /* No need to copy it */
+            p = p->next;
+            continue;
+        }
+
+        /* add bytes to our running total */
+        total_count += (uint64_t)p->length;
+
+        /* copy portion of file corresponding to this chunk,
+         * and record whether copy operation succeeded */
+        int copy_rc = mfu_copy_file(p->name, dest, (uint64_t)p->offset,
+                (uint64_t)p->length, (uint64_t)p->file_size, copy_opts,
+                mfu_src_file, mfu_dst_file);
+        if (copy_rc < 0) {
+            /* error copying file */
+            vals[i] = 1;
+        }
+
+        /* free the dest name */
+        mfu_free(&dest);
+
+        /* update pointer to next element */
+        p = p->next;
     }
 
-    unsigned int i;
-    for (i = 0; i < fiemap->fm_mapped_extents; i++) {
-        size_t ext_start;
-        size_t ext_len;
-        size_t ext_hole_size;
+    /* close files */
+    mfu_copy_cache_close_files(mfu_src_file, mfu_dst_file);
 
-        size_t buf_size = copy_opts->buf_size;
-        void* buf = copy_opts->block_buf1;
+    /* barrier to ensure all files are closed,
+     * may try to unlink bad destination files below */
+    MPI_Barrier(MPI_COMM_WORLD);
 
-        ext_start = fiemap->fm_extents[i].fe_logical;
-        ext_len = fiemap->fm_extents[i].fe_length;
-        ext_hole_size = ext_start - (last_ext_start + last_ext_len);
+    /* allocate a flag for each item in our file list */
+    int* results = (int*) MFU_MALLOC(size * sizeof(int));
 
-        if (ext_hole_size) {
-            if (mfu_file_lseek(src, mfu_src_file, (off_t)ext_start, SEEK_SET) < 0) {
-                MFU_LOG(MFU_LOG_ERR, "Couldn't seek in source path `%s' (errno=%d %s)",
-                    src, errno, strerror(errno));
-                goto fail_fiemap;
-            }
-            if (mfu_file_lseek(dest, mfu_dst_file, (off_t)ext_hole_size, SEEK_CUR) < 0) {
-                MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
-                    dest, errno, strerror(errno));
-                goto fail_fiemap;
+    /* intialize values, since not every item is represented
+     * in chunk list */
+    for (i = 0; i < size; i++) {
+        results[i] = 0;
+    }
+
+    /* determnie which files were copied correctly */
+    mfu_file_chunk_list_lor(list, head, vals, results);
+
+    /* delete any destination file that failed to copy */
+    for (i = 0; i < size; i++) {
+        if (results[i] != 0) {
+            /* found a file that had an error during copy,
+             * compute destination name and delete it */
+            const char* name = mfu_flist_file_get_name(list, i);
+            const char* dest = mfu_param_path_copy_dest(name, numpaths,
+                paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
+            if (dest != NULL) {
+                /* sanity check to ensure we don't * delete the source file */
+                if (strcmp(dest, name) != 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to copy `%s' to `%s'", name, dest);
+                    rc = -1;
+#if 0
+                    /* delete destination file */
+                    int unlink_rc = mfu_file_unlink(dest, mfu_dst_file);
+                    if (unlink_rc != 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s' (errno=%d %s)",
+                                  name, errno, strerror(errno)
+                                );
+                    }
+#endif
+                }
+
+                /* free destination name */
+                mfu_free(&dest);
             }
         }
+    }
 
-        last_ext_start = ext_start;
-        last_ext_len = ext_len;
+    /* free the list of success/fail for each chunk */
+    mfu_free(&vals);
 
-        while (ext_len) {
-            ssize_t num_read = mfu_file_read(src, buf, MIN(ext_len, buf_size), mfu_src_file);
+    /* free copy flags */
+    mfu_free(&results);
 
-            if (!num_read)
-                break;
-            ssize_t num_written = mfu_file_write(dest, buf, (size_t)num_read, mfu_dst_file);
+    /* free the list of file chunks */
+    mfu_file_chunk_list_free(&head);
 
-            if (num_written < 0) {
-                MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
-                          src, dest, errno, strerror(errno));
-                goto fail_fiemap;
-            }
-            if (num_written != num_read) {
-                MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s'",
-                    src, dest);
-                goto fail_fiemap;
-            }
+    /* finalize progress messages for the copy */
+    mfu_progress_complete(&copy_count, &copy_prog);
 
-            ext_len -= (size_t)num_written;
-            mfu_copy_stats.total_bytes_copied += (int64_t) num_written;
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
         }
-    }
 
-    off_t last_written = (off_t) last_byte;
-    off_t file_size_offt = (off_t) file_size;
-    if (last_written >= file_size_offt || file_size == 0) {
-        /* Use ftruncate() here rather than truncate(), because grouplock
-         * of Lustre would cause block to truncate() since the fd is different
-         * from the out_fd. */
-        if (mfu_file_ftruncate(mfu_dst_file, file_size_offt) < 0) {
-            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
-                dest, errno, strerror(errno));
-            goto fail_fiemap;
-       }
-    }
+        /* convert bytes to units */
+        double agg_size_tmp;
+        const char* agg_size_units;
+        mfu_format_bytes(sum, &agg_size_tmp, &agg_size_units);
 
-    if (last_written >= file_size_offt) {
-        mfu_copy_stats.total_size += (int64_t) (file_size_offt - (off_t) offset);
-    } else {
-        mfu_copy_stats.total_size += (int64_t) last_byte;
+        /* convert bandwidth to units */
+        double agg_rate_tmp;
+        const char* agg_rate_units;
+        mfu_format_bw(rate, &agg_rate_tmp, &agg_rate_units);
+
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Copy data: %.3lf %s (%lu bytes)",
+              agg_size_tmp, agg_size_units, sum
+            );
+            MFU_LOG(MFU_LOG_INFO, "Copy rate: %.3lf %s (%lu bytes in %.3lf seconds)",
+              agg_rate_tmp, agg_rate_units, sum, secs
+            );
+        }
     }
 
-    free(fiemap);
-    return 0;
+    mfu_trace_pop();
+    return rc;
+}
 
-fail_fiemap:
-    free(fiemap);
+/* returns 1 if item is a regular file small enough to be copied
+ * whole by the small file path, and 0 otherwise */
+static int mfu_copy_is_small(
+    mfu_flist list,
+    uint64_t idx,
+    const mfu_copy_opts_t* copy_opts)
+{
+    mfu_filetype type = mfu_flist_file_get_type(list, idx);
+    if (type != MFU_TYPE_FILE) {
+        return 0;
+    }
+
+    uint64_t size = mfu_flist_file_get_size(list, idx);
+    if (size >= copy_opts->small_file_size ||
+        size >= (uint64_t) copy_opts->chunk_size)
+    {
+        return 0;
+    }
 
-fail_normal_copy:
-    return -1;
+    return 1;
 }
 
-static int mfu_copy_file(
-    const char* src,
-    const char* dest,
-    uint64_t offset,
-    uint64_t length,
-    uint64_t file_size,
+/* open source and destination of a small file and copy its data,
+ * leaves destination open in the window slot to be flushed later,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_small_write(
+    mfu_flist list,
+    uint64_t idx,
+    mfu_copy_small_t* slot,
     mfu_copy_opts_t* copy_opts,
     mfu_file_t* mfu_src_file,
     mfu_file_t* mfu_dst_file)
 {
-    int ret;
+    const char* name = mfu_flist_file_get_name(list, idx);
+    uint64_t size = mfu_flist_file_get_size(list, idx);
 
     /* open the input file */
-    ret = mfu_copy_open_file(src, 1, &mfu_copy_src_cache,
-                             copy_opts, mfu_src_file);
-    if (ret) {
+    mfu_file_t src_file = *mfu_src_file;
+    if (mfu_file_open(name, mfu_copy_open_flags(1, copy_opts), &src_file) != 0) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open input file `%s' (errno=%d %s)",
-            src, errno, strerror(errno));
+            name, errno, strerror(errno));
         return -1;
     }
 
     /* open the output file */
-    ret = mfu_copy_open_file(dest, 0, &mfu_copy_dst_cache,
-                             copy_opts, mfu_dst_file);
-    if (ret) {
+    slot->file = *mfu_dst_file;
+    if (mfu_file_open(slot->dest, mfu_copy_open_flags(0, copy_opts), &slot->file,
+                      DCOPY_DEF_PERMS_FILE) != 0)
+    {
         MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
-                dest, errno, strerror(errno));
+            slot->dest, errno, strerror(errno));
+        mfu_file_close(name, &src_file);
         return -1;
     }
+    slot->open = 1;
 
-    if (copy_opts->sparse) {
-        bool normal_copy_required;
-        ret = mfu_copy_file_fiemap(src, dest, offset, length, file_size,
-                               &normal_copy_required, copy_opts,
-                               mfu_src_file, mfu_dst_file);
-        if (!ret || !normal_copy_required) {
-            return ret;
+    /* copy the whole file, this also truncates it to its final size */
+    int rc = mfu_copy_file_normal(name, slot->dest, 0, size, size,
+        copy_opts, &src_file, &slot->file);
+
+    /* done reading the source */
+    mfu_file_close(name, &src_file);
+
+    return rc;
+}
+
+/* flush files in the small file window, start writeback on all of
+ * them before waiting on any, then close each and set its metadata,
+ * returns 0 on success and -1 if any file failed */
+static int mfu_copy_small_flush(
+    mfu_flist list,
+    mfu_copy_small_t* window,
+    int count,
+    mfu_copy_opts_t* copy_opts,
+    mfu_file_t* mfu_dst_file)
+{
+    int rc = 0;
+
+    int i;
+#ifdef SYNC_FILE_RANGE_WRITE
+    for (i = 0; i < count; i++) {
+        mfu_copy_small_t* slot = &window[i];
+        if (slot->open && slot->file.type == POSIX) {
+            sync_file_range(slot->file.fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+        }
+    }
+#endif
+
+    for (i = 0; i < count; i++) {
+        mfu_copy_small_t* slot = &window[i];
+
+        /* data must be on disk before setting metadata, which
+         * otherwise may not stick on file systems like Lustre */
+        if (slot->open) {
+            if (slot->file.type == POSIX && mfu_fsync(slot->dest, slot->file.fd) != 0) {
+                slot->rc = -1;
+            }
+            if (mfu_file_close(slot->dest, &slot->file) != 0) {
+                slot->rc = -1;
+            }
+            slot->open = 0;
         }
-    }
 
-    ret = mfu_copy_file_normal(src, dest, offset, length, file_size,
-                               copy_opts, mfu_src_file, mfu_dst_file);
+        if (slot->rc == 0) {
+            int tmp_rc = mfu_copy_set_metadata_item(list, slot->idx, slot->dest,
+                copy_opts, mfu_dst_file);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
+        } else {
+            const char* name = mfu_flist_file_get_name(list, slot->idx);
+            MFU_LOG(MFU_LOG_ERR, "Failed to copy `%s' to `%s'", name, slot->dest);
+            rc = -1;
+        }
 
-    return ret;
+        mfu_free(&slot->dest);
+    }
+
+    return rc;
 }
 
-/* slices files in list at boundaries of chunk size, evenly distributes
- * chunks, and copies data from source to destination file,
- * returns 0 on success and -1 on error */
-static int mfu_copy_files(
+/* copies regular files smaller than both the small file limit and the
+ * chunk size, each rank creates, writes, and sets metadata on its small
+ * files in a single pass without building a chunk list or waiting on
+ * other ranks between phases, sets rest to a new list holding the items
+ * left for the regular copy path, returns 0 on success and -1 on error */
+static int mfu_copy_small_files(
     mfu_flist list,
+    mfu_flist* rest,
     int numpaths,
     const mfu_param_path* paths,
     const mfu_param_path* destpath,
@@ -2112,6 +2905,8 @@ static int mfu_copy_files(
     mfu_file_t* mfu_src_file,
     mfu_file_t* mfu_dst_file)
 {
+    mfu_trace_push("copy small files");
+
     /* assume we'll succeed */
     int rc = 0;
 
@@ -2122,31 +2917,50 @@ static int mfu_copy_files(
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* first, count number of items to create in the list of the current process */
+    /* split list into small files and everything else */
+    mfu_flist smalllist = mfu_flist_subset(list);
+    *rest = mfu_flist_subset(list);
+
     uint64_t idx;
     uint64_t size = mfu_flist_size(list);
-    uint64_t bytes = 0;
     for (idx = 0; idx < size; idx++) {
-        /* count regular files and symlinks */
-        mfu_filetype type = mfu_flist_file_get_type(list, idx);
-        if (type == MFU_TYPE_FILE) {
-            bytes += mfu_flist_file_get_size(list, idx);
+        if (mfu_copy_is_small(list, idx, copy_opts)) {
+            mfu_flist_file_copy(list, idx, smalllist);
+        } else {
+            mfu_flist_file_copy(list, idx, *rest);
         }
     }
+    mfu_flist_summarize(smalllist);
+    mfu_flist_summarize(*rest);
+
+    /* bail early if there are no small files */
+    uint64_t total_files = mfu_flist_global_size(smalllist);
+    if (total_files == 0) {
+        mfu_flist_free(&smalllist);
+        mfu_trace_pop();
+        return rc;
+    }
 
-    /* get total for print percent progress while creating */
+    /* small files don't pass through the chunk list,
+     * so spread them evenly across ranks here */
+    mfu_flist spreadlist = mfu_flist_spread(smalllist);
+    mfu_flist_free(&smalllist);
+
+    /* count bytes for progress messages */
+    uint64_t bytes = 0;
+    size = mfu_flist_size(spreadlist);
+    for (idx = 0; idx < size; idx++) {
+        bytes += mfu_flist_file_get_size(spreadlist, idx);
+    }
     copy_total_count = 0;
     MPI_Allreduce(&bytes, &copy_total_count, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
 
-    /* barrier to ensure all procs are ready to start copy */
-    MPI_Barrier(MPI_COMM_WORLD);
-
     /* indicate which phase we're in to user */
     if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Copying data.");
+        MFU_LOG(MFU_LOG_INFO, "Copying %llu small files.", total_files);
     }
 
-    /* start timer for entie operation */
+    /* start timer for entire operation */
     MPI_Barrier(MPI_COMM_WORLD);
     double total_start = MPI_Wtime();
     uint64_t total_count = 0;
@@ -2154,113 +2968,56 @@ static int mfu_copy_files(
     /* start up progress messages for the copy */
     copy_count = 0;
     copy_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, copy_progress_fn);
+    const char* copy_names[1] = {"bytes"};
+    mfu_progress_describe("copy small files", copy_names, &copy_total_count, copy_prog);
 
-    /* split file list into a linked list of file sections,
-     * this evenly spreads the file sections across processes */
-    mfu_file_chunk* head = mfu_file_chunk_list_alloc(list, copy_opts->chunk_size);
-
-    /* get a count of how many items are the chunk list */
-    uint64_t list_count = mfu_file_chunk_list_size(head);
-
-    /* allocate a flag for each element in chunk list,
-     * will store 0 to mean copy of this chunk succeeded and 1 otherwise
-     * to be used as input to logical OR to determine state of entire file */
-    int* vals = (int*) MFU_MALLOC(list_count * sizeof(int));
-
-    /* loop over and copy data for each file section we're responsible for */
-    uint64_t i;
-    const mfu_file_chunk* p = head;
-    for (i = 0; i < list_count; i++) {
-         /* assume we'll succeed in copying this chunk */
-         vals[i] = 0;
+    /* allocate slots for the files we write before flushing them */
+    int window_size = copy_opts->small_file_window;
+    if (window_size < 1) {
+        window_size = 1;
+    }
+    mfu_copy_small_t* window = (mfu_copy_small_t*) MFU_CALLOC((size_t) window_size, sizeof(mfu_copy_small_t));
 
+    int count = 0;
+    for (idx = 0; idx < size; idx++) {
         /* get name of destination file */
-        char* dest = mfu_param_path_copy_dest(p->name, numpaths,
+        const char* name = mfu_flist_file_get_name(spreadlist, idx);
+        char* dest = mfu_param_path_copy_dest(name, numpaths,
                 paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
         if (dest == NULL) {
             /* No need to copy it */
-            p = p->next;
             continue;
         }
 
-        /* add bytes to our running total */
-        total_count += (uint64_t)p->length;
-
-        /* copy portion of file corresponding to this chunk,
-         * and record whether copy operation succeeded */
-        int copy_rc = mfu_copy_file(p->name, dest, (uint64_t)p->offset,
-                (uint64_t)p->length, (uint64_t)p->file_size, copy_opts,
-                mfu_src_file, mfu_dst_file);
-        if (copy_rc < 0) {
-            /* error copying file */
-            vals[i] = 1;
-        }
-
-        /* free the dest name */
-        mfu_free(&dest);
-
-        /* update pointer to next element */
-        p = p->next;
-    }
-
-    /* close files */
-    mfu_copy_close_file(&mfu_copy_src_cache, mfu_src_file);
-    mfu_copy_close_file(&mfu_copy_dst_cache, mfu_dst_file);
-
-    /* barrier to ensure all files are closed,
-     * may try to unlink bad destination files below */
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    /* allocate a flag for each item in our file list */
-    int* results = (int*) MFU_MALLOC(size * sizeof(int));
-
-    /* intialize values, since not every item is represented
-     * in chunk list */
-    for (i = 0; i < size; i++) {
-        results[i] = 0;
-    }
-
-    /* determnie which files were copied correctly */
-    mfu_file_chunk_list_lor(list, head, vals, results);
+        mfu_copy_small_t* slot = &window[count];
+        slot->idx  = idx;
+        slot->dest = dest;
+        slot->open = 0;
+        count++;
 
-    /* delete any destination file that failed to copy */
-    for (i = 0; i < size; i++) {
-        if (results[i] != 0) {
-            /* found a file that had an error during copy,
-             * compute destination name and delete it */
-            const char* name = mfu_flist_file_get_name(list, i);
-            const char* dest = mfu_param_path_copy_dest(name, numpaths,
+        /* create inode and copy xattrs before writing data,
+         * then write data even if xattrs failed like the chunked path */
+        int create_rc = mfu_create_file(spreadlist, idx, numpaths,
                 paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
-            if (dest != NULL) {
-                /* sanity check to ensure we don't * delete the source file */
-                if (strcmp(dest, name) != 0) {
-                    MFU_LOG(MFU_LOG_ERR, "Failed to copy `%s' to `%s'", name, dest);
-                    rc = -1;
-#if 0
-                    /* delete destination file */
-                    int unlink_rc = mfu_file_unlink(dest, mfu_dst_file);
-                    if (unlink_rc != 0) {
-                        MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s' (errno=%d %s)",
-                                  name, errno, strerror(errno)
-                                );
-                    }
-#endif
-                }
-
-                /* free destination name */
-                mfu_free(&dest);
+        int write_rc = mfu_copy_small_write(spreadlist, idx, slot,
+                copy_opts, mfu_src_file, mfu_dst_file);
+        slot->rc = (create_rc < 0 || write_rc < 0) ? -1 : 0;
+        total_count++;
+
+        /* flush once the window is full */
+        if (count == window_size) {
+            if (mfu_copy_small_flush(spreadlist, window, count, copy_opts, mfu_dst_file) < 0) {
+                rc = -1;
             }
+            count = 0;
         }
     }
 
-    /* free the list of success/fail for each chunk */
-    mfu_free(&vals);
-
-    /* free copy flags */
-    mfu_free(&results);
-
-    /* free the list of file chunks */
-    mfu_file_chunk_list_free(&head);
+    /* flush any files left in the window */
+    if (mfu_copy_small_flush(spreadlist, window, count, copy_opts, mfu_dst_file) < 0) {
+        rc = -1;
+    }
+    mfu_free(&window);
 
     /* finalize progress messages for the copy */
     mfu_progress_complete(&copy_count, &copy_prog);
@@ -2273,38 +3030,28 @@ static int mfu_copy_files(
     if (verbose) {
         uint64_t sum;
         MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-
         double rate = 0.0;
         double secs = total_end - total_start;
         if (secs > 0.0) {
           rate = (double)sum / secs;
         }
-
-        /* convert bytes to units */
-        double agg_size_tmp;
-        const char* agg_size_units;
-        mfu_format_bytes(sum, &agg_size_tmp, &agg_size_units);
-
-        /* convert bandwidth to units */
-        double agg_rate_tmp;
-        const char* agg_rate_units;
-        mfu_format_bw(rate, &agg_rate_tmp, &agg_rate_units);
-
         if (rank == 0) {
-            MFU_LOG(MFU_LOG_INFO, "Copy data: %.3lf %s (%lu bytes)",
-              agg_size_tmp, agg_size_units, sum
-            );
-            MFU_LOG(MFU_LOG_INFO, "Copy rate: %.3lf %s (%lu bytes in %.3lf seconds)",
-              agg_rate_tmp, agg_rate_units, sum, secs
+            MFU_LOG(MFU_LOG_INFO, "Copied %lu small files in %.3lf seconds (%.3lf files/sec)",
+              (unsigned long)sum, secs, rate
             );
         }
     }
 
+    mfu_flist_free(&spreadlist);
+
+    mfu_trace_pop();
     return rc;
 }
 
 static void mfu_sync_all(const char* msg)
 {
+    mfu_trace_push("sync");
+
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
@@ -2322,6 +3069,167 @@ static void mfu_sync_all(const char* msg)
     if (rank == 0) {
         MFU_LOG(MFU_LOG_INFO, "Sync completed in %.3lf seconds.", (end - start));
     }
+
+    mfu_trace_pop();
+}
+
+/* map item to rank by hashing its device and inode numbers */
+static int map_inode(mfu_flist flist, uint64_t idx, int ranks, const void* args)
+{
+    uint64_t key[2];
+    key[0] = mfu_flist_file_get_dev(flist, idx);
+    key[1] = mfu_flist_file_get_ino(flist, idx);
+    uint32_t hash = mfu_hash_jenkins((const char*) key, sizeof(key));
+    return (int)(hash % (uint32_t)ranks);
+}
+
+/* file that shares its inode with other files in the list */
+typedef struct {
+    uint64_t    dev;
+    uint64_t    ino;
+    const char* name;
+    uint64_t    idx;
+} mfu_copy_inode_t;
+
+/* order files by inode, then by name so every run picks the same leader */
+static int mfu_copy_inode_cmp(const void* a, const void* b)
+{
+    const mfu_copy_inode_t* x = (const mfu_copy_inode_t*) a;
+    const mfu_copy_inode_t* y = (const mfu_copy_inode_t*) b;
+    if (x->dev != y->dev) {
+        return (x->dev < y->dev) ? -1 : 1;
+    }
+    if (x->ino != y->ino) {
+        return (x->ino < y->ino) ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+/* returns a list of the items to copy, where only one regular file of
+ * each group of files sharing an inode is kept, the others are added to
+ * links, and targets records the source path of the file each of them
+ * should be linked to once that file has been copied */
+static mfu_flist mfu_copy_split_hardlinks(
+    mfu_flist list,
+    mfu_flist* links,
+    char*** targets)
+{
+    /* separate files with more than one link from everything else */
+    mfu_flist copylist = mfu_flist_subset(list);
+    mfu_flist shared   = mfu_flist_subset(list);
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
+        uint64_t nlink = mfu_flist_file_get_nlink(list, idx);
+        if (type == MFU_TYPE_FILE && nlink > 1) {
+            mfu_flist_file_copy(list, idx, shared);
+        } else {
+            mfu_flist_file_copy(list, idx, copylist);
+        }
+    }
+    mfu_flist_summarize(shared);
+
+    /* gather all files of an inode on the same rank */
+    mfu_flist inodes = mfu_flist_remap(shared, map_inode, NULL);
+    mfu_flist_free(&shared);
+
+    /* sort files by inode */
+    size = mfu_flist_size(inodes);
+    mfu_copy_inode_t* items = (mfu_copy_inode_t*) MFU_MALLOC(size * sizeof(mfu_copy_inode_t));
+    for (idx = 0; idx < size; idx++) {
+        items[idx].dev  = mfu_flist_file_get_dev(inodes, idx);
+        items[idx].ino  = mfu_flist_file_get_ino(inodes, idx);
+        items[idx].name = mfu_flist_file_get_name(inodes, idx);
+        items[idx].idx  = idx;
+    }
+    qsort(items, (size_t)size, sizeof(mfu_copy_inode_t), mfu_copy_inode_cmp);
+
+    /* copy the first file of each inode and link the rest to it */
+    *links   = mfu_flist_subset(list);
+    *targets = (char**) MFU_MALLOC(size * sizeof(char*));
+    uint64_t count = 0;
+    uint64_t leader = 0;
+    for (idx = 0; idx < size; idx++) {
+        if (idx == 0 || items[idx].dev != items[leader].dev || items[idx].ino != items[leader].ino) {
+            leader = idx;
+            mfu_flist_file_copy(inodes, items[idx].idx, copylist);
+        } else {
+            mfu_flist_file_copy(inodes, items[idx].idx, *links);
+            (*targets)[count] = MFU_STRDUP(items[leader].name);
+            count++;
+        }
+    }
+    mfu_free(&items);
+    mfu_flist_free(&inodes);
+
+    mfu_flist_summarize(copylist);
+    mfu_flist_summarize(*links);
+
+    /* report number of files we'll link rather than copy */
+    uint64_t all_count = mfu_flist_global_size(*links);
+    if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Linking %llu files that share an inode with a copied file",
+                (unsigned long long) all_count);
+    }
+
+    return copylist;
+}
+
+/* link each item in links to the copy of its target in the destination,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_create_hardlinks(
+    mfu_flist links,
+    char** targets,
+    int numpaths,
+    const mfu_param_path* paths,
+    const mfu_param_path* destpath,
+    mfu_copy_opts_t* copy_opts,
+    mfu_file_t* mfu_src_file,
+    mfu_file_t* mfu_dst_file)
+{
+    mfu_trace_push("link");
+
+    int rc = 0;
+
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(links);
+    for (idx = 0; idx < size; idx++) {
+        /* get destination names of link and its target */
+        const char* name = mfu_flist_file_get_name(links, idx);
+        char* dest = mfu_param_path_copy_dest(name, numpaths, paths,
+            destpath, copy_opts, mfu_src_file, mfu_dst_file);
+        char* target = mfu_param_path_copy_dest(targets[idx], numpaths, paths,
+            destpath, copy_opts, mfu_src_file, mfu_dst_file);
+        if (dest == NULL || target == NULL) {
+            mfu_free(&dest);
+            mfu_free(&target);
+            continue;
+        }
+
+        /* replace any existing item at the destination */
+        int link_rc = mfu_hardlink(target, dest);
+        if (link_rc != 0 && errno == EEXIST) {
+            mfu_unlink(dest);
+            link_rc = mfu_hardlink(target, dest);
+        }
+        if (link_rc != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to create hardlink %s --> %s (errno=%d %s)",
+                    dest, target, errno, strerror(errno));
+            rc = -1;
+        } else {
+            mfu_copy_stats.total_files++;
+        }
+
+        mfu_free(&dest);
+        mfu_free(&target);
+    }
+
+    /* determine whether any process hit an error */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    mfu_trace_pop();
+    return all_rc;
 }
 
 static void print_summary(mfu_flist flist)
@@ -2433,6 +3341,8 @@ int mfu_flist_copy(
     mfu_file_t* mfu_src_file,       /* whether source items are coming from POSIX/DAOS */
     mfu_file_t* mfu_dst_file)       /* whether destination is in POSIX/DAOS */
 {
+    mfu_trace_push("copy");
+
     /* assume we'll succeed */
     int rc = 0;
 
@@ -2456,6 +3366,17 @@ int mfu_flist_copy(
     }
     mfu_flist_print_summary(src_cp_list);
 
+    /* copy only one file of each set of hard links, the other
+     * names are linked to it after its data has been copied */
+    mfu_flist src_all_list = src_cp_list;
+    mfu_flist link_list = MFU_FLIST_NULL;
+    char** link_targets = NULL;
+    if (copy_opts->hardlinks && mfu_flist_have_detail(src_cp_list) &&
+        mfu_src_file->type == POSIX && mfu_dst_file->type == POSIX)
+    {
+        src_cp_list = mfu_copy_split_hardlinks(src_all_list, &link_list, &link_targets);
+    }
+
     /* TODO: consider file system striping params here */
     /* hard code some configurables for now */
 
@@ -2475,9 +3396,6 @@ int mfu_flist_copy(
     mfu_copy_stats.total_size  = 0;
     mfu_copy_stats.total_bytes_copied = 0;
 
-    /* Initialize file cache */
-    mfu_copy_src_cache.name = NULL;
-    mfu_copy_dst_cache.name = NULL;
 
     /* split items in file list into sublists depending on their
      * directory depth */
@@ -2488,7 +3406,7 @@ int mfu_flist_copy(
     /* TODO: filter out files that are bigger than 0 bytes if we can't read them */
 
     /* create directories, from top down */
-    int tmp_rc = mfu_create_directories(levels, minlevel, lists, numpaths,
+    int tmp_rc = mfu_create_directories(src_cp_list, numpaths,
             paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
     if (tmp_rc < 0) {
         rc = -1;
@@ -2538,11 +3456,22 @@ int mfu_flist_copy(
             /* update our offset */
             batch_offset += count;
 
+            /* copy small files in a single pass, the
+             * remaining items go through the chunked path */
+            mfu_flist copylist = tmplist;
+            if (copy_opts->small_file_size > 0) {
+                tmp_rc = mfu_copy_small_files(tmplist, &copylist, numpaths,
+                    paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
+                if (tmp_rc < 0) {
+                    rc = -1;
+                }
+            }
+
             /* if this batch is all directories, skip this part */
-            uint64_t tmplist_size = mfu_flist_global_size(tmplist);
+            uint64_t tmplist_size = mfu_flist_global_size(copylist);
             if (tmplist_size > 0) {
                 /* spread items evenly over ranks */
-                mfu_flist spreadlist = mfu_flist_spread(tmplist);
+                mfu_flist spreadlist = mfu_flist_spread(copylist);
 
                 /* split items in file list into sublists depending on their
                  * directory depth */
@@ -2583,6 +3512,9 @@ int mfu_flist_copy(
             }
 
             /* done with our batch list */
+            if (copylist != tmplist) {
+                mfu_flist_free(&copylist);
+            }
             mfu_flist_free(&tmplist);
 
             /* Determine the actual and relative end time for the epilogue. */
@@ -2655,6 +3587,16 @@ int mfu_flist_copy(
             }
         }
 
+        /* link remaining names of hard linked files now that
+         * every file they refer to has been copied */
+        if (link_list != MFU_FLIST_NULL) {
+            tmp_rc = mfu_copy_create_hardlinks(link_list, link_targets, numpaths,
+                    paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
+        }
+
         /* set permissions, ownership, and timestamps if needed */
         mfu_copy_set_metadata_dirs(levels, minlevel, lists, numpaths,
                 paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
@@ -2664,15 +3606,30 @@ int mfu_flist_copy(
     } else {
         /* user does not want to batch files, so copy the whole list */
 
+        /* copy small files in a single pass, the
+         * remaining items go through the chunked path */
+        mfu_flist copylist = src_cp_list;
+        int copy_levels = levels;
+        int copy_minlevel = minlevel;
+        mfu_flist* copy_lists = lists;
+        if (copy_opts->small_file_size > 0) {
+            tmp_rc = mfu_copy_small_files(src_cp_list, &copylist, numpaths,
+                paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
+            mfu_flist_array_by_depth(copylist, &copy_levels, &copy_minlevel, &copy_lists);
+        }
+
         /* create files and links */
-        tmp_rc = mfu_create_files(levels, minlevel, lists, numpaths,
+        tmp_rc = mfu_create_files(copy_levels, copy_minlevel, copy_lists, numpaths,
                 paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
         if (tmp_rc < 0) {
             rc = -1;
         }
 
         /* copy data */
-        tmp_rc = mfu_copy_files(src_cp_list, numpaths, paths, destpath,
+        tmp_rc = mfu_copy_files(copylist, numpaths, paths, destpath,
             copy_opts, mfu_src_file, mfu_dst_file);
         if (tmp_rc < 0) {
             rc = -1;
@@ -2682,10 +3639,26 @@ int mfu_flist_copy(
          * setting mismatch, which may happen on lustre */
         mfu_sync_all("Syncing data to disk.");
 
+        /* link remaining names of hard linked files, before
+         * directory timestamps are set */
+        if (link_list != MFU_FLIST_NULL) {
+            tmp_rc = mfu_copy_create_hardlinks(link_list, link_targets, numpaths,
+                    paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
+        }
+
         /* set permissions, ownership, and timestamps if needed */
-        mfu_copy_set_metadata(levels, minlevel, lists, numpaths,
+        mfu_copy_set_metadata(copy_levels, copy_minlevel, copy_lists, numpaths,
                 paths, destpath, copy_opts, mfu_src_file, mfu_dst_file);
 
+        /* free lists of items left after copying small files */
+        if (copylist != src_cp_list) {
+            mfu_flist_array_free(copy_levels, &copy_lists);
+            mfu_flist_free(&copylist);
+        }
+
         /* force updates to disk */
         mfu_sync_all("Syncing directory updates to disk.");
     }
@@ -2693,9 +3666,22 @@ int mfu_flist_copy(
     /* free our lists of levels */
     mfu_flist_array_free(levels, &lists);
 
+    /* free lists used to recreate hard links */
+    if (link_list != MFU_FLIST_NULL) {
+        uint64_t idx;
+        uint64_t link_count = mfu_flist_size(link_list);
+        for (idx = 0; idx < link_count; idx++) {
+            mfu_free(&link_targets[idx]);
+        }
+        mfu_free(&link_targets);
+        mfu_flist_free(&link_list);
+        mfu_flist_free(&src_cp_list);
+    }
+
     /* free buffers */
     mfu_free(&copy_opts->block_buf1);
     mfu_free(&copy_opts->block_buf2);
+    mfu_copy_xattr_bufs_free();
 
     /* Determine the actual and relative end time for the epilogue. */
     mfu_copy_stats.wtime_ended = MPI_Wtime();
@@ -2775,6 +3761,7 @@ int mfu_flist_copy(
     MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
     rc = all_rc;
 
+    mfu_trace_pop();
     return rc;
 }
 
@@ -2837,8 +3824,8 @@ static int mfu_fill_file(
     mfu_file_t* mfu_file)
 {
     /* open the file */
-    int ret = mfu_copy_open_file(dest, 0, &mfu_copy_dst_cache, copy_opts, mfu_file);
-    if (ret) {
+    mfu_copy_file_cache_t* entry = mfu_copy_open_file(dest, 0, &mfu_copy_dst_cache, copy_opts, mfu_file);
+    if (entry == NULL) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
             dest, errno, strerror(errno));
         return -1;
@@ -2929,7 +3916,7 @@ static int mfu_fill_file(
 
     /* we don't bother closing the file because our cache does it for us */
 
-    return ret;
+    return 0;
 }
 
 int mfu_flist_fill(mfu_flist list, mfu_copy_opts_t* copy_opts, mfu_file_t* mfu_file)
@@ -2971,6 +3958,8 @@ int mfu_flist_fill(mfu_flist list, mfu_copy_opts_t* copy_opts, mfu_file_t* mfu_f
     /* start up progress messages for the copy */
     fill_count = 0;
     fill_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, fill_progress_fn);
+    const char* fill_names[1] = {"bytes"};
+    mfu_progress_describe("fill", fill_names, NULL, fill_prog);
 
     /* split file list into a linked list of file sections,
      * this evenly spreads the file sections across processes */
@@ -3008,7 +3997,7 @@ int mfu_flist_fill(mfu_flist list, mfu_copy_opts_t* copy_opts, mfu_file_t* mfu_f
     }
 
     /* close files */
-    mfu_copy_close_file(&mfu_copy_dst_cache, mfu_file);
+    mfu_copy_cache_close_all(&mfu_copy_dst_cache, mfu_file);
 
     /* barrier to ensure all files are closed,
      * may try to unlink bad destination files below */
@@ -3129,9 +4118,6 @@ int mfu_flist_hardlink(
     mfu_copy_stats.total_size  = 0;
     mfu_copy_stats.total_bytes_copied = 0;
 
-    /* Initialize file cache */
-    mfu_copy_src_cache.name = NULL;
-    mfu_copy_dst_cache.name = NULL;
 
     /* split items in file list into sublists depending on their
      * directory depth */
@@ -3142,7 +4128,7 @@ int mfu_flist_hardlink(
     /* TODO: filter out files that are bigger than 0 bytes if we can't read them */
 
     /* create directories, from top down */
-    int tmp_rc = mfu_create_directories(levels, minlevel, lists, 1,
+    int tmp_rc = mfu_create_directories(src_link_list, 1,
             srcpath, destpath, copy_opts, mfu_src_file, mfu_dst_file);
     if (tmp_rc < 0) {
         rc = -1;
@@ -3291,7 +4277,7 @@ int mfu_flist_file_sync_meta(mfu_flist src_list, uint64_t src_index,
 mfu_file_t* mfu_file_new(void)
 {
     mfu_file_t* mfile = (mfu_file_t*) MFU_MALLOC(sizeof(mfu_file_t));
-    mfile->type       = POSIX;
+    mfile->type       = mfu_mock_enabled ? MOCK : POSIX;
     mfile->fd         = -1;
 #ifdef DAOS_SUPPORT
     mfile->obj        = NULL;
@@ -3361,6 +4347,16 @@ mfu_copy_opts_t* mfu_copy_opts_new(void)
     /* By default, do not limit the batch size */
     opts->batch_files = 0;
 
+    /* Set default number of files to keep open for reading and writing */
+    opts->open_files = MFU_OPEN_FILES;
+
+    /* Set default limit and window for the small file copy path */
+    opts->small_file_size   = MFU_SMALL_FILE_SIZE;
+    opts->small_file_window = MFU_SMALL_FILE_WINDOW;
+
+    /* By default, copy each name of a hard linked file separately */
+    opts->hardlinks = false;
+
     return opts;
 }
 
@@ -1,5 +1,6 @@
 #include <string.h>
 #include <errno.h>
+#include <libgen.h> /* dirname */
 
 #include "mfu.h"
 #include "mfu_flist_internal.h"
@@ -44,7 +45,7 @@ static void mkdir_progress_fn(const uint64_t* vals, int count, int complete, int
     }
 }
 
-static int create_directory(mfu_flist list, uint64_t idx)
+static int create_directory(mfu_flist list, uint64_t idx, mfu_file_t* mfu_file)
 {
     /* get name of directory */
     const char* name = mfu_flist_file_get_name(list, idx);
@@ -54,7 +55,7 @@ static int create_directory(mfu_flist list, uint64_t idx)
     mode_t mode = DCOPY_DEF_PERMS_DIR;
 
     /* create the destination directory */
-    int rc = mfu_mkdir(name, mode);
+    int rc = mfu_file_mkdir(name, mode, mfu_file);
     if (rc < 0) {
         if (errno == EEXIST) {
 #if 0
@@ -75,14 +76,122 @@ static int create_directory(mfu_flist list, uint64_t idx)
     return 0;
 }
 
-/* create all directories specified in flist */
-/* create directories, we work from shallowest level to the deepest
- * with a barrier in between levels, so that we don't try to create
- * a child directory until the parent exists */
-void mfu_flist_mkdir(mfu_flist flist, mfu_create_opts_t* opts)
+/* map a directory to the rank holding the table entry for its path,
+ * a child finds the rank holding its parent from the parent path */
+static int map_dir(mfu_flist flist, uint64_t idx, int ranks, const void* args)
+{
+    const char* name = mfu_flist_file_get_name(flist, idx);
+    return mfu_release_key_rank(name, ranks);
+}
+
+/* calls fn on each directory in flist only after fn has been called on
+ * its parent, if its parent is in the list, directories are spread over
+ * ranks by hashing their path and each rank tells the rank of each child
+ * once it has processed the parent, so ranks never wait on directories
+ * outside their own subtrees, returns 0 on success and -1 if any call
+ * to fn failed */
+int mfu_flist_dirs_top_down(mfu_flist flist, mfu_flist_dir_fn fn, void* args)
 {
     int rc = 0;
 
+    /* gather directories from list, and hash each one to a rank */
+    mfu_flist dirlist = mfu_flist_subset(flist);
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(flist);
+    for (idx = 0; idx < size; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(flist, idx);
+        if (type == MFU_TYPE_DIR) {
+            mfu_flist_file_copy(flist, idx, dirlist);
+        }
+    }
+    mfu_flist_summarize(dirlist);
+    mfu_flist list = mfu_flist_remap(dirlist, map_dir, NULL);
+    mfu_flist_free(&dirlist);
+
+    /* each directory waits on its parent, which is an entry in the
+     * table of directory names on the rank its parent maps to,
+     * the top of a tree names itself as its parent and is ready now */
+    size = mfu_flist_size(list);
+    char** names   = (char**) MFU_MALLOC(size * sizeof(char*));
+    char** parents = (char**) MFU_MALLOC(size * sizeof(char*));
+    for (idx = 0; idx < size; idx++) {
+        const char* name = mfu_flist_file_get_name(list, idx);
+        char* parent = MFU_STRDUP(name);
+        dirname(parent);
+        if (strcmp(parent, name) == 0) {
+            mfu_free(&parent);
+        }
+        names[idx]   = (char*) name;
+        parents[idx] = parent;
+    }
+
+    mfu_release_t rel;
+    mfu_release_init(&rel, size);
+    mfu_release_register(&rel, size, parents, names, size);
+
+    for (idx = 0; idx < size; idx++) {
+        mfu_free(&parents[idx]);
+    }
+    mfu_free(&parents);
+    mfu_free(&names);
+
+    /* process directories as they become ready, releasing their children,
+     * and pick up releases from other ranks until all of ours are done */
+    uint64_t done = 0;
+    while (done < size) {
+        while (mfu_release_pop(&rel, &idx)) {
+            if (fn(list, idx, args) != 0) {
+                rc = -1;
+            }
+            done++;
+
+            mfu_release_done(&rel, idx);
+        }
+
+        /* pass on releases before we wait for our own */
+        mfu_release_flush(&rel);
+
+        if (done < size) {
+            mfu_release_wait(&rel);
+        }
+    }
+
+    mfu_release_free(&rel);
+    mfu_flist_free(&list);
+
+    return rc;
+}
+
+/* arguments passed to mkdir_fn while creating directories */
+typedef struct {
+    int rc;                /* most recent non-zero return code */
+    uint64_t count;        /* number of directories created so far */
+    mfu_progress* prg;     /* progress messages */
+    mfu_file_t* mfu_file;  /* I/O filesystem functions to create directories with */
+} mkdir_args_t;
+
+static int mkdir_fn(mfu_flist list, uint64_t idx, void* args)
+{
+    mkdir_args_t* mkdir_args = (mkdir_args_t*) args;
+
+    /* create the directory */
+    int tmp_rc = create_directory(list, idx, mkdir_args->mfu_file);
+    if (tmp_rc != 0) {
+        /* set return code to most recent non-zero return code */
+        mkdir_args->rc = tmp_rc;
+    }
+
+    /* update our running count for progress messages */
+    mkdir_args->count++;
+    mfu_progress_update(&mkdir_args->count, mkdir_args->prg);
+
+    return tmp_rc;
+}
+
+/* create all directories specified in flist, a directory is created
+ * as soon as its parent exists rather than one level at a time */
+void mfu_flist_mkdir(mfu_flist flist, mfu_create_opts_t* opts, mfu_file_t* mfu_file)
+{
     /* get current rank */
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -114,50 +223,17 @@ void mfu_flist_mkdir(mfu_flist flist, mfu_create_opts_t* opts)
     }
 
     /* start progress messages while setting metadata */
-    mfu_progress* mkdir_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, mkdir_progress_fn);
+    mkdir_args_t args;
+    args.rc    = 0;
+    args.count = 0;
+    args.mfu_file = mfu_file;
+    args.prg   = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, mkdir_progress_fn);
 
-    /* split items in file list into sublists depending on their
-     * directory depth */
-    int levels, minlevel;
-    mfu_flist* lists;
-    mfu_flist_array_by_depth(flist, &levels, &minlevel, &lists);
-
-    /* work from shallowest level to deepest level */
-    int level;
-    uint64_t reduce_count = 0;
-    for (level = 0; level < levels; level++) {
-        /* get list of items for this level */
-        mfu_flist list = lists[level];
-
-        /* create each directory we have at this level */
-        size = mfu_flist_size(list);
-        for (idx = 0; idx < size; idx++) {
-            /* check whether we have a directory */
-            mfu_filetype type = mfu_flist_file_get_type(list, idx);
-            if (type == MFU_TYPE_DIR) {
-                /* create the directory */
-                int tmp_rc = create_directory(list, idx);
-                if (tmp_rc != 0) {
-                    /* set return code to most recent non-zero return code */
-                    rc = tmp_rc;
-                }
-
-                /* update our running count for progress messages */
-                reduce_count++;
-                mfu_progress_update(&reduce_count, mkdir_prog);
-            }
-        }
-
-        /* wait for all procs to finish before we start
-         * creating directories at next level */
-        MPI_Barrier(MPI_COMM_WORLD);
-    }
+    /* create each directory once its parent exists */
+    mfu_flist_dirs_top_down(flist, mkdir_fn, &args);
 
     /* finalize progress messages */
-    mfu_progress_complete(&reduce_count, &mkdir_prog);
-
-    /* free our lists of levels */
-    mfu_flist_array_free(levels, &lists);
+    mfu_progress_complete(&args.count, &args.prg);
 
     return;
 }
@@ -202,7 +278,7 @@ static void mknod_progress_fn(const uint64_t* vals, int count, int complete, int
     }
 }
 
-static int create_file(mfu_flist list, uint64_t idx, mfu_create_opts_t* opts)
+static int create_file(mfu_flist list, uint64_t idx, mfu_create_opts_t* opts, mfu_file_t* mfu_file)
 {
     /* get source name */
     const char* name = mfu_flist_file_get_name(list, idx);
@@ -222,7 +298,7 @@ static int create_file(mfu_flist list, uint64_t idx, mfu_create_opts_t* opts)
                 /* If we are overwriting files, preemptively delete any existing entry.
                  * Once a file exists, its striping parameters can't be changed. */
                 if (opts->overwrite) {
-                    mfu_unlink(name);
+                    mfu_file_unlink(name, mfu_file);
                 }
 
                 /* file size is big enough, let's stripe */
@@ -240,17 +316,17 @@ static int create_file(mfu_flist list, uint64_t idx, mfu_create_opts_t* opts)
      * see makedev() to create valid dev */
     dev_t dev;
     memset(&dev, 0, sizeof(dev_t));
-    int mknod_rc = mfu_mknod(name, mode | S_IFREG, dev);
+    int mknod_rc = mfu_file_mknod(name, mode | S_IFREG, dev, mfu_file);
     if (mknod_rc < 0) {
         if (errno == EEXIST) {
             /* failed to create because something already exists at this path,
              * try to delete it */
             if (opts->overwrite) {
                 /* user selected over write, so try to delete the item */
-                int unlink_rc = mfu_unlink(name);
+                int unlink_rc = mfu_file_unlink(name, mfu_file);
                 if (unlink_rc == 0) {
                     /* delete succeeded, try to create it agai */
-                    mknod_rc = mfu_mknod(name, mode | S_IFREG, dev);
+                    mknod_rc = mfu_file_mknod(name, mode | S_IFREG, dev, mfu_file);
                     if (mknod_rc < 0) {
                         MFU_LOG(MFU_LOG_WARN,
                             "Failed to create: `%s' (errno=%d %s)",
@@ -288,7 +364,7 @@ static int create_file(mfu_flist list, uint64_t idx, mfu_create_opts_t* opts)
 }
 
 /* create inodes for all regular files in flist, assumes directories exist */
-void mfu_flist_mknod(mfu_flist flist, mfu_create_opts_t* opts)
+void mfu_flist_mknod(mfu_flist flist, mfu_create_opts_t* opts, mfu_file_t* mfu_file)
 {
     /* get current rank */
     int rank;
@@ -333,7 +409,7 @@ void mfu_flist_mknod(mfu_flist flist, mfu_create_opts_t* opts)
         mfu_filetype type = mfu_flist_file_get_type(flist, idx);
         if (type == MFU_TYPE_FILE) {
             /* TODO: skip file if it's not readable */
-            create_file(flist, idx, opts);
+            create_file(flist, idx, opts, mfu_file);
 
             /* update our running count for progress messages */
             count++;
@@ -370,7 +446,8 @@ static void metaapply_progress_fn(const uint64_t* vals, int count, int complete,
 
 static int mfu_set_ownership(
     mfu_flist flist,
-    uint64_t idx)
+    uint64_t idx,
+    mfu_file_t* mfu_file)
 {
     /* assume we'll succeed */
     int rc = 0;
@@ -381,7 +458,7 @@ static int mfu_set_ownership(
 
     /* note that we use lchown to change ownership of link itself, it path happens to be a link */
     const char* name = mfu_flist_file_get_name(flist, idx);
-    if(mfu_lchown(name, uid, gid) != 0) {
+    if(mfu_file_lchown(name, uid, gid, mfu_file) != 0) {
         /* TODO: are there other EPERM conditions we do want to report? */
 
         /* since the user running dcp may not be the owner of the
@@ -403,7 +480,8 @@ static int mfu_set_ownership(
 static int mfu_set_permissions(
     mfu_flist flist,
     uint64_t idx,
-    mfu_create_opts_t* opts)
+    mfu_create_opts_t* opts,
+    mfu_file_t* mfu_file)
 {
     /* assume we'll succeed */
     int rc = 0;
@@ -424,7 +502,7 @@ static int mfu_set_permissions(
 
         /* chmod of the item */
         const char* name = mfu_flist_file_get_name(flist, idx);
-        if(mfu_chmod(name, mode) != 0) {
+        if(mfu_file_chmod(name, mode, mfu_file) != 0) {
             MFU_LOG(MFU_LOG_ERR, "Failed to change permissions on `%s' chmod() (errno=%d %s)",
                 name, errno, strerror(errno));
             rc = -1;
@@ -435,7 +513,8 @@ static int mfu_set_permissions(
 
 static int mfu_set_timestamps(
     mfu_flist flist,
-    uint64_t idx)
+    uint64_t idx,
+    mfu_file_t* mfu_file)
 {
     /* assume we'll succeed */
     int rc = 0;
@@ -460,7 +539,7 @@ static int mfu_set_timestamps(
      * if it's not absolute, and set times on link (not target file)
      * if dest_path refers to a link */
     const char* name = mfu_flist_file_get_name(flist, idx);
-    if(mfu_utimensat(AT_FDCWD, name, times, AT_SYMLINK_NOFOLLOW) != 0) {
+    if(mfu_file_utimensat(AT_FDCWD, name, times, AT_SYMLINK_NOFOLLOW, mfu_file) != 0) {
         MFU_LOG(MFU_LOG_ERR, "Failed to change timestamps on `%s' utime() (errno=%d %s)",
             name, errno, strerror(errno)
         );
@@ -473,7 +552,7 @@ static int mfu_set_timestamps(
 /* apply metadata to items in flist
  * work from deepest level to shallowest level in case we're
  * doing things like disabling access on directories */
-void mfu_flist_metadata_apply(mfu_flist flist, mfu_create_opts_t* opts)
+void mfu_flist_metadata_apply(mfu_flist flist, mfu_create_opts_t* opts, mfu_file_t* mfu_file)
 {
     int rc = 0;
 
@@ -514,13 +593,13 @@ void mfu_flist_metadata_apply(mfu_flist flist, mfu_create_opts_t* opts)
         uint64_t size = mfu_flist_size(list);
         for (idx = 0; idx < size; idx++) {
             if (opts->set_owner) {
-                int tmp_rc = mfu_set_ownership(list, idx);
+                int tmp_rc = mfu_set_ownership(list, idx, mfu_file);
                 if (tmp_rc < 0) {
                     rc = -1;
                 }
             }
 
-            int tmp_rc = mfu_set_permissions(list, idx, opts);
+            int tmp_rc = mfu_set_permissions(list, idx, opts, mfu_file);
             if (tmp_rc < 0) {
                 rc = -1;
             }
@@ -532,7 +611,7 @@ void mfu_flist_metadata_apply(mfu_flist flist, mfu_create_opts_t* opts)
             }
 #endif
             if (opts->set_timestamps) {
-                int tmp_rc = mfu_set_timestamps(list, idx);
+                int tmp_rc = mfu_set_timestamps(list, idx, mfu_file);
                 if (tmp_rc < 0) {
                     rc = -1;
                 }
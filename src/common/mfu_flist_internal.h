@@ -40,6 +40,9 @@ typedef struct list_elem {
     uint64_t ctime;         /* create time */
     uint64_t ctime_nsec;    /* create time nanoseconds */
     uint64_t size;          /* file size in bytes */
+    uint64_t dev;           /* device holding the inode */
+    uint64_t ino;           /* inode number */
+    uint64_t nlink;         /* number of hard links to inode */
     struct list_elem* next; /* pointer to next item */
     /* vars for a non-posix DAOS copy */
     uint64_t obj_id_lo;
@@ -95,12 +98,16 @@ void mfu_flist_usrgrp_create_map(const buf_t* items, strmap* id2name);
  * to a string if no matching name is found */
 const char* mfu_flist_usrgrp_get_name_from_id(strmap* id2name, uint64_t id);
 
-/* read user array from file system using getpwent() */
+/* prepare user array, names are filled in by mfu_flist_usrgrp_resolve */
 void mfu_flist_usrgrp_get_users(flist_t* flist);
 
-/* read group array from file system using getgrent() */
+/* prepare group array, names are filled in by mfu_flist_usrgrp_resolve */
 void mfu_flist_usrgrp_get_groups(flist_t* flist);
 
+/* look up names of user and group ids in list that are not yet known,
+ * must be called by all ranks */
+void mfu_flist_usrgrp_resolve(flist_t* flist);
+
 /* initialize structures for user and group names and id-to-name maps */
 void mfu_flist_usrgrp_init(flist_t* flist);
 
@@ -121,6 +128,68 @@ void mfu_flist_insert_stat(flist_t* flist, const char* fpath, mode_t mode, const
  * and absolute */
 int mfu_flist_compute_depth(const char* path);
 
+/* open file through the per-rank cache of open source (src=1) or
+ * destination (src=0) files shared by the copy, fill, and compare
+ * routines, sets descriptor in mfu_file, returns 0 on success */
+int mfu_copy_cache_open_file(int src, const char* file, int flags, mfu_copy_opts_t* copy_opts, mfu_file_t* mfu_file);
+
+/* close all files held in the open file caches, fsync'ing those
+ * open for write, returns 0 on success and -1 on error */
+int mfu_copy_cache_close_files(mfu_file_t* mfu_src_file, mfu_file_t* mfu_dst_file);
+
+/* tracks items on this rank that may be processed, and releases of
+ * items on other ranks waiting to be sent, to process items in
+ * dependency order using point-to-point messages between ranks */
+typedef struct {
+    MPI_Comm comm;          /* communicator for release messages */
+    int rank;               /* our rank in comm */
+    int ranks;              /* number of ranks in comm */
+    uint64_t* ready;        /* stack of local items ready to process */
+    uint64_t ready_count;   /* number of entries in ready */
+    uint64_t** out;         /* per-rank buffer of items to release */
+    uint64_t* out_count;    /* number of entries in each out buffer */
+    uint64_t* out_max;      /* allocated length of each out buffer */
+    MPI_Request* reqs;      /* outstanding sends */
+    uint64_t** bufs;        /* buffers of outstanding sends */
+    int reqs_count;         /* number of outstanding sends */
+    int reqs_max;           /* allocated length of reqs and bufs */
+    uint64_t* recv;         /* buffer to receive releases */
+    int recv_max;           /* allocated length of recv */
+    uint64_t* deps_start;   /* offset into deps for each table entry */
+    uint64_t* deps;         /* (rank, item) pairs waiting on table entries */
+} mfu_release_t;
+
+/* initialize release state for up to size local items, collective */
+void mfu_release_init(mfu_release_t* rel, uint64_t size);
+
+/* return rank that a table entry with given key must live on */
+int mfu_release_key_rank(const char* key, int ranks);
+
+/* collective, for each of our count items, item i waits on the table
+ * entry named keys[i] on rank mfu_release_key_rank(keys[i]), an item
+ * whose key is NULL or is not in that rank's table is ready now,
+ * table lists keys of our own entries which must be unique */
+void mfu_release_register(mfu_release_t* rel, uint64_t count, char** keys,
+                          char** table, uint64_t table_size);
+
+/* mark item idx on rank dest as ready */
+void mfu_release_push(mfu_release_t* rel, int dest, uint64_t idx);
+
+/* mark all items waiting on our table entry as ready */
+void mfu_release_done(mfu_release_t* rel, uint64_t entry);
+
+/* send releases queued for other ranks */
+void mfu_release_flush(mfu_release_t* rel);
+
+/* pop a ready item into idx, returns 1 if there was one and 0 otherwise */
+int mfu_release_pop(mfu_release_t* rel, uint64_t* idx);
+
+/* block until releases for at least one of our items arrive */
+void mfu_release_wait(mfu_release_t* rel);
+
+/* wait for outstanding sends and free release state */
+void mfu_release_free(mfu_release_t* rel);
+
 #endif /* MFU_FLIST_INTERNAL_H */
 
 /* enable C++ codes to include this header directly */
@@ -322,6 +322,11 @@ static void list_insert_decode(flist_t* flist, char* buf)
     /* decode buffer and store values in element */
     list_elem_decode(buf, elem);
 
+    /* cache files do not record inode numbers */
+    elem->dev   = 0;
+    elem->ino   = 0;
+    elem->nlink = 0;
+
     /* append element to tail of linked list */
     mfu_flist_insert_elem(flist, elem);
 
@@ -337,6 +342,11 @@ static size_t list_insert_ptr(flist_t* flist, char* ptr, int detail, uint64_t ch
     /* get name and advance pointer */
     size_t bytes = list_elem_unpack(ptr, detail, chars, elem);
 
+    /* cache files do not record inode numbers */
+    elem->dev   = 0;
+    elem->ino   = 0;
+    elem->nlink = 0;
+
     /* append element to tail of linked list */
     mfu_flist_insert_elem(flist, elem);
 
@@ -1084,6 +1094,8 @@ void mfu_flist_read_cache(
     const char* name,
     mfu_flist bflist)
 {
+    mfu_trace_push("read list");
+
     /* convert handle to flist_t */
     flist_t* flist = (flist_t*) bflist;
 
@@ -1109,6 +1121,7 @@ void mfu_flist_read_cache(
         if (rank == 0) {
             MFU_LOG(MFU_LOG_ERR, "Failed to open file %s", name);
         }
+        mfu_trace_pop();
         return;
     }
 
@@ -1181,6 +1194,7 @@ void mfu_flist_read_cache(
     /* wait for summary to be printed */
     MPI_Barrier(MPI_COMM_WORLD);
 
+    mfu_trace_pop();
     return;
 }
 
@@ -1547,6 +1561,8 @@ void mfu_flist_write_cache(
     const char* name,
     mfu_flist bflist)
 {
+    mfu_trace_push("write list");
+
     /* convert handle to flist_t */
     flist_t* flist = (flist_t*) bflist;
 
@@ -1588,6 +1604,7 @@ void mfu_flist_write_cache(
     /* wait for summary to be printed */
     MPI_Barrier(MPI_COMM_WORLD);
 
+    mfu_trace_pop();
     return;
 }
 
@@ -1671,6 +1688,8 @@ void mfu_flist_write_text(
     const char* name,
     mfu_flist bflist)
 {
+    mfu_trace_push("write list");
+
     /* convert handle to flist_t */
     flist_t* flist = (flist_t*) bflist;
 
@@ -1826,5 +1845,6 @@ void mfu_flist_write_text(
         );
     }
 
+    mfu_trace_pop();
     return;
 }
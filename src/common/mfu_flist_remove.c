@@ -7,6 +7,8 @@
 #include <sys/stat.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
 #include <getopt.h>
 
 #include <pwd.h> /* for getpwent */
@@ -63,14 +65,16 @@ static void remove_progress_fn(const uint64_t* vals, int count, int complete, in
 }
 
 /* removes name by calling rmdir, unlink, or remove depending
- * on item type */
-static void remove_type(char type, const char* name, mfu_file_t* mfu_file)
+ * on item type, returns 1 if the item could not be removed and 0
+ * otherwise, an item that is already gone counts as removed */
+static uint64_t remove_type(char type, const char* name, mfu_file_t* mfu_file)
 {
     if (type == 'd') {
         int rc = mfu_file_rmdir(name, mfu_file);
         if (rc != 0 && errno != ENOENT) {
             MFU_LOG(MFU_LOG_ERR, "Failed to rmdir `%s' (errno=%d %s)",
                     name, errno, strerror(errno));
+            return 1;
         }
     }
     else if (type == 'f') {
@@ -78,6 +82,7 @@ static void remove_type(char type, const char* name, mfu_file_t* mfu_file)
         if (rc != 0 && errno != ENOENT) {
             MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s' (errno=%d %s)",
                     name, errno, strerror(errno));
+            return 1;
         }
     }
     else if (type == 'u') {
@@ -85,27 +90,31 @@ static void remove_type(char type, const char* name, mfu_file_t* mfu_file)
         if (rc != 0 && errno != ENOENT) {
             MFU_LOG(MFU_LOG_ERR, "Failed to remove `%s' (errno=%d %s)",
                     name, errno, strerror(errno));
+            return 1;
         }
     }
     else {
         /* print error */
         MFU_LOG(MFU_LOG_ERR, "Unknown type=%c name=%s",
                 type, name);
+        return 1;
     }
 
-    return;
+    return 0;
 }
 
 /*****************************
  * Directly remove items in local portion of distributed list
  ****************************/
 
-/* for given depth, just remove the files we know about */
-static void remove_direct(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
+/* for given depth, just remove the files we know about,
+ * returns number of items that could not be removed */
+static uint64_t remove_direct(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
 {
     /* each process directly removes its elements */
     uint64_t idx;
     uint64_t size = mfu_flist_size(list);
+    uint64_t errors = 0;
 
     /* keep track of files deleted so far */
     for (idx = 0; idx < size; idx++) {
@@ -115,13 +124,13 @@ static void remove_direct(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_fil
 
         /* delete item */
         if (type == MFU_TYPE_DIR) {
-            remove_type('d', name, mfu_file);
+            errors += remove_type('d', name, mfu_file);
         }
         else if (type == MFU_TYPE_FILE || type == MFU_TYPE_LINK) {
-            remove_type('f', name, mfu_file);
+            errors += remove_type('f', name, mfu_file);
         }
         else {
-            remove_type('u', name, mfu_file);
+            errors += remove_type('u', name, mfu_file);
         }
 
         /* increment number of items we have deleted
@@ -132,7 +141,7 @@ static void remove_direct(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_fil
 
     /* report the number of items we deleted */
     *rmcount += size;
-    return;
+    return errors;
 }
 
 /*****************************
@@ -141,14 +150,14 @@ static void remove_direct(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_fil
 
 /* for given depth, evenly spread the files among processes for
  * improved load balancing */
-static void remove_spread(mfu_flist flist, uint64_t* rmcount, mfu_file_t* mfu_file)
+static uint64_t remove_spread(mfu_flist flist, uint64_t* rmcount, mfu_file_t* mfu_file)
 {
     /* evenly spread flist among processes,
      * execute direct delete, and free temp list */
     mfu_flist newlist = mfu_flist_spread(flist);
-    remove_direct(newlist, rmcount, mfu_file);
+    uint64_t errors = remove_direct(newlist, rmcount, mfu_file);
     mfu_flist_free(&newlist);
-    return;
+    return errors;
 }
 
 /*****************************
@@ -158,18 +167,18 @@ static void remove_spread(mfu_flist flist, uint64_t* rmcount, mfu_file_t* mfu_fi
 /* for given depth, evenly spread the files among processes for
  * improved load balancing and sort items by path name to help
  * cluster items in the same directory to the same process */
-static void remove_spread_sort(mfu_flist flist, uint64_t* rmcount, mfu_file_t* mfu_file)
+static uint64_t remove_spread_sort(mfu_flist flist, uint64_t* rmcount, mfu_file_t* mfu_file)
 {
     /* evenly spread flist among processes,
      * sort by path name, execute direct delete, and free temp list */
     mfu_flist spread = mfu_flist_spread(flist);
     mfu_flist sorted = mfu_flist_sort("name", spread);
 
-    remove_direct(sorted, rmcount, mfu_file);
+    uint64_t errors = remove_direct(sorted, rmcount, mfu_file);
 
     mfu_flist_free(&sorted);
     mfu_flist_free(&spread);
-    return;
+    return errors;
 }
 /*****************************
  * Map all items in same parent directory to a single rank
@@ -198,18 +207,18 @@ static int map_name(mfu_flist flist, uint64_t idx, int ranks, const void* args)
     return rank;
 }
 
-static void remove_map(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
+static uint64_t remove_map(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
 {
     /* remap files based on parent directory */
     mfu_flist newlist = mfu_flist_remap(list, map_name, NULL);
 
     /* at this point, we can directly remove files in our list */
-    remove_direct(newlist, rmcount, mfu_file);
+    uint64_t errors = remove_direct(newlist, rmcount, mfu_file);
 
     /* free list of remapped files */
     mfu_flist_free(&newlist);
 
-    return;
+    return errors;
 }
 
 /*****************************
@@ -220,12 +229,12 @@ static void remove_map(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
 /* for each depth, sort files by filename and then remove, to test
  * whether it matters to limit the number of directories each process
  * has to reference (e.g., locking) */
-static void remove_sort(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
+static uint64_t remove_sort(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
 {
     /* bail out if total count is 0 */
     uint64_t all_count = mfu_flist_global_size(list);
     if (all_count == 0) {
-        return;
+        return 0;
     }
 
     /* get maximum file name and number of items */
@@ -282,6 +291,7 @@ static void remove_sort(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
 
     /* delete data */
     int delcount = 0;
+    uint64_t errors = 0;
     ptr = (char*)recvbuf;
     while (delcount < recvcount) {
         /* get item name */
@@ -293,7 +303,7 @@ static void remove_sort(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
         ptr++;
 
         /* delete item */
-        remove_type(type, name, mfu_file);
+        errors += remove_type(type, name, mfu_file);
         delcount++;
     }
 
@@ -313,7 +323,7 @@ static void remove_sort(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
     MPI_Type_free(&dt_keysat);
     MPI_Type_free(&dt_key);
 
-    return;
+    return errors;
 }
 
 /*****************************
@@ -323,6 +333,7 @@ static void remove_sort(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
 /* globals needed for libcircle callback routines */
 static mfu_flist circle_list; /* list of items we're deleting */
 static uint64_t circle_count;   /* number of items local process has removed */
+static uint64_t circle_errors;  /* number of items local process failed to remove */
 static mfu_file_t* circle_mfu_file; /* mfu_file for I/O functions */
 
 static void remove_create(CIRCLE_handle* handle)
@@ -371,7 +382,7 @@ static void remove_process(CIRCLE_handle* handle)
 
     char item = path[0];
     char* name = &path[1];
-    remove_type(item, name, circle_mfu_file);
+    circle_errors += remove_type(item, name, circle_mfu_file);
     circle_count++;
 
     return;
@@ -379,11 +390,12 @@ static void remove_process(CIRCLE_handle* handle)
 
 /* insert all items to be removed into libcircle for
  * dynamic load balancing */
-static void remove_libcircle(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
+static uint64_t remove_libcircle(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_file)
 {
     /* set globals for libcircle callbacks */
-    circle_list  = list;
-    circle_count = 0;
+    circle_list   = list;
+    circle_count  = 0;
+    circle_errors = 0;
     circle_mfu_file = mfu_file;
 
     /* initialize libcircle */
@@ -407,7 +419,7 @@ static void remove_libcircle(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_
     /* record number of items we deleted */
     *rmcount = circle_count;
 
-    return;
+    return circle_errors;
 }
 
 /* TODO: sort w/ spread and synchronization */
@@ -420,6 +432,245 @@ static void remove_libcircle(mfu_flist list, uint64_t* rmcount, mfu_file_t* mfu_
 /* if my right neighbor has same dirname, send it msg when we're done */
 /* if my left neighbor has same dirname, wait for msg */
 
+/*****************************
+ * Group items by parent directory, unlink relative to the parent,
+ * and remove each directory as soon as it is empty
+ ****************************/
+
+/* item to be removed, split into parent directory and name */
+typedef struct {
+    const char* name;       /* full path of item */
+    const char* base;       /* name of item within parent, points into name */
+    size_t      parent_len; /* length of parent directory prefix in name */
+    uint64_t    idx;        /* index of item in list */
+} remove_item_t;
+
+/* order items by parent directory, then by name within the parent */
+static int remove_item_cmp(const void* a, const void* b)
+{
+    const remove_item_t* x = (const remove_item_t*) a;
+    const remove_item_t* y = (const remove_item_t*) b;
+
+    size_t len = (x->parent_len < y->parent_len) ? x->parent_len : y->parent_len;
+    int cmp = strncmp(x->name, y->name, len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (x->parent_len != y->parent_len) {
+        return (x->parent_len < y->parent_len) ? -1 : 1;
+    }
+    return strcmp(x->base, y->base);
+}
+
+/* map item to rank by hashing the path of its parent directory,
+ * the same way a directory is hashed to find its children */
+static int map_parent(mfu_flist flist, uint64_t idx, int ranks, const void* args)
+{
+    const char* name = mfu_flist_file_get_name(flist, idx);
+    char* dir = MFU_STRDUP(name);
+    dirname(dir);
+    int rank = mfu_release_key_rank(dir, ranks);
+    mfu_free(&dir);
+    return rank;
+}
+
+/* remove item relative to open parent directory,
+ * returns 1 if the item could not be removed and 0 otherwise */
+static uint64_t remove_at(int dirfd, const remove_item_t* item, mfu_filetype type)
+{
+    int flags = (type == MFU_TYPE_DIR) ? AT_REMOVEDIR : 0;
+    int rc = unlinkat(dirfd, item->base, flags);
+    if (rc != 0 && errno == EISDIR && type != MFU_TYPE_DIR) {
+        /* type was unknown and item is a directory */
+        rc = unlinkat(dirfd, item->base, AT_REMOVEDIR);
+    }
+    if (rc != 0 && errno != ENOENT) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to %s `%s' (errno=%d %s)",
+                (flags ? "rmdir" : "unlink"), item->name, errno, strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+/* order positions of items in the sorted list */
+static int remove_pos_cmp(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return (x < y) ? -1 : (x > y);
+}
+
+/* all children of a directory are sent to the same rank, which unlinks
+ * them relative to an open descriptor of the directory, a directory item
+ * is removed by the rank holding its parent once the rank holding its
+ * children reports that all of them are gone, so directories at all
+ * depths are removed without waiting on other levels,
+ * returns number of items that could not be removed */
+static uint64_t remove_bydir(mfu_flist flist, uint64_t* rmcount, mfu_file_t* mfu_file)
+{
+    /* send each item to the rank responsible for its parent */
+    mfu_flist list = mfu_flist_remap(flist, map_parent, NULL);
+
+    /* group items by parent directory */
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    remove_item_t* items = (remove_item_t*) MFU_MALLOC(size * sizeof(remove_item_t));
+    for (idx = 0; idx < size; idx++) {
+        remove_item_t* item = &items[idx];
+        const char* name = mfu_flist_file_get_name(list, idx);
+        const char* slash = strrchr(name, '/');
+        item->name       = name;
+        item->base       = (slash != NULL) ? slash + 1 : name;
+        item->parent_len = (slash != NULL) ? (size_t)(slash - name) : 0;
+        item->idx        = idx;
+    }
+    qsort(items, (size_t)size, sizeof(remove_item_t), remove_item_cmp);
+
+    /* record the parent directory of each group and the group of
+     * each item, along with a count of items left in each group */
+    uint64_t groups = 0;
+    char** parents      = (char**)    MFU_MALLOC(size * sizeof(char*));
+    uint64_t* left      = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t* group_of  = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t* item_of   = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    for (idx = 0; idx < size; idx++) {
+        remove_item_t* item = &items[idx];
+        if (idx == 0 ||
+            item->parent_len != items[idx - 1].parent_len ||
+            strncmp(item->name, items[idx - 1].name, item->parent_len) != 0)
+        {
+            /* got a new parent, the root directory is the
+             * empty prefix of an absolute path */
+            size_t len = item->parent_len;
+            char* parent;
+            if (item->base == item->name) {
+                parent = MFU_STRDUP(".");
+            } else if (len == 0) {
+                parent = MFU_STRDUP("/");
+            } else {
+                parent = (char*) MFU_MALLOC(len + 1);
+                memcpy(parent, item->name, len);
+                parent[len] = '\0';
+            }
+            parents[groups] = parent;
+            left[groups]    = 0;
+            groups++;
+        }
+        group_of[item->idx] = groups - 1;
+        item_of[item->idx]  = idx;
+        left[groups - 1]++;
+    }
+
+    /* a directory waits until the group of its own children is empty,
+     * non-directories can be removed right away */
+    char** keys = (char**) MFU_MALLOC(size * sizeof(char*));
+    for (idx = 0; idx < size; idx++) {
+        keys[idx] = NULL;
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
+        if (type == MFU_TYPE_DIR) {
+            keys[idx] = (char*) mfu_flist_file_get_name(list, idx);
+        }
+    }
+
+    mfu_release_t rel;
+    mfu_release_init(&rel, size);
+    mfu_release_register(&rel, size, keys, parents, groups);
+    mfu_free(&keys);
+
+    /* remove items as they become ready, taking each batch of ready
+     * items in sorted order, so the items of a group are adjacent and
+     * its parent is opened once per batch */
+    uint64_t* ready = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t errors = 0;
+    uint64_t done = 0;
+    while (done < size) {
+        /* gather ready items by their position in the sorted list */
+        uint64_t nready = 0;
+        while (mfu_release_pop(&rel, &idx)) {
+            ready[nready] = item_of[idx];
+            nready++;
+        }
+        if (nready == 0) {
+            mfu_release_wait(&rel);
+            continue;
+        }
+        qsort(ready, (size_t)nready, sizeof(uint64_t), remove_pos_cmp);
+
+        int dirfd = -1;
+        uint64_t dirfd_group = UINT64_MAX;
+        uint64_t i;
+        for (i = 0; i < nready; i++) {
+            const remove_item_t* item = &items[ready[i]];
+            idx = item->idx;
+            uint64_t group = group_of[idx];
+            if (dirfd_group != group) {
+                if (dirfd >= 0) {
+                    mfu_close(parents[dirfd_group], dirfd);
+                }
+#ifdef O_PATH
+                dirfd = mfu_open(parents[group], O_PATH | O_DIRECTORY);
+#else
+                dirfd = mfu_open(parents[group], O_RDONLY | O_DIRECTORY);
+#endif
+                dirfd_group = group;
+            }
+
+            /* remove the item, fall back to its full path
+             * if we failed to open the parent */
+            mfu_filetype type = mfu_flist_file_get_type(list, idx);
+            if (dirfd >= 0) {
+                errors += remove_at(dirfd, item, type);
+            } else if (type == MFU_TYPE_DIR) {
+                errors += remove_type('d', item->name, mfu_file);
+            } else if (type == MFU_TYPE_FILE || type == MFU_TYPE_LINK) {
+                errors += remove_type('f', item->name, mfu_file);
+            } else {
+                errors += remove_type('u', item->name, mfu_file);
+            }
+            done++;
+
+            /* once a directory is empty, let the rank holding it know */
+            left[group]--;
+            if (left[group] == 0) {
+                if (dirfd >= 0) {
+                    mfu_close(parents[group], dirfd);
+                    dirfd = -1;
+                }
+                dirfd_group = UINT64_MAX;
+                mfu_release_done(&rel, group);
+            }
+
+            /* increment number of items we have deleted
+             * and check on progress message */
+            remove_count++;
+            mfu_progress_update(&remove_count, rmprog);
+        }
+        if (dirfd >= 0) {
+            mfu_close(parents[dirfd_group], dirfd);
+        }
+
+        /* pass on releases before we wait for our own */
+        mfu_release_flush(&rel);
+    }
+    mfu_free(&ready);
+
+    mfu_release_free(&rel);
+
+    for (idx = 0; idx < groups; idx++) {
+        mfu_free(&parents[idx]);
+    }
+    mfu_free(&parents);
+    mfu_free(&left);
+    mfu_free(&group_of);
+    mfu_free(&item_of);
+    mfu_free(&items);
+    mfu_flist_free(&list);
+
+    /* report the number of items we deleted */
+    *rmcount += size;
+    return errors;
+}
+
 /*****************************
  * Driver functions
  ****************************/
@@ -429,17 +680,116 @@ typedef enum mfu_remove_algos_t {
   SPREAD,
   MAP,
   SORT,
-  LIBCIRCLE
+  LIBCIRCLE,
+  BYDIR
 } mfu_remove_algos;
 
-static mfu_remove_algos select_algo(void)
+static const char* algo_name(mfu_remove_algos algo)
+{
+    switch (algo) {
+    case DIRECT:    return "DIRECT";
+    case SPREAD:    return "SPREAD";
+    case MAP:       return "MAP";
+    case SORT:      return "SORT";
+    case LIBCIRCLE: return "LIBCIRCLE";
+    case BYDIR:     return "BYDIR";
+    }
+    return "UNKNOWN";
+}
+
+/* compare hash values of parent directories */
+static int hash_cmp(const void* a, const void* b)
 {
-    /* default to SPREAD */
-    mfu_remove_algos algo = SPREAD;
+    uint32_t x = *(const uint32_t*) a;
+    uint32_t y = *(const uint32_t*) b;
+    return (x < y) ? -1 : (x > y);
+}
+
+/* profile the shape of the tree to be removed and pick the
+ * algorithm expected to finish first */
+static mfu_remove_algos profile_algo(mfu_flist flist, mfu_file_t* mfu_file)
+{
+    /* count items per parent directory in our part of the list,
+     * the walk places the entries of a directory on the rank that
+     * read it, so local counts give a good estimate of the widest
+     * directory */
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(flist);
+    uint32_t* hashes = (uint32_t*) MFU_MALLOC(size * sizeof(uint32_t));
+    for (idx = 0; idx < size; idx++) {
+        const char* name = mfu_flist_file_get_name(flist, idx);
+        const char* slash = strrchr(name, '/');
+        size_t len = (slash != NULL) ? (size_t)(slash - name) : 0;
+        hashes[idx] = mfu_hash_jenkins(name, len);
+    }
+    qsort(hashes, (size_t)size, sizeof(uint32_t), hash_cmp);
 
+    uint64_t vals[3] = {size, 0, 0}; /* local size, parents, widest parent */
+    uint64_t run = 0;
+    for (idx = 0; idx < size; idx++) {
+        if (idx == 0 || hashes[idx] != hashes[idx - 1]) {
+            vals[1]++;
+            run = 0;
+        }
+        run++;
+        if (run > vals[2]) {
+            vals[2] = run;
+        }
+    }
+    mfu_free(&hashes);
+
+    uint64_t sums[3], maxs[3];
+    MPI_Allreduce(vals, sums, 3, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(vals, maxs, 3, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    uint64_t total   = sums[0];
+    uint64_t parents = sums[1];
+    uint64_t widest  = maxs[2];
+    double share     = (double)total / (double)ranks;
+    double imbalance = (share > 0.0) ? (double)maxs[0] / share : 1.0;
+    int levels = 0;
+    if (total > 0) {
+        levels = mfu_flist_max_depth(flist) - mfu_flist_min_depth(flist) + 1;
+    }
+
+    mfu_remove_algos algo;
+    if (mfu_file->type != POSIX) {
+        /* without directory descriptors, just balance the load */
+        algo = (imbalance <= 1.1) ? DIRECT : SPREAD;
+    } else if (ranks > 1 && (double)widest > 2.0 * share) {
+        /* removing by directory would leave one rank with most of
+         * the work, spread the items evenly and go level by level */
+        algo = SPREAD;
+    } else if (levels <= 2 && imbalance <= 1.1) {
+        /* a flat tree that is already balanced needs no communication */
+        algo = DIRECT;
+    } else {
+        algo = BYDIR;
+    }
+
+    if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Remove strategy %s: %llu items, %llu parents, widest %llu, %d levels, imbalance %.2f",
+            algo_name(algo), (unsigned long long)total, (unsigned long long)parents,
+            (unsigned long long)widest, levels, imbalance);
+    }
+
+    return algo;
+}
+
+static mfu_remove_algos select_algo(mfu_flist flist, mfu_file_t* mfu_file)
+{
     /* allow override algorithm choice via environment variable */
     char varname[] = "MFU_FLIST_UNLINK";
     const char* value = getenv(varname);
+    if (value == NULL || strcmp(value, "AUTO") == 0) {
+        return profile_algo(flist, mfu_file);
+    }
+
+    /* default to removing by directory, which needs
+     * POSIX directory descriptors, otherwise SPREAD */
+    mfu_remove_algos algo = (mfu_file->type == POSIX) ? BYDIR : SPREAD;
     if (value != NULL) {
         if (strcmp(value, "DIRECT") == 0) {
             if (mfu_rank == 0) {
@@ -466,6 +816,11 @@ static mfu_remove_algos select_algo(void)
                 MFU_LOG(MFU_LOG_INFO, "%s: LIBCIRCLE", varname);
             }
             algo = LIBCIRCLE;
+        } else if (strcmp(value, "BYDIR") == 0 && mfu_file->type == POSIX) {
+            if (mfu_rank == 0) {
+                MFU_LOG(MFU_LOG_INFO, "%s: BYDIR", varname);
+            }
+            algo = BYDIR;
         } else {
             if (mfu_rank == 0) {
                 MFU_LOG(MFU_LOG_ERR, "%s: Unknown value: %s", varname, value);
@@ -476,39 +831,46 @@ static mfu_remove_algos select_algo(void)
     return algo;
 }
 
-static void remove_by_algo(mfu_remove_algos algo, mfu_flist flist, uint64_t* count, mfu_file_t* mfu_file)
+/* returns number of items this rank could not remove */
+static uint64_t remove_by_algo(mfu_remove_algos algo, mfu_flist flist, uint64_t* count, mfu_file_t* mfu_file)
 {
+    uint64_t errors = 0;
     switch (algo) {
     case DIRECT:
-        remove_direct(flist, count, mfu_file);
+        errors = remove_direct(flist, count, mfu_file);
         break;
     case SPREAD:
-        remove_spread(flist, count, mfu_file);
+        errors = remove_spread(flist, count, mfu_file);
         break;
     case MAP:
-        remove_map(flist, count, mfu_file);
+        errors = remove_map(flist, count, mfu_file);
         break;
     case SORT:
         //remove_sort(flist, count);
-        remove_spread_sort(flist, count, mfu_file);
+        errors = remove_spread_sort(flist, count, mfu_file);
         break;
     case LIBCIRCLE:
-        remove_libcircle(flist, count, mfu_file);
+        errors = remove_libcircle(flist, count, mfu_file);
+        break;
+    case BYDIR:
+        errors = remove_bydir(flist, count, mfu_file);
         break;
     }
 
-    return;
+    return errors;
 }
 
 /* removes list of items, sets write bits on directories from
  * top-to-bottom, then removes items one level at a time starting
  * from the deepest */
-void mfu_flist_unlink(mfu_flist flist, bool traceless, mfu_file_t* mfu_file)
+int mfu_flist_unlink(mfu_flist flist, bool traceless, mfu_file_t* mfu_file)
 {
+    mfu_trace_push("remove");
+
     uint64_t idx;
 
     /* allow override algorithm choice via environment variable */
-    mfu_remove_algos algo = select_algo();
+    mfu_remove_algos algo = select_algo(flist, mfu_file);
 
     /* wait for all tasks and start timer */
     MPI_Barrier(MPI_COMM_WORLD);
@@ -660,20 +1022,46 @@ void mfu_flist_unlink(mfu_flist flist, bool traceless, mfu_file_t* mfu_file)
     /* start timer and broadcast for progress messages */
     remove_count = 0;
     rmprog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, remove_progress_fn);
+    const char* remove_names[1] = {"items"};
+    uint64_t remove_total = mfu_flist_global_size(flist);
+    mfu_progress_describe("remove", remove_names, &remove_total, rmprog);
 
-    /* remove all non directory (leaf) items */
+    /* remove all non directory (leaf) items, removing by directory
+     * handles files and directories together in one pass */
     uint64_t count = 0;
-    remove_by_algo(algo, flist_nondirs, &count, mfu_file);
+    uint64_t errors = 0;
+    int toplevel = levels - 1;
+    if (algo == BYDIR) {
+        errors += remove_by_algo(algo, flist, &count, mfu_file);
+        toplevel = -1;
+    } else {
+        errors += remove_by_algo(algo, flist_nondirs, &count, mfu_file);
+    }
 
     /* remove directories starting from deepest level */
     int level;
-    for (level = levels - 1; level >= 0; level--) {
+    for (level = toplevel; level >= 0; level--) {
         /* get list for this level */
         mfu_flist list = lists[level];
 
+        /* skip redistributing a level whose items are already
+         * spread evenly across ranks */
+        mfu_remove_algos level_algo = algo;
+        if (algo == SPREAD) {
+            uint64_t size = mfu_flist_size(list);
+            uint64_t max_size;
+            MPI_Allreduce(&size, &max_size, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+            uint64_t all_size = mfu_flist_global_size(list);
+            int ranks;
+            MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+            if ((double)max_size * (double)ranks <= 1.1 * (double)all_size) {
+                level_algo = DIRECT;
+            }
+        }
+
         /* remove items at this level */
         uint64_t count = 0;
-        remove_by_algo(algo, list, &count, mfu_file);
+        errors += remove_by_algo(level_algo, list, &count, mfu_file);
 
         /* wait for all procs to finish before we start
          * with items at next level */
@@ -733,13 +1121,311 @@ void mfu_flist_unlink(mfu_flist flist, bool traceless, mfu_file_t* mfu_file)
         if (time_diff > 0.0) {
             rate = ((double)all_count) / time_diff;
         }
+        MFU_LOG(MFU_LOG_INFO, "Removed %lu items in %.3lf seconds (%.3lf items/sec) with %s",
+            all_count, time_diff, rate, algo_name(algo)
+        );
+    }
+
+    /* check whether any rank failed to remove an item */
+    uint64_t all_errors;
+    MPI_Allreduce(&errors, &all_errors, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (all_errors > 0 && mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to remove %llu items", (unsigned long long) all_errors);
+    }
+
+    mfu_trace_pop();
+    return (all_errors > 0) ? -1 : 0;
+}
+
+/*****************************
+ * Remove items while reading directories, without building a list
+ ****************************/
+
+/* records returned by getdents64 */
+struct purge_dirent {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+#define PURGE_BUF_SIZE (128*1024U)
+
+/* globals needed for libcircle callback routines */
+static const mfu_param_path* purge_params; /* paths to be removed */
+static uint64_t purge_num;                 /* number of paths */
+static mfu_flist purge_dirs;               /* directories to rmdir once empty */
+static uint64_t purge_count;               /* number of items local process has removed */
+static double purge_start;                 /* time purge started */
+static int purge_result;                   /* set to -1 on any error */
+static char purge_buf[PURGE_BUF_SIZE];     /* buffer to read directory entries */
+
+static void purge_reduce_init(void)
+{
+    CIRCLE_reduce(&purge_count, sizeof(uint64_t));
+}
+
+static void purge_reduce_exec(const void* buf1, size_t size1, const void* buf2, size_t size2)
+{
+    const uint64_t* a = (const uint64_t*) buf1;
+    const uint64_t* b = (const uint64_t*) buf2;
+    uint64_t val = a[0] + b[0];
+    CIRCLE_reduce(&val, sizeof(uint64_t));
+}
+
+static void purge_reduce_fini(const void* buf, size_t size)
+{
+    /* get result of reduction */
+    const uint64_t* a = (const uint64_t*) buf;
+    unsigned long long val = (unsigned long long) a[0];
+
+    /* compute remove rate */
+    double rate = 0.0;
+    double secs = MPI_Wtime() - purge_start;
+    if (secs > 0.0) {
+        rate = (double)val / secs;
+    }
+
+    MFU_LOG(MFU_LOG_INFO, "Removed %llu items in %.3lf secs (%.3lf items/sec) ...", val, secs, rate);
+}
+
+/* record directory to be removed in the termination phase */
+static void purge_record_dir(const char* path)
+{
+    uint64_t idx = mfu_flist_file_create(purge_dirs);
+    mfu_flist_file_set_name(purge_dirs, idx, path);
+    mfu_flist_file_set_type(purge_dirs, idx, MFU_TYPE_DIR);
+}
+
+/* unlink every non-directory in dir as it is read,
+ * and enqueue subdirectories to be processed */
+static void purge_process_dir(const char* dir, CIRCLE_handle* handle)
+{
+    int fd = mfu_open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open directory for reading: `%s' (errno=%d %s)",
+                dir, errno, strerror(errno));
+        purge_result = -1;
+        return;
+    }
+
+    /* some file systems skip entries when items are unlinked while
+     * the directory is being read, so rescan until a pass finds
+     * nothing to remove, subdirectories are only queued on the
+     * first pass */
+    int pass = 0;
+    int removed = 1;
+    while (removed) {
+        removed = 0;
+        if (pass > 0 && lseek(fd, 0, SEEK_SET) == (off_t)-1) {
+            break;
+        }
+
+        while (1) {
+            int nread = syscall(SYS_getdents64, fd, purge_buf, (int) PURGE_BUF_SIZE);
+            if (nread == -1) {
+                MFU_LOG(MFU_LOG_ERR, "syscall to getdents failed when reading `%s' (errno=%d %s)",
+                        dir, errno, strerror(errno));
+                purge_result = -1;
+                break;
+            }
+
+            /* bail out if we're done */
+            if (nread == 0) {
+                break;
+            }
+
+            int bpos = 0;
+            while (bpos < nread) {
+                struct purge_dirent* d = (struct purge_dirent*)(purge_buf + bpos);
+                bpos += d->d_reclen;
+
+                /* skip d_ino == 0, ".", and ".." entries */
+                const char* name = d->d_name;
+                if (d->d_ino == 0 || strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+                    continue;
+                }
+
+                /* remove anything that is not known to be a directory */
+                int is_dir = (d->d_type == DT_DIR);
+                if (! is_dir) {
+                    if (unlinkat(fd, name, 0) == 0) {
+                        purge_count++;
+                        removed = 1;
+                        continue;
+                    }
+                    struct stat st;
+                    if (errno == EISDIR ||
+                        (errno == EPERM && mfu_fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode)))
+                    {
+                        /* type was unknown and item is a directory */
+                        is_dir = 1;
+                    } else if (errno != ENOENT) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s/%s' (errno=%d %s)",
+                                dir, name, errno, strerror(errno));
+                        purge_result = -1;
+                    }
+                }
+
+                /* queue up directory to be purged */
+                if (is_dir && pass == 0) {
+                    char path[CIRCLE_MAX_STRING_LEN];
+                    int len = snprintf(path, sizeof(path), "%s/%s", dir, name);
+                    if (len < 0 || (size_t)len >= sizeof(path)) {
+                        MFU_LOG(MFU_LOG_ERR, "Path name is too long: '%s/%s'", dir, name);
+                        purge_result = -1;
+                        continue;
+                    }
+                    purge_record_dir(path);
+                    handle->enqueue(path);
+                }
+            }
+        }
+
+        pass++;
+    }
+
+    mfu_close(dir, fd);
+
+    return;
+}
+
+static void purge_create(CIRCLE_handle* handle)
+{
+    uint64_t i;
+    for (i = 0; i < purge_num; i++) {
+        const char* path = purge_params[i].path;
+
+        /* stat top level item */
+        struct stat st;
+        if (mfu_lstat(path, &st) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to stat: '%s' (errno=%d %s)",
+                    path, errno, strerror(errno));
+            purge_result = -1;
+            continue;
+        }
+
+        /* remove item directly unless it's a directory */
+        if (! S_ISDIR(st.st_mode)) {
+            if (mfu_unlink(path) == 0) {
+                purge_count++;
+            } else if (errno != ENOENT) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s' (errno=%d %s)",
+                        path, errno, strerror(errno));
+                purge_result = -1;
+            }
+            continue;
+        }
+
+        purge_record_dir(path);
+        purge_process_dir(path, handle);
+    }
+
+    return;
+}
+
+static void purge_process(CIRCLE_handle* handle)
+{
+    /* only items on queue are directories */
+    char path[CIRCLE_MAX_STRING_LEN];
+    handle->dequeue(path);
+    purge_process_dir(path, handle);
+    return;
+}
+
+/* remove each path and everything below it without walking first */
+int mfu_flist_purge_param_paths(uint64_t num, const mfu_param_path* params, mfu_file_t* mfu_file)
+{
+    mfu_trace_push("purge");
+
+    /* entries are read with getdents and removed with unlinkat */
+    if (mfu_file->type != POSIX) {
+        if (mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Purge is only supported on POSIX file systems");
+        }
+        mfu_trace_pop();
+        return -1;
+    }
+
+    /* wait for all tasks and start timer */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start_purge = MPI_Wtime();
+
+    if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
+        uint64_t i;
+        for (i = 0; i < num; i++) {
+            MFU_LOG(MFU_LOG_INFO, "Purging %s", params[i].path);
+        }
+    }
+
+    /* set globals for libcircle callbacks */
+    purge_params = params;
+    purge_num    = num;
+    purge_dirs   = mfu_flist_new();
+    purge_count  = 0;
+    purge_start  = start_purge;
+    purge_result = 0;
+
+    /* initialize libcircle */
+    CIRCLE_init(0, NULL, CIRCLE_SPLIT_EQUAL | CIRCLE_TERM_TREE);
+    CIRCLE_enable_logging(CIRCLE_LOG_WARN);
+
+    /* register callbacks */
+    CIRCLE_cb_create(&purge_create);
+    CIRCLE_cb_process(&purge_process);
+
+    /* report progress with libcircle reductions */
+    CIRCLE_cb_reduce_init(&purge_reduce_init);
+    CIRCLE_cb_reduce_op(&purge_reduce_exec);
+    CIRCLE_cb_reduce_fini(&purge_reduce_fini);
+    int reduce_secs = 0;
+    if (mfu_progress_timeout > 0 && mfu_debug_level >= MFU_LOG_VERBOSE) {
+        reduce_secs = mfu_progress_timeout;
+    }
+    CIRCLE_set_reduce_period(reduce_secs);
+
+    /* run the libcircle job */
+    CIRCLE_begin();
+    CIRCLE_finalize();
+
+    /* all directories are now free of files, remove them
+     * bottom up as each one becomes empty */
+    mfu_flist_summarize(purge_dirs);
+    remove_count = 0;
+    remove_count_total = mfu_flist_global_size(purge_dirs);
+    rmprog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, remove_progress_fn);
+    const char* purge_names[1] = {"items"};
+    mfu_progress_describe("purge", purge_names, &remove_count_total, rmprog);
+    uint64_t count = 0;
+    uint64_t errors = remove_bydir(purge_dirs, &count, mfu_file);
+    mfu_progress_complete(&remove_count, &rmprog);
+    mfu_flist_free(&purge_dirs);
+    if (errors > 0) {
+        purge_result = -1;
+    }
+
+    /* wait for all tasks and stop timer */
+    purge_count += count - errors;
+    uint64_t all_count;
+    MPI_Allreduce(&purge_count, &all_count, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    double end_purge = MPI_Wtime();
+
+    /* report remove count, time, and rate */
+    if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
+        double time_diff = end_purge - start_purge;
+        double rate = 0.0;
+        if (time_diff > 0.0) {
+            rate = ((double)all_count) / time_diff;
+        }
         MFU_LOG(MFU_LOG_INFO, "Removed %lu items in %.3lf seconds (%.3lf items/sec)",
             all_count, time_diff, rate
         );
     }
 
-    /* wait for summary to be printed */
-    MPI_Barrier(MPI_COMM_WORLD);
+    int all_rc;
+    MPI_Allreduce(&purge_result, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
 
-    return;
+    mfu_trace_pop();
+    return all_rc;
 }
@@ -590,6 +590,8 @@ static mfu_flist sort_files_stat(const char* sortfields, mfu_flist flist)
  *   char fields[] = "size,-name"; */
 mfu_flist mfu_flist_sort(const char* sortfields, mfu_flist flist)
 {
+    mfu_trace_push("sort");
+
     if (sortfields == NULL) {
         MFU_ABORT(1, "mfu_flist_sort called with invalid sortfields");
     }
@@ -625,5 +627,6 @@ mfu_flist mfu_flist_sort(const char* sortfields, mfu_flist flist)
     /* wait for summary to be printed */
     MPI_Barrier(MPI_COMM_WORLD);
 
+    mfu_trace_pop();
     return flist2;
 }
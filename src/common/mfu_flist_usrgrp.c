@@ -168,296 +168,510 @@ void mfu_flist_usrgrp_create_stridtype(int chars, MPI_Datatype* dt)
     return;
 }
 
-/* element for a linked list of name/id pairs */
-typedef struct strid {
-    char* name;
-    uint64_t id;
-    struct strid* next;
-} strid_t;
-
-/* insert specified name and id into linked list given by
- * head, tail, and count, also increase maxchars if needed */
-static void strid_insert(
-    const char* name,
-    uint64_t id,
-    strid_t** head,
-    strid_t** tail,
-    int* count,
-    int* maxchars)
+/****************************************
+ * Resolve names of ids in use, caching them between runs
+ ***************************************/
+
+/* default number of seconds names cached on disk stay valid */
+#define MFU_USRGRP_CACHE_TTL (24 * 60 * 60)
+
+/* names resolved by this process, shared by all lists, keyed by id,
+ * an empty name marks an id that has no entry, the contents are the
+ * same on all ranks since every update is made collectively */
+static strmap* usrgrp_cache[2] = {NULL, NULL};
+
+/* file caching names between runs, NULL if disabled */
+static char* usrgrp_cache_file = NULL;
+
+/* time the cache file was started, reset when its entries expire */
+static long long usrgrp_cache_created = 0;
+
+/* format id as string for use as strmap key */
+static void usrgrp_id_str(uint64_t id, char* str, size_t len)
+{
+    snprintf(str, len, "%llu", (unsigned long long) id);
+}
+
+/* rank 0 reads names cached by earlier runs and broadcasts them,
+ * the cache file is only used if named by MFU_USRGRP_CACHE,
+ * entries are dropped after MFU_USRGRP_CACHE_TTL seconds */
+static void usrgrp_cache_load(void)
 {
-    /* allocate and fill in new element */
-    strid_t* elem = (strid_t*) malloc(sizeof(strid_t));
-    elem->name = MFU_STRDUP(name);
-    elem->id   = id;
-    elem->next = NULL;
-
-    /* insert element into linked list */
-    if (*head == NULL) {
-        *head = elem;
+    if (usrgrp_cache[0] != NULL) {
+        return;
+    }
+    usrgrp_cache[0] = strmap_new();
+    usrgrp_cache[1] = strmap_new();
+
+    /* determine name of cache file */
+    const char* value = getenv("MFU_USRGRP_CACHE");
+    if (value != NULL && value[0] != '\0') {
+        usrgrp_cache_file = MFU_STRDUP(value);
     }
-    if (*tail != NULL) {
-        (*tail)->next = elem;
+    if (usrgrp_cache_file == NULL) {
+        return;
+    }
+
+    long long ttl = MFU_USRGRP_CACHE_TTL;
+    value = getenv("MFU_USRGRP_CACHE_TTL");
+    if (value != NULL) {
+        ttl = atoll(value);
     }
-    *tail = elem;
-    (*count)++;
-
-    /* increase maximum name if we need to */
-    size_t len = strlen(name) + 1;
-    if (*maxchars < (int)len) {
-        /* round up to nearest multiple of 8 */
-        size_t len8 = len / 8;
-        if (len8 * 8 < len) {
-            len8++;
+
+    /* rank 0 reads the file, the first line records when it was started,
+     * and each following line is a kind (u or g), id, and name separated
+     * by tabs, names may contain spaces so the name is the rest of the line */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        FILE* fp = fopen(usrgrp_cache_file, "r");
+        if (fp != NULL) {
+            long long created;
+            if (fscanf(fp, "# mfu usrgrp cache %lld\n", &created) == 1 &&
+                (long long) time(NULL) - created <= ttl)
+            {
+                usrgrp_cache_created = created;
+                char line[1100];
+                while (fgets(line, sizeof(line), fp) != NULL) {
+                    /* skip the rest of a line too long to be an entry */
+                    size_t len = strlen(line);
+                    if (len == 0 || line[len - 1] != '\n') {
+                        int c;
+                        while ((c = fgetc(fp)) != EOF && c != '\n');
+                        continue;
+                    }
+                    line[len - 1] = '\0';
+
+                    /* skip lines that are not well formed */
+                    char kind = line[0];
+                    if ((kind != 'u' && kind != 'g') || line[1] != '\t') {
+                        continue;
+                    }
+                    char* end;
+                    errno = 0;
+                    unsigned long long id = strtoull(&line[2], &end, 10);
+                    if (errno != 0 || end == &line[2] || *end != '\t' || end[1] == '\0') {
+                        continue;
+                    }
+
+                    char id_str[32];
+                    usrgrp_id_str((uint64_t) id, id_str, sizeof(id_str));
+                    strmap_set(usrgrp_cache[(kind == 'g') ? 1 : 0], id_str, end + 1);
+                }
+            }
+            fclose(fp);
         }
-        len8 *= 8;
+    }
 
-        *maxchars = (int)len8;
+    /* broadcast cached names, packed as id and name strings */
+    int i;
+    for (i = 0; i < 2; i++) {
+        const strmap_node* node;
+        uint64_t bytes = 0;
+        if (rank == 0) {
+            for (node = strmap_node_first(usrgrp_cache[i]); node != NULL; node = strmap_node_next(node)) {
+                bytes += strlen(strmap_node_key(node)) + strlen(strmap_node_value(node)) + 2;
+            }
+        }
+        MPI_Bcast(&bytes, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+        if (bytes == 0) {
+            continue;
+        }
+        char* buf = (char*) MFU_MALLOC((size_t) bytes);
+        if (rank == 0) {
+            char* ptr = buf;
+            for (node = strmap_node_first(usrgrp_cache[i]); node != NULL; node = strmap_node_next(node)) {
+                strcpy(ptr, strmap_node_key(node));
+                ptr += strlen(ptr) + 1;
+                strcpy(ptr, strmap_node_value(node));
+                ptr += strlen(ptr) + 1;
+            }
+        }
+        MPI_Bcast(buf, (int) bytes, MPI_BYTE, 0, MPI_COMM_WORLD);
+        if (rank != 0) {
+            const char* ptr = buf;
+            while (ptr < buf + bytes) {
+                const char* key = ptr;
+                ptr += strlen(ptr) + 1;
+                strmap_set(usrgrp_cache[i], key, ptr);
+                ptr += strlen(ptr) + 1;
+            }
+        }
+        mfu_free(&buf);
     }
 
     return;
 }
 
-/* copy data from linked list to array */
-static void strid_serialize(strid_t* head, int chars, void* buf)
+/* rank 0 writes all cached names to a temporary file and renames it
+ * over the cache file, so concurrent runs never see a partial file */
+static void usrgrp_cache_save(void)
 {
-    char* ptr = (char*)buf;
-    strid_t* current = head;
-    while (current != NULL) {
-        char* name  = current->name;
-        uint64_t id = current->id;
+    if (usrgrp_cache_file == NULL) {
+        return;
+    }
 
-        strcpy(ptr, name);
-        ptr += chars;
+    /* start the file over if its entries expired */
+    if (usrgrp_cache_created == 0) {
+        usrgrp_cache_created = (long long) time(NULL);
+    }
 
-        mfu_pack_uint64(&ptr, id);
+    char* tmpname = MFU_STRDUPF("%s.XXXXXX", usrgrp_cache_file);
+    int fd = mkstemp(tmpname);
+    if (fd < 0) {
+        mfu_free(&tmpname);
+        return;
+    }
+    FILE* fp = fdopen(fd, "w");
+    if (fp == NULL) {
+        close(fd);
+        unlink(tmpname);
+        mfu_free(&tmpname);
+        return;
+    }
 
-        current = current->next;
+    int k;
+    fprintf(fp, "# mfu usrgrp cache %lld\n", usrgrp_cache_created);
+    for (k = 0; k < 2; k++) {
+        const strmap_node* node;
+        for (node = strmap_node_first(usrgrp_cache[k]); node != NULL; node = strmap_node_next(node)) {
+            /* ids without an entry are looked up again next time */
+            const char* name = strmap_node_value(node);
+            if (name[0] == '\0' || strchr(name, '\n') != NULL) {
+                continue;
+            }
+            fprintf(fp, "%c\t%s\t%s\n", k ? 'g' : 'u', strmap_node_key(node), name);
+        }
     }
-    return;
+
+    if (fclose(fp) != 0 || rename(tmpname, usrgrp_cache_file) != 0) {
+        unlink(tmpname);
+    }
+    mfu_free(&tmpname);
 }
 
-/* delete linked list and reset head, tail, and count values */
-static void strid_delete(strid_t** head, strid_t** tail, int* count)
+/* look up name of user or group id, returns 0 and copies
+ * name to buffer on success, -1 if there is no such id */
+static int usrgrp_lookup(int kind, uint64_t id, char* name, size_t len)
 {
-    /* free memory allocated in linked list */
-    strid_t* current = *head;
-    while (current != NULL) {
-        strid_t* next = current->next;
-        mfu_free(&current->name);
-        mfu_free(&current);
-        current = next;
-    }
+    long max = sysconf(kind ? _SC_GETGR_R_SIZE_MAX : _SC_GETPW_R_SIZE_MAX);
+    size_t bufsize = (max > 0) ? (size_t) max : 16384;
+
+    int rc = -1;
+    while (1) {
+        char* buf = (char*) MFU_MALLOC(bufsize);
+        const char* found = NULL;
+        int err;
+        if (kind == 0) {
+            struct passwd pw, *result = NULL;
+            err = getpwuid_r((uid_t) id, &pw, buf, bufsize, &result);
+            if (err == 0 && result != NULL) {
+                found = result->pw_name;
+            }
+        } else {
+            struct group gr, *result = NULL;
+            err = getgrgid_r((gid_t) id, &gr, buf, bufsize, &result);
+            if (err == 0 && result != NULL) {
+                found = result->gr_name;
+            }
+        }
+        if (found != NULL && strlen(found) < len) {
+            strcpy(name, found);
+            rc = 0;
+        }
+        mfu_free(&buf);
 
-    /* set list data structure values back to NULL */
-    *head  = NULL;
-    *tail  = NULL;
-    *count = 0;
+        /* try again with a larger buffer if needed */
+        if (err == ERANGE) {
+            bufsize *= 2;
+            continue;
+        }
+        break;
+    }
 
-    return;
+    return rc;
 }
 
-/* read user array from file system using getpwent() */
-void mfu_flist_usrgrp_get_users(flist_t* flist)
+/* compare two uint64_t values for qsort */
+static int usrgrp_id_cmp(const void* a, const void* b)
 {
-    /* get pointer to users buf_t */
-    buf_t* items = &flist->users;
-
-    /* initialize output parameters */
-    buft_init(items);
-
-    /* get our rank */
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return (x < y) ? -1 : (x > y);
+}
 
-    /* rank 0 iterates over users with getpwent */
-    strid_t* head = NULL;
-    strid_t* tail = NULL;
-    int count = 0;
-    int chars = 0;
-    if (rank == 0) {
-        struct passwd* p;
-        while (1) {
-            /* get next user, this function can fail so we retry a few times */
-            int retries = 3;
-retry:
-            p = getpwent();
-            if (p == NULL) {
-                if (errno == EIO) {
-                    retries--;
-                }
-                else {
-                    /* TODO: ERROR! */
-                    retries = 0;
-                }
-                if (retries > 0) {
-                    goto retry;
-                }
-            }
+/* sort array and drop duplicates, returns number of values left */
+static uint64_t usrgrp_unique(uint64_t* ids, uint64_t count)
+{
+    qsort(ids, (size_t) count, sizeof(uint64_t), usrgrp_id_cmp);
+    uint64_t i, n = 0;
+    for (i = 0; i < count; i++) {
+        if (n == 0 || ids[i] != ids[n - 1]) {
+            ids[n] = ids[i];
+            n++;
+        }
+    }
+    return n;
+}
 
-            if (p != NULL) {
-                /*
-                printf("User=%s Pass=%s UID=%d GID=%d Name=%s Dir=%s Shell=%s\n",
-                  p->pw_name, p->pw_passwd, p->pw_uid, p->pw_gid, p->pw_gecos, p->pw_dir, p->pw_shell
-                );
-                printf("User=%s UID=%d GID=%d\n",
-                  p->pw_name, p->pw_uid, p->pw_gid
-                );
-                */
-                char* name  = p->pw_name;
-                uint64_t id = p->pw_uid;
-                strid_insert(name, id, &head, &tail, &count, &chars);
-            }
-            else {
-                /* hit the end of the user list */
-                endpwent();
-                break;
+/* rebuild array of name/id pairs from those entries in the
+ * id-to-name map that have a name */
+static void usrgrp_build_buf(strmap* id2name, buf_t* items)
+{
+    buft_free(items);
+
+    /* count names and find longest, rounded up to 8 bytes */
+    uint64_t count = 0;
+    int chars = 8;
+    const strmap_node* node;
+    for (node = strmap_node_first(id2name); node != NULL; node = strmap_node_next(node)) {
+        const char* key  = strmap_node_key(node);
+        const char* name = strmap_node_value(node);
+        if (strcmp(key, name) != 0) {
+            int len = (int) strlen(name) + 1;
+            len = ((len + 7) / 8) * 8;
+            if (len > chars) {
+                chars = len;
             }
+            count++;
         }
-
-        //    printf("Max username %d, count %d\n", (int)chars, count);
     }
 
-    /* bcast count and number of chars */
-    MPI_Bcast(&count, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&chars, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-    /* create datatype to represent a username/id pair */
     MPI_Datatype dt;
     mfu_flist_usrgrp_create_stridtype(chars, &dt);
-
-    /* get extent of type */
     MPI_Aint lb, extent;
     MPI_Type_get_extent(dt, &lb, &extent);
 
-    /* allocate an array to hold all user names and ids */
-    size_t bufsize = (size_t)count * (size_t)extent;
+    size_t bufsize = (size_t) count * (size_t) extent;
     char* buf = (char*) MFU_MALLOC(bufsize);
-
-    /* copy items from list into array */
-    if (rank == 0) {
-        strid_serialize(head, chars, buf);
+    memset(buf, 0, bufsize);
+    char* ptr = buf;
+    for (node = strmap_node_first(id2name); node != NULL; node = strmap_node_next(node)) {
+        const char* key  = strmap_node_key(node);
+        const char* name = strmap_node_value(node);
+        if (strcmp(key, name) != 0) {
+            strcpy(ptr, name);
+            ptr += chars;
+            uint64_t id = (uint64_t) strtoull(key, NULL, 10);
+            mfu_pack_uint64(&ptr, id);
+        }
     }
 
-    /* broadcast the array of usernames and ids */
-    MPI_Bcast(buf, count, dt, 0, MPI_COMM_WORLD);
-
-    /* set output parameters */
     items->buf     = buf;
     items->bufsize = bufsize;
-    items->count   = (uint64_t) count;
+    items->count   = count;
     items->chars   = (uint64_t) chars;
     items->dt      = dt;
 
-    /* delete the linked list */
-    if (rank == 0) {
-        strid_delete(&head, &tail, &count);
-    }
-
-    /* create map of user id to user name */
-    mfu_flist_usrgrp_create_map(items, flist->user_id2name);
-    flist->have_users = 1;
-
     return;
 }
 
-/* read group array from file system using getgrent() */
-void mfu_flist_usrgrp_get_groups(flist_t* flist)
+/* record ids whose names are not yet in the map, skipping ids
+ * known to have no name, returns number of ids added to list */
+static uint64_t usrgrp_missing(strmap* id2name, strmap* cache, uint64_t* ids, uint64_t count)
 {
-    /* get pointer to users buf_t */
-    buf_t* items = &flist->groups;
-
-    /* initialize output parameters */
-    buft_init(items);
+    uint64_t i, n = 0;
+    for (i = 0; i < count; i++) {
+        char id_str[32];
+        usrgrp_id_str(ids[i], id_str, sizeof(id_str));
+        const char* name = strmap_get(id2name, id_str);
+        if (name != NULL && strcmp(name, id_str) != 0) {
+            continue;
+        }
+        const char* cached = strmap_get(cache, id_str);
+        if (cached != NULL && cached[0] == '\0') {
+            continue;
+        }
+        ids[n] = ids[i];
+        n++;
+    }
+    return n;
+}
 
-    /* get our rank */
-    int rank;
+/* resolve names of all user and group ids in the list that are
+ * not yet in its maps, the distinct ids are gathered from all
+ * ranks, names not in the cache are looked up in parallel with
+ * each rank taking a share, and results are cached on disk */
+void mfu_flist_usrgrp_resolve(flist_t* flist)
+{
+    int rank, ranks;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-    /* rank 0 iterates over users with getpwent */
-    strid_t* head = NULL;
-    strid_t* tail = NULL;
-    int count = 0;
-    int chars = 0;
-    if (rank == 0) {
-        struct group* p;
-        while (1) {
-            /* get next user, this function can fail so we retry a few times */
-            int retries = 3;
-retry:
-            p = getgrent();
-            if (p == NULL) {
-                if (errno == EIO || errno == EINTR) {
-                    retries--;
+    usrgrp_cache_load();
+
+    strmap* maps[2] = {flist->user_id2name, flist->group_id2name};
+    buf_t* bufs[2]  = {&flist->users, &flist->groups};
+
+    /* collect distinct uids and gids in our part of the list,
+     * skipping repeats of the previous item's ids */
+    uint64_t size = flist->list_count;
+    uint64_t* ids[2];
+    uint64_t counts[2] = {0, 0};
+    ids[0] = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    ids[1] = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    const elem_t* current = flist->list_head;
+    while (current != NULL) {
+        if (counts[0] == 0 || ids[0][counts[0] - 1] != current->uid) {
+            ids[0][counts[0]++] = current->uid;
+        }
+        if (counts[1] == 0 || ids[1][counts[1] - 1] != current->gid) {
+            ids[1][counts[1]++] = current->gid;
+        }
+        current = current->next;
+    }
+
+    int k;
+    int local[2];
+    int added = 0;
+    for (k = 0; k < 2; k++) {
+        counts[k] = usrgrp_unique(ids[k], counts[k]);
+        counts[k] = usrgrp_missing(maps[k], usrgrp_cache[k], ids[k], counts[k]);
+        local[k] = (int) counts[k];
+    }
+
+    /* gather counts of unknown ids, we're done if there are none */
+    int* all = (int*) MFU_MALLOC((size_t) ranks * 2 * sizeof(int));
+    MPI_Allgather(local, 2, MPI_INT, all, 2, MPI_INT, MPI_COMM_WORLD);
+
+    for (k = 0; k < 2; k++) {
+        int* recvcounts = (int*) MFU_MALLOC((size_t) ranks * sizeof(int));
+        int* recvdisps  = (int*) MFU_MALLOC((size_t) ranks * sizeof(int));
+        int i, total = 0;
+        for (i = 0; i < ranks; i++) {
+            recvcounts[i] = all[i * 2 + k];
+            recvdisps[i]  = total;
+            total += recvcounts[i];
+        }
+
+        int changed = (bufs[k]->dt == MPI_DATATYPE_NULL);
+        if (total > 0) {
+            /* gather unknown ids to all ranks */
+            uint64_t* allids = (uint64_t*) MFU_MALLOC((size_t) total * sizeof(uint64_t));
+            MPI_Allgatherv(ids[k], local[k], MPI_UINT64_T,
+                allids, recvcounts, recvdisps, MPI_UINT64_T, MPI_COMM_WORLD);
+            uint64_t unique = usrgrp_unique(allids, (uint64_t) total);
+
+            /* look up our share of the ids not in the cache,
+             * recording an empty name for those not found */
+            uint64_t j;
+            uint64_t miss = 0;
+            uint64_t found = 0;
+            size_t packsize = 0;
+            uint64_t* found_ids = (uint64_t*) MFU_MALLOC((size_t) unique * sizeof(uint64_t));
+            char** found_names  = (char**)    MFU_MALLOC((size_t) unique * sizeof(char*));
+            for (j = 0; j < unique; j++) {
+                char id_str[32];
+                usrgrp_id_str(allids[j], id_str, sizeof(id_str));
+                if (strmap_get(usrgrp_cache[k], id_str) != NULL) {
+                    continue;
                 }
-                else {
-                    /* TODO: ERROR! */
-                    retries = 0;
+                if ((miss++ % (uint64_t) ranks) != (uint64_t) rank) {
+                    continue;
                 }
-                if (retries > 0) {
-                    goto retry;
+                char name[1024];
+                if (usrgrp_lookup(k, allids[j], name, sizeof(name)) != 0) {
+                    name[0] = '\0';
                 }
+                found_ids[found]   = allids[j];
+                found_names[found] = MFU_STRDUP(name);
+                packsize += 8 + strlen(name) + 1;
+                found++;
             }
 
-            if (p != NULL) {
-                /*
-                        printf("Group=%s GID=%d\n",
-                          p->gr_name, p->gr_gid
-                        );
-                */
-                char* name  = p->gr_name;
-                uint64_t id = p->gr_gid;
-                strid_insert(name, id, &head, &tail, &count, &chars);
+            /* pack each as its id followed by its name */
+            char* pack = (char*) MFU_MALLOC(packsize);
+            char* packptr = pack;
+            for (j = 0; j < found; j++) {
+                mfu_pack_uint64(&packptr, found_ids[j]);
+                strcpy(packptr, found_names[j]);
+                packptr += strlen(found_names[j]) + 1;
+                mfu_free(&found_names[j]);
+            }
+            mfu_free(&found_ids);
+            mfu_free(&found_names);
+
+            /* share names with all ranks */
+            int packcount = (int) packsize;
+            MPI_Allgather(&packcount, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+            int packtotal = 0;
+            for (i = 0; i < ranks; i++) {
+                recvdisps[i] = packtotal;
+                packtotal += recvcounts[i];
+            }
+            char* names = (char*) MFU_MALLOC((size_t) packtotal);
+            MPI_Allgatherv(pack, packcount, MPI_BYTE,
+                names, recvcounts, recvdisps, MPI_BYTE, MPI_COMM_WORLD);
+            mfu_free(&pack);
+
+            /* add new names to the cache, it is written out below */
+            if (packtotal > 0) {
+                added = 1;
             }
-            else {
-                /* hit the end of the group list */
-                endgrent();
-                break;
+            const char* ptr = names;
+            while (ptr < names + packtotal) {
+                uint64_t id;
+                mfu_unpack_uint64(&ptr, &id);
+                char id_str[32];
+                usrgrp_id_str(id, id_str, sizeof(id_str));
+                strmap_set(usrgrp_cache[k], id_str, ptr);
+                ptr += strlen(ptr) + 1;
             }
+            mfu_free(&names);
+
+            /* record names of all unknown ids in the list's map */
+            for (j = 0; j < unique; j++) {
+                char id_str[32];
+                usrgrp_id_str(allids[j], id_str, sizeof(id_str));
+                const char* name = strmap_get(usrgrp_cache[k], id_str);
+                if (name != NULL && name[0] != '\0') {
+                    strmap_set(maps[k], id_str, name);
+                    changed = 1;
+                }
+            }
+            mfu_free(&allids);
         }
 
-        //    printf("Max groupname %d, count %d\n", chars, count);
-    }
-
-    /* bcast count and number of chars */
-    MPI_Bcast(&count, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&chars, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-    /* create datatype to represent a username/id pair */
-    MPI_Datatype dt;
-    mfu_flist_usrgrp_create_stridtype(chars, &dt);
-
-    /* get extent of type */
-    MPI_Aint lb, extent;
-    MPI_Type_get_extent(dt, &lb, &extent);
+        /* rebuild array of names if we added any */
+        if (changed) {
+            usrgrp_build_buf(maps[k], bufs[k]);
+        }
 
-    /* allocate an array to hold all user names and ids */
-    size_t bufsize = (size_t)count * (size_t)extent;
-    char* buf = (char*) MFU_MALLOC(bufsize);
+        mfu_free(&recvcounts);
+        mfu_free(&recvdisps);
+    }
 
-    /* copy items from list into array */
-    if (rank == 0) {
-        strid_serialize(head, chars, buf);
+    /* rank 0 saves names to the cache file if we looked up any */
+    if (rank == 0 && added) {
+        usrgrp_cache_save();
     }
 
-    /* broadcast the array of usernames and ids */
-    MPI_Bcast(buf, count, dt, 0, MPI_COMM_WORLD);
+    mfu_free(&all);
+    mfu_free(&ids[0]);
+    mfu_free(&ids[1]);
 
-    /* set output parameters */
-    items->buf     = buf;
-    items->bufsize = bufsize;
-    items->count   = (uint64_t) count;
-    items->chars   = (uint64_t) chars;
-    items->dt      = dt;
+    return;
+}
 
-    /* delete the linked list */
-    if (rank == 0) {
-        strid_delete(&head, &tail, &count);
-    }
+/* prepare user array, names are resolved for ids in use when
+ * the list is summarized rather than reading all users here */
+void mfu_flist_usrgrp_get_users(flist_t* flist)
+{
+    buf_t* items = &flist->users;
+    buft_init(items);
+    usrgrp_build_buf(flist->user_id2name, items);
+    flist->have_users = 1;
+    return;
+}
 
-    /* create map of user id to user name */
-    mfu_flist_usrgrp_create_map(items, flist->group_id2name);
+/* prepare group array, names are resolved for ids in use when
+ * the list is summarized rather than reading all groups here */
+void mfu_flist_usrgrp_get_groups(flist_t* flist)
+{
+    buf_t* items = &flist->groups;
+    buft_init(items);
+    usrgrp_build_buf(flist->group_id2name, items);
     flist->have_groups = 1;
-
     return;
 }
 
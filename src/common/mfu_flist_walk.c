@@ -566,6 +566,8 @@ int mfu_flist_walk_paths(uint64_t num_paths, const char** paths,
                           mfu_walk_opts_t* walk_opts, mfu_flist bflist,
                           mfu_file_t* mfu_file)
 {
+    mfu_trace_push("walk");
+
     /* report walk count, time, and rate */
     double start_walk = MPI_Wtime();
 
@@ -691,6 +693,7 @@ int mfu_flist_walk_paths(uint64_t num_paths, const char** paths,
     int all_rc;
     MPI_Allreduce(&WALK_RESULT, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
 
+    mfu_trace_pop();
     return all_rc;
 }
 
@@ -742,6 +745,8 @@ void mfu_flist_stat(
   int dereference,
   mfu_file_t* mfu_file)
 {
+    mfu_trace_push("stat");
+
     flist_t* file_list = (flist_t*)flist;
 
     /* we will stat all items in output list, so set detail to 1 */
@@ -815,4 +820,6 @@ void mfu_flist_stat(
 
     /* compute global summary */
     mfu_flist_summarize(flist);
+
+    mfu_trace_pop();
 }
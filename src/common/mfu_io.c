@@ -26,14 +26,45 @@
 
 static int mpi_rank;
 
+/* the mock file system fails calls with EINTR and EIO to test how tools
+ * cope, returns 1 if a mock call that just failed should be tried again
+ * the way the POSIX wrappers retry, and 0 to return the error */
+static int mock_retry(int* tries)
+{
+    if (errno != EINTR && errno != EIO) {
+        return 0;
+    }
+
+    (*tries)--;
+    if (*tries <= 0) {
+        return 0;
+    }
+
+    /* sleep a bit before consecutive tries */
+    usleep(MFU_IO_USLEEP);
+    return 1;
+}
+
 /* calls access, and retries a few times if we get EIO or EINTR */
 int mfu_file_access(const char* path, int amode, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_access(path, amode);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_access(path, amode, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_access(path, amode, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -74,11 +105,23 @@ int daos_access(const char* path, int amode, mfu_file_t* mfu_file)
 /* calls faccessat, and retries a few times if we get EIO or EINTR */
 int mfu_file_faccessat(int dirfd, const char* path, int amode, int flags, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_faccessat(dirfd, path, amode, flags);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_faccessat(dirfd, path, amode, flags, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_faccessat(dirfd, path, amode, flags, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -126,11 +169,23 @@ int daos_faccessat(int dirfd, const char* path, int amode, int flags, mfu_file_t
 /* calls lchown, and retries a few times if we get EIO or EINTR */
 int mfu_file_lchown(const char* path, uid_t owner, gid_t group, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_lchown(path, owner, group);
+        MFU_TRACE_END(MFU_TRACE_SETATTR, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_lchown(path, owner, group, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_SETATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_lchown(path, owner, group, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_SETATTR, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -158,6 +213,26 @@ retry:
     return rc;
 }
 
+int mfu_fchownat(int dirfd, const char* path, uid_t owner, gid_t group, int flags)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = fchownat(dirfd, path, owner, group, flags);
+    if (rc != 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 int daos_lchown(const char* path, uid_t owner, gid_t group, mfu_file_t* mfu_file)
 {
     /* At this time, DFS does not support updating the uid or gid.
@@ -195,14 +270,46 @@ retry:
     return rc;
 }
 
+int mfu_fchmodat(int dirfd, const char* path, mode_t mode, int flags)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = fchmodat(dirfd, path, mode, flags);
+    if (rc != 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 /* calls chmod, and retries a few times if we get EIO or EINTR */
 int mfu_file_chmod(const char* path, mode_t mode, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_chmod(path, mode);
+        MFU_TRACE_END(MFU_TRACE_SETATTR, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_chmod(path, mode, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_SETATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_chmod(path, mode, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_SETATTR, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -214,11 +321,23 @@ int mfu_file_chmod(const char* path, mode_t mode, mfu_file_t* mfu_file)
 int mfu_file_utimensat(int dirfd, const char* pathname, const struct timespec times[2], int flags,
                        mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_utimensat(dirfd, pathname, times, flags);
+        MFU_TRACE_END(MFU_TRACE_SETATTR, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_utimensat(dirfd, pathname, times, flags, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_SETATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_utimensat(dirfd, pathname, times, flags, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_SETATTR, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -296,11 +415,23 @@ retry:
 /* calls stat, and retries a few times if we get EIO or EINTR */
 int mfu_file_stat(const char* path, struct stat* buf, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_stat(path, buf);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_stat(path, buf, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_stat(path, buf, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -338,14 +469,46 @@ retry:
     return rc;
 }
 
+int mfu_fstatat(int dirfd, const char* path, struct stat* buf, int flags)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = fstatat(dirfd, path, buf, flags);
+    if (rc != 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 /* calls lstat, and retries a few times if we get EIO or EINTR */
 int mfu_file_lstat(const char* path, struct stat* buf, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_lstat(path, buf);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_lstat(path, buf, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_lstat(path, buf, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -407,11 +570,23 @@ retry:
 /* call mknod, retry a few times on EINTR or EIO */
 int mfu_file_mknod(const char* path, mode_t mode, dev_t dev, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_mknod(path, mode, dev);
+        MFU_TRACE_END(MFU_TRACE_CREATE, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_mknod(path, mode, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_CREATE, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_mknod(path, mode, dev, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_CREATE, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -421,11 +596,23 @@ int mfu_file_mknod(const char* path, mode_t mode, dev_t dev, mfu_file_t* mfu_fil
 
 int mfu_file_remove(const char* path, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_remove(path);
+        MFU_TRACE_END(MFU_TRACE_REMOVE, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_remove(path, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_REMOVE, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_remove(path, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_REMOVE, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -467,11 +654,23 @@ int daos_remove(const char* path, mfu_file_t* mfu_file)
 /* calls realpath */
 char* mfu_file_realpath(const char* path, char* resolved_path, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         char* p = mfu_realpath(path, resolved_path);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return p;
     } else if (mfu_file->type == DFS) {
         char* p = daos_realpath(path, resolved_path, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
+        return p;
+    } else if (mfu_file->type == MOCK) {
+        char* p;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            p = mock_realpath(path, resolved_path, mfu_file);
+        } while (p == NULL && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
         return p;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -537,17 +736,25 @@ retry:
 
 ssize_t mfu_file_readlink(const char* path, char* buf, size_t bufsize, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     int rc;
 
     if (mfu_file->type == POSIX) {
         rc = mfu_readlink(path, buf, bufsize);
     } else if (mfu_file->type == DFS) {
         rc = daos_readlink(path, buf, bufsize, mfu_file);
+    } else if (mfu_file->type == MOCK) {
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_readlink(path, buf, bufsize, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
                   path, mfu_file->type);
     }
 
+    MFU_TRACE_END(MFU_TRACE_STAT, trace_start, 0);
     return rc;
 }
 
@@ -585,17 +792,25 @@ retry:
 
 int mfu_file_symlink(const char* oldpath, const char* newpath, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     int rc;
 
     if (mfu_file->type == POSIX) {
         rc = mfu_symlink(oldpath, newpath);
     } else if (mfu_file->type == DFS) {
         rc = daos_symlink(oldpath, newpath, mfu_file);
+    } else if (mfu_file->type == MOCK) {
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_symlink(oldpath, newpath, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
                   oldpath, mfu_file->type);
     }
 
+    MFU_TRACE_END(MFU_TRACE_CREATE, trace_start, 0);
     return rc;
 }
 
@@ -688,6 +903,7 @@ int mfu_open(const char* file, int flags, ...)
  * Return 0 on success, -1 on error */
 int mfu_file_open(const char* file, int flags, mfu_file_t* mfu_file, ...)
 {
+    double trace_start = MFU_TRACE_START();
     /* extract the mode (see man 2 open) */
     int mode_set = 0;
     mode_t mode  = 0;
@@ -717,11 +933,21 @@ int mfu_file_open(const char* file, int flags, mfu_file_t* mfu_file, ...)
             rc = -1;
         }
 #endif
+    } else if (mfu_file->type == MOCK) {
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            mfu_file->fd = mock_open(file, flags, mode, mfu_file);
+        } while (mfu_file->fd < 0 && mock_retry(&tries));
+        if (mfu_file->fd < 0) {
+            rc = -1;
+        }
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
                   file, mfu_file->type);
     }
 
+    MFU_TRACE_END(MFU_TRACE_OPEN, trace_start, 0);
     return rc;
 }
 
@@ -761,14 +987,26 @@ retry:
 
 int mfu_file_close(const char* file, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_close(file, mfu_file->fd);
         if (rc == 0) {
             mfu_file->fd = -1;
         }
+        MFU_TRACE_END(MFU_TRACE_CLOSE, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_close(file, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_CLOSE, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_close(file, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_CLOSE, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -812,11 +1050,23 @@ retry:
 
 off_t mfu_file_lseek(const char* file, mfu_file_t* mfu_file, off_t pos, int whence)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         off_t rc = mfu_lseek(file, mfu_file->fd, pos, whence);
+        MFU_TRACE_END(MFU_TRACE_SEEK, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         off_t rc = daos_lseek(file, mfu_file, pos, whence);
+        MFU_TRACE_END(MFU_TRACE_SEEK, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        off_t rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_lseek(file, mfu_file, pos, whence);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_SEEK, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -827,11 +1077,23 @@ off_t mfu_file_lseek(const char* file, mfu_file_t* mfu_file, off_t pos, int when
 /* reliable read from file descriptor (retries, if necessary, until hard error) */
 ssize_t mfu_file_read(const char* file, void* buf, size_t size, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         ssize_t got_size = mfu_read(file, mfu_file->fd, buf, size);
+        MFU_TRACE_END(MFU_TRACE_READ, trace_start, got_size);
         return got_size;
     } else if (mfu_file->type == DFS) {
         ssize_t got_size = daos_read(file, buf, size, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_READ, trace_start, got_size);
+        return got_size;
+    } else if (mfu_file->type == MOCK) {
+        ssize_t got_size;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            got_size = mock_read(file, buf, size, mfu_file);
+        } while (got_size < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_READ, trace_start, got_size);
         return got_size;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -896,11 +1158,35 @@ ssize_t mfu_read(const char* file, int fd, void* buf, size_t size)
 /* reliable write to file descriptor (retries, if necessary, until hard error) */
 ssize_t mfu_file_write(const char* file, const void* buf, size_t size, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         ssize_t num_bytes_written = mfu_write(file, mfu_file->fd, buf, size);
+        MFU_TRACE_END(MFU_TRACE_WRITE, trace_start, num_bytes_written);
         return num_bytes_written;
     } else if (mfu_file->type == DFS) {
         ssize_t num_bytes_written = daos_write(file, buf, size, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_WRITE, trace_start, num_bytes_written);
+        return num_bytes_written;
+    } else if (mfu_file->type == MOCK) {
+        /* like mfu_write, keep writing after a short write */
+        ssize_t num_bytes_written = 0;
+        int tries = MFU_IO_TRIES;
+        while ((size_t)num_bytes_written < size) {
+            errno = 0;
+            ssize_t rc = mock_write(file, (const char*) buf + num_bytes_written,
+                size - (size_t)num_bytes_written, mfu_file);
+            if (rc > 0) {
+                num_bytes_written += rc;
+                tries = MFU_IO_TRIES;
+            } else if (rc == 0 || ! mock_retry(&tries)) {
+                /* return what we wrote, or the error if nothing */
+                if (num_bytes_written == 0) {
+                    num_bytes_written = rc;
+                }
+                break;
+            }
+        }
+        MFU_TRACE_END(MFU_TRACE_WRITE, trace_start, num_bytes_written);
         return num_bytes_written;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -964,11 +1250,23 @@ ssize_t daos_write(const char* file, const void* buf, size_t size, mfu_file_t* m
 /* reliable pread from file descriptor (retries, if necessary, until hard error) */
 ssize_t mfu_file_pread(const char* file, void* buf, size_t size, off_t offset, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         ssize_t rc = mfu_pread(file, mfu_file->fd, buf, size, offset);
+        MFU_TRACE_END(MFU_TRACE_READ, trace_start, rc);
         return rc;
     } else if (mfu_file->type == DFS) {
         ssize_t rc = daos_pread(file, buf, size, offset, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_READ, trace_start, rc);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        ssize_t rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_pread(file, buf, size, offset, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_READ, trace_start, rc);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -1022,11 +1320,23 @@ ssize_t mfu_pread(const char* file, int fd, void* buf, size_t size, off_t offset
 
 ssize_t mfu_file_pwrite(const char* file, const void* buf, size_t size, off_t offset, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         ssize_t rc = mfu_pwrite(file, mfu_file->fd, buf, size, offset);
+        MFU_TRACE_END(MFU_TRACE_WRITE, trace_start, rc);
         return rc;
     } else if (mfu_file->type == DFS) {
         ssize_t rc = daos_pwrite(file, buf, size, offset, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_WRITE, trace_start, rc);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        ssize_t rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_pwrite(file, buf, size, offset, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_WRITE, trace_start, rc);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -1081,11 +1391,23 @@ ssize_t daos_pwrite(const char* file, const void* buf, size_t size, off_t offset
 /* truncate a file */
 int mfu_file_truncate(const char* file, off_t length, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_truncate(file, length);
+        MFU_TRACE_END(MFU_TRACE_TRUNC, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_truncate(file, length, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_TRUNC, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_truncate(file, length, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_TRUNC, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1157,11 +1479,23 @@ retry:
 /* ftruncate a file */
 int mfu_file_ftruncate(mfu_file_t* mfu_file, off_t length)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_ftruncate(mfu_file->fd, length);
+        MFU_TRACE_END(MFU_TRACE_TRUNC, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_ftruncate(mfu_file, length);
+        MFU_TRACE_END(MFU_TRACE_TRUNC, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_ftruncate(mfu_file, length);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_TRUNC, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1172,11 +1506,23 @@ int mfu_file_ftruncate(mfu_file_t* mfu_file, off_t length)
 /* unlink a file */
 int mfu_file_unlink(const char* file, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_unlink(file);
+        MFU_TRACE_END(MFU_TRACE_REMOVE, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_unlink(file, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_REMOVE, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_unlink(file, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_REMOVE, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1220,6 +1566,7 @@ int mfu_fsync(const char* file, int fd)
 {
     int rc;
     int tries = MFU_IO_TRIES;
+    double trace_start = MFU_TRACE_START();
 retry:
     errno = 0;
     rc = fsync(fd);
@@ -1233,6 +1580,29 @@ retry:
             }
         }
     }
+    MFU_TRACE_END(MFU_TRACE_FSYNC, trace_start, 0);
+    return rc;
+}
+
+/* deallocate byte range of a file, leaving a hole that reads as zeros,
+ * keeps the file size unchanged */
+int mfu_punch_hole(const char* file, int fd, off_t offset, off_t length)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length);
+    if (rc < 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
     return rc;
 }
 
@@ -1285,11 +1655,23 @@ retry:
 /* create directory, retry a few times on EINTR or EIO */
 int mfu_file_mkdir(const char* dir, mode_t mode, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_mkdir(dir, mode);
+        MFU_TRACE_END(MFU_TRACE_CREATE, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_mkdir(dir, mode, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_CREATE, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_mkdir(dir, mode, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_CREATE, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -1299,11 +1681,23 @@ int mfu_file_mkdir(const char* dir, mode_t mode, mfu_file_t* mfu_file)
 
 int mfu_file_rmdir(const char* dir, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_rmdir(dir);
+        MFU_TRACE_END(MFU_TRACE_REMOVE, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_rmdir(dir, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_REMOVE, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_rmdir(dir, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_REMOVE, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -1383,11 +1777,23 @@ retry:
 /* open directory, retry a few times on EINTR or EIO */
 DIR* mfu_file_opendir(const char* dir, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         DIR* dirp = mfu_opendir(dir);
+        MFU_TRACE_END(MFU_TRACE_READDIR, trace_start, 0);
         return dirp;
     } else if (mfu_file->type == DFS) {
         DIR* dirp = daos_opendir(dir, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_READDIR, trace_start, 0);
+        return dirp;
+    } else if (mfu_file->type == MOCK) {
+        DIR* dirp;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            dirp = mock_opendir(dir, mfu_file);
+        } while (dirp == NULL && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_READDIR, trace_start, 0);
         return dirp;
     } else {
         MFU_ABORT(-1, "File type not known: %s type=%d",
@@ -1429,11 +1835,23 @@ retry:
 
 int mfu_file_closedir(DIR* dirp, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_closedir(dirp);
+        MFU_TRACE_END(MFU_TRACE_READDIR, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_closedir(dirp, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_READDIR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_closedir(dirp, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_READDIR, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1481,11 +1899,23 @@ retry:
 
 struct dirent* mfu_file_readdir(DIR* dirp, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         struct dirent* entry = mfu_readdir(dirp);
+        MFU_TRACE_END(MFU_TRACE_READDIR, trace_start, 0);
         return entry;
     } else if (mfu_file->type == DFS) {
         struct dirent* entry = daos_readdir(dirp, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_READDIR, trace_start, 0);
+        return entry;
+    } else if (mfu_file->type == MOCK) {
+        struct dirent* entry;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            entry = mock_readdir(dirp, mfu_file);
+        } while (entry == NULL && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_READDIR, trace_start, 0);
         return entry;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1497,11 +1927,23 @@ struct dirent* mfu_file_readdir(DIR* dirp, mfu_file_t* mfu_file)
 /* list xattrs (link interrogation) */
 ssize_t mfu_file_llistxattr(const char* path, char* list, size_t size, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         ssize_t rc = mfu_llistxattr(path, list, size);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         ssize_t rc = daos_llistxattr(path, list, size, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        ssize_t rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_llistxattr(path, list, size, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1534,11 +1976,23 @@ ssize_t daos_llistxattr(const char* path, char* list, size_t size, mfu_file_t* m
 /* list xattrs (link dereference) */
 ssize_t mfu_file_listxattr(const char* path, char* list, size_t size, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         ssize_t rc = mfu_listxattr(path, list, size);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         ssize_t rc = daos_listxattr(path, list, size, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        ssize_t rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_listxattr(path, list, size, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1571,11 +2025,23 @@ ssize_t daos_listxattr(const char* path, char* list, size_t size, mfu_file_t* mf
 /* get xattrs (link interrogation) */
 ssize_t mfu_file_lgetxattr(const char* path, const char* name, void* value, size_t size, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
    if (mfu_file->type == POSIX) {
         ssize_t rc = mfu_lgetxattr(path, name, value, size);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         ssize_t rc = daos_lgetxattr(path, name, value, size, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        ssize_t rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_lgetxattr(path, name, value, size, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1606,11 +2072,23 @@ ssize_t daos_lgetxattr(const char* path, const char* name, void* value, size_t s
 /* get xattrs (link dereference) */
 ssize_t mfu_file_getxattr(const char* path, const char* name, void* value, size_t size, mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
    if (mfu_file->type == POSIX) {
         ssize_t rc = mfu_getxattr(path, name, value, size);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         ssize_t rc = daos_getxattr(path, name, value, size, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        ssize_t rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_getxattr(path, name, value, size, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1642,11 +2120,23 @@ ssize_t daos_getxattr(const char* path, const char* name, void* value, size_t si
 int mfu_file_lsetxattr(const char* path, const char* name, const void* value, size_t size, int flags,
                        mfu_file_t* mfu_file)
 {
+    double trace_start = MFU_TRACE_START();
     if (mfu_file->type == POSIX) {
         int rc = mfu_lsetxattr(path, name, value, size, flags);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else if (mfu_file->type == DFS) {
         int rc = daos_lsetxattr(path, name, value, size, flags, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        int rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_lsetxattr(path, name, value, size, flags, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
         return rc;
     } else {
         MFU_ABORT(-1, "File type not known, type=%d",
@@ -1670,4 +2160,72 @@ int daos_lsetxattr(const char* path, const char* name, const void* value, size_t
     return mfu_errno2rc(ENOSYS);
 #endif
 }
+
+/* list xattrs of open file, path names the same file and is
+ * used by backends that do not work from the open file */
+ssize_t mfu_file_flistxattr(const char* path, char* list, size_t size, mfu_file_t* mfu_file)
+{
+    double trace_start = MFU_TRACE_START();
+    if (mfu_file->type == POSIX) {
+        ssize_t rc = mfu_flistxattr(mfu_file->fd, list, size);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == DFS) {
+        ssize_t rc = daos_listxattr(path, list, size, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        ssize_t rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_listxattr(path, list, size, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else {
+        MFU_ABORT(-1, "File type not known, type=%d",
+                  mfu_file->type);
+    }
+}
+
+ssize_t mfu_flistxattr(int fd, char* list, size_t size)
+{
+    ssize_t rc = flistxattr(fd, list, size);
+    return rc;
+}
+
+/* get xattrs of open file, path names the same file and is
+ * used by backends that do not work from the open file */
+ssize_t mfu_file_fgetxattr(const char* path, const char* name, void* value, size_t size, mfu_file_t* mfu_file)
+{
+    double trace_start = MFU_TRACE_START();
+    if (mfu_file->type == POSIX) {
+        ssize_t rc = mfu_fgetxattr(mfu_file->fd, name, value, size);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == DFS) {
+        ssize_t rc = daos_getxattr(path, name, value, size, mfu_file);
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else if (mfu_file->type == MOCK) {
+        ssize_t rc;
+        int tries = MFU_IO_TRIES;
+        do {
+            errno = 0;
+            rc = mock_getxattr(path, name, value, size, mfu_file);
+        } while (rc < 0 && mock_retry(&tries));
+        MFU_TRACE_END(MFU_TRACE_XATTR, trace_start, 0);
+        return rc;
+    } else {
+        MFU_ABORT(-1, "File type not known, type=%d",
+                  mfu_file->type);
+    }
+}
+
+ssize_t mfu_fgetxattr(int fd, const char* name, void* value, size_t size)
+{
+    ssize_t rc = fgetxattr(fd, name, value, size);
+    return rc;
+}
 #endif // DCOPY_USE_XATTRS
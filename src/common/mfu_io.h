@@ -69,11 +69,17 @@ int mfu_file_lchown(const char* path, uid_t owner, gid_t group, mfu_file_t* mfu_
 int mfu_lchown(const char* path, uid_t owner, gid_t group);
 int daos_lchown(const char* path, uid_t owner, gid_t group, mfu_file_t* mfu_file);
 
+/* calls fchownat, and retries a few times if we get EIO or EINTR */
+int mfu_fchownat(int dirfd, const char* path, uid_t owner, gid_t group, int flags);
+
 /* calls chmod, and retries a few times if we get EIO or EINTR */
 int daos_chmod(const char* path, mode_t mode, mfu_file_t* mfu_file);
 int mfu_chmod(const char* path, mode_t mode);
 int mfu_file_chmod(const char* path, mode_t mode, mfu_file_t* mfu_file);
 
+/* calls fchmodat, and retries a few times if we get EIO or EINTR */
+int mfu_fchmodat(int dirfd, const char* path, mode_t mode, int flags);
+
 /* calls utimensat, and retries a few times if we get EIO or EINTR */
 int mfu_file_utimensat(int dirfd, const char *pathname, const struct timespec times[2], int flags,
                        mfu_file_t* mfu_file);
@@ -86,6 +92,9 @@ int mfu_file_lstat(const char* path, struct stat* buf, mfu_file_t* mfu_file);
 int mfu_lstat(const char* path, struct stat* buf);
 int daos_lstat(const char* path, struct stat* buf, mfu_file_t* mfu_file);
 
+/* calls fstatat, and retries a few times if we get EIO or EINTR */
+int mfu_fstatat(int dirfd, const char* path, struct stat* buf, int flags);
+
 /* only dcp1 calls mfu_lstat64, is it necessary? */
 int mfu_lstat64(const char* path, struct stat64* buf);
 
@@ -136,6 +145,14 @@ int mfu_lsetxattr(const char* path, const char* name, const void* value, size_t
 int daos_lsetxattr(const char* path, const char* name, const void* value, size_t size, int flags,
                            mfu_file_t* mfu_file);
 
+/* list xattrs of open file */
+ssize_t mfu_file_flistxattr(const char* path, char* list, size_t size, mfu_file_t* mfu_file);
+ssize_t mfu_flistxattr(int fd, char* list, size_t size);
+
+/* get xattrs of open file */
+ssize_t mfu_file_fgetxattr(const char* path, const char* name, void* value, size_t size, mfu_file_t* mfu_file);
+ssize_t mfu_fgetxattr(int fd, const char* name, void* value, size_t size);
+
 /* calls realpath */
 char* mfu_file_realpath(const char* path, char* resolved_path, mfu_file_t* mfu_file);
 char* mfu_realpath(const char* path, char* resolved_path);
@@ -216,6 +233,10 @@ int mfu_unlink(const char* file);
 /* force flush of written data */
 int mfu_fsync(const char* file, int fd);
 
+/* deallocate byte range of file with fallocate(PUNCH_HOLE),
+ * file size is unchanged, fails with EOPNOTSUPP if not supported */
+int mfu_punch_hole(const char* file, int fd, off_t offset, off_t length);
+
 /*****************************
  * Directories
  ****************************/
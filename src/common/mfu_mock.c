@@ -0,0 +1,1588 @@
+/* Implements an in-memory file system with configurable delays and
+ * faults behind the mfu_file_* calls, see mfu_mock.h */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#if DCOPY_USE_XATTRS
+#include <sys/xattr.h>
+#endif
+
+#include "mfu.h"
+#include "mfu_mock.h"
+
+#ifndef XATTR_CREATE
+#define XATTR_CREATE  (1)
+#define XATTR_REPLACE (2)
+#endif
+
+/* descriptors start here so they are never mistaken for POSIX descriptors */
+#define MOCK_FD_BASE (1 << 20)
+
+/* device id reported for every item ("mock") */
+#define MOCK_DEV (0x6d6f636b)
+
+/* max number of symlinks followed in one lookup */
+#define MOCK_MAX_LINKS (40)
+
+/* extended attribute of an item */
+typedef struct mock_xattr {
+    char* name;               /* name of attribute */
+    void* value;              /* value of attribute */
+    size_t size;              /* number of bytes in value */
+    struct mock_xattr* next;  /* next attribute of item */
+} mock_xattr;
+
+/* an item in the tree */
+typedef struct mock_node {
+    char* path;                /* full path of item */
+    struct stat st;            /* attributes returned by stat */
+    char* data;                /* contents of a regular file */
+    size_t cap;                /* number of bytes allocated for data */
+    char* target;              /* target of a symlink */
+    struct mock_node** kids;   /* items in a directory, in order of creation */
+    uint64_t nkids;            /* number of items in directory */
+    uint64_t maxkids;          /* number of slots allocated in kids */
+    struct mock_node* parent;  /* directory holding item, the root is its own parent */
+    struct mock_node* next;    /* next item in hash chain */
+    mock_xattr* xattrs;        /* list of extended attributes */
+    int opens;                 /* number of descriptors open on item */
+    int removed;               /* set if item was removed while open */
+} mock_node;
+
+/* an open file */
+typedef struct {
+    mock_node* node;  /* item, NULL if slot is free */
+    int flags;        /* flags item was opened with */
+    off_t pos;        /* offset used by read and write */
+} mock_fd;
+
+/* an open directory, returned to callers as a DIR* */
+typedef struct {
+    char* path;            /* path of directory */
+    uint64_t pos;          /* index of next entry, 0 and 1 are . and .. */
+    struct dirent entry;   /* last entry returned */
+} mock_dir;
+
+/* counters printed at finalize */
+enum {
+    MOCK_CALLS = 0, /* calls made, including retries */
+    MOCK_BYTES,     /* bytes read and written */
+    MOCK_EINTR,     /* EINTR faults */
+    MOCK_EIO,       /* EIO faults */
+    MOCK_SHORT,     /* short reads and writes */
+    MOCK_ENOSPC,    /* writes that found the rank full */
+    MOCK_STATS      /* number of counters, must be last */
+};
+
+int mfu_mock_enabled = 0;
+
+static mock_node** mock_table   = NULL; /* hash table of items by path */
+static uint64_t    mock_buckets = 0;    /* number of buckets in table */
+static uint64_t    mock_items   = 0;    /* number of items in table */
+static mock_fd*    mock_fds     = NULL; /* table of open files */
+static int         mock_nfds    = 0;    /* number of slots in table of open files */
+static ino_t       mock_ino     = 1;    /* inode number of next item */
+static uint64_t    mock_used    = 0;    /* bytes held in files on this rank */
+static mode_t      mock_umask   = 0;    /* umask of process */
+
+static unsigned long mock_latency   = 0;   /* usecs added to every call */
+static double        mock_bandwidth = 0.0; /* bytes per second, 0 for unlimited */
+static double        mock_busy      = 0.0; /* time when data moved so far is done */
+static uint64_t      mock_eintr     = 0;   /* every Nth call fails with EINTR */
+static uint64_t      mock_eio       = 0;   /* every Nth read or write fails with EIO */
+static uint64_t      mock_short     = 0;   /* every Nth read or write is short */
+static uint64_t      mock_capacity  = 0;   /* bytes each rank can hold, 0 for unlimited */
+static uint64_t      mock_ios       = 0;   /* number of reads and writes, including retries */
+
+static uint64_t mock_stats[MOCK_STATS];
+
+/* FNV-1a hash of a path */
+static uint64_t mock_hash(const char* path)
+{
+    uint64_t h = 14695981039346656037ULL;
+    while (*path != '\0') {
+        h ^= (unsigned char) *path++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* look up item by normalized path, returns NULL if not found */
+static mock_node* mock_find(const char* path)
+{
+    mock_node* node = mock_table[mock_hash(path) % mock_buckets];
+    while (node != NULL && strcmp(node->path, path) != 0) {
+        node = node->next;
+    }
+    return node;
+}
+
+/* add item to hash table, doubling the table when it fills up */
+static void mock_hash_insert(mock_node* node)
+{
+    if (mock_items >= mock_buckets) {
+        uint64_t buckets = mock_buckets * 2;
+        mock_node** table = (mock_node**) MFU_CALLOC(buckets, sizeof(mock_node*));
+        uint64_t i;
+        for (i = 0; i < mock_buckets; i++) {
+            mock_node* n = mock_table[i];
+            while (n != NULL) {
+                mock_node* next = n->next;
+                uint64_t b = mock_hash(n->path) % buckets;
+                n->next = table[b];
+                table[b] = n;
+                n = next;
+            }
+        }
+        mfu_free(&mock_table);
+        mock_table   = table;
+        mock_buckets = buckets;
+    }
+
+    uint64_t b = mock_hash(node->path) % mock_buckets;
+    node->next = mock_table[b];
+    mock_table[b] = node;
+    mock_items++;
+}
+
+/* remove item from hash table */
+static void mock_hash_remove(mock_node* node)
+{
+    mock_node** p = &mock_table[mock_hash(node->path) % mock_buckets];
+    while (*p != NULL) {
+        if (*p == node) {
+            *p = node->next;
+            mock_items--;
+            return;
+        }
+        p = &(*p)->next;
+    }
+}
+
+/* free item and everything it holds */
+static void mock_free_node(mock_node* node)
+{
+    mock_used -= (uint64_t) node->st.st_size;
+    mock_xattr* x = node->xattrs;
+    while (x != NULL) {
+        mock_xattr* next = x->next;
+        mfu_free(&x->name);
+        mfu_free(&x->value);
+        mfu_free(&x);
+        x = next;
+    }
+    mfu_free(&node->path);
+    mfu_free(&node->data);
+    mfu_free(&node->target);
+    mfu_free(&node->kids);
+    mfu_free(&node);
+}
+
+/* get the current time */
+static void mock_now(struct timespec* ts)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+}
+
+/* write absolute, reduced form of path into buf of PATH_MAX bytes,
+ * a relative path is taken from the current working directory,
+ * returns 0 on success and -1 with errno set otherwise */
+static int mock_normalize(const char* path, char* buf)
+{
+    if (path == NULL || path[0] == '\0') {
+        errno = ENOENT;
+        return -1;
+    }
+
+    char tmp[PATH_MAX];
+    size_t len = 0;
+    if (path[0] != '/') {
+        if (getcwd(tmp, sizeof(tmp)) == NULL) {
+            return -1;
+        }
+        len = strlen(tmp);
+        tmp[len++] = '/';
+    }
+    size_t pathlen = strlen(path);
+    if (len + pathlen >= sizeof(tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(tmp + len, path, pathlen + 1);
+
+    /* append each component, dropping "." and backing up for ".." */
+    len = 0;
+    buf[0] = '\0';
+    char* saveptr;
+    char* tok = strtok_r(tmp, "/", &saveptr);
+    while (tok != NULL) {
+        if (strcmp(tok, "..") == 0) {
+            char* slash = strrchr(buf, '/');
+            if (slash != NULL) {
+                *slash = '\0';
+                len = (size_t) (slash - buf);
+            }
+        } else if (strcmp(tok, ".") != 0) {
+            size_t toklen = strlen(tok);
+            if (len + 1 + toklen >= PATH_MAX) {
+                errno = ENAMETOOLONG;
+                return -1;
+            }
+            buf[len++] = '/';
+            memcpy(buf + len, tok, toklen + 1);
+            len += toklen;
+        }
+        tok = strtok_r(NULL, "/", &saveptr);
+    }
+    if (len == 0) {
+        strcpy(buf, "/");
+    }
+    return 0;
+}
+
+/* look up item at path, following a symlink in the last component
+ * if follow is set, returns NULL with errno set if there is none */
+static mock_node* mock_lookup(const char* path, int follow)
+{
+    char norm[PATH_MAX];
+    if (mock_normalize(path, norm) != 0) {
+        return NULL;
+    }
+
+    int links = 0;
+    while (1) {
+        mock_node* node = mock_find(norm);
+        if (node == NULL) {
+            errno = ENOENT;
+            return NULL;
+        }
+        if (! follow || ! S_ISLNK(node->st.st_mode)) {
+            return node;
+        }
+
+        links++;
+        if (links > MOCK_MAX_LINKS) {
+            errno = ELOOP;
+            return NULL;
+        }
+
+        /* a relative target is taken from the directory holding the link */
+        char tmp[PATH_MAX];
+        int n;
+        if (node->target[0] == '/') {
+            n = snprintf(tmp, sizeof(tmp), "%s", node->target);
+        } else {
+            n = snprintf(tmp, sizeof(tmp), "%s/%s", node->parent->path, node->target);
+        }
+        if (n < 0 || (size_t) n >= sizeof(tmp)) {
+            errno = ENAMETOOLONG;
+            return NULL;
+        }
+        if (mock_normalize(tmp, norm) != 0) {
+            return NULL;
+        }
+    }
+}
+
+/* add item with given mode at normalized path, which must not exist,
+ * creating any missing parent directories, returns NULL with errno
+ * set on error */
+static mock_node* mock_add(const char* path, mode_t mode)
+{
+    struct timespec now;
+    mock_now(&now);
+
+    /* find the parent directory, the root has none */
+    mock_node* parent = NULL;
+    if (strcmp(path, "/") != 0) {
+        char dir[PATH_MAX];
+        strcpy(dir, path);
+        char* slash = strrchr(dir, '/');
+        if (slash == dir) {
+            slash[1] = '\0';
+        } else {
+            *slash = '\0';
+        }
+
+        parent = mock_find(dir);
+        if (parent == NULL) {
+            parent = mock_add(dir, S_IFDIR | (0777 & ~mock_umask));
+            if (parent == NULL) {
+                return NULL;
+            }
+        } else if (! S_ISDIR(parent->st.st_mode)) {
+            errno = ENOTDIR;
+            return NULL;
+        }
+    }
+
+    mock_node* node = (mock_node*) MFU_CALLOC(1, sizeof(mock_node));
+    node->path          = MFU_STRDUP(path);
+    node->st.st_dev     = MOCK_DEV;
+    node->st.st_ino     = mock_ino++;
+    node->st.st_mode    = mode;
+    node->st.st_nlink   = S_ISDIR(mode) ? 2 : 1;
+    node->st.st_uid     = geteuid();
+    node->st.st_gid     = getegid();
+    node->st.st_blksize = 4096;
+    node->st.st_atim    = now;
+    node->st.st_mtim    = now;
+    node->st.st_ctim    = now;
+
+    if (parent != NULL) {
+        if (parent->nkids == parent->maxkids) {
+            parent->maxkids = (parent->maxkids > 0) ? parent->maxkids * 2 : 8;
+            parent->kids = (mock_node**) realloc(parent->kids, parent->maxkids * sizeof(mock_node*));
+            if (parent->kids == NULL) {
+                MFU_ABORT(-1, "Failed to allocate entries of mock directory `%s'", parent->path);
+            }
+        }
+        parent->kids[parent->nkids++] = node;
+        if (S_ISDIR(mode)) {
+            parent->st.st_nlink++;
+        }
+        parent->st.st_mtim = now;
+        parent->st.st_ctim = now;
+        node->parent = parent;
+    } else {
+        node->parent = node;
+    }
+
+    mock_hash_insert(node);
+    return node;
+}
+
+/* add item with given mode at path, returns NULL with errno set
+ * if the path exists or on error */
+static mock_node* mock_create(const char* path, mode_t mode)
+{
+    char norm[PATH_MAX];
+    if (mock_normalize(path, norm) != 0) {
+        return NULL;
+    }
+    if (mock_find(norm) != NULL) {
+        errno = EEXIST;
+        return NULL;
+    }
+    return mock_add(norm, mode);
+}
+
+/* drop item from the tree, its memory is released now or on last close */
+static void mock_delete(mock_node* node)
+{
+    struct timespec now;
+    mock_now(&now);
+
+    mock_node* parent = node->parent;
+    uint64_t i;
+    for (i = 0; i < parent->nkids; i++) {
+        if (parent->kids[i] == node) {
+            memmove(&parent->kids[i], &parent->kids[i + 1],
+                (parent->nkids - i - 1) * sizeof(mock_node*));
+            parent->nkids--;
+            break;
+        }
+    }
+    if (S_ISDIR(node->st.st_mode)) {
+        parent->st.st_nlink--;
+    }
+    parent->st.st_mtim = now;
+    parent->st.st_ctim = now;
+
+    mock_hash_remove(node);
+    if (node->opens > 0) {
+        node->removed = 1;
+        node->st.st_nlink = 0;
+        return;
+    }
+    mock_free_node(node);
+}
+
+/* set size of a regular file, zero filling any bytes it grows by,
+ * returns 0 on success and -1 with errno set to ENOSPC if the rank
+ * would hold more than its capacity */
+static int mock_resize(mock_node* node, uint64_t size)
+{
+    uint64_t old = (uint64_t) node->st.st_size;
+    if (size > old && mock_capacity > 0 && mock_used + (size - old) > mock_capacity) {
+        mock_stats[MOCK_ENOSPC]++;
+        errno = ENOSPC;
+        return -1;
+    }
+
+    if (size > node->cap) {
+        size_t cap = (node->cap * 2 > size) ? node->cap * 2 : (size_t) size;
+        node->data = (char*) realloc(node->data, cap);
+        if (node->data == NULL) {
+            MFU_ABORT(-1, "Failed to allocate %llu bytes for mock file `%s'",
+                (unsigned long long) cap, node->path);
+        }
+        node->cap = cap;
+    }
+    if (size > old) {
+        memset(node->data + old, 0, (size_t) (size - old));
+    }
+
+    mock_used = mock_used - old + size;
+    node->st.st_size   = (off_t) size;
+    node->st.st_blocks = (blkcnt_t) ((size + 511) / 512);
+    return 0;
+}
+
+/* delay a call and decide whether it fails, io is set for reads and
+ * writes, returns 0 if the call should go ahead and -1 with errno set
+ * otherwise, a call that fails with EINTR or EIO is retried by the
+ * mfu_file_* wrapper in mfu_io.c, just as it would be on a real file system */
+static int mock_begin(int io)
+{
+    mock_stats[MOCK_CALLS]++;
+    if (mock_latency > 0) {
+        usleep((useconds_t) mock_latency);
+    }
+
+    if (mock_eintr > 0 && mock_stats[MOCK_CALLS] % mock_eintr == 0) {
+        mock_stats[MOCK_EINTR]++;
+        errno = EINTR;
+        return -1;
+    }
+    if (io) {
+        mock_ios++;
+        if (mock_eio > 0 && mock_ios % mock_eio == 0) {
+            mock_stats[MOCK_EIO]++;
+            errno = EIO;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* returns number of bytes a read or write of size bytes should move */
+static size_t mock_short_size(size_t size)
+{
+    if (mock_short > 0 && size > 1 && mock_ios % mock_short == 0) {
+        mock_stats[MOCK_SHORT]++;
+        return size / 2;
+    }
+    return size;
+}
+
+/* hold the caller as long as moving bytes takes at the configured bandwidth */
+static void mock_transfer(size_t bytes)
+{
+    mock_stats[MOCK_BYTES] += (uint64_t) bytes;
+    if (mock_bandwidth <= 0.0) {
+        return;
+    }
+
+    double now = MPI_Wtime();
+    if (mock_busy < now) {
+        mock_busy = now;
+    }
+    mock_busy += (double) bytes / mock_bandwidth;
+
+    double secs = mock_busy - now;
+    struct timespec ts;
+    ts.tv_sec  = (time_t) secs;
+    ts.tv_nsec = (long) ((secs - (double) ts.tv_sec) * 1.0e9);
+    nanosleep(&ts, NULL);
+}
+
+/* look up open file for descriptor, returns NULL with errno set if not open */
+static mock_fd* mock_fd_get(int fd)
+{
+    int i = fd - MOCK_FD_BASE;
+    if (i < 0 || i >= mock_nfds || mock_fds[i].node == NULL) {
+        errno = EBADF;
+        return NULL;
+    }
+    return &mock_fds[i];
+}
+
+/* copy bytes of a regular file starting at offset into buf */
+static ssize_t mock_read_node(mock_node* node, void* buf, size_t size, off_t offset)
+{
+    if (S_ISDIR(node->st.st_mode)) {
+        errno = EISDIR;
+        return -1;
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size = mock_short_size(size);
+    uint64_t filesize = (uint64_t) node->st.st_size;
+    if ((uint64_t) offset >= filesize) {
+        return 0;
+    }
+    if ((uint64_t) offset + size > filesize) {
+        size = (size_t) (filesize - (uint64_t) offset);
+    }
+
+    memcpy(buf, node->data + offset, size);
+    mock_transfer(size);
+    return (ssize_t) size;
+}
+
+/* copy bytes from buf into a regular file starting at offset,
+ * writes as much as fits if the rank is nearly full */
+static ssize_t mock_write_node(mock_node* node, const void* buf, size_t size, off_t offset)
+{
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size = mock_short_size(size);
+    uint64_t end = (uint64_t) offset + size;
+    uint64_t filesize = (uint64_t) node->st.st_size;
+    if (end > filesize && mock_capacity > 0) {
+        uint64_t room = (mock_capacity > mock_used) ? mock_capacity - mock_used : 0;
+        if (end - filesize > room) {
+            end = filesize + room;
+            if (end <= (uint64_t) offset) {
+                mock_stats[MOCK_ENOSPC]++;
+                errno = ENOSPC;
+                return -1;
+            }
+            size = (size_t) (end - (uint64_t) offset);
+        }
+    }
+    if (end > filesize && mock_resize(node, end) != 0) {
+        return -1;
+    }
+
+    memcpy(node->data + offset, buf, size);
+    mock_now(&node->st.st_mtim);
+    node->st.st_ctim = node->st.st_mtim;
+    mock_transfer(size);
+    return (ssize_t) size;
+}
+
+/* copy attributes and contents of the item at path on the real
+ * file system into memory, recursing into directories */
+static int mock_load_item(const char* path)
+{
+    struct stat st;
+    if (mfu_lstat(path, &st) != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to stat `%s' (errno=%d %s)",
+            path, errno, strerror(errno));
+        return MFU_FAILURE;
+    }
+
+    int rc = MFU_SUCCESS;
+
+    mock_node* node = mock_find(path);
+    if (node == NULL) {
+        node = mock_add(path, st.st_mode);
+        if (node == NULL) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to add `%s' to mock file system (errno=%d %s)",
+                path, errno, strerror(errno));
+            return MFU_FAILURE;
+        }
+    }
+
+    if (S_ISREG(st.st_mode)) {
+        mock_resize(node, (uint64_t) st.st_size);
+        int fd = mfu_open(path, O_RDONLY);
+        if (fd < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
+                path, errno, strerror(errno));
+            return MFU_FAILURE;
+        }
+        off_t pos = 0;
+        while (pos < st.st_size) {
+            ssize_t n = mfu_read(path, fd, node->data + pos, (size_t) (st.st_size - pos));
+            if (n <= 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to read `%s'", path);
+                rc = MFU_FAILURE;
+                break;
+            }
+            pos += n;
+        }
+        mfu_close(path, fd);
+    } else if (S_ISLNK(st.st_mode)) {
+        char target[PATH_MAX + 1];
+        ssize_t n = mfu_readlink(path, target, sizeof(target) - 1);
+        if (n < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to read link `%s' (errno=%d %s)",
+                path, errno, strerror(errno));
+            return MFU_FAILURE;
+        }
+        target[n] = '\0';
+        node->target = MFU_STRDUP(target);
+        node->st.st_size = (off_t) n;
+    } else if (S_ISDIR(st.st_mode)) {
+        DIR* dirp = mfu_opendir(path);
+        if (dirp == NULL) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open directory `%s' (errno=%d %s)",
+                path, errno, strerror(errno));
+            return MFU_FAILURE;
+        }
+        struct dirent* entry;
+        while ((entry = mfu_readdir(dirp)) != NULL) {
+            const char* name = entry->d_name;
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+                continue;
+            }
+            char* child = MFU_STRDUPF("%s/%s", (strcmp(path, "/") == 0) ? "" : path, name);
+            if (mock_load_item(child) != MFU_SUCCESS) {
+                rc = MFU_FAILURE;
+            }
+            mfu_free(&child);
+        }
+        mfu_closedir(dirp);
+    }
+
+    /* set attributes last, since adding items changes times of a directory */
+    node->st.st_mode = st.st_mode;
+    node->st.st_uid  = st.st_uid;
+    node->st.st_gid  = st.st_gid;
+    node->st.st_rdev = st.st_rdev;
+    node->st.st_atim = st.st_atim;
+    node->st.st_mtim = st.st_mtim;
+    node->st.st_ctim = st.st_ctim;
+
+    return rc;
+}
+
+/* copy the tree at path on the real file system into memory,
+ * along with the directories above it */
+static int mock_load(const char* path)
+{
+    char real[PATH_MAX];
+    if (realpath(path, real) == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to resolve `%s' (errno=%d %s)",
+            path, errno, strerror(errno));
+        return MFU_FAILURE;
+    }
+
+    /* copy attributes of each directory above the tree */
+    char* slash = real;
+    while ((slash = strchr(slash + 1, '/')) != NULL) {
+        *slash = '\0';
+        struct stat st;
+        if (mfu_lstat(real, &st) == 0) {
+            mock_node* node = mock_find(real);
+            if (node == NULL) {
+                node = mock_add(real, st.st_mode);
+            }
+            if (node != NULL) {
+                node->st.st_mode = st.st_mode;
+                node->st.st_uid  = st.st_uid;
+                node->st.st_gid  = st.st_gid;
+            }
+        }
+        *slash = '/';
+    }
+
+    return mock_load_item(real);
+}
+
+/* parse MFU_MOCK_FAULTS, returns MFU_SUCCESS if all entries are known */
+static int mock_parse_faults(const char* value)
+{
+    int rc = MFU_SUCCESS;
+
+    char* list = MFU_STRDUP(value);
+    char* saveptr;
+    char* tok = strtok_r(list, ",", &saveptr);
+    while (tok != NULL) {
+        char* sep = strchr(tok, ':');
+        unsigned long long n = 0;
+        if (sep == NULL || mfu_abtoull(sep + 1, &n) != MFU_SUCCESS || n == 0) {
+            rc = MFU_FAILURE;
+        } else {
+            *sep = '\0';
+            if (strcmp(tok, "eintr") == 0) {
+                mock_eintr = (uint64_t) n;
+            } else if (strcmp(tok, "eio") == 0) {
+                mock_eio = (uint64_t) n;
+            } else if (strcmp(tok, "short") == 0) {
+                mock_short = (uint64_t) n;
+            } else if (strcmp(tok, "enospc") == 0) {
+                mock_capacity = (uint64_t) n;
+            } else {
+                *sep = ':';
+                rc = MFU_FAILURE;
+            }
+        }
+        if (rc != MFU_SUCCESS) {
+            if (mfu_rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Invalid fault in MFU_MOCK_FAULTS: `%s'", tok);
+            }
+            break;
+        }
+        tok = strtok_r(NULL, ",", &saveptr);
+    }
+    mfu_free(&list);
+
+    return rc;
+}
+
+void mfu_mock_init(void)
+{
+    const char* seed = getenv("MFU_MOCK_FS");
+    if (seed == NULL) {
+        return;
+    }
+    mfu_mock_enabled = 1;
+
+    mock_umask = umask(0);
+    umask(mock_umask);
+
+    memset(mock_stats, 0, sizeof(mock_stats));
+    mock_buckets = 1024;
+    mock_table = (mock_node**) MFU_CALLOC(mock_buckets, sizeof(mock_node*));
+    mock_add("/", S_IFDIR | 0755);
+
+    const char* value = getenv("MFU_MOCK_LATENCY");
+    if (value != NULL) {
+        mock_latency = strtoul(value, NULL, 10);
+    }
+
+    value = getenv("MFU_MOCK_BANDWIDTH");
+    if (value != NULL && value[0] != '\0') {
+        unsigned long long bytes;
+        if (mfu_abtoull(value, &bytes) == MFU_SUCCESS) {
+            mock_bandwidth = (double) bytes;
+        } else if (mfu_rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Invalid MFU_MOCK_BANDWIDTH: `%s'", value);
+        }
+    }
+
+    value = getenv("MFU_MOCK_FAULTS");
+    if (value != NULL && value[0] != '\0') {
+        if (mock_parse_faults(value) != MFU_SUCCESS) {
+            MFU_ABORT(-1, "Invalid MFU_MOCK_FAULTS: `%s'", value);
+        }
+    }
+
+    /* load the tree without delays, faults, or a capacity limit */
+    if (seed[0] != '\0') {
+        uint64_t capacity = mock_capacity;
+        mock_capacity = 0;
+        if (mock_load(seed) != MFU_SUCCESS) {
+            MFU_ABORT(-1, "Failed to load `%s' into mock file system", seed);
+        }
+        mock_capacity = capacity;
+    }
+}
+
+void mfu_mock_finalize(void)
+{
+    if (! mfu_mock_enabled) {
+        return;
+    }
+
+    uint64_t total[MOCK_STATS];
+    MPI_Reduce(mock_stats, total, MOCK_STATS, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Mock file system: %llu calls, %llu bytes read or written",
+            (unsigned long long) total[MOCK_CALLS],
+            (unsigned long long) total[MOCK_BYTES]);
+        MFU_LOG(MFU_LOG_INFO, "Mock faults: %llu EINTR, %llu EIO, %llu short, %llu ENOSPC",
+            (unsigned long long) total[MOCK_EINTR],
+            (unsigned long long) total[MOCK_EIO],
+            (unsigned long long) total[MOCK_SHORT],
+            (unsigned long long) total[MOCK_ENOSPC]);
+    }
+
+    /* free items still open, then everything in the tree */
+    int i;
+    for (i = 0; i < mock_nfds; i++) {
+        mock_node* node = mock_fds[i].node;
+        if (node != NULL) {
+            node->opens--;
+            if (node->removed && node->opens == 0) {
+                mock_free_node(node);
+            }
+        }
+    }
+    mfu_free(&mock_fds);
+    mock_nfds = 0;
+
+    uint64_t b;
+    for (b = 0; b < mock_buckets; b++) {
+        mock_node* node = mock_table[b];
+        while (node != NULL) {
+            mock_node* next = node->next;
+            mock_free_node(node);
+            node = next;
+        }
+    }
+    mfu_free(&mock_table);
+    mock_buckets = 0;
+    mock_items   = 0;
+
+    mfu_mock_enabled = 0;
+}
+
+/* returns 0 if the caller may access item as amode asks */
+static int mock_check_access(mock_node* node, int amode)
+{
+    if (amode == F_OK || geteuid() == 0) {
+        return 0;
+    }
+
+    mode_t mode = node->st.st_mode;
+    int bits;
+    if (node->st.st_uid == geteuid()) {
+        bits = (mode >> 6) & 7;
+    } else if (node->st.st_gid == getegid()) {
+        bits = (mode >> 3) & 7;
+    } else {
+        bits = mode & 7;
+    }
+    if ((amode & bits) != amode) {
+        errno = EACCES;
+        return -1;
+    }
+    return 0;
+}
+
+int mock_access(const char* path, int amode, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 1);
+    if (node == NULL) {
+        return -1;
+    }
+    return mock_check_access(node, amode);
+}
+
+int mock_faccessat(int dirfd, const char* path, int amode, int flags, mfu_file_t* mfu_file)
+{
+    /* only the current working directory is supported */
+    if (dirfd != AT_FDCWD) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, ! (flags & AT_SYMLINK_NOFOLLOW));
+    if (node == NULL) {
+        return -1;
+    }
+    return mock_check_access(node, amode);
+}
+
+int mock_lchown(const char* path, uid_t owner, gid_t group, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 0);
+    if (node == NULL) {
+        return -1;
+    }
+    if (owner != (uid_t) -1) {
+        node->st.st_uid = owner;
+    }
+    if (group != (gid_t) -1) {
+        node->st.st_gid = group;
+    }
+    mock_now(&node->st.st_ctim);
+    return 0;
+}
+
+int mock_chmod(const char* path, mode_t mode, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 1);
+    if (node == NULL) {
+        return -1;
+    }
+    node->st.st_mode = (node->st.st_mode & S_IFMT) | (mode & 07777);
+    mock_now(&node->st.st_ctim);
+    return 0;
+}
+
+int mock_utimensat(int dirfd, const char* pathname, const struct timespec times[2], int flags,
+                   mfu_file_t* mfu_file)
+{
+    /* only the current working directory is supported */
+    if (dirfd != AT_FDCWD) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(pathname, ! (flags & AT_SYMLINK_NOFOLLOW));
+    if (node == NULL) {
+        return -1;
+    }
+
+    struct timespec now;
+    mock_now(&now);
+    if (times == NULL) {
+        node->st.st_atim = now;
+        node->st.st_mtim = now;
+    } else {
+        if (times[0].tv_nsec != UTIME_OMIT) {
+            node->st.st_atim = (times[0].tv_nsec == UTIME_NOW) ? now : times[0];
+        }
+        if (times[1].tv_nsec != UTIME_OMIT) {
+            node->st.st_mtim = (times[1].tv_nsec == UTIME_NOW) ? now : times[1];
+        }
+    }
+    node->st.st_ctim = now;
+    return 0;
+}
+
+int mock_stat(const char* path, struct stat* buf, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 1);
+    if (node == NULL) {
+        return -1;
+    }
+    *buf = node->st;
+    return 0;
+}
+
+int mock_lstat(const char* path, struct stat* buf, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 0);
+    if (node == NULL) {
+        return -1;
+    }
+    *buf = node->st;
+    return 0;
+}
+
+int mock_mknod(const char* path, mode_t mode, dev_t dev, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    if ((mode & S_IFMT) == 0) {
+        mode |= S_IFREG;
+    }
+    if (S_ISDIR(mode) || S_ISLNK(mode)) {
+        errno = EINVAL;
+        return -1;
+    }
+    mock_node* node = mock_create(path, (mode & S_IFMT) | (mode & 07777 & ~mock_umask));
+    if (node == NULL) {
+        return -1;
+    }
+    node->st.st_rdev = dev;
+    return 0;
+}
+
+int mock_remove(const char* path, mfu_file_t* mfu_file)
+{
+    mock_node* node = mock_lookup(path, 0);
+    if (node != NULL && S_ISDIR(node->st.st_mode)) {
+        return mock_rmdir(path, mfu_file);
+    }
+    return mock_unlink(path, mfu_file);
+}
+
+char* mock_realpath(const char* path, char* resolved_path, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return NULL;
+    }
+    mock_node* node = mock_lookup(path, 1);
+    if (node == NULL) {
+        return NULL;
+    }
+    if (resolved_path == NULL) {
+        return strdup(node->path);
+    }
+    strcpy(resolved_path, node->path);
+    return resolved_path;
+}
+
+ssize_t mock_readlink(const char* path, char* buf, size_t bufsize, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 0);
+    if (node == NULL) {
+        return -1;
+    }
+    if (! S_ISLNK(node->st.st_mode)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* like readlink, the target is truncated and not terminated */
+    size_t len = strlen(node->target);
+    if (len > bufsize) {
+        len = bufsize;
+    }
+    memcpy(buf, node->target, len);
+    return (ssize_t) len;
+}
+
+int mock_symlink(const char* oldpath, const char* newpath, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_create(newpath, S_IFLNK | 0777);
+    if (node == NULL) {
+        return -1;
+    }
+    node->target = MFU_STRDUP(oldpath);
+    node->st.st_size = (off_t) strlen(oldpath);
+    return 0;
+}
+
+int mock_open(const char* file, int flags, mode_t mode, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+
+    int accmode = flags & O_ACCMODE;
+    mock_node* node = mock_lookup(file, ! (flags & O_NOFOLLOW));
+    if (node == NULL) {
+        if (errno != ENOENT) {
+            return -1;
+        }
+
+        /* another rank may have created a file we are asked to write,
+         * so create it in our tree as well */
+        if ((! (flags & O_CREAT) && accmode == O_RDONLY) || (flags & O_DIRECTORY)) {
+            return -1;
+        }
+        if (! (flags & O_CREAT)) {
+            mode = 0666;
+        }
+        node = mock_create(file, S_IFREG | (mode & 07777 & ~mock_umask));
+        if (node == NULL) {
+            return -1;
+        }
+    } else {
+        if ((flags & O_CREAT) && (flags & O_EXCL)) {
+            errno = EEXIST;
+            return -1;
+        }
+        if (S_ISLNK(node->st.st_mode)) {
+            errno = ELOOP;
+            return -1;
+        }
+        if ((flags & O_DIRECTORY) && ! S_ISDIR(node->st.st_mode)) {
+            errno = ENOTDIR;
+            return -1;
+        }
+        if (S_ISDIR(node->st.st_mode) && accmode != O_RDONLY) {
+            errno = EISDIR;
+            return -1;
+        }
+        if ((flags & O_TRUNC) && accmode != O_RDONLY && S_ISREG(node->st.st_mode)) {
+            mock_resize(node, 0);
+            mock_now(&node->st.st_mtim);
+            node->st.st_ctim = node->st.st_mtim;
+        }
+    }
+
+    /* take the first free slot in the table of open files */
+    int i;
+    for (i = 0; i < mock_nfds; i++) {
+        if (mock_fds[i].node == NULL) {
+            break;
+        }
+    }
+    if (i == mock_nfds) {
+        int nfds = (mock_nfds > 0) ? mock_nfds * 2 : 64;
+        mock_fds = (mock_fd*) realloc(mock_fds, (size_t) nfds * sizeof(mock_fd));
+        if (mock_fds == NULL) {
+            MFU_ABORT(-1, "Failed to allocate table of mock open files");
+        }
+        memset(&mock_fds[mock_nfds], 0, (size_t) (nfds - mock_nfds) * sizeof(mock_fd));
+        mock_nfds = nfds;
+    }
+
+    mock_fds[i].node  = node;
+    mock_fds[i].flags = flags;
+    mock_fds[i].pos   = 0;
+    node->opens++;
+    return MOCK_FD_BASE + i;
+}
+
+int mock_close(const char* file, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_fd* f = mock_fd_get(mfu_file->fd);
+    if (f == NULL) {
+        return -1;
+    }
+
+    mock_node* node = f->node;
+    f->node = NULL;
+    node->opens--;
+    if (node->removed && node->opens == 0) {
+        mock_free_node(node);
+    }
+    mfu_file->fd = -1;
+    return 0;
+}
+
+off_t mock_lseek(const char* file, mfu_file_t* mfu_file, off_t pos, int whence)
+{
+    if (mock_begin(0) != 0) {
+        return (off_t) -1;
+    }
+    mock_fd* f = mock_fd_get(mfu_file->fd);
+    if (f == NULL) {
+        return (off_t) -1;
+    }
+
+    /* files have no holes, so all of a file is data */
+    off_t size = f->node->st.st_size;
+    off_t newpos;
+    switch (whence) {
+    case SEEK_SET:
+        newpos = pos;
+        break;
+    case SEEK_CUR:
+        newpos = f->pos + pos;
+        break;
+    case SEEK_END:
+        newpos = size + pos;
+        break;
+#ifdef SEEK_DATA
+    case SEEK_DATA:
+    case SEEK_HOLE:
+        if (pos < 0 || pos >= size) {
+            errno = ENXIO;
+            return (off_t) -1;
+        }
+        newpos = (whence == SEEK_DATA) ? pos : size;
+        break;
+#endif
+    default:
+        errno = EINVAL;
+        return (off_t) -1;
+    }
+    if (newpos < 0) {
+        errno = EINVAL;
+        return (off_t) -1;
+    }
+
+    f->pos = newpos;
+    return newpos;
+}
+
+ssize_t mock_read(const char* file, void* buf, size_t size, mfu_file_t* mfu_file)
+{
+    if (mock_begin(1) != 0) {
+        return -1;
+    }
+    mock_fd* f = mock_fd_get(mfu_file->fd);
+    if (f == NULL) {
+        return -1;
+    }
+    if ((f->flags & O_ACCMODE) == O_WRONLY) {
+        errno = EBADF;
+        return -1;
+    }
+
+    ssize_t n = mock_read_node(f->node, buf, size, f->pos);
+    if (n > 0) {
+        f->pos += n;
+    }
+    return n;
+}
+
+/* like write, this may write fewer bytes than asked for, and
+ * mfu_file_write calls again for the rest */
+ssize_t mock_write(const char* file, const void* buf, size_t size, mfu_file_t* mfu_file)
+{
+    if (mock_begin(1) != 0) {
+        return -1;
+    }
+    mock_fd* f = mock_fd_get(mfu_file->fd);
+    if (f == NULL) {
+        return -1;
+    }
+    if ((f->flags & O_ACCMODE) == O_RDONLY) {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (f->flags & O_APPEND) {
+        f->pos = f->node->st.st_size;
+    }
+    ssize_t n = mock_write_node(f->node, buf, size, f->pos);
+    if (n > 0) {
+        f->pos += n;
+    }
+    return n;
+}
+
+ssize_t mock_pread(const char* file, void* buf, size_t size, off_t offset, mfu_file_t* mfu_file)
+{
+    if (mock_begin(1) != 0) {
+        return -1;
+    }
+    mock_fd* f = mock_fd_get(mfu_file->fd);
+    if (f == NULL) {
+        return -1;
+    }
+    if ((f->flags & O_ACCMODE) == O_WRONLY) {
+        errno = EBADF;
+        return -1;
+    }
+    return mock_read_node(f->node, buf, size, offset);
+}
+
+ssize_t mock_pwrite(const char* file, const void* buf, size_t size, off_t offset, mfu_file_t* mfu_file)
+{
+    if (mock_begin(1) != 0) {
+        return -1;
+    }
+    mock_fd* f = mock_fd_get(mfu_file->fd);
+    if (f == NULL) {
+        return -1;
+    }
+    if ((f->flags & O_ACCMODE) == O_RDONLY) {
+        errno = EBADF;
+        return -1;
+    }
+    return mock_write_node(f->node, buf, size, offset);
+}
+
+/* set size of regular file */
+static int mock_truncate_node(mock_node* node, off_t length)
+{
+    if (S_ISDIR(node->st.st_mode)) {
+        errno = EISDIR;
+        return -1;
+    }
+    if (length < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (mock_resize(node, (uint64_t) length) != 0) {
+        return -1;
+    }
+    mock_now(&node->st.st_mtim);
+    node->st.st_ctim = node->st.st_mtim;
+    return 0;
+}
+
+int mock_truncate(const char* file, off_t length, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(file, 1);
+    if (node == NULL) {
+        return -1;
+    }
+    return mock_truncate_node(node, length);
+}
+
+int mock_ftruncate(mfu_file_t* mfu_file, off_t length)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_fd* f = mock_fd_get(mfu_file->fd);
+    if (f == NULL) {
+        return -1;
+    }
+    return mock_truncate_node(f->node, length);
+}
+
+int mock_unlink(const char* file, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(file, 0);
+    if (node == NULL) {
+        return -1;
+    }
+    if (S_ISDIR(node->st.st_mode)) {
+        errno = EISDIR;
+        return -1;
+    }
+    mock_delete(node);
+    return 0;
+}
+
+int mock_mkdir(const char* dir, mode_t mode, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_create(dir, S_IFDIR | (mode & 07777 & ~mock_umask));
+    if (node == NULL) {
+        return -1;
+    }
+    return 0;
+}
+
+int mock_rmdir(const char* dir, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(dir, 0);
+    if (node == NULL) {
+        return -1;
+    }
+    if (! S_ISDIR(node->st.st_mode)) {
+        errno = ENOTDIR;
+        return -1;
+    }
+    if (node->parent == node) {
+        errno = EBUSY;
+        return -1;
+    }
+    if (node->nkids > 0) {
+        errno = ENOTEMPTY;
+        return -1;
+    }
+    mock_delete(node);
+    return 0;
+}
+
+DIR* mock_opendir(const char* dir, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return NULL;
+    }
+    mock_node* node = mock_lookup(dir, 1);
+    if (node == NULL) {
+        return NULL;
+    }
+    if (! S_ISDIR(node->st.st_mode)) {
+        errno = ENOTDIR;
+        return NULL;
+    }
+
+    /* look the directory up by path on each read,
+     * since it may be removed while open */
+    mock_dir* d = (mock_dir*) MFU_CALLOC(1, sizeof(mock_dir));
+    d->path = MFU_STRDUP(node->path);
+    d->pos  = 0;
+    return (DIR*) d;
+}
+
+int mock_closedir(DIR* dirp, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_dir* d = (mock_dir*) dirp;
+    mfu_free(&d->path);
+    mfu_free(&d);
+    return 0;
+}
+
+struct dirent* mock_readdir(DIR* dirp, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return NULL;
+    }
+    mock_dir* d = (mock_dir*) dirp;
+    mock_node* node = mock_find(d->path);
+    if (node == NULL) {
+        /* directory was removed, so it is empty */
+        errno = 0;
+        return NULL;
+    }
+
+    /* list . and .. before the items in the directory */
+    const char* name;
+    mock_node* item;
+    if (d->pos == 0) {
+        name = ".";
+        item = node;
+    } else if (d->pos == 1) {
+        name = "..";
+        item = node->parent;
+    } else if (d->pos - 2 < node->nkids) {
+        item = node->kids[d->pos - 2];
+        name = strrchr(item->path, '/') + 1;
+    } else {
+        errno = 0;
+        return NULL;
+    }
+
+    struct dirent* entry = &d->entry;
+    entry->d_ino    = item->st.st_ino;
+    entry->d_off    = (off_t) d->pos;
+    entry->d_reclen = sizeof(struct dirent);
+    entry->d_type   = IFTODT(item->st.st_mode);
+    strncpy(entry->d_name, name, sizeof(entry->d_name) - 1);
+    entry->d_name[sizeof(entry->d_name) - 1] = '\0';
+    d->pos++;
+    return entry;
+}
+
+/* copy names of extended attributes of item into list, each followed
+ * by a NUL, returns size of list or the size needed if size is 0 */
+static ssize_t mock_list_node(mock_node* node, char* list, size_t size)
+{
+    size_t len = 0;
+    mock_xattr* x;
+    for (x = node->xattrs; x != NULL; x = x->next) {
+        len += strlen(x->name) + 1;
+    }
+    if (size == 0) {
+        return (ssize_t) len;
+    }
+    if (len > size) {
+        errno = ERANGE;
+        return -1;
+    }
+
+    char* p = list;
+    for (x = node->xattrs; x != NULL; x = x->next) {
+        size_t n = strlen(x->name) + 1;
+        memcpy(p, x->name, n);
+        p += n;
+    }
+    return (ssize_t) len;
+}
+
+/* copy value of named extended attribute of item into value,
+ * returns size of value or the size needed if size is 0 */
+static ssize_t mock_get_node(mock_node* node, const char* name, void* value, size_t size)
+{
+    mock_xattr* x = node->xattrs;
+    while (x != NULL && strcmp(x->name, name) != 0) {
+        x = x->next;
+    }
+    if (x == NULL) {
+        errno = ENODATA;
+        return -1;
+    }
+    if (size == 0) {
+        return (ssize_t) x->size;
+    }
+    if (x->size > size) {
+        errno = ERANGE;
+        return -1;
+    }
+    memcpy(value, x->value, x->size);
+    return (ssize_t) x->size;
+}
+
+ssize_t mock_llistxattr(const char* path, char* list, size_t size, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 0);
+    if (node == NULL) {
+        return -1;
+    }
+    return mock_list_node(node, list, size);
+}
+
+ssize_t mock_listxattr(const char* path, char* list, size_t size, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 1);
+    if (node == NULL) {
+        return -1;
+    }
+    return mock_list_node(node, list, size);
+}
+
+ssize_t mock_lgetxattr(const char* path, const char* name, void* value, size_t size, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 0);
+    if (node == NULL) {
+        return -1;
+    }
+    return mock_get_node(node, name, value, size);
+}
+
+ssize_t mock_getxattr(const char* path, const char* name, void* value, size_t size, mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 1);
+    if (node == NULL) {
+        return -1;
+    }
+    return mock_get_node(node, name, value, size);
+}
+
+int mock_lsetxattr(const char* path, const char* name, const void* value, size_t size, int flags,
+                   mfu_file_t* mfu_file)
+{
+    if (mock_begin(0) != 0) {
+        return -1;
+    }
+    mock_node* node = mock_lookup(path, 0);
+    if (node == NULL) {
+        return -1;
+    }
+
+    mock_xattr* x = node->xattrs;
+    while (x != NULL && strcmp(x->name, name) != 0) {
+        x = x->next;
+    }
+    if (x != NULL && (flags & XATTR_CREATE)) {
+        errno = EEXIST;
+        return -1;
+    }
+    if (x == NULL && (flags & XATTR_REPLACE)) {
+        errno = ENODATA;
+        return -1;
+    }
+
+    if (x == NULL) {
+        /* append so attributes are listed in the order they were set */
+        x = (mock_xattr*) MFU_CALLOC(1, sizeof(mock_xattr));
+        x->name = MFU_STRDUP(name);
+        mock_xattr** p = &node->xattrs;
+        while (*p != NULL) {
+            p = &(*p)->next;
+        }
+        *p = x;
+    }
+    mfu_free(&x->value);
+    x->value = MFU_MALLOC(size);
+    if (size > 0) {
+        memcpy(x->value, value, size);
+    }
+    x->size = size;
+    mock_now(&node->st.st_ctim);
+    return 0;
+}
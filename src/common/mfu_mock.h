@@ -0,0 +1,104 @@
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MFU_MOCK_H
+#define MFU_MOCK_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include "mfu_param_path.h"
+
+/* In-memory file system for testing and benchmarking tools without
+ * real storage.
+ *
+ * The mock is off unless MFU_MOCK_FS is set in the environment, in
+ * which case mfu_file_new returns handles of type MOCK and tools read
+ * and write a tree held in memory through the mfu_file_* calls.  The
+ * value names a directory on the real file system that is copied into
+ * memory by every rank in mfu_init, along with the directories above
+ * it, so paths are the same in both.  An empty value starts with only
+ * the root directory.
+ *
+ * Each rank holds its own tree.  Since one rank may create a file that
+ * others write, opening a missing file for writing creates it, and
+ * creating an item creates any missing parent directories.  Only a
+ * symlink in the last component of a path is followed.
+ *
+ * Calls are delayed and fail as configured by:
+ *
+ *   MFU_MOCK_LATENCY=<usecs>  - time added to every call
+ *   MFU_MOCK_BANDWIDTH=<size> - bytes each rank reads or writes per
+ *                               second, e.g., 100MB, unlimited if unset
+ *   MFU_MOCK_FAULTS=<list>    - comma-separated list of
+ *       eintr:N   - every Nth call fails with EINTR
+ *       eio:N     - every Nth read or write fails with EIO
+ *       short:N   - every Nth read or write moves half the bytes asked for
+ *       enospc:S  - writes fail with ENOSPC once files on a rank hold S bytes
+ *
+ * Faults are counted per rank, so a run is repeatable.  The mock_*
+ * calls return each fault, and the mfu_file_* wrappers in mfu_io retry
+ * EINTR and EIO a few times, as they would for a real file system,
+ * before the error reaches the tool.  The number of calls, bytes,
+ * and faults across ranks is logged by rank 0 at MFU_LOG_INFO in
+ * mfu_finalize. */
+
+/* nonzero when MFU_MOCK_FS is set */
+extern int mfu_mock_enabled;
+
+/* read settings from the environment and load the initial tree,
+ * called by mfu_init */
+void mfu_mock_init(void);
+
+/* log counts across ranks and free the tree, must be called by
+ * all ranks, called by mfu_finalize before the library shuts down */
+void mfu_mock_finalize(void);
+
+/* Called by the mfu_file_* functions for handles of type MOCK, each
+ * follows the convention of the POSIX call it is named after.  The
+ * descriptor of an open file is kept in mfu_file->fd, it is not a
+ * valid POSIX descriptor. */
+int mock_access(const char* path, int amode, mfu_file_t* mfu_file);
+int mock_faccessat(int dirfd, const char* path, int amode, int flags, mfu_file_t* mfu_file);
+int mock_lchown(const char* path, uid_t owner, gid_t group, mfu_file_t* mfu_file);
+int mock_chmod(const char* path, mode_t mode, mfu_file_t* mfu_file);
+int mock_utimensat(int dirfd, const char* pathname, const struct timespec times[2], int flags,
+                   mfu_file_t* mfu_file);
+int mock_stat(const char* path, struct stat* buf, mfu_file_t* mfu_file);
+int mock_lstat(const char* path, struct stat* buf, mfu_file_t* mfu_file);
+int mock_mknod(const char* path, mode_t mode, dev_t dev, mfu_file_t* mfu_file);
+int mock_remove(const char* path, mfu_file_t* mfu_file);
+char* mock_realpath(const char* path, char* resolved_path, mfu_file_t* mfu_file);
+ssize_t mock_readlink(const char* path, char* buf, size_t bufsize, mfu_file_t* mfu_file);
+int mock_symlink(const char* oldpath, const char* newpath, mfu_file_t* mfu_file);
+int mock_open(const char* file, int flags, mode_t mode, mfu_file_t* mfu_file);
+int mock_close(const char* file, mfu_file_t* mfu_file);
+off_t mock_lseek(const char* file, mfu_file_t* mfu_file, off_t pos, int whence);
+ssize_t mock_read(const char* file, void* buf, size_t size, mfu_file_t* mfu_file);
+ssize_t mock_write(const char* file, const void* buf, size_t size, mfu_file_t* mfu_file);
+ssize_t mock_pread(const char* file, void* buf, size_t size, off_t offset, mfu_file_t* mfu_file);
+ssize_t mock_pwrite(const char* file, const void* buf, size_t size, off_t offset, mfu_file_t* mfu_file);
+int mock_truncate(const char* file, off_t length, mfu_file_t* mfu_file);
+int mock_ftruncate(mfu_file_t* mfu_file, off_t length);
+int mock_unlink(const char* file, mfu_file_t* mfu_file);
+int mock_mkdir(const char* dir, mode_t mode, mfu_file_t* mfu_file);
+int mock_rmdir(const char* dir, mfu_file_t* mfu_file);
+DIR* mock_opendir(const char* dir, mfu_file_t* mfu_file);
+int mock_closedir(DIR* dirp, mfu_file_t* mfu_file);
+struct dirent* mock_readdir(DIR* dirp, mfu_file_t* mfu_file);
+ssize_t mock_llistxattr(const char* path, char* list, size_t size, mfu_file_t* mfu_file);
+ssize_t mock_listxattr(const char* path, char* list, size_t size, mfu_file_t* mfu_file);
+ssize_t mock_lgetxattr(const char* path, const char* name, void* value, size_t size, mfu_file_t* mfu_file);
+ssize_t mock_getxattr(const char* path, const char* name, void* value, size_t size, mfu_file_t* mfu_file);
+int mock_lsetxattr(const char* path, const char* name, const void* value, size_t size, int flags,
+                   mfu_file_t* mfu_file);
+
+#endif /* MFU_MOCK_H */
+
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
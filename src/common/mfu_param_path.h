@@ -54,7 +54,7 @@ typedef struct mfu_param_path_t {
 
 /* options passed to I/O functions that tell them which backend filesystem to use */
 typedef struct {
-    enum                 {POSIX, DFS, DAOS} type;
+    enum                 {POSIX, DFS, DAOS, MOCK} type;
     int                  fd;
 #ifdef DAOS_SUPPORT
     /* DAOS specific variables for I/O */
@@ -144,6 +144,10 @@ typedef struct {
     char*        block_buf2;       /* another buffer to read / write data */
     int          grouplock_id;     /* Lustre grouplock ID */
     uint64_t     batch_files;      /* max batch size to copy files, 0 implies no limit */
+    int          open_files;       /* max files each rank keeps open for reading and for writing */
+    uint64_t     small_file_size;  /* files smaller than this are copied in one pass, 0 disables */
+    int          small_file_window;/* number of small files written before flushing them together */
+    bool         hardlinks;        /* whether to recreate hard links between source files */
 } mfu_copy_opts_t;
 
 /*
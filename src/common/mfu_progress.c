@@ -1,9 +1,54 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 
 #include "mfu.h"
 
+/* file descriptor of progress stream on rank 0, -1 if not open */
+static int mfu_progress_stream_fd = -1;
+
+/* open progress stream named by MFU_PROGRESS_STREAM if not already open,
+ * returns file descriptor or -1 if it can't be opened right now */
+static int mfu_progress_stream_open(void)
+{
+    if (mfu_progress_stream_fd >= 0) {
+        return mfu_progress_stream_fd;
+    }
+
+    const char* path = getenv("MFU_PROGRESS_STREAM");
+    if (path == NULL || path[0] == '\0') {
+        return -1;
+    }
+
+    /* don't block on a FIFO, opening one fails with ENXIO
+     * until there is a reader, so we'll try again next time */
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_NONBLOCK, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0) {
+        if (errno != ENXIO) {
+            MFU_LOG(MFU_LOG_WARN, "Failed to open progress stream `%s' (errno=%d %s)",
+                path, errno, strerror(errno));
+        }
+        return -1;
+    }
+
+    /* a reader of a FIFO may go away, get EPIPE from write
+     * in that case rather than being killed by SIGPIPE */
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode)) {
+        signal(SIGPIPE, SIG_IGN);
+    }
+
+    mfu_progress_stream_fd = fd;
+    return fd;
+}
+
 /* start progress timer */
 mfu_progress* mfu_progress_start(int secs, int count, MPI_Comm comm, mfu_progress_fn progfn)
 {
@@ -26,6 +71,7 @@ mfu_progress* mfu_progress_start(int secs, int count, MPI_Comm comm, mfu_progres
     /* initialize broadcast and reduce requests to NULL */
     prg->bcast_req  = MPI_REQUEST_NULL;
     prg->reduce_req = MPI_REQUEST_NULL;
+    prg->loc_req    = MPI_REQUEST_NULL;
 
     /* we'll keep executing bcast/reduce iterations until
      * all processes call complete */
@@ -48,9 +94,36 @@ mfu_progress* mfu_progress_start(int secs, int count, MPI_Comm comm, mfu_progres
     prg->time_last  = prg->time_start;
     prg->timeout    = (double) secs;
 
-    /* post buffer for incoming bcast */
+    /* rank 0 decides whether to write stream records, so that
+     * all ranks agree on whether to find the slowest rank */
     int rank;
     MPI_Comm_rank(prg->comm, &rank);
+    prg->stream = 0;
+    if (rank == 0) {
+        const char* path = getenv("MFU_PROGRESS_STREAM");
+        prg->stream = (path != NULL && path[0] != '\0');
+    }
+    MPI_Bcast(&prg->stream, 1, MPI_INT, 0, prg->comm);
+
+    /* name values until caller describes them */
+    prg->op          = NULL;
+    prg->names       = NULL;
+    prg->totals      = NULL;
+    prg->stream_vals = NULL;
+    prg->stream_last = prg->time_start;
+    if (prg->stream) {
+        prg->op = MFU_STRDUP("progress");
+        prg->names = (char**) MFU_MALLOC(count * sizeof(char*));
+        prg->stream_vals = (uint64_t*) MFU_CALLOC(count, sizeof(uint64_t));
+        int i;
+        for (i = 0; i < count; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "value%d", i);
+            prg->names[i] = MFU_STRDUP(name);
+        }
+    }
+
+    /* post buffer for incoming bcast */
     if (rank != 0) {
         MPI_Ibcast(&(prg->keep_going), 1, MPI_INT, 0, prg->comm, &(prg->bcast_req));
     }
@@ -72,9 +145,154 @@ static void mfu_progress_reduce(uint64_t complete, uint64_t* vals, mfu_progress*
     /* initiate the reduction */
     MPI_Ireduce(prg->values, prg->global_vals, prg->count + 1,
                 MPI_UINT64_T, MPI_SUM, 0, prg->comm, &(prg->reduce_req));
+
+    /* find the ranks that have made the least and most progress
+     * on the first value for the stream, negating the value lets
+     * a single MINLOC reduction find both */
+    if (prg->stream) {
+        int rank;
+        MPI_Comm_rank(prg->comm, &rank);
+        double value = (prg->count > 0) ? (double) vals[0] : 0.0;
+        prg->loc[0].value = value;
+        prg->loc[0].rank  = rank;
+        prg->loc[1].value = -value;
+        prg->loc[1].rank  = rank;
+        MPI_Ireduce(prg->loc, prg->global_loc, 2,
+                    MPI_DOUBLE_INT, MPI_MINLOC, 0, prg->comm, &(prg->loc_req));
+    }
+}
+
+/* test whether outstanding reductions have completed,
+ * sets flag to 1 if there are none */
+static void mfu_progress_test_reduce(int* flag, mfu_progress* prg)
+{
+    MPI_Request reqs[2];
+    reqs[0] = prg->reduce_req;
+    reqs[1] = prg->loc_req;
+    MPI_Testall(2, reqs, flag, MPI_STATUSES_IGNORE);
+    prg->reduce_req = reqs[0];
+    prg->loc_req    = reqs[1];
+}
+
+/* wait for outstanding reductions to complete */
+static void mfu_progress_wait_reduce(mfu_progress* prg)
+{
+    MPI_Wait(&(prg->reduce_req), MPI_STATUS_IGNORE);
+    MPI_Wait(&(prg->loc_req), MPI_STATUS_IGNORE);
+}
+
+/* append a record of the latest global values to the progress
+ * stream as a JSON object on one line, called by rank 0 */
+static void mfu_progress_stream_write(int done, int ranks, mfu_progress* prg)
+{
+    if (! prg->stream) {
+        return;
+    }
+
+    int fd = mfu_progress_stream_open();
+    if (fd < 0) {
+        return;
+    }
+
+    double now  = MPI_Wtime();
+    double secs = now - prg->time_start;
+    double interval = now - prg->stream_last;
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    double timestamp = (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+
+    /* allocate enough space for the record */
+    size_t bufsize = 512;
+    int i;
+    for (i = 0; i < prg->count; i++) {
+        bufsize += strlen(prg->names[i]) + 160;
+    }
+    bufsize += strlen(prg->op);
+    char* buf = (char*) MFU_MALLOC(bufsize);
+
+    size_t len = 0;
+    len += snprintf(buf + len, bufsize - len,
+        "{\"time\": %.3f, \"op\": \"%s\", \"elapsed\": %.3f, \"done\": %s, \"ranks\": %d, \"complete\": %llu, \"values\": {",
+        timestamp, prg->op, secs, done ? "true" : "false", ranks,
+        (unsigned long long) prg->global_vals[0]);
+
+    /* estimate time left from the first value with a known total */
+    double eta = -1.0;
+    for (i = 0; i < prg->count; i++) {
+        uint64_t sum = prg->global_vals[i + 1];
+        double rate = (interval > 0.0) ? (double) (sum - prg->stream_vals[i]) / interval : 0.0;
+        double avg_rate = (secs > 0.0) ? (double) sum / secs : 0.0;
+        len += snprintf(buf + len, bufsize - len, "%s\"%s\": {\"sum\": %llu, \"rate\": %.3f, \"avg_rate\": %.3f",
+            (i > 0) ? ", " : "", prg->names[i], (unsigned long long) sum, rate, avg_rate);
+        if (prg->totals != NULL) {
+            len += snprintf(buf + len, bufsize - len, ", \"total\": %llu", (unsigned long long) prg->totals[i]);
+            if (eta < 0.0 && avg_rate > 0.0 && prg->totals[i] >= sum) {
+                eta = (double) (prg->totals[i] - sum) / avg_rate;
+            }
+        }
+        len += snprintf(buf + len, bufsize - len, "}");
+        prg->stream_vals[i] = sum;
+    }
+    len += snprintf(buf + len, bufsize - len, "}");
+
+    if (done) {
+        eta = 0.0;
+    }
+    if (eta >= 0.0) {
+        len += snprintf(buf + len, bufsize - len, ", \"eta\": %.3f", eta);
+    } else {
+        len += snprintf(buf + len, bufsize - len, ", \"eta\": null");
+    }
+
+    /* report rank that has made least progress and the one that has made most */
+    len += snprintf(buf + len, bufsize - len,
+        ", \"slowest\": {\"rank\": %d, \"value\": %.0f}, \"fastest\": {\"rank\": %d, \"value\": %.0f}}\n",
+        prg->global_loc[0].rank, prg->global_loc[0].value,
+        prg->global_loc[1].rank, -prg->global_loc[1].value);
+
+    /* drop the record rather than stall the tool if a FIFO is full,
+     * and reopen later if its reader went away */
+    ssize_t rc = write(fd, buf, len);
+    if (rc < 0 && errno == EPIPE) {
+        close(fd);
+        mfu_progress_stream_fd = -1;
+    }
+
+    prg->stream_last = now;
+    mfu_free(&buf);
 }
 #endif
 
+/* describe values for records written to the progress stream */
+void mfu_progress_describe(const char* op, const char** names, const uint64_t* totals, mfu_progress* prg)
+{
+    /* nothing to do if progress or its stream are disabled */
+    if (prg == NULL || ! prg->stream) {
+        return;
+    }
+
+    if (op != NULL) {
+        mfu_free(&prg->op);
+        prg->op = MFU_STRDUP(op);
+    }
+
+    int i;
+    if (names != NULL) {
+        for (i = 0; i < prg->count; i++) {
+            mfu_free(&prg->names[i]);
+            prg->names[i] = MFU_STRDUP(names[i]);
+        }
+    }
+
+    if (totals != NULL) {
+        if (prg->totals == NULL) {
+            prg->totals = (uint64_t*) MFU_MALLOC(prg->count * sizeof(uint64_t));
+        }
+        memcpy(prg->totals, totals, prg->count * sizeof(uint64_t));
+    }
+}
+
 /* update progress across all processes in work loop */
 void mfu_progress_update(uint64_t* vals, mfu_progress* prg)
 {
@@ -95,7 +313,7 @@ void mfu_progress_update(uint64_t* vals, mfu_progress* prg)
     if (rank == 0) {
         /* if there are no bcast or reduce requests outstanding,
          * check whether it is time to send one */
-        if (prg->bcast_req == MPI_REQUEST_NULL && prg->reduce_req == MPI_REQUEST_NULL) {
+        if (prg->bcast_req == MPI_REQUEST_NULL && prg->reduce_req == MPI_REQUEST_NULL && prg->loc_req == MPI_REQUEST_NULL) {
             /* get current time and compute number of seconds since
              * we last printed a message */
             double now = MPI_Wtime();
@@ -120,9 +338,9 @@ void mfu_progress_update(uint64_t* vals, mfu_progress* prg)
             MPI_Test(&(prg->bcast_req), &bcast_done, MPI_STATUS_IGNORE);
             MPI_Test(&(prg->bcast_req), &bcast_done, MPI_STATUS_IGNORE);
             MPI_Test(&(prg->bcast_req), &bcast_done, MPI_STATUS_IGNORE);
-            MPI_Test(&(prg->reduce_req), &reduce_done, MPI_STATUS_IGNORE);
-            MPI_Test(&(prg->reduce_req), &reduce_done, MPI_STATUS_IGNORE);
-            MPI_Test(&(prg->reduce_req), &reduce_done, MPI_STATUS_IGNORE);
+            mfu_progress_test_reduce(&reduce_done, prg);
+            mfu_progress_test_reduce(&reduce_done, prg);
+            mfu_progress_test_reduce(&reduce_done, prg);
 
             /* print new progress message when bcast and reduce have completed */
             if (bcast_done && reduce_done) {
@@ -132,15 +350,18 @@ void mfu_progress_update(uint64_t* vals, mfu_progress* prg)
                     double secs = now - prg->time_start;
                     (*prg->progfn)(&prg->global_vals[1], prg->count, (int)prg->global_vals[0], ranks, secs);
                 }
+
+                /* write record to progress stream */
+                mfu_progress_stream_write(0, ranks, prg);
             }
         }
     } else {
         /* we may have a reduce already outstanding,
          * wait for it to complete before we start a new one,
          * if there is no outstanding reduce, this sets the flag to 1 */
-        MPI_Test(&(prg->reduce_req), &reduce_done, MPI_STATUS_IGNORE);
-        MPI_Test(&(prg->reduce_req), &reduce_done, MPI_STATUS_IGNORE);
-        MPI_Test(&(prg->reduce_req), &reduce_done, MPI_STATUS_IGNORE);
+        mfu_progress_test_reduce(&reduce_done, prg);
+        mfu_progress_test_reduce(&reduce_done, prg);
+        mfu_progress_test_reduce(&reduce_done, prg);
 
         /* make progress on any outstanding bcast */
         MPI_Test(&(prg->bcast_req), &bcast_done, MPI_STATUS_IGNORE);
@@ -200,7 +421,7 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
     if (rank == 0) {
         while (1) {
             /* send a bcast/request pair */
-            if (prg->bcast_req == MPI_REQUEST_NULL && prg->reduce_req == MPI_REQUEST_NULL) {
+            if (prg->bcast_req == MPI_REQUEST_NULL && prg->reduce_req == MPI_REQUEST_NULL && prg->loc_req == MPI_REQUEST_NULL) {
                 /* initiate a new bcast/reduce iteration */
                 MPI_Ibcast(&(prg->keep_going), 1, MPI_INT, 0, prg->comm, &(prg->bcast_req));
 
@@ -211,11 +432,13 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
                 /* if there are outstanding reqs then wait for bcast
                  * and reduce to finish */
                 MPI_Wait(&(prg->bcast_req), MPI_STATUS_IGNORE);
-                MPI_Wait(&(prg->reduce_req), MPI_STATUS_IGNORE);
+                mfu_progress_wait_reduce(prg);
 
                 /* once outstanding bcast finishes in which we
-                 * set keep_going == 0, we can stop */
+                 * set keep_going == 0, we can stop,
+                 * with a last record of the final values */
                 if (prg->keep_going == 0) {
+                    mfu_progress_stream_write(1, ranks, prg);
                     break;
                 }
 
@@ -244,7 +467,7 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
         while (1) {
             /* if have an outstanding reduce, wait for that to finish
              * if not, this will return immediately */
-            MPI_Wait(&(prg->reduce_req), MPI_STATUS_IGNORE);
+            mfu_progress_wait_reduce(prg);
 
             /* wait for bcast to finish */
             MPI_Wait(&(prg->bcast_req), MPI_STATUS_IGNORE);
@@ -258,7 +481,7 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
                 MPI_Ibcast(&(prg->keep_going), 1, MPI_INT, 0, prg->comm, &(prg->bcast_req));
             } else {
                 /* everyone is finished, wait on the reduce we just started */
-                MPI_Wait(&(prg->reduce_req), MPI_STATUS_IGNORE);
+                mfu_progress_wait_reduce(prg);
                 break;
             }
         }
@@ -271,6 +494,18 @@ void mfu_progress_complete(uint64_t* vals, mfu_progress** pprg)
     mfu_free(&prg->values);
     mfu_free(&prg->global_vals);
 
+    /* free stream descriptions */
+    if (prg->names != NULL) {
+        int i;
+        for (i = 0; i < prg->count; i++) {
+            mfu_free(&prg->names[i]);
+        }
+        mfu_free(&prg->names);
+    }
+    mfu_free(&prg->op);
+    mfu_free(&prg->totals);
+    mfu_free(&prg->stream_vals);
+
     /* free our structure */
     mfu_free(pprg);
 #endif
@@ -16,11 +16,18 @@ extern "C" {
  *   secs     - number of seconds since start was called */
 typedef void (*mfu_progress_fn)(const uint64_t* vals, int count, int complete, int ranks, double secs);
 
+/* value of a rank paired with its rank for MPI_DOUBLE_INT reductions */
+typedef struct {
+    double value;
+    int rank;
+} mfu_progress_loc;
+
 /* (opaque) struct that holds state for progress message reporting */
 typedef struct {
     MPI_Comm comm;          /* dup'ed communicator to execute bcast/reduce */
     MPI_Request bcast_req;  /* request for outstanding bcast */
     MPI_Request reduce_req; /* request for outstanding reduce */
+    MPI_Request loc_req;    /* request for outstanding reduce of slowest/fastest rank */
     double time_start;      /* time when start was called */
     double time_last;       /* time when last report was requested */
     double timeout;         /* number of seconds between reports */
@@ -29,6 +36,14 @@ typedef struct {
     uint64_t* values;       /* array holding contribution to global sum from local proc */
     uint64_t* global_vals;  /* array to hold global sum across ranks */
     mfu_progress_fn progfn; /* callback function to execute to print progress message */
+    int stream;             /* whether records are written to the progress stream */
+    char* op;               /* name of operation in stream records */
+    char** names;           /* name of each value in stream records */
+    uint64_t* totals;       /* expected final sum of each value, NULL if unknown */
+    uint64_t* stream_vals;  /* global sums written in last stream record */
+    double stream_last;     /* time of last stream record */
+    mfu_progress_loc loc[2];        /* first value of this rank, and its negation */
+    mfu_progress_loc global_loc[2]; /* slowest rank, and fastest rank with value negated */
 } mfu_progress;
 
 /* start progress timer and return newly allocated structure
@@ -39,6 +54,16 @@ typedef struct {
  *   progfn - IN callback to invoke to print progress message */
 mfu_progress* mfu_progress_start(int secs, int count, MPI_Comm comm, mfu_progress_fn progfn);
 
+/* describe values for records written to the progress stream,
+ * which is enabled by setting MFU_PROGRESS_STREAM to the path of a
+ * file or FIFO, rank 0 then appends a JSON object on a line for each
+ * progress message, should be called right after start
+ *   op     - IN name of operation, e.g., "copy data"
+ *   names  - IN name of each value, e.g., "bytes", may be NULL
+ *   totals - IN expected final sum of each value, may be NULL
+ *   prg    - IN pointer to struct returned in start */
+void mfu_progress_describe(const char* op, const char** names, const uint64_t* totals, mfu_progress* prg);
+
 /* update progress across all processes in work loop,
  *   vals - IN update contribution of this process to global sum
  *   prg  - IN pointer to struct returned in start */
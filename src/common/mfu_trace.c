@@ -0,0 +1,523 @@
+/* Implements per-phase counters and latency histograms of I/O calls
+ * and collectives, see mfu_trace.h */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "mfu.h"
+
+/* number of latency histogram buckets, bucket b counts operations
+ * that took less than 2^(b+1) microseconds (the last takes the rest) */
+#define MFU_TRACE_BUCKETS (24)
+
+/* max number of distinct phases and depth of nested phases */
+#define MFU_TRACE_PHASES (64)
+#define MFU_TRACE_DEPTH  (16)
+
+/* max length of a phase name including terminating NUL */
+#define MFU_TRACE_NAME (64)
+
+/* counters for one operation within a phase */
+typedef struct {
+    uint64_t count;                     /* number of calls */
+    uint64_t bytes;                     /* number of bytes moved */
+    double   time;                      /* total seconds in calls */
+    double   max;                       /* longest call in seconds */
+    uint64_t hist[MFU_TRACE_BUCKETS];   /* histogram of latencies */
+} mfu_trace_stat_t;
+
+/* counters for one phase */
+typedef struct {
+    char name[MFU_TRACE_NAME];          /* name of phase */
+    double time;                        /* seconds in phase, excluding nested phases */
+    mfu_trace_stat_t ops[MFU_TRACE_OPS];
+} mfu_trace_phase_t;
+
+/* names of operations as printed in the report */
+static const char* mfu_trace_op_names[MFU_TRACE_OPS] = {
+    "open", "close", "stat", "read", "write", "seek", "truncate", "fsync",
+    "create", "remove", "readdir", "setattr", "xattr",
+    "barrier", "bcast", "reduce", "gather", "alltoall",
+};
+
+int mfu_trace_enabled = 0;
+
+static mfu_trace_phase_t* trace_phases = NULL; /* table of phases, entry 0 is outside any phase */
+static int    trace_nphases = 0;               /* number of entries used in table */
+static int    trace_stack[MFU_TRACE_DEPTH];    /* indices of phases we're nested in */
+static int    trace_depth = 0;                 /* number of nested phases, may exceed MFU_TRACE_DEPTH */
+static double trace_phase_start = 0.0;         /* time current phase was last entered */
+static char*  trace_json = NULL;               /* file to write JSON summary to, if any */
+
+/* return index of phase operations are currently charged to */
+static int mfu_trace_current(void)
+{
+    int depth = trace_depth;
+    if (depth > MFU_TRACE_DEPTH) {
+        depth = MFU_TRACE_DEPTH;
+    }
+    return (depth > 0) ? trace_stack[depth - 1] : 0;
+}
+
+/* charge time since last phase change to current phase */
+static void mfu_trace_charge(double now)
+{
+    trace_phases[mfu_trace_current()].time += now - trace_phase_start;
+    trace_phase_start = now;
+}
+
+void mfu_trace_init(void)
+{
+    const char* value = getenv("MFU_TRACE");
+    if (value != NULL && atoi(value) != 0) {
+        mfu_trace_enabled = 1;
+    }
+
+    value = getenv("MFU_TRACE_JSON");
+    if (value != NULL && value[0] != '\0') {
+        trace_json = MFU_STRDUP(value);
+        mfu_trace_enabled = 1;
+    }
+
+    if (! mfu_trace_enabled) {
+        return;
+    }
+
+    trace_phases = (mfu_trace_phase_t*) MFU_CALLOC(MFU_TRACE_PHASES, sizeof(mfu_trace_phase_t));
+    strncpy(trace_phases[0].name, "other", MFU_TRACE_NAME - 1);
+    trace_nphases = 1;
+    trace_depth = 0;
+    trace_phase_start = MPI_Wtime();
+}
+
+void mfu_trace_record(mfu_trace_op op, double start, int64_t bytes)
+{
+    if (trace_phases == NULL) {
+        return;
+    }
+
+    double secs = MPI_Wtime() - start;
+
+    mfu_trace_stat_t* stat = &trace_phases[mfu_trace_current()].ops[op];
+    stat->count++;
+    if (bytes > 0) {
+        stat->bytes += (uint64_t) bytes;
+    }
+    stat->time += secs;
+    if (secs > stat->max) {
+        stat->max = secs;
+    }
+
+    /* find log2 bucket of latency in microseconds */
+    double usecs = secs * 1000000.0;
+    int bucket = 0;
+    while (usecs >= 2.0 && bucket < MFU_TRACE_BUCKETS - 1) {
+        usecs /= 2.0;
+        bucket++;
+    }
+    stat->hist[bucket]++;
+}
+
+void mfu_trace_push(const char* name)
+{
+    if (trace_phases == NULL) {
+        return;
+    }
+
+    mfu_trace_charge(MPI_Wtime());
+
+    /* look up phase by name, adding it if it's new,
+     * charge to the catch all phase if the table is full */
+    int idx;
+    for (idx = 0; idx < trace_nphases; idx++) {
+        if (strcmp(trace_phases[idx].name, name) == 0) {
+            break;
+        }
+    }
+    if (idx == trace_nphases) {
+        if (trace_nphases < MFU_TRACE_PHASES) {
+            strncpy(trace_phases[idx].name, name, MFU_TRACE_NAME - 1);
+            trace_nphases++;
+        } else {
+            idx = 0;
+        }
+    }
+
+    if (trace_depth < MFU_TRACE_DEPTH) {
+        trace_stack[trace_depth] = idx;
+    }
+    trace_depth++;
+}
+
+void mfu_trace_pop(void)
+{
+    if (trace_phases == NULL || trace_depth == 0) {
+        return;
+    }
+
+    mfu_trace_charge(MPI_Wtime());
+    trace_depth--;
+}
+
+/* summary of one operation within a phase across ranks */
+typedef struct {
+    uint64_t count;                     /* calls summed over ranks */
+    uint64_t bytes;                     /* bytes summed over ranks */
+    double   min, max, sum;             /* per-rank seconds in calls */
+    double   lat_max;                   /* longest single call */
+    uint64_t hist[MFU_TRACE_BUCKETS];   /* histogram summed over ranks */
+} mfu_trace_sum_t;
+
+/* summary of one phase across ranks */
+typedef struct {
+    char name[MFU_TRACE_NAME];
+    int nranks;                         /* number of ranks that entered phase */
+    double min, max, sum;               /* per-rank seconds in phase */
+    mfu_trace_sum_t ops[MFU_TRACE_OPS];
+} mfu_trace_phase_sum_t;
+
+/* returns upper bound in seconds on latency of given fraction of calls */
+static double mfu_trace_percentile(const mfu_trace_sum_t* op, double frac)
+{
+    uint64_t target = (uint64_t) ((double) op->count * frac);
+    uint64_t seen = 0;
+    int b;
+    for (b = 0; b < MFU_TRACE_BUCKETS - 1; b++) {
+        seen += op->hist[b];
+        if (seen > target) {
+            break;
+        }
+    }
+    if (b == MFU_TRACE_BUCKETS - 1) {
+        return op->lat_max;
+    }
+    return (double) (2ULL << b) / 1000000.0;
+}
+
+/* ratio of max to average, 1.0 means perfectly balanced */
+static double mfu_trace_imbalance(double max, double sum, int ranks)
+{
+    double avg = sum / (double) ranks;
+    return (avg > 0.0) ? max / avg : 1.0;
+}
+
+/* print summary table to stdout */
+static void mfu_trace_print(const mfu_trace_phase_sum_t* sums, int count, int ranks)
+{
+    printf("Phase timing across %d ranks (seconds, imbalance = max / avg)\n", ranks);
+    int i;
+    for (i = 0; i < count; i++) {
+        const mfu_trace_phase_sum_t* p = &sums[i];
+        printf("%-24s min %10.3f  max %10.3f  avg %10.3f  imbalance %6.2f\n",
+            p->name, p->min, p->max, p->sum / (double) ranks,
+            mfu_trace_imbalance(p->max, p->sum, ranks));
+
+        int op;
+        for (op = 0; op < MFU_TRACE_OPS; op++) {
+            const mfu_trace_sum_t* s = &p->ops[op];
+            if (s->count == 0) {
+                continue;
+            }
+
+            double bytes_val;
+            const char* bytes_units;
+            mfu_format_bytes(s->bytes, &bytes_val, &bytes_units);
+
+            printf("  %-10s calls %12llu  bytes %8.3f %-3s  time min %9.3f  max %9.3f  imbalance %6.2f"
+                "  latency p50 %.6f  p99 %.6f  max %.6f\n",
+                mfu_trace_op_names[op], (unsigned long long) s->count,
+                bytes_val, bytes_units, s->min, s->max,
+                mfu_trace_imbalance(s->max, s->sum, ranks),
+                mfu_trace_percentile(s, 0.50), mfu_trace_percentile(s, 0.99), s->lat_max);
+        }
+    }
+    fflush(stdout);
+}
+
+/* write summary as JSON to given file */
+static void mfu_trace_write_json(const char* file, const mfu_trace_phase_sum_t* sums, int count, int ranks)
+{
+    FILE* fp = fopen(file, "w");
+    if (fp == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open trace file `%s' (errno=%d %s)",
+            file, errno, strerror(errno));
+        return;
+    }
+
+    fprintf(fp, "{\"ranks\": %d, \"phases\": [", ranks);
+    int i;
+    for (i = 0; i < count; i++) {
+        const mfu_trace_phase_sum_t* p = &sums[i];
+        fprintf(fp, "%s\n  {\"name\": \"%s\", \"time\": {\"min\": %.6f, \"max\": %.6f, \"avg\": %.6f}, \"ops\": [",
+            (i > 0) ? "," : "", p->name, p->min, p->max, p->sum / (double) ranks);
+
+        int first = 1;
+        int op;
+        for (op = 0; op < MFU_TRACE_OPS; op++) {
+            const mfu_trace_sum_t* s = &p->ops[op];
+            if (s->count == 0) {
+                continue;
+            }
+            fprintf(fp, "%s\n    {\"op\": \"%s\", \"calls\": %llu, \"bytes\": %llu, "
+                "\"time\": {\"min\": %.6f, \"max\": %.6f, \"avg\": %.6f}, "
+                "\"latency\": {\"max\": %.6f, \"hist_usec_log2\": [",
+                first ? "" : ",", mfu_trace_op_names[op],
+                (unsigned long long) s->count, (unsigned long long) s->bytes,
+                s->min, s->max, s->sum / (double) ranks, s->lat_max);
+            int b;
+            for (b = 0; b < MFU_TRACE_BUCKETS; b++) {
+                fprintf(fp, "%s%llu", (b > 0) ? ", " : "", (unsigned long long) s->hist[b]);
+            }
+            fprintf(fp, "]}}");
+            first = 0;
+        }
+        fprintf(fp, "]}");
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+}
+
+void mfu_trace_report(void)
+{
+    if (trace_phases == NULL) {
+        return;
+    }
+
+    /* charge the last phase and stop recording, so the
+     * collectives below are not counted */
+    mfu_trace_charge(MPI_Wtime());
+    mfu_trace_enabled = 0;
+
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* gather phase tables to rank 0, phases are matched up by name
+     * in case ranks entered different phases */
+    int bytes = trace_nphases * (int) sizeof(mfu_trace_phase_t);
+    int* counts = NULL;
+    int* disps  = NULL;
+    char* all   = NULL;
+    if (rank == 0) {
+        counts = (int*) MFU_MALLOC((size_t) ranks * sizeof(int));
+        disps  = (int*) MFU_MALLOC((size_t) ranks * sizeof(int));
+    }
+    MPI_Gather(&bytes, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int total = 0;
+    if (rank == 0) {
+        int i;
+        for (i = 0; i < ranks; i++) {
+            disps[i] = total;
+            total += counts[i];
+        }
+        all = (char*) MFU_MALLOC((size_t) total);
+    }
+    MPI_Gatherv(trace_phases, bytes, MPI_BYTE, all, counts, disps, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        /* combine phases by name */
+        mfu_trace_phase_sum_t* sums = (mfu_trace_phase_sum_t*) MFU_CALLOC(
+            (size_t) total / sizeof(mfu_trace_phase_t) + 1, sizeof(mfu_trace_phase_sum_t));
+        int nsums = 0;
+
+        int i;
+        for (i = 0; i < ranks; i++) {
+            const mfu_trace_phase_t* phases = (const mfu_trace_phase_t*) (all + disps[i]);
+            int nphases = counts[i] / (int) sizeof(mfu_trace_phase_t);
+            int j;
+            for (j = 0; j < nphases; j++) {
+                const mfu_trace_phase_t* p = &phases[j];
+                int k;
+                for (k = 0; k < nsums; k++) {
+                    if (strcmp(sums[k].name, p->name) == 0) {
+                        break;
+                    }
+                }
+                mfu_trace_phase_sum_t* sum = &sums[k];
+                if (k == nsums) {
+                    strncpy(sum->name, p->name, MFU_TRACE_NAME - 1);
+                    sum->min = p->time;
+                    int op;
+                    for (op = 0; op < MFU_TRACE_OPS; op++) {
+                        sum->ops[op].min = p->ops[op].time;
+                    }
+                    nsums++;
+                }
+                sum->nranks++;
+
+                if (sum->min > p->time) {
+                    sum->min = p->time;
+                }
+                if (sum->max < p->time) {
+                    sum->max = p->time;
+                }
+                sum->sum += p->time;
+
+                int op;
+                for (op = 0; op < MFU_TRACE_OPS; op++) {
+                    const mfu_trace_stat_t* s = &p->ops[op];
+                    mfu_trace_sum_t* t = &sum->ops[op];
+                    t->count += s->count;
+                    t->bytes += s->bytes;
+                    if (t->min > s->time) {
+                        t->min = s->time;
+                    }
+                    if (t->max < s->time) {
+                        t->max = s->time;
+                    }
+                    t->sum += s->time;
+                    if (t->lat_max < s->max) {
+                        t->lat_max = s->max;
+                    }
+                    int b;
+                    for (b = 0; b < MFU_TRACE_BUCKETS; b++) {
+                        t->hist[b] += s->hist[b];
+                    }
+                }
+            }
+        }
+
+        /* a rank that never entered a phase spent no time there */
+        for (i = 0; i < nsums; i++) {
+            if (sums[i].nranks < ranks) {
+                sums[i].min = 0.0;
+                int op;
+                for (op = 0; op < MFU_TRACE_OPS; op++) {
+                    sums[i].ops[op].min = 0.0;
+                }
+            }
+        }
+
+        mfu_trace_print(sums, nsums, ranks);
+        if (trace_json != NULL) {
+            mfu_trace_write_json(trace_json, sums, nsums, ranks);
+        }
+
+        mfu_free(&sums);
+        mfu_free(&all);
+        mfu_free(&counts);
+        mfu_free(&disps);
+    }
+
+    mfu_free(&trace_phases);
+    mfu_free(&trace_json);
+    trace_nphases = 0;
+    trace_depth = 0;
+}
+
+#if defined(MFU_TRACE_MPI) && MPI_VERSION >= 3
+/* time collectives through the MPI profiling interface */
+
+int MPI_Barrier(MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Barrier(comm);
+    MFU_TRACE_END(MFU_TRACE_BARRIER, start, 0);
+    return rc;
+}
+
+int MPI_Bcast(void* buf, int count, MPI_Datatype type, int root, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Bcast(buf, count, type, root, comm);
+    MFU_TRACE_END(MFU_TRACE_BCAST, start, 0);
+    return rc;
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type,
+               MPI_Op op, int root, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Reduce(sendbuf, recvbuf, count, type, op, root, comm);
+    MFU_TRACE_END(MFU_TRACE_REDUCE, start, 0);
+    return rc;
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type,
+                  MPI_Op op, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Allreduce(sendbuf, recvbuf, count, type, op, comm);
+    MFU_TRACE_END(MFU_TRACE_REDUCE, start, 0);
+    return rc;
+}
+
+int MPI_Scan(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type,
+             MPI_Op op, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Scan(sendbuf, recvbuf, count, type, op, comm);
+    MFU_TRACE_END(MFU_TRACE_REDUCE, start, 0);
+    return rc;
+}
+
+int MPI_Exscan(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type,
+               MPI_Op op, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Exscan(sendbuf, recvbuf, count, type, op, comm);
+    MFU_TRACE_END(MFU_TRACE_REDUCE, start, 0);
+    return rc;
+}
+
+int MPI_Gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+               void* recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    MFU_TRACE_END(MFU_TRACE_GATHER, start, 0);
+    return rc;
+}
+
+int MPI_Gatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                void* recvbuf, const int recvcounts[], const int displs[],
+                MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+    MFU_TRACE_END(MFU_TRACE_GATHER, start, 0);
+    return rc;
+}
+
+int MPI_Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                  void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    MFU_TRACE_END(MFU_TRACE_GATHER, start, 0);
+    return rc;
+}
+
+int MPI_Allgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                   void* recvbuf, const int recvcounts[], const int displs[],
+                   MPI_Datatype recvtype, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
+    MFU_TRACE_END(MFU_TRACE_GATHER, start, 0);
+    return rc;
+}
+
+int MPI_Alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                 void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    MFU_TRACE_END(MFU_TRACE_ALLTOALL, start, 0);
+    return rc;
+}
+
+int MPI_Alltoallv(const void* sendbuf, const int sendcounts[], const int sdispls[],
+                  MPI_Datatype sendtype, void* recvbuf, const int recvcounts[],
+                  const int rdispls[], MPI_Datatype recvtype, MPI_Comm comm)
+{
+    double start = MFU_TRACE_START();
+    int rc = PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype,
+                            recvbuf, recvcounts, rdispls, recvtype, comm);
+    MFU_TRACE_END(MFU_TRACE_ALLTOALL, start, 0);
+    return rc;
+}
+#endif /* MFU_TRACE_MPI */
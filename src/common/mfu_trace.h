@@ -0,0 +1,86 @@
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MFU_TRACE_H
+#define MFU_TRACE_H
+
+#include <stdint.h>
+#include "mpi.h"
+
+/* Lightweight timing of I/O calls and collectives.
+ *
+ * Tracing is off unless MFU_TRACE is set to a nonzero value in the
+ * environment, in which case each rank counts the calls, bytes, and
+ * time of each operation, along with a histogram of latencies, split
+ * by the phase the tool was in.  A table summarizing all ranks is
+ * printed by rank 0 when mfu_finalize is called.  If MFU_TRACE_JSON
+ * names a file, tracing is enabled and the summary is also written
+ * to that file as JSON.
+ *
+ * Every mfu_file_* call is timed.  Collectives are timed through the
+ * MPI profiling interface when built with -DMFU_TRACE_MPI. */
+
+/* operations that are timed */
+typedef enum {
+    MFU_TRACE_OPEN = 0, /* open */
+    MFU_TRACE_CLOSE,    /* close */
+    MFU_TRACE_STAT,     /* stat, lstat, access, readlink, realpath */
+    MFU_TRACE_READ,     /* read, pread */
+    MFU_TRACE_WRITE,    /* write, pwrite */
+    MFU_TRACE_SEEK,     /* lseek */
+    MFU_TRACE_TRUNC,    /* truncate, ftruncate */
+    MFU_TRACE_FSYNC,    /* fsync */
+    MFU_TRACE_CREATE,   /* mknod, mkdir, symlink */
+    MFU_TRACE_REMOVE,   /* unlink, rmdir, remove */
+    MFU_TRACE_READDIR,  /* opendir, readdir, closedir */
+    MFU_TRACE_SETATTR,  /* chmod, lchown, utimensat */
+    MFU_TRACE_XATTR,    /* list, get, and set extended attributes */
+    MFU_TRACE_BARRIER,  /* MPI_Barrier */
+    MFU_TRACE_BCAST,    /* MPI_Bcast */
+    MFU_TRACE_REDUCE,   /* MPI_Reduce, MPI_Allreduce, MPI_Scan, MPI_Exscan */
+    MFU_TRACE_GATHER,   /* MPI_Gather(v), MPI_Allgather(v) */
+    MFU_TRACE_ALLTOALL, /* MPI_Alltoall(v) */
+    MFU_TRACE_OPS       /* number of operations, must be last */
+} mfu_trace_op;
+
+/* nonzero when tracing is enabled */
+extern int mfu_trace_enabled;
+
+/* returns start time of an operation, or 0.0 when tracing is off */
+#define MFU_TRACE_START() (mfu_trace_enabled ? MPI_Wtime() : 0.0)
+
+/* record operation op that began at start and moved bytes,
+ * a negative byte count (e.g., an error) is not added */
+#define MFU_TRACE_END(op, start, bytes) \
+    do { \
+        if (mfu_trace_enabled) { \
+            mfu_trace_record((op), (start), (int64_t) (bytes)); \
+        } \
+    } while (0)
+
+/* enable tracing if requested in the environment, called by mfu_init */
+void mfu_trace_init(void);
+
+/* add an operation to the current phase, use MFU_TRACE_END instead */
+void mfu_trace_record(mfu_trace_op op, double start, int64_t bytes);
+
+/* enter a named phase, operations and time are charged to the innermost
+ * phase until the matching mfu_trace_pop, all ranks should use the same
+ * names for the summary to be meaningful */
+void mfu_trace_push(const char* name);
+
+/* leave the phase entered by the last mfu_trace_push */
+void mfu_trace_pop(void);
+
+/* print summary across ranks and free resources, must be called by
+ * all ranks, called by mfu_finalize */
+void mfu_trace_report(void);
+
+#endif /* MFU_TRACE_H */
+
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
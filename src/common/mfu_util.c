@@ -5,6 +5,7 @@
 #include "mpi.h"
 #include "dtcmp.h"
 #include "mfu_errors.h"
+#include "mfu_flist_internal.h"
 #include "list.h"
 
 #include <stdio.h>
@@ -19,6 +20,8 @@
 #include <unistd.h>
 
 #include <sys/vfs.h>
+#include <sys/sysinfo.h>
+#include <sys/resource.h>
 
 #ifndef ULLONG_MAX
 #define ULLONG_MAX (__LONG_LONG_MAX__ * 2UL + 1UL)
@@ -29,6 +32,12 @@
 #include <lustre/lustre_user.h>
 #endif
 
+/* x86 vector intrinsics for mfu_mem kernels */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MFU_MEM_X86 1
+#endif
+
 int mfu_initialized = 0;
 
 /* set globals */
@@ -41,6 +50,9 @@ mfu_loglevel mfu_debug_level = MFU_LOG_ERR;
 /* default progress message timeout in seconds */
 int mfu_progress_timeout = 10;
 
+/* no limit on buffer memory beyond what the system imposes */
+uint64_t mfu_memory_limit = 0;
+
 /* initialize mfu library,
  * reference counting allows for multiple init/finalize pairs */
 int mfu_init()
@@ -51,6 +63,8 @@ int mfu_init()
         mfu_debug_stream = stdout;
         DTCMP_Init();
         mfu_init_filesystem_list();
+        mfu_trace_init();
+        mfu_mock_init();
         mfu_initialized++;
     }
 
@@ -60,11 +74,16 @@ int mfu_init()
 /* finalize mfu library */
 int mfu_finalize()
 {
+    /* mock counts are logged, so report them while MFU_LOG still prints */
+    if (mfu_initialized == 1) {
+        mfu_mock_finalize();
+    }
     if (mfu_initialized > 0) {
         DTCMP_Finalize();
         mfu_initialized--;
     }
     if (mfu_initialized == 0) {
+        mfu_trace_report();
         mfu_destroy_filesystem_list();
     }
     return MFU_SUCCESS;
@@ -592,6 +611,320 @@ uint32_t mfu_hash_jenkins(const char* key, size_t len)
     return hash;
 }
 
+/* The mfu_mem kernels scan data buffers for sparse copies and content
+ * comparisons.  Each kernel has a portable version that works on 64-bit
+ * words and x86 versions that work on SSE2, AVX2, or AVX-512 vectors.
+ * The best version the running processor supports is selected on first use. */
+
+typedef struct {
+    const char* name;
+    int (*is_zero)(const char* buf, size_t size);
+    size_t (*first_diff)(const char* buf1, const char* buf2, size_t size);
+} mfu_mem_kernels_t;
+
+/* load a word from a possibly unaligned address */
+static inline uint64_t mem_load64(const char* p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static int mem_is_zero_generic(const char* buf, size_t size)
+{
+    /* check four words at a time, stop on first non-zero word */
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint64_t w = mem_load64(buf + i)      | mem_load64(buf + i + 8) |
+                     mem_load64(buf + i + 16) | mem_load64(buf + i + 24);
+        if (w != 0) {
+            return 0;
+        }
+    }
+    for (; i + 8 <= size; i += 8) {
+        if (mem_load64(buf + i) != 0) {
+            return 0;
+        }
+    }
+
+    /* check any trailing bytes */
+    for (; i < size; i++) {
+        if (buf[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static size_t mem_first_diff_generic(const char* buf1, const char* buf2, size_t size)
+{
+    /* skip over matching blocks of four words, then narrow down
+     * to the differing word and finally to the differing byte */
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint64_t w = (mem_load64(buf1 + i)      ^ mem_load64(buf2 + i))      |
+                     (mem_load64(buf1 + i + 8)  ^ mem_load64(buf2 + i + 8))  |
+                     (mem_load64(buf1 + i + 16) ^ mem_load64(buf2 + i + 16)) |
+                     (mem_load64(buf1 + i + 24) ^ mem_load64(buf2 + i + 24));
+        if (w != 0) {
+            break;
+        }
+    }
+    for (; i + 8 <= size; i += 8) {
+        if (mem_load64(buf1 + i) != mem_load64(buf2 + i)) {
+            break;
+        }
+    }
+    for (; i < size; i++) {
+        if (buf1[i] != buf2[i]) {
+            break;
+        }
+    }
+    return i;
+}
+
+#ifdef MFU_MEM_X86
+__attribute__((target("sse2")))
+static int mem_is_zero_sse2(const char* buf, size_t size)
+{
+    /* test 64 bytes per iteration */
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(buf + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(buf + i + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i*)(buf + i + 32));
+        __m128i v3 = _mm_loadu_si128((const __m128i*)(buf + i + 48));
+        __m128i v  = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF) {
+            return 0;
+        }
+    }
+    return mem_is_zero_generic(buf + i, size - i);
+}
+
+__attribute__((target("sse2")))
+static size_t mem_first_diff_sse2(const char* buf1, const char* buf2, size_t size)
+{
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m128i v0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(buf1 + i)),
+                                   _mm_loadu_si128((const __m128i*)(buf2 + i)));
+        __m128i v1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(buf1 + i + 16)),
+                                   _mm_loadu_si128((const __m128i*)(buf2 + i + 16)));
+        __m128i v2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(buf1 + i + 32)),
+                                   _mm_loadu_si128((const __m128i*)(buf2 + i + 32)));
+        __m128i v3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(buf1 + i + 48)),
+                                   _mm_loadu_si128((const __m128i*)(buf2 + i + 48)));
+        __m128i v  = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF) {
+            break;
+        }
+    }
+
+    /* locate differing byte from the per-byte equality mask */
+    for (; i + 16 <= size; i += 16) {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buf1 + i)),
+                                    _mm_loadu_si128((const __m128i*)(buf2 + i)));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(eq);
+        if (mask != 0xFFFF) {
+            return i + (size_t) __builtin_ctz(~mask);
+        }
+    }
+    return i + mem_first_diff_generic(buf1 + i, buf2 + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static int mem_is_zero_avx2(const char* buf, size_t size)
+{
+    /* test 128 bytes per iteration */
+    size_t i = 0;
+    for (; i + 128 <= size; i += 128) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i*)(buf + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i*)(buf + i + 32));
+        __m256i v2 = _mm256_loadu_si256((const __m256i*)(buf + i + 64));
+        __m256i v3 = _mm256_loadu_si256((const __m256i*)(buf + i + 96));
+        __m256i v  = _mm256_or_si256(_mm256_or_si256(v0, v1), _mm256_or_si256(v2, v3));
+        if (! _mm256_testz_si256(v, v)) {
+            return 0;
+        }
+    }
+    return mem_is_zero_generic(buf + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static size_t mem_first_diff_avx2(const char* buf1, const char* buf2, size_t size)
+{
+    size_t i = 0;
+    for (; i + 128 <= size; i += 128) {
+        __m256i v0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(buf1 + i)),
+                                      _mm256_loadu_si256((const __m256i*)(buf2 + i)));
+        __m256i v1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(buf1 + i + 32)),
+                                      _mm256_loadu_si256((const __m256i*)(buf2 + i + 32)));
+        __m256i v2 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(buf1 + i + 64)),
+                                      _mm256_loadu_si256((const __m256i*)(buf2 + i + 64)));
+        __m256i v3 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(buf1 + i + 96)),
+                                      _mm256_loadu_si256((const __m256i*)(buf2 + i + 96)));
+        __m256i v  = _mm256_or_si256(_mm256_or_si256(v0, v1), _mm256_or_si256(v2, v3));
+        if (! _mm256_testz_si256(v, v)) {
+            break;
+        }
+    }
+
+    /* locate differing byte from the per-byte equality mask */
+    for (; i + 32 <= size; i += 32) {
+        __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buf1 + i)),
+                                       _mm256_loadu_si256((const __m256i*)(buf2 + i)));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(eq);
+        if (mask != 0xFFFFFFFFU) {
+            return i + (size_t) __builtin_ctz(~mask);
+        }
+    }
+    return i + mem_first_diff_generic(buf1 + i, buf2 + i, size - i);
+}
+
+__attribute__((target("avx512f")))
+static int mem_is_zero_avx512(const char* buf, size_t size)
+{
+    /* test 256 bytes per iteration */
+    size_t i = 0;
+    for (; i + 256 <= size; i += 256) {
+        __m512i v0 = _mm512_loadu_si512((const void*)(buf + i));
+        __m512i v1 = _mm512_loadu_si512((const void*)(buf + i + 64));
+        __m512i v2 = _mm512_loadu_si512((const void*)(buf + i + 128));
+        __m512i v3 = _mm512_loadu_si512((const void*)(buf + i + 192));
+        __m512i v  = _mm512_or_si512(_mm512_or_si512(v0, v1), _mm512_or_si512(v2, v3));
+        if (_mm512_test_epi64_mask(v, v) != 0) {
+            return 0;
+        }
+    }
+    return mem_is_zero_generic(buf + i, size - i);
+}
+
+__attribute__((target("avx512f")))
+static size_t mem_first_diff_avx512(const char* buf1, const char* buf2, size_t size)
+{
+    size_t i = 0;
+    for (; i + 256 <= size; i += 256) {
+        __m512i v0 = _mm512_xor_si512(_mm512_loadu_si512((const void*)(buf1 + i)),
+                                      _mm512_loadu_si512((const void*)(buf2 + i)));
+        __m512i v1 = _mm512_xor_si512(_mm512_loadu_si512((const void*)(buf1 + i + 64)),
+                                      _mm512_loadu_si512((const void*)(buf2 + i + 64)));
+        __m512i v2 = _mm512_xor_si512(_mm512_loadu_si512((const void*)(buf1 + i + 128)),
+                                      _mm512_loadu_si512((const void*)(buf2 + i + 128)));
+        __m512i v3 = _mm512_xor_si512(_mm512_loadu_si512((const void*)(buf1 + i + 192)),
+                                      _mm512_loadu_si512((const void*)(buf2 + i + 192)));
+        __m512i v  = _mm512_or_si512(_mm512_or_si512(v0, v1), _mm512_or_si512(v2, v3));
+        if (_mm512_test_epi64_mask(v, v) != 0) {
+            break;
+        }
+    }
+
+    /* AVX-512F compares 64-bit lanes, so locate the differing word here
+     * and let the generic kernel find the byte within it */
+    for (; i + 64 <= size; i += 64) {
+        __mmask8 ne = _mm512_cmpneq_epi64_mask(_mm512_loadu_si512((const void*)(buf1 + i)),
+                                               _mm512_loadu_si512((const void*)(buf2 + i)));
+        if (ne != 0) {
+            i += 8 * (size_t) __builtin_ctz((unsigned int) ne);
+            break;
+        }
+    }
+    return i + mem_first_diff_generic(buf1 + i, buf2 + i, size - i);
+}
+#endif /* MFU_MEM_X86 */
+
+/* kernel sets ordered from least to most capable */
+static const mfu_mem_kernels_t mfu_mem_kernel_table[] = {
+    { "generic", mem_is_zero_generic, mem_first_diff_generic },
+#ifdef MFU_MEM_X86
+    { "sse2",    mem_is_zero_sse2,    mem_first_diff_sse2    },
+    { "avx2",    mem_is_zero_avx2,    mem_first_diff_avx2    },
+    { "avx512",  mem_is_zero_avx512,  mem_first_diff_avx512  },
+#endif
+};
+
+/* kernel set in use, selected on first call */
+static const mfu_mem_kernels_t* mfu_mem_kernels = NULL;
+
+/* return 1 if the running processor can execute the given kernel set */
+static int mem_kernels_supported(const mfu_mem_kernels_t* k)
+{
+#ifdef MFU_MEM_X86
+    __builtin_cpu_init();
+    if (strcmp(k->name, "sse2") == 0) {
+        return __builtin_cpu_supports("sse2");
+    } else if (strcmp(k->name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    } else if (strcmp(k->name, "avx512") == 0) {
+        return __builtin_cpu_supports("avx512f");
+    }
+#endif
+    return (strcmp(k->name, "generic") == 0);
+}
+
+static const mfu_mem_kernels_t* mem_kernels_select(void)
+{
+    int count = (int) (sizeof(mfu_mem_kernel_table) / sizeof(mfu_mem_kernel_table[0]));
+
+    /* allow override of kernel choice via environment variable */
+    char varname[] = "MFU_MEM_SIMD";
+    const char* value = getenv(varname);
+    if (value != NULL) {
+        int i;
+        for (i = 0; i < count; i++) {
+            const mfu_mem_kernels_t* k = &mfu_mem_kernel_table[i];
+            if (strcmp(value, k->name) == 0) {
+                if (mem_kernels_supported(k)) {
+                    return k;
+                }
+                MFU_LOG(MFU_LOG_WARN, "%s: %s not supported by this processor", varname, value);
+                break;
+            }
+        }
+        if (i == count) {
+            MFU_LOG(MFU_LOG_ERR, "%s: Unknown value: %s", varname, value);
+        }
+    }
+
+    /* otherwise pick the most capable kernel set this processor supports */
+    int i;
+    for (i = count - 1; i > 0; i--) {
+        if (mem_kernels_supported(&mfu_mem_kernel_table[i])) {
+            break;
+        }
+    }
+    return &mfu_mem_kernel_table[i];
+}
+
+/* all threads pick the same kernel set, so a race on first use is harmless */
+static inline const mfu_mem_kernels_t* mem_kernels(void)
+{
+    if (mfu_mem_kernels == NULL) {
+        mfu_mem_kernels = mem_kernels_select();
+    }
+    return mfu_mem_kernels;
+}
+
+const char* mfu_mem_simd(void)
+{
+    return mem_kernels()->name;
+}
+
+int mfu_mem_is_zero(const void* buf, size_t size)
+{
+    return mem_kernels()->is_zero((const char*) buf, size);
+}
+
+size_t mfu_mem_first_diff(const void* buf1, const void* buf2, size_t size)
+{
+    return mem_kernels()->first_diff((const char*) buf1, (const char*) buf2, size);
+}
+
+int mfu_mem_equal(const void* buf1, const void* buf2, size_t size)
+{
+    return (mfu_mem_first_diff(buf1, buf2, size) == size);
+}
+
 void mfu_stat_get_atimes(const struct stat* sb, uint64_t* secs, uint64_t* nsecs)
 {
     *secs = (uint64_t) sb->st_atime;
@@ -707,8 +1040,9 @@ void mfu_stat_set_ctimes (struct stat* sb, uint64_t secs, uint64_t nsecs)
 }
 
 /* compares contents of two files and optionally overwrite dest with source,
+ * leaves both files open in a per-rank cache for later calls,
  * returns -1 on error, 0 if equal, 1 if different */
-int mfu_compare_contents(
+int mfu_compare_contents_cached(
     const char* src_name,          /* IN  - path name to source file */
     const char* dst_name,          /* IN  - path name to destination file */
     off_t offset,                  /* IN  - offset with file to start comparison */
@@ -745,8 +1079,9 @@ int mfu_compare_contents(
         src_flags |= O_DIRECT;
     }
 
-    /* open source file */
-    int src_rc = mfu_file_open(src_name, src_flags, mfu_src_file);
+    /* open source file, files stay open in a per-rank cache
+     * until mfu_compare_contents_close is called */
+    int src_rc = mfu_copy_cache_open_file(1, src_name, src_flags, copy_opts, mfu_src_file);
     if (src_rc != 0) {
         /* log error if there is an open failure on the src side */
         MFU_LOG(MFU_LOG_ERR, "Failed to open source file `%s' (errno=%d %s)",
@@ -768,17 +1103,16 @@ int mfu_compare_contents(
     }
 
     /* open destination file */
-    int dst_rc = mfu_file_open(dst_name, dst_flags, mfu_dst_file);
+    int dst_rc = mfu_copy_cache_open_file(0, dst_name, dst_flags, copy_opts, mfu_dst_file);
     if (dst_rc != 0) {
         /* log error if there is an open failure on the dst side */
         MFU_LOG(MFU_LOG_ERR, "Failed to open destination file `%s' (errno=%d %s)",
                 dst_name, errno, strerror(errno));
-        mfu_file_close(src_name, mfu_src_file);
         return -1;
     }
 
     /* hint that we'll read from file sequentially */
-    if (mfu_src_file->type != DAOS && mfu_src_file->type != DFS) {
+    if (mfu_src_file->type == POSIX) {
         posix_fadvise(mfu_src_file->fd, offset, length, POSIX_FADV_SEQUENTIAL);
         posix_fadvise(mfu_src_file->fd, offset, length, POSIX_FADV_SEQUENTIAL);
     }
@@ -798,6 +1132,10 @@ int mfu_compare_contents(
     /* if we write with O_DIRECT, we may need to truncate file */
     int need_truncate = 0;
 
+    /* when overwriting, rewrite from the start of the first
+     * differing block of this size within each buffer */
+    size_t write_align = 4096;
+
     /* read and compare data from files */
     off_t total_bytes = 0;
     while (total_bytes < length) {
@@ -893,8 +1231,10 @@ int mfu_compare_contents(
             min_read = dst_read;
         }
 
-        /* if have same size buffers, and read some data, let's check the contents */
-        if (memcmp((ssize_t*)src_buf, (ssize_t*)dst_buf, (size_t)min_read) != 0) {
+        /* if have same size buffers, and read some data, let's check the contents,
+         * and find the offset of the first byte that differs */
+        size_t first_diff = mfu_mem_first_diff(src_buf, dst_buf, (size_t)min_read);
+        if (first_diff < (size_t)min_read) {
             /* memory contents are different */
             rc = 1;
             if (! overwrite) {
@@ -906,8 +1246,16 @@ int mfu_compare_contents(
         /* if the bytes are different,
          * then copy the bytes from the source into the destination */
         if (overwrite && need_copy) {
+            /* bytes before the first difference already match, so start
+             * writing at the beginning of the block holding that difference,
+             * O_DIRECT requires that we write the full buffer */
+            size_t write_start = 0;
+            if (! direct) {
+                write_start = first_diff - (first_diff % write_align);
+            }
+
             /* compute number of bytes to write */
-            size_t bytes_to_write = (size_t) min_read;
+            size_t bytes_to_write = (size_t) min_read - write_start;
             if (direct) {
                 /* O_DIRECT requires particular write sizes,
                  * ok to write beyond end of file so long as
@@ -933,13 +1281,13 @@ int mfu_compare_contents(
             ssize_t n = 0;
             while (n < bytes_to_write) {
                 /* write data to destination file */
-                ssize_t bytes_written = mfu_file_pwrite(dst_name, ((char*)src_buf) + n, bytes_to_write - n, off + n,
-                                                   mfu_dst_file);
+                ssize_t bytes_written = mfu_file_pwrite(dst_name, ((char*)src_buf) + write_start + n,
+                                                   bytes_to_write - n, off + write_start + n, mfu_dst_file);
 
                 /* check for write error */
                 if (bytes_written < 0) {
-                    MFU_LOG(MFU_LOG_ERR, "Failed to write `%s' at offset %llx (errno=%d %s)", 
-                        dst_name, (unsigned long long)off + n, strerror(errno));
+                    MFU_LOG(MFU_LOG_ERR, "Failed to write `%s' at offset %llx (errno=%d %s)",
+                        dst_name, (unsigned long long)(off + write_start + n), errno, strerror(errno));
                     rc = -1;
                     break;
                 }
@@ -989,13 +1337,46 @@ int mfu_compare_contents(
     mfu_free(&src_buf);
     mfu_free(&dst_buf);
 
-    /* close files */
-    mfu_file_close(dst_name, mfu_dst_file);
-    mfu_file_close(src_name, mfu_src_file);
+    return rc;
+}
+
+/* compares contents of two files and optionally overwrite dest with source,
+ * returns -1 on error, 0 if equal, 1 if different */
+int mfu_compare_contents(
+    const char* src_name,          /* IN  - path name to source file */
+    const char* dst_name,          /* IN  - path name to destination file */
+    off_t offset,                  /* IN  - offset with file to start comparison */
+    off_t length,                  /* IN  - number of bytes to be compared */
+    off_t file_size,               /* IN  - size of file */
+    int overwrite,                 /* IN  - whether to replace dest with source contents (1) or not (0) */
+    mfu_copy_opts_t* copy_opts,    /* IN  - options for data compare/copy step */
+    uint64_t* count_bytes_read,    /* OUT - number of bytes read (src + dest) */
+    uint64_t* count_bytes_written, /* OUT - number of bytes written to dest */
+    mfu_progress* prg,             /* IN  - progress message structure */
+    mfu_file_t* mfu_src_file,      /* IN  - I/O filesystem functions to use for source */
+    mfu_file_t* mfu_dst_file)      /* IN  - I/O filesystem functions to use for destination */
+{
+    int rc = mfu_compare_contents_cached(src_name, dst_name, offset, length, file_size,
+        overwrite, copy_opts, count_bytes_read, count_bytes_written, prg,
+        mfu_src_file, mfu_dst_file);
+
+    /* close both files before returning */
+    if (mfu_compare_contents_close(mfu_src_file, mfu_dst_file) != 0) {
+        rc = -1;
+    }
 
     return rc;
 }
 
+/* close files left open by mfu_compare_contents_cached,
+ * returns 0 on success and -1 on error */
+int mfu_compare_contents_close(
+    mfu_file_t* mfu_src_file,      /* IN  - I/O filesystem functions to use for source */
+    mfu_file_t* mfu_dst_file)      /* IN  - I/O filesystem functions to use for destination */
+{
+    return mfu_copy_cache_close_files(mfu_src_file, mfu_dst_file);
+}
+
 /* compares targets of two symlinks, returns 0 if equal, positive value if
  * different, -1 on error when reading symlink. */
 int mfu_compare_symlinks(
@@ -1390,6 +1771,275 @@ bool mfu_alltrue(bool flag, MPI_Comm comm)
     return alltrue;
 }
 
+/* read the value in a cgroup file under dir into val,
+ * the string "max" reads as UINT64_MAX, returns 0 on success */
+static int mem_read_value(const char* dir, const char* file, uint64_t* val)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    int rc = -1;
+    char buf[64];
+    if (fgets(buf, sizeof(buf), fp) != NULL) {
+        if (strncmp(buf, "max", 3) == 0) {
+            *val = UINT64_MAX;
+            rc = 0;
+        } else {
+            char* end;
+            errno = 0;
+            unsigned long long value = strtoull(buf, &end, 10);
+            if (end != buf && errno == 0) {
+                *val = (uint64_t) value;
+                rc = 0;
+            }
+        }
+    }
+
+    fclose(fp);
+    return rc;
+}
+
+/* look up key in the memory.stat file under dir,
+ * returns 0 if not found */
+static uint64_t mem_read_stat(const char* dir, const char* key)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/memory.stat", dir);
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        return 0;
+    }
+
+    uint64_t val = 0;
+    size_t keylen = strlen(key);
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (strncmp(line, key, keylen) == 0 && line[keylen] == ' ') {
+            val = (uint64_t) strtoull(line + keylen + 1, NULL, 10);
+            break;
+        }
+    }
+
+    fclose(fp);
+    return val;
+}
+
+/* returns bytes that can still be charged to the cgroup at path under
+ * the hierarchy mounted at root before hitting the tightest limit set
+ * on it or any of its parents, page cache that can be dropped on
+ * demand counts as free, returns UINT64_MAX if there is no limit */
+static uint64_t mem_cgroup_headroom(
+    const char* root,       /* mount point of hierarchy */
+    const char* path,       /* cgroup path from /proc/self/cgroup */
+    const char* limit_file, /* file holding limit */
+    const char* usage_file, /* file holding current usage */
+    const char* cache_key)  /* memory.stat key of reclaimable cache */
+{
+    size_t rootlen = strlen(root);
+
+    /* within a cgroup namespace, our group is mounted at the root,
+     * so fall back to that if the full path does not exist */
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s%s", root, path);
+    if (access(dir, F_OK) != 0) {
+        snprintf(dir, sizeof(dir), "%s", root);
+    }
+    size_t len = strlen(dir);
+    while (len > rootlen && dir[len - 1] == '/') {
+        dir[--len] = '\0';
+    }
+
+    /* the limit of a parent applies to all groups below it */
+    uint64_t headroom = UINT64_MAX;
+    while (1) {
+        uint64_t limit, usage;
+        if (mem_read_value(dir, limit_file, &limit) == 0 &&
+            mem_read_value(dir, usage_file, &usage) == 0)
+        {
+            /* v1 reports no limit as a huge value rather than "max" */
+            if (limit < ((uint64_t)1 << 60)) {
+                uint64_t cache = mem_read_stat(dir, cache_key);
+                usage = (cache < usage) ? usage - cache : 0;
+                uint64_t left = (usage < limit) ? limit - usage : 0;
+                if (left < headroom) {
+                    headroom = left;
+                }
+            }
+        }
+
+        /* step up to parent, stop after the root */
+        char* slash = strrchr(dir, '/');
+        if (strlen(dir) <= rootlen || slash == NULL || slash < dir + rootlen) {
+            break;
+        }
+        *slash = '\0';
+    }
+
+    return headroom;
+}
+
+/* returns 1 if comma-separated list of controllers includes name */
+static int mem_has_controller(const char* list, const char* name)
+{
+    size_t namelen = strlen(name);
+    const char* p = list;
+    while (p != NULL) {
+        if (strncmp(p, name, namelen) == 0 && (p[namelen] == ',' || p[namelen] == '\0')) {
+            return 1;
+        }
+        p = strchr(p, ',');
+        if (p != NULL) {
+            p++;
+        }
+    }
+    return 0;
+}
+
+/* returns bytes left under the memory cgroup limits of the calling
+ * process, UINT64_MAX if none are set */
+static uint64_t mem_cgroup_available(void)
+{
+    uint64_t avail = UINT64_MAX;
+
+    FILE* fp = fopen("/proc/self/cgroup", "r");
+    if (fp == NULL) {
+        return avail;
+    }
+
+    /* each line is hierarchy-id:controllers:path,
+     * the v2 unified hierarchy has id 0 and no controllers */
+    char line[PATH_MAX + 64];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+
+        char* controllers = strchr(line, ':');
+        if (controllers == NULL) {
+            continue;
+        }
+        controllers++;
+        char* path = strchr(controllers, ':');
+        if (path == NULL) {
+            continue;
+        }
+        *path = '\0';
+        path++;
+
+        uint64_t left = UINT64_MAX;
+        if (controllers[0] == '\0') {
+            left = mem_cgroup_headroom("/sys/fs/cgroup", path,
+                "memory.max", "memory.current", "inactive_file");
+        } else if (mem_has_controller(controllers, "memory")) {
+            left = mem_cgroup_headroom("/sys/fs/cgroup/memory", path,
+                "memory.limit_in_bytes", "memory.usage_in_bytes", "total_inactive_file");
+        }
+        if (left < avail) {
+            avail = left;
+        }
+    }
+
+    fclose(fp);
+    return avail;
+}
+
+/* returns bytes of memory available on the node without swapping */
+static uint64_t mem_node_available(void)
+{
+    /* MemAvailable includes page cache that can be dropped */
+    uint64_t avail = 0;
+    FILE* fp = fopen("/proc/meminfo", "r");
+    if (fp != NULL) {
+        char line[256];
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            unsigned long long kb;
+            if (sscanf(line, "MemAvailable: %llu kB", &kb) == 1) {
+                avail = (uint64_t) kb * 1024;
+                break;
+            }
+        }
+        fclose(fp);
+    }
+
+    /* older kernels lack MemAvailable */
+    if (avail == 0) {
+        struct sysinfo info;
+        if (sysinfo(&info) == 0) {
+            avail = (uint64_t) info.freeram * (uint64_t) info.mem_unit;
+        }
+    }
+
+    return avail;
+}
+
+/* returns bytes left under the rlimit given by resource,
+ * used is the number of bytes already counted against it */
+static uint64_t mem_rlimit_available(int resource, uint64_t used)
+{
+    struct rlimit limit;
+    if (getrlimit(resource, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) {
+        return UINT64_MAX;
+    }
+    uint64_t max = (uint64_t) limit.rlim_cur;
+    return (used < max) ? max - used : 0;
+}
+
+uint64_t mfu_mem_budget(MPI_Comm comm)
+{
+    /* count procs of comm that share our node */
+    MPI_Comm node_comm;
+    int node_ranks;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_size(node_comm, &node_ranks);
+    MPI_Comm_free(&node_comm);
+
+    /* memory of the node and of a cgroup, as under slurm or
+     * in a container, is shared by all procs on the node */
+    uint64_t budget = mem_node_available();
+    uint64_t cgroup = mem_cgroup_available();
+    if (cgroup < budget) {
+        budget = cgroup;
+    }
+    budget /= (uint64_t) node_ranks;
+
+    /* rlimits apply to each process, statm lists the total size and
+     * the data size of the process in pages */
+    uint64_t vm_pages = 0;
+    uint64_t data_pages = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (fp != NULL) {
+        unsigned long long size, resident, shared, text, lib, data;
+        if (fscanf(fp, "%llu %llu %llu %llu %llu %llu",
+            &size, &resident, &shared, &text, &lib, &data) == 6)
+        {
+            vm_pages   = (uint64_t) size;
+            data_pages = (uint64_t) data;
+        }
+        fclose(fp);
+    }
+    uint64_t pagesize = (uint64_t) sysconf(_SC_PAGESIZE);
+    uint64_t left = mem_rlimit_available(RLIMIT_AS, vm_pages * pagesize);
+    if (left < budget) {
+        budget = left;
+    }
+    left = mem_rlimit_available(RLIMIT_DATA, data_pages * pagesize);
+    if (left < budget) {
+        budget = left;
+    }
+
+    /* user may ask for less */
+    if (mfu_memory_limit > 0 && mfu_memory_limit < budget) {
+        budget = mfu_memory_limit;
+    }
+
+    /* use the tightest budget so all procs agree */
+    uint64_t min_budget;
+    MPI_Allreduce(&budget, &min_budget, 1, MPI_UINT64_T, MPI_MIN, comm);
+    return min_budget;
+}
+
 /* given the rank of the calling process, the number of ranks,
  * and the number of items, compute starting offset and count
  * for the calling rank so as to evenly spread items across ranks */
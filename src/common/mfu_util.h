@@ -80,6 +80,10 @@ extern mfu_loglevel mfu_debug_level;
 /* defines timeout period between progress messages */
 extern int mfu_progress_timeout;
 
+/* max bytes a process should use for large buffers, 0 for no limit,
+ * see mfu_mem_budget */
+extern uint64_t mfu_memory_limit;
+
 #define MFU_LOG(level, ...) do {  \
         if (mfu_initialized && level <= mfu_debug_level) { \
             char timestamp[256]; \
@@ -239,6 +243,22 @@ void mfu_unpack_uint64(const char** pptr, uint64_t* value);
 /* Bob Jenkins one-at-a-time hash: http://en.wikipedia.org/wiki/Jenkins_hash_function */
 uint32_t mfu_hash_jenkins(const char* key, size_t len);
 
+/* returns 1 if all size bytes of buf are 0 and 0 otherwise,
+ * stops at the first non-zero word */
+int mfu_mem_is_zero(const void* buf, size_t size);
+
+/* returns offset of the first byte that differs between buf1 and buf2,
+ * returns size if the first size bytes of both buffers match */
+size_t mfu_mem_first_diff(const void* buf1, const void* buf2, size_t size);
+
+/* returns 1 if the first size bytes of buf1 and buf2 match and 0 otherwise */
+int mfu_mem_equal(const void* buf1, const void* buf2, size_t size);
+
+/* returns name of vector instruction set used by the mfu_mem functions,
+ * one of "generic", "sse2", "avx2", or "avx512", the best supported
+ * set is picked unless MFU_MEM_SIMD names another */
+const char* mfu_mem_simd(void);
+
 /* get secs and nsecs values from stat structure */
 void mfu_stat_get_atimes(const struct stat* sb, uint64_t* secs, uint64_t* nsecs);
 void mfu_stat_get_mtimes(const struct stat* sb, uint64_t* secs, uint64_t* nsecs);
@@ -266,6 +286,32 @@ int mfu_compare_contents(
     mfu_file_t* mfu_dst_file  /* IN  - I/O filesystem functions to use for destination */
 );
 
+/* same as mfu_compare_contents, but leaves the files open in a per-rank
+ * cache so that later calls on chunks of the same files skip the open,
+ * call mfu_compare_contents_close after the last comparison of a set */
+int mfu_compare_contents_cached(
+    const char* src,          /* IN  - path name to souce file */
+    const char* dst,          /* IN  - path name to destination file */
+    off_t offset,             /* IN  - offset with file to start comparison */
+    off_t length,             /* IN  - number of bytes to be compared */
+    off_t file_size,          /* IN  - size of file to be compared */
+    int overwrite,            /* IN  - whether to replace dest with source contents (1) or not (0) */
+    mfu_copy_opts_t* opts,    /* IN  - options to use in compare/copy */
+    uint64_t* bytes_read,     /* OUT - number of bytes read (src + dest) */
+    uint64_t* bytes_written,  /* OUT - number of bytes written to dest */
+    mfu_progress* prg,        /* IN  - progress message structure */
+    mfu_file_t* mfu_src_file, /* IN  - I/O filesystem functions to use for source */
+    mfu_file_t* mfu_dst_file  /* IN  - I/O filesystem functions to use for destination */
+);
+
+/* closes files that mfu_compare_contents_cached keeps open between calls,
+ * files opened for write are fsync'd, call after the last comparison
+ * of a set, returns 0 on success and -1 on error */
+int mfu_compare_contents_close(
+    mfu_file_t* mfu_src_file, /* IN  - I/O filesystem functions to use for source */
+    mfu_file_t* mfu_dst_file  /* IN  - I/O filesystem functions to use for destination */
+);
+
 /* compares targets of two symlinks, returns 0 if equal, positive value if
  * different, -1 on error when reading symlink. */
 int mfu_compare_symlinks(
@@ -291,6 +337,14 @@ bool mfu_is_hpss(const char* path);
  * returns 1 if all true and 0 otherwise */
 bool mfu_alltrue(bool flag, MPI_Comm comm);
 
+/* returns number of bytes each process on comm may allocate for
+ * buffers, this is the memory left under the memory cgroup limit
+ * (v1 or v2) or the available memory of the node, whichever is less,
+ * split among the procs of comm on that node, further capped by the
+ * data and address space rlimits and mfu_memory_limit,
+ * returns the minimum over all procs, collective */
+uint64_t mfu_mem_budget(MPI_Comm comm);
+
 /* given the rank of the calling process, the number of ranks,
  * and the number of items, compute starting offset and count
  * for the calling rank so as to evenly spread items across ranks */
@@ -23,6 +23,8 @@ static int opts_keep       = 0;
 static int opts_force      = 0;
 static ssize_t opts_memory = -1;
 static int opts_blocksize  = 9;
+static char* opts_codec    = NULL;
+static int opts_level      = -1;
 static int opts_verbose    = 0;
 static int opts_debug      = 0;
 
@@ -37,6 +39,9 @@ static void print_usage(void)
     printf("  -k, --keep             - keep existing input file\n");
     printf("  -f, --force            - overwrite output file\n");
     printf("  -b, --blocksize <num>  - block size (1-9)\n");
+    printf("  -t, --codec <name>     - compress in block format with bz2, gzip, zstd, or lz4\n");
+    printf("  -l, --level <num>      - compression level for --codec\n");
+    printf("  -m, --memory <size>    - max memory per process for buffers, e.g., 512MB\n");
     printf("  -v, --verbose          - verbose output\n");
     printf("  -q, --quiet            - quiet output\n");
     printf("  -h, --help             - print usage\n");
@@ -63,6 +68,9 @@ int main(int argc, char** argv)
         {"keep",       0, 0, 'k'},
         {"force",      0, 0, 'f'},
         {"blocksize",  1, 0, 'b'},
+        {"codec",      1, 0, 't'},
+        {"level",      1, 0, 'l'},
+        {"memory",     1, 0, 'm'},
         {"verbose",    0, 0, 'v'},
         {"quiet",      0, 0, 'q'},
         {"help",       0, 0, 'h'},
@@ -75,7 +83,7 @@ int main(int argc, char** argv)
     int usage = 0;
     while (1) {
         int c = getopt_long(
-                    argc, argv, "zdkfb:vqh",
+                    argc, argv, "zdkfb:t:l:m:vqh",
                     long_options, &option_index
                 );
 
@@ -100,8 +108,19 @@ int main(int argc, char** argv)
             case 'b':
                 opts_blocksize = atoi(optarg);
                 break;
+            case 't':
+                opts_codec = MFU_STRDUP(optarg);
+                break;
+            case 'l':
+                opts_level = atoi(optarg);
+                break;
             case 'm':
-                mfu_abtoull(optarg, &bytes);
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Invalid memory size: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
                 opts_memory = (ssize_t) bytes;
                 break;
             case 'v':
@@ -126,6 +145,11 @@ int main(int argc, char** argv)
         }
     }
 
+    /* limit memory used for compression buffers */
+    if (opts_memory > 0) {
+        mfu_memory_limit = (uint64_t) opts_memory;
+    }
+
     /* TODO: also bail if we can't find the file */
     /* print usage if we don't have a file name */
     if (argc - optind != 1) {
@@ -137,6 +161,15 @@ int main(int argc, char** argv)
         usage = 1;
     }
 
+    /* check that we know the codec */
+    mfu_codec_t codec = MFU_CODEC_NONE;
+    if (!usage && opts_codec != NULL && mfu_codec_parse(opts_codec, &codec) != MFU_SUCCESS) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Unknown or unavailable codec: `%s'", opts_codec);
+        }
+        usage = 1;
+    }
+
     /* print usage if we need to */
     if (usage) {
         if (rank == 0) {
@@ -182,15 +215,45 @@ int main(int argc, char** argv)
 
     /* generate target file name based on source file and operation */
     char fname_out[PATH_MAX];
+    int block_format = (codec != MFU_CODEC_NONE);
     if (opts_compress) {
-        /* generate source file namem with .dbz2 extension */
-        strncpy(fname_out, source_file, sizeof(fname_out));
-        strcat(fname_out, ".dbz2");
+        /* generate source file name with .dbz2 extension,
+         * or the extension of the codec */
+        const char* ext = block_format ? mfu_codec_ext(codec) : ".dbz2";
+        snprintf(fname_out, sizeof(fname_out), "%s%s", source_file, ext);
     } else {
-        /* generate file name without .dbz2 extension */
-        strncpy(fname_out, source_file, sizeof(fname_out));
+        /* generate file name without .dbz2 extension, any other
+         * known extension means the file is in block format */
+        strncpy(fname_out, source_file, sizeof(fname_out) - 1);
+        fname_out[sizeof(fname_out) - 1] = '\0';
         size_t len = strlen(fname_out);
-        fname_out[len - 5] = '\0';
+        size_t extlen = 0;
+        if (len > 5 && strcmp(fname_out + len - 5, ".dbz2") == 0) {
+            extlen = 5;
+        } else {
+            int c;
+            for (c = MFU_CODEC_BZ2; c <= MFU_CODEC_LZ4; c++) {
+                const char* ext = mfu_codec_ext((mfu_codec_t) c);
+                size_t n = (ext != NULL) ? strlen(ext) : 0;
+                if (n > 0 && len > n && strcmp(fname_out + len - n, ext) == 0) {
+                    extlen = n;
+                    block_format = 1;
+                    break;
+                }
+            }
+        }
+
+        if (extlen == 0) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Input file has an unknown extension: `%s'", source_file);
+            }
+            mfu_param_path_free_all(numpaths, paths);
+            mfu_file_delete(&mfu_file);
+            mfu_finalize();
+            MPI_Finalize();
+            return 1;
+        }
+        fname_out[len - extlen] = '\0';
     }
 
     /* delete target file if --force thrown */
@@ -218,9 +281,13 @@ int main(int argc, char** argv)
 
     /* compress or decompress file */
     int rc;
-    if (opts_compress) {
+    if (opts_compress && block_format) {
+        rc = mfu_compress_file(source_file, fname_out, codec, opts_level, 0);
+    } else if (opts_compress) {
         int b_size = (int)opts_blocksize;
         rc = mfu_compress_bz2(source_file, fname_out, b_size);
+    } else if (block_format) {
+        rc = mfu_decompress_file(source_file, fname_out);
     } else {
         rc = mfu_decompress_bz2(source_file, fname_out);
     }
@@ -250,6 +317,8 @@ int main(int argc, char** argv)
     /* free the mfu_file object */
     mfu_file_delete(&mfu_file);
 
+    mfu_free(&opts_codec);
+
     /* shut down MPI */
     mfu_finalize();
     MPI_Finalize();
@@ -46,6 +46,7 @@ static void print_usage(void)
 #endif
     printf("  -s, --direct              - open files with O_DIRECT\n");
     printf("      --open-noatime        - open files with O_NOATIME\n");
+    printf("      --open-files <N>      - max files each process keeps open to read and to write (default " MFU_OPEN_FILES_STR ")\n");
     printf("      --progress <N>        - print progress every N seconds\n");
     printf("  -v, --verbose             - verbose output\n");
     printf("  -q, --quiet               - quiet output\n");
@@ -838,7 +839,7 @@ static int dcmp_strmap_compare_data(
 
         /* compare the contents of the files */
         int overwrite = 0;
-        int compare_rc = mfu_compare_contents(src_p->name, dst_p->name, offset, length, filesize,
+        int compare_rc = mfu_compare_contents_cached(src_p->name, dst_p->name, offset, length, filesize,
                 overwrite, copy_opts, &bytes_read, &bytes_written, prg, mfu_src_file, mfu_dst_file);
         if (compare_rc == -1) {
             /* we hit an error while reading */
@@ -860,6 +861,11 @@ static int dcmp_strmap_compare_data(
         dst_p = dst_p->next;
     }
 
+    /* close files left open by the comparisons */
+    if (mfu_compare_contents_close(mfu_src_file, mfu_dst_file) != 0) {
+        rc = -1;
+    }
+
     /* finalize progress messages */
     uint64_t count_bytes[2];
     count_bytes[0] = bytes_read;
@@ -2145,6 +2151,7 @@ int main(int argc, char **argv)
         {"daos-api",      1, 0, 'x'},
         {"direct",        0, 0, 's'},
         {"open-noatime",  0, 0, 'U'},
+        {"open-files",    1, 0, 'F'},
         {"progress",      1, 0, 'R'},
         {"verbose",       0, 0, 'v'},
         {"quiet",         0, 0, 'q'},
@@ -2217,6 +2224,15 @@ int main(int argc, char **argv)
                 MFU_LOG(MFU_LOG_INFO, "Using O_NOATIME");
             }
             break;
+        case 'F':
+            copy_opts->open_files = atoi(optarg);
+            if (copy_opts->open_files < 1) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Number of --open-files must be positive: '%s'", optarg);
+                }
+                usage = 1;
+            }
+            break;
         case 'R':
             mfu_progress_timeout = atoi(optarg);
             break;
@@ -83,6 +83,8 @@ void print_usage(void)
 #endif
     printf("  -b, --bufsize <SIZE>     - IO buffer size in bytes (default " MFU_BUFFER_SIZE_STR ")\n");
     printf("  -k, --chunksize <SIZE>   - work size per task in bytes (default " MFU_CHUNK_SIZE_STR ")\n");
+    printf("      --small-size <SIZE>  - copy files smaller than SIZE in one pass, 0 to disable (default " MFU_SMALL_FILE_SIZE_STR ")\n");
+    printf("      --small-window <N>   - small files each process writes before flushing them (default " MFU_SMALL_FILE_WINDOW_STR ")\n");
     printf("  -X, --xattrs <OPT>       - copy xattrs (none, all, non-lustre, libattr)\n");
 #ifdef DAOS_SUPPORT
     printf("      --daos-api           - DAOS API in {DFS, DAOS} (default uses DFS for POSIX containers)\n");
@@ -91,12 +93,14 @@ void print_usage(void)
     					 "to write the metadata to is expected\n");
 #endif
 #endif
+    printf("  -H, --hardlinks          - copy files that share an inode once and hard link the other names\n");
     printf("  -i, --input <file>       - read source list from file\n");
     printf("  -L, --dereference        - copy original files instead of links\n");
     printf("  -P, --no-dereference     - don't follow links in source\n");
     printf("  -p, --preserve           - preserve permissions, ownership, timestamps (see also --xattrs)\n");
     printf("  -s, --direct             - open files with O_DIRECT\n");
     printf("      --open-noatime       - open files with O_NOATIME\n");
+    printf("      --open-files <N>     - max files each process keeps open to read and to write (default " MFU_OPEN_FILES_STR ")\n");
     printf("  -S, --sparse             - create sparse files when possible\n");
     printf("      --progress <N>       - print progress every N seconds\n");
     printf("  -G  --gid <GID>          - Set the group id to perform copy\n");
@@ -160,8 +164,11 @@ int main(int argc, char** argv)
         {"grouplock"            , required_argument, 0, 'g'}, // untested
         {"daos-api"             , required_argument, 0, 'y'},
         {"daos-preserve"        , required_argument, 0, 'D'},
+        {"hardlinks"            , no_argument      , 0, 'H'},
         {"input"                , required_argument, 0, 'i'},
         {"chunksize"            , required_argument, 0, 'k'},
+        {"small-size"           , required_argument, 0, 'Z'},
+        {"small-window"         , required_argument, 0, 'W'},
         {"xattrs"               , required_argument, 0, 'X'},
         {"dereference"          , no_argument      , 0, 'L'},
         {"no-dereference"       , no_argument      , 0, 'P'},
@@ -169,6 +176,7 @@ int main(int argc, char** argv)
         {"synchronous"          , no_argument      , 0, 's'},
         {"direct"               , no_argument      , 0, 's'},
         {"open-noatime"         , no_argument      , 0, 'A'},
+        {"open-files"           , required_argument, 0, 'F'},
         {"sparse"               , no_argument      , 0, 'S'},
         {"progress"             , required_argument, 0, 'R'},
         {"gid"                  , required_argument, 0, 'G'},
@@ -184,7 +192,7 @@ int main(int argc, char** argv)
     int usage = 0;
     while(1) {
         int c = getopt_long(
-                    argc, argv, "b:d:g:G:i:k:LPpsSU:vqhX:",
+                    argc, argv, "b:d:g:G:Hi:k:LPpsSU:vqhX:",
                     long_options, &option_index
                 );
 
@@ -297,6 +305,26 @@ int main(int argc, char** argv)
                     mfu_copy_opts->chunk_size = bytes;
                 }
                 break;
+            case 'Z':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse small file size: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->small_file_size = (uint64_t)bytes;
+                }
+                break;
+            case 'W':
+                mfu_copy_opts->small_file_window = atoi(optarg);
+                if (mfu_copy_opts->small_file_window < 1) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Number of --small-window files must be positive: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
             case 'L':
                 /* turn on dereference.
                  * turn off no_dereference */
@@ -329,6 +357,18 @@ int main(int argc, char** argv)
                     MFU_LOG(MFU_LOG_INFO, "Using O_NOATIME");
                 }
                 break;
+            case 'F':
+                mfu_copy_opts->open_files = atoi(optarg);
+                if (mfu_copy_opts->open_files < 1) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Number of --open-files must be positive: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
+            case 'H':
+                mfu_copy_opts->hardlinks = true;
+                break;
             case 'S':
                 mfu_copy_opts->sparse = 1;
                 if(rank == 0) {
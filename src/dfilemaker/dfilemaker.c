@@ -1073,10 +1073,12 @@ int main(int narg, char** arg)
     //  create directories and files
     //---------------------------------
     mfu_create_opts_t* create_opts = mfu_create_opts_new();
-    mfu_flist_mkdir(mybflist, create_opts);
-    mfu_flist_mknod(mybflist, create_opts);
+    mfu_file_t* mfu_file = mfu_file_new();
+    mfu_flist_mkdir(mybflist, create_opts, mfu_file);
+    mfu_flist_mknod(mybflist, create_opts, mfu_file);
     write_files(mybflist, filltype);
     mfu_free(&buf); // used only in write_files()->write_file()
+    mfu_file_delete(&mfu_file);
     mfu_create_opts_delete(&create_opts);
 
     //------------------------------------
@@ -51,6 +51,7 @@ static void print_usage(void)
     printf("      --name             - change regex to apply to entry name rather than full pathname\n");
     printf("      --dryrun           - print out list of files that would be deleted\n");
     printf("      --aggressive       - aggressive mode deletes files during the walk. You CANNOT use dryrun with this option. \n");
+    printf("      --purge            - remove items while reading directories without building a list\n");
     printf("  -T, --traceless        - remove child items without changing parent directory mtime\n");
     printf("      --progress <N>     - print progress every N seconds\n");
     printf("  -v, --verbose          - verbose output\n");
@@ -89,6 +90,7 @@ int main(int argc, char** argv)
     int dryrun       = 0;
     int traceless    = 0;
     int text         = 0;
+    int purge        = 0;
 
 #ifdef DAOS_SUPPORT
     /* DAOS vars */
@@ -118,6 +120,7 @@ int main(int argc, char** argv)
         {"name",        0, 0, 'n'},
         {"dryrun",      0, 0, 'd'},
         {"aggressive",  0, 0, 'A'},
+        {"purge",       0, 0, 'P'},
         {"traceless",   0, 0, 'T'},
         {"progress",    1, 0, 'R'},
         {"verbose",     0, 0, 'v'},
@@ -180,6 +183,9 @@ int main(int argc, char** argv)
                  * on one process */
                 walk_opts->use_stat = 1;
                 break;
+            case 'P':
+                purge = 1;
+                break;
             case 'T':
                 traceless = 1;
                 break;
@@ -317,6 +323,17 @@ daos_setup_done:
         usage = 1;
     }
 
+    /* purge removes items as it reads directories, so it needs
+     * paths to start from and it never has a list to filter or write */
+    if (purge && (!walk || dryrun || walk_opts->remove || outputname != NULL ||
+                  regex_exp != NULL || traceless))
+    {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Cannot use --purge with --input, --output, --dryrun, --aggressive, --match, --exclude, or --traceless.");
+        }
+        usage = 1;
+    }
+
     /* print usage if we need to */
     if (usage) {
         if (rank == 0) {
@@ -331,6 +348,24 @@ daos_setup_done:
         return 1;
     }
 
+    /* remove items directly from the directory entries */
+    if (purge) {
+        if (mfu_flist_purge_param_paths(numpaths, paths, mfu_file) != 0) {
+            rc = 1;
+        }
+
+#ifdef DAOS_SUPPORT
+        daos_cleanup(daos_args, mfu_file, NULL);
+#endif
+        mfu_param_path_free_all(numpaths, paths);
+        mfu_free(&paths);
+        mfu_walk_opts_delete(&walk_opts);
+        mfu_file_delete(&mfu_file);
+        mfu_finalize();
+        MPI_Finalize();
+        return rc;
+    }
+
     /* create an empty file list */
     mfu_flist flist = mfu_flist_new();
 
@@ -365,7 +400,10 @@ daos_setup_done:
         mfu_flist_print(srclist);
     } else {
         /* remove files */
-        mfu_flist_unlink(srclist, traceless, mfu_file);
+        int tmp_rc = mfu_flist_unlink(srclist, traceless, mfu_file);
+        if (tmp_rc != 0) {
+            rc = 1;
+        }
     }
 
     /* write data to cache file */
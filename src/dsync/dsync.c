@@ -76,6 +76,9 @@ static void print_usage(void)
     printf("  -P, --no-dereference    - don't follow links in source\n"); 
     printf("  -s, --direct            - open files with O_DIRECT\n");
     printf("      --open-noatime      - open files with O_NOATIME\n");
+    printf("      --open-files <N>    - max files each process keeps open to read and to write (default " MFU_OPEN_FILES_STR ")\n");
+    printf("      --small-size <SIZE> - copy files smaller than SIZE in one pass, 0 to disable (default " MFU_SMALL_FILE_SIZE_STR ")\n");
+    printf("      --small-window <N>  - small files each process writes before flushing them (default " MFU_SMALL_FILE_WINDOW_STR ")\n");
     printf("      --link-dest <DIR>   - hardlink to files in DIR when unchanged\n");
     printf("  -S, --sparse            - create sparse files when possible\n");
     printf("      --progress <N>      - print progress every N seconds\n");
@@ -784,7 +787,7 @@ static void dsync_strmap_compare_data_link_dest(
         off_t filesize = (off_t)src_p->file_size;
         
         /* compare the contents of the files */
-        int compare_rc = mfu_compare_contents(src_p->name, dst_p->name, offset, length, filesize,
+        int compare_rc = mfu_compare_contents_cached(src_p->name, dst_p->name, offset, length, filesize,
                 overwrite, copy_opts, count_bytes_read, count_bytes_written, compare_prog,
                 mfu_src_file, mfu_dst_file);
         if (compare_rc == -1) {
@@ -807,6 +810,11 @@ static void dsync_strmap_compare_data_link_dest(
         dst_p = dst_p->next;
     }
 
+    /* close files left open by the comparisons */
+    if (mfu_compare_contents_close(mfu_src_file, mfu_dst_file) != 0) {
+        rc = -1;
+    }
+
     /* finalize progress messages */
     count_bytes[0] = *count_bytes_read;
     count_bytes[1] = *count_bytes_written;
@@ -924,7 +932,7 @@ static int dsync_strmap_compare_data(
         off_t filesize = (off_t)src_p->file_size;
         
         /* compare the contents of the files */
-        int compare_rc = mfu_compare_contents(src_p->name, dst_p->name, offset, length, filesize,
+        int compare_rc = mfu_compare_contents_cached(src_p->name, dst_p->name, offset, length, filesize,
                 overwrite, copy_opts, count_bytes_read, count_bytes_written, compare_prog,
                 mfu_src_file, mfu_dst_file);
         if (compare_rc == -1) {
@@ -947,6 +955,11 @@ static int dsync_strmap_compare_data(
         dst_p = dst_p->next;
     }
 
+    /* close files left open by the comparisons */
+    if (mfu_compare_contents_close(mfu_src_file, mfu_dst_file) != 0) {
+        rc = -1;
+    }
+
     /* finalize progress messages */
     count_bytes[0] = *count_bytes_read;
     count_bytes[1] = *count_bytes_written;
@@ -1387,7 +1400,10 @@ static int dsync_sync_files(
         if (rank == 0) {
             MFU_LOG(MFU_LOG_INFO, "Deleting items from destination");
         }
-        mfu_flist_unlink(dst_remove_list, 0, mfu_dst_file);
+        tmp_rc = mfu_flist_unlink(dst_remove_list, 0, mfu_dst_file);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
     }
 
     /* summarize the src copy list for files
@@ -3082,6 +3098,9 @@ int main(int argc, char **argv)
         {"no-dereference", 0, 0, 'P'},
         {"direct",         0, 0, 's'},
         {"open-noatime",   0, 0, 'U'},
+        {"open-files",     1, 0, 'F'},
+        {"small-size",     1, 0, 'Z'},
+        {"small-window",   1, 0, 'W'},
         {"output",         1, 0, 'o'}, // undocumented
         {"debug",          0, 0, 'd'}, // undocumented
         {"link-dest",      1, 0, 'l'},
@@ -3191,6 +3210,35 @@ int main(int argc, char **argv)
                 MFU_LOG(MFU_LOG_INFO, "Using O_NOATIME");
             }
             break;
+        case 'F':
+            copy_opts->open_files = atoi(optarg);
+            if (copy_opts->open_files < 1) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Number of --open-files must be positive: '%s'", optarg);
+                }
+                usage = 1;
+            }
+            break;
+        case 'Z':
+            if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR,
+                            "Failed to parse small file size: '%s'", optarg);
+                }
+                usage = 1;
+            } else {
+                copy_opts->small_file_size = (uint64_t)bytes;
+            }
+            break;
+        case 'W':
+            copy_opts->small_file_window = atoi(optarg);
+            if (copy_opts->small_file_window < 1) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Number of --small-window files must be positive: '%s'", optarg);
+                }
+                usage = 1;
+            }
+            break;
         case 'l':
             options.link_dest = MFU_STRDUP(optarg);
             break;
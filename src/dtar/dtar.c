@@ -19,6 +19,11 @@
 
 #include "mfu.h"
 
+/* for daos */
+#ifdef DAOS_SUPPORT
+#include "mfu_daos.h"
+#endif
+
 static void DTAR_abort(int code)
 {
     MPI_Abort(MPI_COMM_WORLD, code);
@@ -119,6 +124,337 @@ static int add_parent_dirs(
     return rc;
 }
 
+/* number and size of files each rank writes for the benchmark */
+#define BENCH_SMALL_FILES 256
+#define BENCH_SMALL_SIZE  (4 * 1024)
+#define BENCH_MEDIUM_FILES 16
+#define BENCH_MEDIUM_SIZE (1024 * 1024)
+
+/* one timed run of the benchmark */
+typedef struct {
+    const char* op;   /* operation: create, extract, or scan */
+    const char* algo; /* algorithm selected through the environment */
+    double secs;      /* time of the run in seconds */
+    int rc;           /* return code of the run */
+} bench_result;
+
+/* write a file of size bytes filled from buf, returns MFU_SUCCESS or MFU_FAILURE */
+static int bench_write_file(const char* name, const char* buf, size_t bufsize, uint64_t size)
+{
+    int fd = mfu_open(name, O_WRONLY | O_CREAT | O_TRUNC, 0660);
+    if (fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to create '%s' errno=%d %s",
+            name, errno, strerror(errno));
+        return MFU_FAILURE;
+    }
+
+    int rc = MFU_SUCCESS;
+    uint64_t written = 0;
+    while (written < size) {
+        size_t count = bufsize;
+        if (size - written < (uint64_t) count) {
+            count = (size_t) (size - written);
+        }
+        ssize_t nwrite = mfu_write(name, fd, buf, count);
+        if (nwrite < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to write '%s' errno=%d %s",
+                name, errno, strerror(errno));
+            rc = MFU_FAILURE;
+            break;
+        }
+        written += (uint64_t) nwrite;
+    }
+    mfu_close(name, fd);
+    return rc;
+}
+
+/* Build the synthetic dataset under src: each rank writes a directory
+ * of many small files and a few medium files, and rank 0 also writes
+ * one large file of several chunks per rank, so that the chunks to copy
+ * vary widely in cost, collective */
+static int bench_create_dataset(const char* src, mfu_archive_opts_t* opts)
+{
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    if (rank == 0) {
+        mfu_mkdir(src, S_IRWXU);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    size_t bufsize = opts->buf_size;
+    char* buf = (char*) MFU_MALLOC(bufsize);
+    size_t i;
+    for (i = 0; i < bufsize; i++) {
+        buf[i] = (char) ('a' + (rank + i) % 26);
+    }
+
+    int rc = MFU_SUCCESS;
+    char name[PATH_MAX];
+    snprintf(name, sizeof(name), "%s/rank.%d", src, rank);
+    if (mfu_mkdir(name, S_IRWXU) < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to create '%s' errno=%d %s",
+            name, errno, strerror(errno));
+        rc = MFU_FAILURE;
+    }
+
+    int j;
+    for (j = 0; j < BENCH_SMALL_FILES && rc == MFU_SUCCESS; j++) {
+        snprintf(name, sizeof(name), "%s/rank.%d/small.%d", src, rank, j);
+        rc = bench_write_file(name, buf, bufsize, BENCH_SMALL_SIZE);
+    }
+    for (j = 0; j < BENCH_MEDIUM_FILES && rc == MFU_SUCCESS; j++) {
+        snprintf(name, sizeof(name), "%s/rank.%d/medium.%d", src, rank, j);
+        rc = bench_write_file(name, buf, bufsize, BENCH_MEDIUM_SIZE);
+    }
+    if (rank == 0 && rc == MFU_SUCCESS) {
+        snprintf(name, sizeof(name), "%s/large", src);
+        rc = bench_write_file(name, buf, bufsize, (uint64_t) ranks * 4 * opts->chunk_size);
+    }
+
+    mfu_free(&buf);
+
+    if (! mfu_alltrue(rc == MFU_SUCCESS, MPI_COMM_WORLD)) {
+        rc = MFU_FAILURE;
+    }
+    return rc;
+}
+
+/* delete path and everything below it, collective */
+static void bench_remove(const char* path, mfu_file_t* mfu_file)
+{
+    mfu_param_path param;
+    mfu_param_path_set(path, &param, mfu_file, true);
+    if (param.path_stat_valid) {
+        mfu_flist_purge_param_paths(1, &param, mfu_file);
+    }
+    mfu_param_path_free(&param);
+}
+
+/* delete an archive and any index file next to it, collective */
+static void bench_remove_archive(const char* tarfile)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        char idxfile[PATH_MAX];
+        snprintf(idxfile, sizeof(idxfile), "%s.dtaridx", tarfile);
+        mfu_unlink(tarfile);
+        mfu_unlink(idxfile);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+/* Time each archive algorithm on a synthetic dataset built in dir,
+ * which must already exist.  Algorithms are selected through the same
+ * environment variables users set, and DEFAULT runs let the library
+ * choose on its own.  Prints a table of results to outfile if given
+ * and to stdout otherwise, then deletes everything it created,
+ * collective */
+static int run_bench(const char* dir, const char* outfile,
+    mfu_archive_opts_t* opts, mfu_walk_opts_t* walk_opts, mfu_file_t* mfu_file)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* work from within the benchmark directory */
+    char oldcwd[PATH_MAX];
+    mfu_getcwd(oldcwd, PATH_MAX);
+    if (! mfu_alltrue(chdir(dir) == 0, MPI_COMM_WORLD)) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to change directory to '%s'", dir);
+        }
+        return MFU_FAILURE;
+    }
+
+    char cwd[PATH_MAX];
+    mfu_getcwd(cwd, PATH_MAX);
+    mfu_param_path cwd_param;
+    mfu_param_path_set(cwd, &cwd_param, mfu_file, true);
+
+    char out[PATH_MAX + sizeof("/dtar_bench.out")];
+    snprintf(out, sizeof(out), "%s/dtar_bench.out", cwd);
+
+    /* build and walk the dataset */
+    const char* src = "dtar_bench.src";
+    const char* tarfile = "dtar_bench.tar";
+    int rc = bench_create_dataset(src, opts);
+    mfu_param_path src_param;
+    mfu_param_path_set(src, &src_param, mfu_file, true);
+    mfu_flist flist = mfu_flist_new();
+    if (rc == MFU_SUCCESS) {
+        mfu_flist_walk_param_paths(1, &src_param, walk_opts, flist, mfu_file);
+    }
+
+    /* total bytes of file data to compute rates */
+    uint64_t idx;
+    uint64_t bytes = 0;
+    uint64_t size = mfu_flist_size(flist);
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(flist, idx) == MFU_TYPE_FILE) {
+            bytes += mfu_flist_file_get_size(flist, idx);
+        }
+    }
+    uint64_t total_bytes;
+    MPI_Allreduce(&bytes, &total_bytes, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    const char* create_algos[]  = {"CHUNK", "LIBCIRCLE", "DEFAULT"};
+    const char* extract_algos[] = {"LIBARCHIVE", "LIBARCHIVE_IDX", "CHUNK", "LIBCIRCLE", "DEFAULT"};
+    const char* scan_algos[]    = {"SINGLE", "LINEAR", "PARALLEL", "DEFAULT"};
+    int num_create  = (int) (sizeof(create_algos)  / sizeof(create_algos[0]));
+    int num_extract = (int) (sizeof(extract_algos) / sizeof(extract_algos[0]));
+    int num_scan    = (int) (sizeof(scan_algos)    / sizeof(scan_algos[0]));
+    bench_result results[3 + 5 + 4];
+    int count = 0;
+
+    /* set if we could not get back into the benchmark directory,
+     * in which case we skip everything that uses relative paths */
+    int lost_cwd = 0;
+
+    int i;
+    double start;
+    for (i = 0; i < num_create && rc == MFU_SUCCESS; i++) {
+        bench_remove_archive(tarfile);
+        setenv("MFU_FLIST_ARCHIVE_CREATE", create_algos[i], 1);
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = MPI_Wtime();
+        results[count].rc = mfu_flist_archive_create(flist, tarfile, 1, &src_param, &cwd_param, opts, mfu_file);
+        results[count].secs = MPI_Wtime() - start;
+        results[count].op   = "create";
+        results[count].algo = create_algos[i];
+        count++;
+    }
+    unsetenv("MFU_FLIST_ARCHIVE_CREATE");
+
+    /* extract the archive from the last create into a fresh directory each time */
+    for (i = 0; i < num_extract && rc == MFU_SUCCESS; i++) {
+        bench_remove(out, mfu_file);
+        if (rank == 0) {
+            mfu_mkdir(out, S_IRWXU);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        mfu_param_path out_param;
+        mfu_param_path_set(out, &out_param, mfu_file, true);
+        char archive[PATH_MAX + sizeof("/dtar_bench.tar")];
+        snprintf(archive, sizeof(archive), "%s/%s", cwd, tarfile);
+
+        setenv("MFU_FLIST_ARCHIVE_EXTRACT", extract_algos[i], 1);
+        int chdir_rc = chdir(out);
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = MPI_Wtime();
+        results[count].rc = mfu_flist_archive_extract(archive, &out_param, opts, mfu_file);
+        results[count].secs = MPI_Wtime() - start;
+        results[count].op   = "extract";
+        results[count].algo = extract_algos[i];
+        if (chdir_rc != 0) {
+            results[count].rc = MFU_FAILURE;
+        }
+        count++;
+        mfu_param_path_free(&out_param);
+
+        if (! mfu_alltrue(chdir(cwd) == 0, MPI_COMM_WORLD)) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to change directory to '%s'", cwd);
+            }
+            lost_cwd = 1;
+            rc = MFU_FAILURE;
+        }
+    }
+    unsetenv("MFU_FLIST_ARCHIVE_EXTRACT");
+    bench_remove(out, mfu_file);
+
+    /* scanning is only needed without an index, so write the index
+     * to a separate file and delete it, then list the archive */
+    if (rc == MFU_SUCCESS) {
+        bench_remove_archive(tarfile);
+        setenv("MFU_FLIST_ARCHIVE_INDEX", "FILE", 1);
+        rc = mfu_flist_archive_create(flist, tarfile, 1, &src_param, &cwd_param, opts, mfu_file);
+        unsetenv("MFU_FLIST_ARCHIVE_INDEX");
+        if (rank == 0) {
+            char idxfile[PATH_MAX];
+            snprintf(idxfile, sizeof(idxfile), "%s.dtaridx", tarfile);
+            mfu_unlink(idxfile);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+    for (i = 0; i < num_scan && rc == MFU_SUCCESS; i++) {
+        if (strcmp(scan_algos[i], "DEFAULT") == 0) {
+            unsetenv("MFU_FLIST_ARCHIVE_SCAN");
+        } else {
+            setenv("MFU_FLIST_ARCHIVE_SCAN", scan_algos[i], 1);
+        }
+        mfu_flist list = mfu_flist_new();
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = MPI_Wtime();
+        results[count].rc = mfu_flist_archive_list(tarfile, &cwd_param, opts, list);
+        results[count].secs = MPI_Wtime() - start;
+        results[count].op   = "scan";
+        results[count].algo = scan_algos[i];
+        count++;
+        mfu_flist_free(&list);
+    }
+    unsetenv("MFU_FLIST_ARCHIVE_SCAN");
+
+    /* print the table */
+    if (rank == 0 && count > 0) {
+        FILE* fp = stdout;
+        if (outfile != NULL) {
+            fp = fopen(outfile, "w");
+            if (fp == NULL) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to open '%s' errno=%d %s",
+                    outfile, errno, strerror(errno));
+                fp = stdout;
+            }
+        }
+
+        int ranks;
+        MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+        uint64_t total_items = mfu_flist_global_size(flist);
+        double items = (double) total_items;
+        double mb = (double) total_bytes / (1024.0 * 1024.0);
+        fprintf(fp, "# %llu items, %.1f MiB, %d ranks\n",
+            (unsigned long long) total_items, mb, ranks);
+        fprintf(fp, "%-8s %-15s %10s %10s %12s %s\n",
+            "op", "algorithm", "seconds", "MiB/s", "items/s", "status");
+        for (i = 0; i < count; i++) {
+            double secs = results[i].secs;
+            fprintf(fp, "%-8s %-15s %10.3f %10.1f %12.1f %s\n",
+                results[i].op, results[i].algo, secs,
+                (secs > 0.0) ? mb / secs : 0.0,
+                (secs > 0.0) ? items / secs : 0.0,
+                (results[i].rc == MFU_SUCCESS) ? "ok" : "failed");
+        }
+
+        if (fp != stdout) {
+            fclose(fp);
+        }
+    }
+
+    /* clean up */
+    mfu_flist_free(&flist);
+    if (! lost_cwd) {
+        bench_remove_archive(tarfile);
+    }
+    bench_remove(src_param.path, mfu_file);
+    mfu_param_path_free(&src_param);
+    mfu_param_path_free(&cwd_param);
+    if (! mfu_alltrue(chdir(oldcwd) == 0, MPI_COMM_WORLD)) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to change directory to '%s'", oldcwd);
+        }
+        rc = MFU_FAILURE;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (results[i].rc != MFU_SUCCESS) {
+            rc = MFU_FAILURE;
+        }
+    }
+    return rc;
+}
+
 /* TODO: add options
  *   --index-skip -- avoid trying to index and extract entries the hard way (round robin)
  *   --index-nowrite -- do not save index after indexing
@@ -129,14 +465,31 @@ static int add_parent_dirs(
 static void print_usage(void)
 {
     printf("\n");
-    printf("Usage: dtar [options] <source ...>\n");
+    printf("Usage: dtar [options] -c -f <archive> <source ...>\n");
+    printf("       dtar [options] -u -f <archive> <source ...>\n");
+    printf("       dtar [options] -x -f <archive> [member ...]\n");
+    printf("       dtar [options] -t -f <archive> [member ...]\n");
+    printf("       dtar [options] --bench <DIR>\n");
+#ifdef DAOS_SUPPORT
+    printf("\n");
+    printf("DAOS paths can be specified as:\n");
+    printf("       daos://<pool>/<cont>[/<path>] | <UNS path>\n");
+    printf("A DAOS path may be given as the one source to -c or -u, or as the\n");
+    printf("directory to -C with -x, the archive file itself is always POSIX\n");
+#endif
     printf("\n");
     printf("Options:\n");
     printf("  -c, --create            - create archive\n");
+    printf("  -u, --update            - append new and changed files to archive\n");
     printf("  -x, --extract           - extract archive\n");
+    printf("  -t, --list              - list archive entries from its index\n");
+    printf("  -o, --output <FILE>     - use with -t; write list to file in binary format,\n");
+    printf("                            use with --bench; write table to file\n");
+    printf("      --text              - use with -o; write list to file in ascii format\n");
+    printf("      --bench <DIR>       - time each archive algorithm on files written in DIR\n");
     printf("  -f, --file <FILE>       - specify archive file\n");
     printf("  -C, --chdir <DIR>       - change directory to DIR before executing\n");
-//    printf("  -j, --compress          - compress archive\n");
+    printf("  -j, --compress <CODEC>  - compress archive with bz2, gzip, zstd, or lz4\n");
 //    printf("  -p, --preserve          - preserve attributes\n");
     printf("      --preserve-owner    - preserve owner/group (default effective uid/gid)\n");
     printf("      --preserve-times    - preserve atime/mtime (default current time)\n");
@@ -170,6 +523,15 @@ int main(int argc, char** argv)
     /* pointer to mfu_file src object */
     mfu_file_t* mfu_src_file = mfu_file_new();
 
+    /* the archive file itself is always read and written through POSIX */
+    mfu_file_t* mfu_archive_file = mfu_file_new();
+    mfu_archive_file->type = POSIX;
+
+#ifdef DAOS_SUPPORT
+    /* DAOS vars */
+    daos_args_t* daos_args = daos_args_new();
+#endif
+
     /* pointer to mfu_walk_opts */
     mfu_walk_opts_t* walk_opts = mfu_walk_opts_new();
 
@@ -181,16 +543,26 @@ int main(int argc, char** argv)
 
     int     opts_help     = 0;
     int     opts_create   = 0;
+    int     opts_update   = 0;
     int     opts_extract  = 0;
-    int     opts_compress = 0;
+    int     opts_list     = 0;
+    int     opts_text     = 0;
+    char*   opts_output   = NULL;
+    char*   opts_bench    = NULL;
+    char*   opts_compress = NULL;
     char*   opts_tarfile  = NULL;
     char*   opts_chdir    = NULL;
 
     int option_index = 0;
     static struct option long_options[] = {
         {"create",    0, 0, 'c'},
+        {"update",    0, 0, 'u'},
         {"extract",   0, 0, 'x'},
-        //{"compress",  0, 0, 'j'},
+        {"list",      0, 0, 't'},
+        {"output",    1, 0, 'o'},
+        {"text",      0, 0, 'E'},
+        {"bench",     1, 0, 'B'},
+        {"compress",  1, 0, 'j'},
         {"file",      1, 0, 'f'},
         {"chdir",     1, 0, 'C'},
         {"preserve",  0, 0, 'p'},
@@ -217,7 +589,7 @@ int main(int argc, char** argv)
     int usage = 0;
     while (1) {
         int c = getopt_long(
-                    argc, argv, "cxf:C:pb:k:vqh",
+                    argc, argv, "cuxto:f:C:j:pb:k:vqh",
                     long_options, &option_index
                 );
 
@@ -230,9 +602,24 @@ int main(int argc, char** argv)
             case 'c':
                 opts_create = 1;
                 break;
+            case 'u':
+                opts_update = 1;
+                break;
             case 'x':
                 opts_extract = 1;
                 break;
+            case 't':
+                opts_list = 1;
+                break;
+            case 'o':
+                opts_output = MFU_STRDUP(optarg);
+                break;
+            case 'E':
+                opts_text = 1;
+                break;
+            case 'B':
+                opts_bench = MFU_STRDUP(optarg);
+                break;
             case 'f':
                 opts_tarfile = MFU_STRDUP(optarg);
                 break;
@@ -240,7 +627,7 @@ int main(int argc, char** argv)
                 opts_chdir = MFU_STRDUP(optarg);
                 break;
             case 'j':
-                opts_compress = 1;
+                opts_compress = MFU_STRDUP(optarg);
                 break;
             case 'p':
                 archive_opts->preserve = true;
@@ -335,28 +722,58 @@ int main(int argc, char** argv)
         usage = 1;
     }
 
-    if (!opts_create && !opts_extract && !opts_help) {
+    int opts_benchmark = (opts_bench != NULL);
+    if (!opts_create && !opts_update && !opts_extract && !opts_list && !opts_benchmark && !opts_help) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "One of extract(x), create(c), update(u), list(t), or bench needs to be specified");
+        }
+        usage = 1;
+    }
+
+    if (opts_create + opts_update + opts_extract + opts_list + opts_benchmark > 1) {
         if (rank == 0) {
-            MFU_LOG(MFU_LOG_ERR, "One of extract(x) or create(c) needs to be specified");
+            MFU_LOG(MFU_LOG_ERR, "Only one of extraction(x), create(c), update(u), list(t), or bench can be specified");
         }
         usage = 1;
     }
 
-    if (opts_create && opts_extract) {
+    /* new entries are appended in place, which a compressed archive can't take */
+    if (opts_update && opts_compress != NULL) {
         if (rank == 0) {
-            MFU_LOG(MFU_LOG_ERR, "Only one of extraction(x) or create(c) can be specified");
+            MFU_LOG(MFU_LOG_ERR, "Cannot update(u) a compressed(j) archive");
         }
         usage = 1;
     }
 
-    /* when creating a tarbll, we require a file name */
-    if (opts_create && opts_tarfile == NULL) {
+    /* when creating, extracting, or listing a tarbll, we require a file name */
+    if ((opts_create || opts_update || opts_extract || opts_list) && opts_tarfile == NULL) {
         if (rank == 0) {
             MFU_LOG(MFU_LOG_ERR, "Must specify a file name(-f)");
         }
         usage = 1;
     }
 
+    /* check that we know the codec */
+    mfu_codec_t codec = MFU_CODEC_NONE;
+    if (opts_compress != NULL && mfu_codec_parse(opts_compress, &codec) != MFU_SUCCESS) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Unknown or unavailable codec: '%s'", opts_compress);
+        }
+        usage = 1;
+    }
+
+    /* a compressed archive is written with the extension of its codec */
+    if (codec != MFU_CODEC_NONE && opts_create && ! usage) {
+        const char* ext = mfu_codec_ext(codec);
+        size_t size = strlen(opts_tarfile) + strlen(ext) + 1;
+        char* fname = (char*) MFU_MALLOC(size);
+        snprintf(fname, size, "%s%s", opts_tarfile, ext);
+        mfu_free(&opts_tarfile);
+        opts_tarfile = fname;
+
+        archive_opts->codec = codec;
+    }
+
     /* print usage if we need to */
     if (usage) {
         if (rank == 0) {
@@ -377,8 +794,68 @@ int main(int argc, char** argv)
     int numpaths = argc - optind;
     const char** pathlist = (const char**) &argv[optind];
 
-    /* change directory if requested */
-    if (opts_chdir != NULL) {
+    /* path within a DAOS container to use as the current working dir */
+    char* daos_cwd = NULL;
+
+#ifdef DAOS_SUPPORT
+    /* items are read from a DAOS container when the source of a create
+     * is a DAOS path, and written to one when extracting to a -C DAOS path */
+    char* daos_paths[1] = { NULL };
+    if ((opts_create || opts_update) && numpaths > 0) {
+        daos_paths[0] = (char*) pathlist[0];
+    } else if (opts_extract && opts_chdir != NULL) {
+        daos_paths[0] = opts_chdir;
+
+        /* extracting always requires write permission */
+        daos_args->default_src_cont_open_flags = DAOS_COO_RW;
+    }
+
+    if (daos_paths[0] != NULL) {
+        /* Set up DAOS arguments, containers, dfs, etc. */
+        int daos_rc = daos_setup(rank, daos_paths, 1, daos_args, mfu_src_file, NULL);
+        if (daos_rc != 0) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Detected one or more DAOS errors: "MFU_ERRF, MFU_ERRP(-MFU_ERR_DAOS));
+            }
+            daos_cleanup(daos_args, mfu_src_file, NULL);
+            DTAR_exit(EXIT_FAILURE);
+        }
+
+        /* Not yet supported */
+        if (mfu_src_file->type == DAOS) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "dtar only supports DAOS POSIX containers with the DFS API.");
+            }
+            daos_cleanup(daos_args, mfu_src_file, NULL);
+            DTAR_exit(EXIT_FAILURE);
+        }
+
+        if (mfu_src_file->type == DFS) {
+            if (opts_extract) {
+                /* extract under the path within the container */
+                daos_cwd = MFU_STRDUP(daos_paths[0]);
+            } else if (numpaths != 1) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "dtar only supports a single DAOS source path");
+                }
+                daos_cleanup(daos_args, mfu_src_file, NULL);
+                DTAR_exit(EXIT_FAILURE);
+            } else {
+                /* name entries relative to the parent of the source,
+                 * as tar would after changing to that directory */
+                pathlist[0] = daos_paths[0];
+                mfu_path* parent = mfu_path_from_str(daos_paths[0]);
+                mfu_path_dirname(parent);
+                daos_cwd = mfu_path_strdup(parent);
+                mfu_path_delete(&parent);
+            }
+        }
+    }
+#endif
+
+    /* change directory if requested, when extracting into a DAOS
+     * container, the path is used as the working dir instead */
+    if (opts_chdir != NULL && !(opts_extract && daos_cwd != NULL)) {
         /* change directory, and check that all processes succeeded */
         int chdir_rc = chdir(opts_chdir);
         if (! mfu_alltrue(chdir_rc == 0, MPI_COMM_WORLD)) {
@@ -393,11 +870,18 @@ int main(int argc, char** argv)
     /* standardize current working dir */
     mfu_param_path cwd_param;
     char cwd[PATH_MAX];
-    mfu_getcwd(cwd, PATH_MAX);
+    if (daos_cwd != NULL) {
+        snprintf(cwd, sizeof(cwd), "%s", daos_cwd);
+    } else {
+        mfu_getcwd(cwd, PATH_MAX);
+    }
     mfu_param_path_set(cwd, &cwd_param, mfu_src_file, true);
 
     int ret = MFU_SUCCESS;
-    if (opts_create) {
+    if (opts_create || opts_update) {
+        /* add to the archive if it exists rather than replacing it */
+        archive_opts->update = (opts_update != 0);
+
         /* allocate space to record info for each source */
         mfu_param_path* paths = (mfu_param_path*) MFU_MALLOC(numpaths * sizeof(mfu_param_path));
 
@@ -406,15 +890,16 @@ int main(int argc, char** argv)
 
         /* standardize destination path */
         mfu_param_path destpath;
-        mfu_param_path_set(opts_tarfile, &destpath, mfu_src_file, false);
+        mfu_param_path_set(opts_tarfile, &destpath, mfu_archive_file, false);
 
         /* if we have an existing archive, it is deleted in check_archive so that we don't
          * walk it to be included as an entry of the archive itself in the target archive
-         * happens to be in the directory we are walking */
+         * happens to be in the directory we are walking, when updating, it is kept and
+         * skipped as an entry instead */
 
         /* check that source and destination are okay */
         int valid;
-        mfu_param_path_check_archive(numpaths, paths, destpath, archive_opts, &valid);
+        mfu_param_path_check_archive(numpaths, paths, destpath, archive_opts, &valid, mfu_src_file);
 
         /* walk path to get stats info on all files */
         mfu_flist flist = mfu_flist_new();
@@ -437,27 +922,8 @@ int main(int argc, char** argv)
         mfu_flist_free(&flist);
         flist = flist2;
 
-        /* create the archive file */
-        ret = mfu_flist_archive_create(flist, opts_tarfile, numpaths, paths, &cwd_param, archive_opts);
-
-#if 0
-        /* compress archive file */
-        if (opts_compress) {
-            struct stat st;
-            char fname[50];
-            char fname1[50];
-            strncpy(fname1, opts_tarfile, 50);
-            strncpy(fname, opts_tarfile, 50);
-            if ((mfu_file_stat(strcat(fname, ".bz2"), &st, mfu_src_file) == 0)) {
-                if (rank == 0) {
-                    MFU_LOG(MFU_LOG_INFO, "Output file already exists: '%s'", fname);
-                }
-                exit(0);
-            }
-            dbz2_compress(opts_blocksize, opts_tarfile, opts_memory);
-            remove(fname1);
-        }
-#endif
+        /* create the archive file, compressing it as it is written */
+        ret = mfu_flist_archive_create(flist, opts_tarfile, numpaths, paths, &cwd_param, archive_opts, mfu_src_file);
 
         /* free the file list */
         mfu_flist_free(&flist);
@@ -467,28 +933,35 @@ int main(int argc, char** argv)
         mfu_param_path_free(&destpath);
         mfu_free(&paths);
     } else if (opts_extract) {
-        char* tarfile = opts_tarfile;
-#if 0
-        if (opts_compress) {
-            char fname[50];
-            char fname_out[50];
-            strncpy(fname, opts_tarfile, 50);
-            strncpy(fname_out, opts_tarfile, 50);
-            size_t len = strlen(fname_out);
-            fname_out[len - 4] = '\0';
-            struct stat st;
-            if ((mfu_file_stat(fname_out, &st, mfu_src_file) == 0)) {
-                if (rank == 0) {
-                    MFU_LOG(MFU_LOG_ERR, "Output file already exists '%s'", fname_out);
+        /* extract only the members named on the command line, if any,
+         * an archive compressed in block format is decompressed as needed */
+        archive_opts->num_members = (uint64_t) numpaths;
+        archive_opts->members     = (char**) pathlist;
+        ret = mfu_flist_archive_extract(opts_tarfile, &cwd_param, archive_opts, mfu_src_file);
+    } else if (opts_list) {
+        /* list only the members named on the command line, if any,
+         * an archive compressed in block format is decompressed as needed */
+        archive_opts->num_members = (uint64_t) numpaths;
+        archive_opts->members     = (char**) pathlist;
+        mfu_flist flist = mfu_flist_new();
+        ret = mfu_flist_archive_list(opts_tarfile, &cwd_param, archive_opts, flist);
+        if (ret == MFU_SUCCESS) {
+            mfu_flist_print_summary(flist);
+            if (opts_output != NULL) {
+                /* save list for dwalk, dfind, and friends */
+                if (opts_text) {
+                    mfu_flist_write_text(opts_output, flist);
+                } else {
+                    mfu_flist_write_cache(opts_output, flist);
                 }
-                exit(0);
+            } else {
+                mfu_flist_print(flist);
             }
-            //decompress(fname, fname_out);
-            remove(fname);
-            tarfile = fname_out;
         }
-#endif
-        ret = mfu_flist_archive_extract(tarfile, &cwd_param, archive_opts);
+        mfu_flist_free(&flist);
+    } else if (opts_benchmark) {
+        /* time each algorithm and print a table of results */
+        ret = run_bench(opts_bench, opts_output, archive_opts, walk_opts, mfu_src_file);
     } else {
         if (rank == 0) {
             MFU_LOG(MFU_LOG_ERR, "Neither creation or extraction is specified");
@@ -505,12 +978,21 @@ int main(int argc, char** argv)
     /* free the walk options */
     mfu_walk_opts_delete(&walk_opts);
 
-    /* free the mfu_file object */
+#ifdef DAOS_SUPPORT
+    daos_cleanup(daos_args, mfu_src_file, NULL);
+#endif
+
+    /* free the mfu_file objects */
+    mfu_file_delete(&mfu_archive_file);
     mfu_file_delete(&mfu_src_file);
 
     /* free context */
     mfu_free(&opts_tarfile);
     mfu_free(&opts_chdir);
+    mfu_free(&daos_cwd);
+    mfu_free(&opts_compress);
+    mfu_free(&opts_output);
+    mfu_free(&opts_bench);
 
     if (ret != MFU_SUCCESS) {
         DTAR_exit(EXIT_FAILURE);
@@ -0,0 +1,60 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dbz2 decompresses bzip2 files written by the
+#   bzip2 command, including several streams concatenated in one file.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DBZ2_TEST_BIN=${DBZ2_TEST_BIN:-${1}}
+DBZ2_MPIRUN_BIN=${DBZ2_MPIRUN_BIN:-${2}}
+DBZ2_TMP_DIR=${DBZ2_TMP_DIR:-${3}}
+
+echo "Using dbz2 binary at: $DBZ2_TEST_BIN"
+echo "Using mpirun binary at: $DBZ2_MPIRUN_BIN"
+echo "Using tmp directory at: $DBZ2_TMP_DIR"
+
+if ! command -v bzip2 > /dev/null; then
+	echo "bzip2 command not found, skipping"
+	exit 0
+fi
+
+dir=$DBZ2_TMP_DIR/bzip2
+rm -rf $dir
+mkdir -p $dir
+
+# many small blocks of text and random data, and a long run of zeros
+# that decompresses to far more than a block
+for i in `seq 1 400000`; do echo "line $i"; done > $dir/orig1
+head -c 1234567 /dev/urandom >> $dir/orig1
+head -c 20000000 /dev/zero > $dir/orig2
+cat $dir/orig1 $dir/orig2 > $dir/orig
+
+bzip2 -1 -c $dir/orig1 > $dir/file.bz2
+bzip2 -9 -c $dir/orig2 >> $dir/file.bz2
+
+# the bzip2 command writes several blocks per stream, which dbz2 should
+# split across ranks rather than falling back to a serial pass
+$DBZ2_MPIRUN_BIN -np 3 $DBZ2_TEST_BIN --decompress $dir/file.bz2 > $dir/out 2>&1
+rc=$?
+cat $dir/out
+if [ $rc -ne 0 ]; then
+	echo "dbz2 failed to decompress bzip2 streams"
+	exit 1
+fi
+if grep -q "Could not split" $dir/out; then
+	echo "dbz2 fell back to a serial pass on bzip2 streams"
+	exit 1
+fi
+if ! cmp $dir/orig $dir/file; then
+	echo "dbz2 did not restore the original file from bzip2 streams"
+	exit 1
+fi
+
+rm -rf $dir
+exit 0
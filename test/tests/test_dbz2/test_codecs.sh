@@ -0,0 +1,56 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dbz2 --codec compresses a file in block format
+#   with each available codec and decompresses it back to the original.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DBZ2_TEST_BIN=${DBZ2_TEST_BIN:-${1}}
+DBZ2_MPIRUN_BIN=${DBZ2_MPIRUN_BIN:-${2}}
+DBZ2_TMP_DIR=${DBZ2_TMP_DIR:-${3}}
+
+echo "Using dbz2 binary at: $DBZ2_TEST_BIN"
+echo "Using mpirun binary at: $DBZ2_MPIRUN_BIN"
+echo "Using tmp directory at: $DBZ2_TMP_DIR"
+
+dir=$DBZ2_TMP_DIR/codecs
+rm -rf $dir
+mkdir -p $dir
+
+# several blocks of text followed by a partial block of random data
+for i in `seq 1 400000`; do echo "line $i"; done > $dir/orig
+head -c 1234567 /dev/urandom >> $dir/orig
+
+for codec in bz2 gzip zstd lz4; do
+	case $codec in
+		bz2)  ext=bz2 ;;
+		gzip) ext=gz ;;
+		zstd) ext=zst ;;
+		lz4)  ext=lz4 ;;
+	esac
+
+	cp $dir/orig $dir/file
+	$DBZ2_MPIRUN_BIN -np 3 $DBZ2_TEST_BIN --compress --codec $codec $dir/file
+	if [[ ! -f $dir/file.$ext ]]; then
+		echo "dbz2 --codec $codec did not create $dir/file.$ext, skipping"
+		rm -f $dir/file
+		continue
+	fi
+
+	# decompress with a different number of ranks than we compressed with
+	$DBZ2_MPIRUN_BIN -np 4 $DBZ2_TEST_BIN --decompress $dir/file.$ext
+	if ! cmp $dir/orig $dir/file; then
+		echo "dbz2 --codec $codec did not restore the original file"
+		exit 1
+	fi
+	rm -f $dir/file
+done
+
+rm -rf $dir
+exit 0
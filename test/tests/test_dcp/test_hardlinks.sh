@@ -0,0 +1,63 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dcp --hardlinks copies the data of files that
+#   share an inode once and links the other names to the copy.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DCP_TEST_BIN=${DCP_TEST_BIN:-${1}}
+DCP_MPIRUN_BIN=${DCP_MPIRUN_BIN:-${2}}
+DCP_SRC_DIR=${DCP_SRC_DIR:-${3}}
+DCP_DEST_DIR=${DCP_DEST_DIR:-${4}}
+
+echo "Using dcp binary at: $DCP_TEST_BIN"
+echo "Using mpirun binary at: $DCP_MPIRUN_BIN"
+echo "Using src directory at: $DCP_SRC_DIR"
+echo "Using dest directory at: $DCP_DEST_DIR"
+
+rm -rf $DCP_SRC_DIR/links $DCP_DEST_DIR/links
+
+# one inode with three names across two directories, and a plain file
+mkdir -p $DCP_SRC_DIR/links/sub
+echo "shared" > $DCP_SRC_DIR/links/a
+ln $DCP_SRC_DIR/links/a $DCP_SRC_DIR/links/b
+ln $DCP_SRC_DIR/links/a $DCP_SRC_DIR/links/sub/c
+echo "single" > $DCP_SRC_DIR/links/d
+
+$DCP_MPIRUN_BIN -np 3 $DCP_TEST_BIN --hardlinks $DCP_SRC_DIR/links $DCP_DEST_DIR/links
+if [[ $? -ne 0 ]]; then
+	echo "dcp failed"
+	exit 1
+fi
+
+ino_a=`stat -c %i $DCP_DEST_DIR/links/a`
+for name in b sub/c; do
+	ino=`stat -c %i $DCP_DEST_DIR/links/$name`
+	if [[ "$ino" != "$ino_a" ]]; then
+		echo "$DCP_DEST_DIR/links/$name is not linked to $DCP_DEST_DIR/links/a"
+		exit 1
+	fi
+done
+
+nlink=`stat -c %h $DCP_DEST_DIR/links/a`
+if [[ "$nlink" != "3" ]]; then
+	echo "Expected 3 links to $DCP_DEST_DIR/links/a, found $nlink"
+	exit 1
+fi
+
+nlink=`stat -c %h $DCP_DEST_DIR/links/d`
+if [[ "$nlink" != "1" ]]; then
+	echo "Expected 1 link to $DCP_DEST_DIR/links/d, found $nlink"
+	exit 1
+fi
+
+cmp $DCP_SRC_DIR/links/a $DCP_DEST_DIR/links/sub/c || exit 1
+
+rm -rf $DCP_SRC_DIR/links $DCP_DEST_DIR/links
+exit 0
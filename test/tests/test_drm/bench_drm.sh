@@ -0,0 +1,85 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   Generates trees of different shapes and times drm on each of them
+#   with every remove algorithm, including the automatic choice.
+#
+#   Shapes:
+#     wide - many directories with a few files each
+#     deep - a long chain of directories with files at every level
+#     flat - one directory holding all of the files
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+MFU_INSTALL_DIR=${MFU_INSTALL_DIR:-${1}}
+MFU_MPIRUN_BIN=${MFU_MPIRUN_BIN:-${2:-mpirun}}
+MFU_BENCH_NP=${MFU_BENCH_NP:-${3:-4}}
+MFU_BENCH_DIR=${MFU_BENCH_DIR:-${4:-/tmp/drm_bench.$$}}
+MFU_BENCH_FILES=${MFU_BENCH_FILES:-${5:-20000}}
+
+echo "Using MFU install at: $MFU_INSTALL_DIR"
+echo "Using mpirun binary at: $MFU_MPIRUN_BIN"
+echo "Using $MFU_BENCH_NP ranks and $MFU_BENCH_FILES files per tree in $MFU_BENCH_DIR"
+
+DRM=$MFU_INSTALL_DIR/bin/drm
+
+# create files named f<i> in directory $1, numbered $2 up to $3
+make_files()
+{
+	local dir=$1
+	mkdir -p $dir
+	(cd $dir && seq -f "f%.0f" $2 $3 | xargs touch)
+}
+
+make_tree()
+{
+	local shape=$1
+	local root=$MFU_BENCH_DIR/$shape
+	local i
+	case $shape in
+	wide)
+		for ((i = 0; i < MFU_BENCH_FILES / 10; i++)); do
+			make_files $root/d$i 1 10
+		done
+		;;
+	deep)
+		local dir=$root
+		for ((i = 0; i < 200; i++)); do
+			dir=$dir/d$i
+			make_files $dir 1 $((MFU_BENCH_FILES / 200))
+		done
+		;;
+	flat)
+		make_files $root 1 $MFU_BENCH_FILES
+		;;
+	esac
+}
+
+rc=0
+for shape in wide deep flat; do
+	for algo in AUTO DIRECT SPREAD MAP SORT LIBCIRCLE BYDIR; do
+		make_tree $shape
+		start=`date +%s.%N`
+		MFU_FLIST_UNLINK=$algo $MFU_MPIRUN_BIN -np $MFU_BENCH_NP $DRM \
+			$MFU_BENCH_DIR/$shape | grep "Remove strategy\|Removed .* seconds"
+		if [[ ${PIPESTATUS[0]} -ne 0 ]]; then
+			echo "FAIL: drm failed for $shape with $algo"
+			rc=1
+		fi
+		end=`date +%s.%N`
+		if [ -e $MFU_BENCH_DIR/$shape ]; then
+			echo "FAIL: $MFU_BENCH_DIR/$shape not removed with $algo"
+			rm -rf $MFU_BENCH_DIR/$shape
+			rc=1
+		fi
+		printf "%-5s %-10s %8.3f secs\n" $shape $algo `echo "$end - $start" | bc`
+	done
+done
+
+rm -rf $MFU_BENCH_DIR
+exit $rc
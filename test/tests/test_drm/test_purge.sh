@@ -0,0 +1,104 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that drm --purge removes everything it is given and
+#   reports failure when it cannot
+#     - a tree of files, links, and nested directories, plus a top level
+#       file, is removed completely and drm exits with 0
+#     - a tree holding a directory whose subdirectory cannot be removed
+#       makes drm exit non-zero, while everything else is still removed
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+MFU_INSTALL_DIR=${MFU_INSTALL_DIR:-${1}}
+MFU_MPIRUN_BIN=${MFU_MPIRUN_BIN:-${2:-mpirun}}
+MFU_TEST_NP=${MFU_TEST_NP:-${3:-3}}
+
+echo "Using MFU install at: $MFU_INSTALL_DIR"
+echo "Using mpirun binary at: $MFU_MPIRUN_BIN"
+
+MFU_TEST_BIN=$MFU_INSTALL_DIR/bin
+mpirun="$MFU_MPIRUN_BIN -np $MFU_TEST_NP"
+
+TEST_DIR=$(mktemp --directory ${TMPDIR:-/tmp}/test_drm.XXXXX)
+locked=""
+cleanup()
+{
+	if [ -n "$locked" ]; then
+		if [ $(id -u) -eq 0 ]; then
+			chattr -i $locked
+		else
+			chmod u+w $locked
+		fi
+	fi
+	rm -rf $TEST_DIR
+}
+trap cleanup EXIT
+
+# build a tree with directories at several depths
+make_tree()
+{
+	local root=$1
+	local i
+	for i in $(seq 1 10); do
+		mkdir -p $root/d$i/sub/deeper $root/empty$i
+		echo "file $i" > $root/d$i/file
+		echo "file $i" > $root/d$i/sub/deeper/file
+		ln -s file $root/d$i/link
+	done
+	echo "top" > $root/top
+}
+
+make_tree $TEST_DIR/tree
+echo "single" > $TEST_DIR/single
+
+$mpirun $MFU_TEST_BIN/drm --purge $TEST_DIR/tree $TEST_DIR/single
+if [ $? -ne 0 ]; then
+	echo "drm --purge failed on a removable tree"
+	exit 1
+fi
+if [ -e $TEST_DIR/tree ] || [ -e $TEST_DIR/single ]; then
+	echo "drm --purge left items behind"
+	find $TEST_DIR/tree $TEST_DIR/single
+	exit 1
+fi
+
+# lock a directory that holds only an empty subdirectory, so the
+# failure comes from the final rmdir pass, root ignores permission
+# bits so use the immutable flag instead
+make_tree $TEST_DIR/tree
+locked=$TEST_DIR/tree/d3/sub
+rm -f $locked/deeper/file
+if [ $(id -u) -eq 0 ]; then
+	if ! chattr +i $locked 2>/dev/null; then
+		echo "cannot set immutable flag, skipping failure check"
+		exit 0
+	fi
+else
+	chmod a-w $locked
+fi
+
+$mpirun $MFU_TEST_BIN/drm --purge $TEST_DIR/tree
+if [ $? -eq 0 ]; then
+	echo "drm --purge reported success but could not remove $locked"
+	exit 1
+fi
+if [ ! -d $locked/deeper ]; then
+	echo "drm --purge removed an item inside a locked directory"
+	exit 1
+fi
+
+# only the locked directory and its parents should remain
+left=$(find $TEST_DIR/tree -path $locked -prune -o -print | sort | tr '\n' ' ')
+expect="$TEST_DIR/tree $TEST_DIR/tree/d3 "
+if [ "$left" != "$expect" ]; then
+	echo "drm --purge left unexpected items: $left"
+	exit 1
+fi
+
+exit 0
@@ -0,0 +1,72 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dtar -j creates a block compressed archive with
+#   each available codec, and that the archive extracts back to the
+#   original tree, including when using a different number of ranks
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+MFU_INSTALL_DIR=${MFU_INSTALL_DIR:-${1}}
+MFU_MPIRUN_BIN=${MFU_MPIRUN_BIN:-${2:-mpirun}}
+MFU_TEST_NP=${MFU_TEST_NP:-${3:-3}}
+
+echo "Using MFU install at: $MFU_INSTALL_DIR"
+echo "Using mpirun binary at: $MFU_MPIRUN_BIN"
+
+MFU_TEST_BIN=$MFU_INSTALL_DIR/bin
+mpirun="$MFU_MPIRUN_BIN -np $MFU_TEST_NP"
+
+TEST_DIR=$(mktemp --directory ${TMPDIR:-/tmp}/test_dtar.XXXXX)
+trap "rm -rf $TEST_DIR" EXIT
+
+# many small files, empty files and directories, a link, and files
+# that span several compression blocks
+mkdir -p $TEST_DIR/src/empty
+for i in $(seq 1 50); do
+	mkdir -p $TEST_DIR/src/d$((i % 5))
+	echo "file $i" > $TEST_DIR/src/d$((i % 5))/file$i
+done
+touch $TEST_DIR/src/zero
+ln -s d1/file1 $TEST_DIR/src/link
+for i in $(seq 1 300000); do echo "line $i"; done > $TEST_DIR/src/text
+head -c 3000000 /dev/urandom > $TEST_DIR/src/random
+
+cd $TEST_DIR
+
+found=0
+for codec in bz2 gzip zstd lz4; do
+	rm -rf $TEST_DIR/extract $TEST_DIR/src.tar*
+	mkdir $TEST_DIR/extract
+
+	$mpirun $MFU_TEST_BIN/dtar -cf $TEST_DIR/src.tar -j $codec src
+	archive=$(ls $TEST_DIR/src.tar?* 2>/dev/null)
+	if [ -z "$archive" ]; then
+		echo "dtar -j $codec did not create an archive, skipping"
+		continue
+	fi
+	found=1
+
+	# extract with a different number of ranks than we created with
+	$MFU_MPIRUN_BIN -np $((MFU_TEST_NP + 1)) $MFU_TEST_BIN/dtar -xf $archive -C $TEST_DIR/extract
+	if [ $? -ne 0 ]; then
+		echo "dtar failed to extract $archive"
+		exit 1
+	fi
+	if ! diff -r --no-dereference $TEST_DIR/src $TEST_DIR/extract/src; then
+		echo "tree extracted from dtar -j $codec archive does not match source"
+		exit 1
+	fi
+done
+
+if [ $found -eq 0 ]; then
+	echo "dtar -j did not create an archive with any codec"
+	exit 1
+fi
+
+exit 0
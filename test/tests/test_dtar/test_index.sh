@@ -0,0 +1,82 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dtar only uses an index file that matches its archive
+#     - extracting an archive without an index writes a .dtaridx file
+#     - after the archive is replaced by one of the same size with its
+#       entries at other offsets, dtar ignores the old index file and
+#       still extracts the new archive correctly
+#     - the same holds when the new archive has a different size
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+MFU_INSTALL_DIR=${MFU_INSTALL_DIR:-${1}}
+MFU_MPIRUN_BIN=${MFU_MPIRUN_BIN:-${2:-mpirun}}
+MFU_TEST_NP=${MFU_TEST_NP:-${3:-3}}
+
+echo "Using MFU install at: $MFU_INSTALL_DIR"
+echo "Using mpirun binary at: $MFU_MPIRUN_BIN"
+
+MFU_TEST_BIN=$MFU_INSTALL_DIR/bin
+mpirun="$MFU_MPIRUN_BIN -np $MFU_TEST_NP"
+
+TEST_DIR=$(mktemp --directory ${TMPDIR:-/tmp}/test_dtar.XXXXX)
+trap "rm -rf $TEST_DIR" EXIT
+
+cd $TEST_DIR
+
+# create tar archive $1 of a tree holding files a and b of sizes $2 and $3,
+# tar pads archives to 10 KiB records, so small changes keep the same size
+make_archive()
+{
+	rm -rf $TEST_DIR/src
+	mkdir $TEST_DIR/src
+	head -c $2 /dev/urandom > $TEST_DIR/src/a
+	head -c $3 /dev/urandom > $TEST_DIR/src/b
+	echo "c" > $TEST_DIR/src/c
+	tar -cf $1 src
+}
+
+# extract archive $1 with dtar and compare it to the source tree
+check_extract()
+{
+	rm -rf $TEST_DIR/extract
+	mkdir $TEST_DIR/extract
+	$mpirun $MFU_TEST_BIN/dtar -xf $1 -C $TEST_DIR/extract
+	if [ $? -ne 0 ]; then
+		echo "dtar failed to extract $1"
+		exit 1
+	fi
+	if ! diff -r $TEST_DIR/src $TEST_DIR/extract/src; then
+		echo "tree extracted from $1 does not match source"
+		exit 1
+	fi
+}
+
+make_archive $TEST_DIR/src.tar 100 2000
+check_extract $TEST_DIR/src.tar
+if [ ! -f $TEST_DIR/src.tar.dtaridx ]; then
+	echo "dtar did not write an index file when extracting"
+	exit 1
+fi
+
+# same size, entries at other offsets, and an older mtime
+size=$(stat -c %s $TEST_DIR/src.tar)
+make_archive $TEST_DIR/src.tar 2000 100
+touch -d "2020-01-01" $TEST_DIR/src.tar
+if [ $(stat -c %s $TEST_DIR/src.tar) -ne $size ]; then
+	echo "replacement archive changed size, cannot check mtime"
+	exit 1
+fi
+check_extract $TEST_DIR/src.tar
+
+# different size
+make_archive $TEST_DIR/src.tar 30000 100
+check_extract $TEST_DIR/src.tar
+
+exit 0
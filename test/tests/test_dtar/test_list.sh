@@ -0,0 +1,124 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dtar -t lists the same entries as tar -t
+#     - the entries dtar -t prints match tar -tv by type, mode, and name
+#     - a list saved with dtar -t -o and read with dwalk -i matches too
+#     - both hold for an archive compressed with dtar -j, which only
+#       has some of its blocks decompressed
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+MFU_INSTALL_DIR=${MFU_INSTALL_DIR:-${1}}
+MFU_MPIRUN_BIN=${MFU_MPIRUN_BIN:-${2:-mpirun}}
+MFU_TEST_NP=${MFU_TEST_NP:-${3:-3}}
+
+echo "Using MFU install at: $MFU_INSTALL_DIR"
+echo "Using mpirun binary at: $MFU_MPIRUN_BIN"
+
+MFU_TEST_BIN=$MFU_INSTALL_DIR/bin
+mpirun="$MFU_MPIRUN_BIN -np $MFU_TEST_NP"
+
+TEST_DIR=$(mktemp --directory ${TMPDIR:-/tmp}/test_dtar.XXXXX)
+trap "rm -rf $TEST_DIR" EXIT
+
+# dtar prints the first and last 10 entries, so keep the tree below
+# 20 entries, with large files so a compressed archive spans several
+# blocks that listing does not need
+mkdir -p $TEST_DIR/src/a/b $TEST_DIR/src/empty
+head -c 9000000 /dev/urandom > $TEST_DIR/src/a/big
+echo "one" > $TEST_DIR/src/a/one
+chmod 600 $TEST_DIR/src/a/one
+echo "two" > $TEST_DIR/src/a/b/two
+chmod 755 $TEST_DIR/src/a/b/two
+touch $TEST_DIR/src/zero
+ln -s a/one $TEST_DIR/src/link
+head -c 9000000 /dev/urandom > $TEST_DIR/src/zbig
+
+cd $TEST_DIR
+
+$mpirun $MFU_TEST_BIN/dtar -cf $TEST_DIR/src.tar src
+if [ $? -ne 0 ]; then
+	echo "dtar failed to create archive"
+	exit 1
+fi
+
+# mode and name of each entry as tar lists it, without the dtar index
+tar -tvf $TEST_DIR/src.tar | sed 's/ -> .*//' | awk '{print $1, $NF}' | \
+	sed 's|/$||' | grep -v '\.dtaridx$' | sort > $TEST_DIR/expect
+
+# mode and name of each entry in a dtar or dwalk listing on stdin,
+# named relative to the directory we listed under
+entries()
+{
+	grep '^[-dl][-rwxsStT]\{9\} ' | awk '{print $1, $NF}' | \
+		sed "s| $TEST_DIR/| |" | sort
+}
+
+# compare the listings of archive $1 against tar
+check_list()
+{
+	local archive=$1
+
+	$mpirun $MFU_TEST_BIN/dtar -tf $archive > $TEST_DIR/log 2>&1
+	if [ $? -ne 0 ]; then
+		cat $TEST_DIR/log
+		echo "dtar failed to list $archive"
+		exit 1
+	fi
+	if ! diff $TEST_DIR/expect <(entries < $TEST_DIR/log); then
+		echo "dtar -t of $archive does not match tar -t"
+		exit 1
+	fi
+
+	rm -f $TEST_DIR/list.mfu
+	$mpirun $MFU_TEST_BIN/dtar -tf $archive -o $TEST_DIR/list.mfu > /dev/null 2>&1
+	if [ $? -ne 0 ] || [ ! -f $TEST_DIR/list.mfu ]; then
+		echo "dtar failed to save list of $archive"
+		exit 1
+	fi
+	$mpirun $MFU_TEST_BIN/dwalk -i $TEST_DIR/list.mfu -p > $TEST_DIR/walk 2>&1
+	if [ $? -ne 0 ]; then
+		cat $TEST_DIR/walk
+		echo "dwalk failed to read list saved from $archive"
+		exit 1
+	fi
+	if ! diff $TEST_DIR/expect <(entries < $TEST_DIR/walk); then
+		echo "dwalk -i of list saved from $archive does not match tar -t"
+		exit 1
+	fi
+}
+
+check_list $TEST_DIR/src.tar
+
+# a compressed archive should only have some of its blocks decompressed
+for codec in zstd lz4 gzip bz2; do
+	$mpirun $MFU_TEST_BIN/dtar -cf $TEST_DIR/src.tar -j $codec src > /dev/null 2>&1
+	archive=$(ls $TEST_DIR/src.tar?* 2>/dev/null)
+	if [ -n "$archive" ]; then
+		break
+	fi
+done
+if [ -z "$archive" ]; then
+	echo "dtar -j did not create an archive with any codec, skipping compressed check"
+	exit 0
+fi
+
+check_list $archive
+blocks=$(sed -n 's/.*Decompressed \([0-9]*\) of \([0-9]*\) blocks.*/\1 \2/p' $TEST_DIR/log)
+if [ -z "$blocks" ]; then
+	echo "dtar did not report the blocks it decompressed from $archive"
+	exit 1
+fi
+set -- $blocks
+if [ $1 -ge $2 ]; then
+	echo "dtar decompressed $1 of $2 blocks from $archive to list it"
+	exit 1
+fi
+
+exit 0
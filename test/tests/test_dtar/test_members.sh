@@ -0,0 +1,137 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dtar -xf ARCHIVE MEMBER... extracts only the
+#   selected members
+#     - a member named by its path is extracted along with its missing
+#       parent directories
+#     - a glob pattern selects the entries it matches
+#     - a directory member selects everything below it
+#     - the same selection works on an archive compressed with dtar -j,
+#       which decompresses only some of its blocks
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+MFU_INSTALL_DIR=${MFU_INSTALL_DIR:-${1}}
+MFU_MPIRUN_BIN=${MFU_MPIRUN_BIN:-${2:-mpirun}}
+MFU_TEST_NP=${MFU_TEST_NP:-${3:-3}}
+
+echo "Using MFU install at: $MFU_INSTALL_DIR"
+echo "Using mpirun binary at: $MFU_MPIRUN_BIN"
+
+MFU_TEST_BIN=$MFU_INSTALL_DIR/bin
+mpirun="$MFU_MPIRUN_BIN -np $MFU_TEST_NP"
+
+TEST_DIR=$(mktemp --directory ${TMPDIR:-/tmp}/test_dtar.XXXXX)
+trap "rm -rf $TEST_DIR" EXIT
+
+# large files on either side of the members so that a compressed
+# archive spans several blocks that the selection does not need
+mkdir -p $TEST_DIR/src/a/b/c $TEST_DIR/src/logs $TEST_DIR/src/proj/sub
+head -c 12000000 /dev/urandom > $TEST_DIR/src/a/big
+echo "deep" > $TEST_DIR/src/a/b/c/deep.txt
+echo "other" > $TEST_DIR/src/a/b/other.txt
+for i in 1 2 3; do
+	echo "log $i" > $TEST_DIR/src/logs/run$i.log
+	echo "out $i" > $TEST_DIR/src/logs/run$i.out
+done
+echo "p" > $TEST_DIR/src/proj/p.c
+echo "s" > $TEST_DIR/src/proj/sub/s.c
+ln -s p.c $TEST_DIR/src/proj/link
+head -c 12000000 /dev/urandom > $TEST_DIR/src/zbig
+
+cd $TEST_DIR
+
+# expected items, relative to the extract directory
+expect="src
+src/a
+src/a/b
+src/a/b/c
+src/a/b/c/deep.txt
+src/logs
+src/logs/run1.log
+src/logs/run2.log
+src/logs/run3.log
+src/proj
+src/proj/link
+src/proj/p.c
+src/proj/sub
+src/proj/sub/s.c"
+
+# extract the members from archive $1 into a new directory and check them
+check_members()
+{
+	local archive=$1
+	rm -rf $TEST_DIR/extract
+	mkdir $TEST_DIR/extract
+
+	$mpirun $MFU_TEST_BIN/dtar -xf $archive -C $TEST_DIR/extract \
+		src/a/b/c/deep.txt 'src/logs/*.log' src/proj > $TEST_DIR/log 2>&1
+	if [ $? -ne 0 ]; then
+		cat $TEST_DIR/log
+		echo "dtar failed to extract members from $archive"
+		exit 1
+	fi
+
+	local got=$(cd $TEST_DIR/extract && find . -mindepth 1 | sed 's|^\./||' | sort)
+	if [ "$got" != "$expect" ]; then
+		echo "dtar extracted the wrong items from $archive:"
+		echo "$got"
+		exit 1
+	fi
+
+	local f
+	for f in a/b/c/deep.txt logs/run1.log logs/run3.log proj/sub/s.c; do
+		if ! cmp $TEST_DIR/src/$f $TEST_DIR/extract/src/$f; then
+			echo "member $f extracted from $archive does not match source"
+			exit 1
+		fi
+	done
+	if [ "$(readlink $TEST_DIR/extract/src/proj/link)" != "p.c" ]; then
+		echo "link extracted from $archive does not match source"
+		exit 1
+	fi
+}
+
+$mpirun $MFU_TEST_BIN/dtar -cf $TEST_DIR/src.tar src
+if [ $? -ne 0 ]; then
+	echo "dtar failed to create archive"
+	exit 1
+fi
+check_members $TEST_DIR/src.tar
+
+# a compressed archive should only have some of its blocks decompressed
+for codec in zstd lz4 gzip bz2; do
+	$mpirun $MFU_TEST_BIN/dtar -cf $TEST_DIR/src.tar -j $codec src > /dev/null 2>&1
+	archive=$(ls $TEST_DIR/src.tar?* 2>/dev/null)
+	if [ -n "$archive" ]; then
+		break
+	fi
+done
+if [ -z "$archive" ]; then
+	echo "dtar -j did not create an archive with any codec, skipping compressed check"
+	exit 0
+fi
+
+check_members $archive
+blocks=$(sed -n 's/.*Decompressed \([0-9]*\) of \([0-9]*\) blocks.*/\1 \2/p' $TEST_DIR/log)
+if [ -z "$blocks" ]; then
+	echo "dtar did not report the blocks it decompressed from $archive"
+	exit 1
+fi
+set -- $blocks
+if [ $1 -ge $2 ]; then
+	echo "dtar decompressed $1 of $2 blocks from $archive to extract a few members"
+	exit 1
+fi
+if ls $TEST_DIR/src.tar?*.* > /dev/null 2>&1; then
+	echo "dtar left a decompressed copy of $archive behind"
+	exit 1
+fi
+
+exit 0
@@ -0,0 +1,91 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   A test to check that dtar --update only appends new and changed items
+#     - updating an unchanged tree appends nothing, including paths that
+#       hold an '=' character
+#     - a changed file is appended once and extracts with its new data
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+MFU_INSTALL_DIR=${MFU_INSTALL_DIR:-${1}}
+MFU_MPIRUN_BIN=${MFU_MPIRUN_BIN:-${2:-mpirun}}
+MFU_TEST_NP=${MFU_TEST_NP:-${3:-3}}
+
+echo "Using MFU install at: $MFU_INSTALL_DIR"
+echo "Using mpirun binary at: $MFU_MPIRUN_BIN"
+
+MFU_TEST_BIN=$MFU_INSTALL_DIR/bin
+mpirun="$MFU_MPIRUN_BIN -np $MFU_TEST_NP"
+
+TEST_DIR=$(mktemp --directory ${TMPDIR:-/tmp}/test_dtar.XXXXX)
+trap "rm -rf $TEST_DIR" EXIT
+
+# build a tree whose names include an '=' as job output often does
+mkdir -p "$TEST_DIR/src/run=5" $TEST_DIR/extract
+for i in $(seq 1 20); do
+	echo "file $i" > $TEST_DIR/src/file$i
+done
+echo "output" > "$TEST_DIR/src/run=5/out.dat"
+echo "a=b" > "$TEST_DIR/src/key=value"
+
+cd $TEST_DIR
+
+# count the entries tar sees, duplicates included
+count_entries()
+{
+	tar -tf $TEST_DIR/src.tar | wc -l
+}
+
+$mpirun $MFU_TEST_BIN/dtar -cf $TEST_DIR/src.tar src
+if [ $? -ne 0 ]; then
+	echo "dtar failed to create archive"
+	exit 1
+fi
+before=$(count_entries)
+
+# update twice without changing anything
+for pass in 1 2; do
+	$mpirun $MFU_TEST_BIN/dtar -uf $TEST_DIR/src.tar src
+	if [ $? -ne 0 ]; then
+		echo "dtar update $pass failed"
+		exit 1
+	fi
+	after=$(count_entries)
+	if [ "$after" -ne "$before" ]; then
+		echo "dtar update $pass of an unchanged tree added entries: $before -> $after"
+		tar -tf $TEST_DIR/src.tar | sort | uniq -d
+		exit 1
+	fi
+done
+
+# change one file, it should be appended exactly once
+sleep 1
+echo "new output" > "$TEST_DIR/src/run=5/out.dat"
+$mpirun $MFU_TEST_BIN/dtar -uf $TEST_DIR/src.tar src
+if [ $? -ne 0 ]; then
+	echo "dtar update of a changed tree failed"
+	exit 1
+fi
+after=$(count_entries)
+if [ "$after" -ne $((before + 1)) ]; then
+	echo "dtar update of one changed file added $((after - before)) entries"
+	exit 1
+fi
+
+$mpirun $MFU_TEST_BIN/dtar -xf $TEST_DIR/src.tar -C $TEST_DIR/extract
+if [ $? -ne 0 ]; then
+	echo "dtar failed to extract updated archive"
+	exit 1
+fi
+if ! diff -r $TEST_DIR/src $TEST_DIR/extract/src; then
+	echo "extracted tree does not match source after update"
+	exit 1
+fi
+
+exit 0
@@ -0,0 +1,153 @@
+/*
+ * Checks and times the mfu_mem zero detection and compare kernels.
+ *
+ * Each rank verifies that the kernels locate a single non-zero or
+ * differing byte at every position of small buffers, then times
+ * repeated scans of a buffer that must be read end to end and
+ * reports GB/s per core (min/max over ranks).
+ *
+ * Usage: mpirun -np N mfu_mem_bench [buffer_bytes] [iterations]
+ *
+ * Set MFU_MEM_SIMD=generic|sse2|avx2|avx512 to time a particular kernel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+
+#include "mfu.h"
+
+/* verify kernels on all buffer lengths and byte positions up to max */
+static int check_kernels(size_t max)
+{
+    int errors = 0;
+    char* a = (char*) MFU_MALLOC(max + 1);
+    char* b = (char*) MFU_MALLOC(max + 1);
+
+    size_t len;
+    for (len = 0; len <= max; len++) {
+        /* offset buffers by one byte to exercise unaligned loads */
+        char* za = a + (len & 1);
+        char* zb = b + (len & 1);
+        memset(za, 0, len);
+        memset(zb, 0, len);
+
+        if (! mfu_mem_is_zero(za, len)) {
+            printf("is_zero failed on zero buffer of %zu bytes\n", len);
+            errors++;
+        }
+        if (! mfu_mem_equal(za, zb, len)) {
+            printf("equal failed on matching buffers of %zu bytes\n", len);
+            errors++;
+        }
+        if (mfu_mem_first_diff(za, zb, len) != len) {
+            printf("first_diff failed on matching buffers of %zu bytes\n", len);
+            errors++;
+        }
+
+        size_t pos;
+        for (pos = 0; pos < len; pos++) {
+            za[pos] = 1;
+            if (mfu_mem_is_zero(za, len)) {
+                printf("is_zero missed byte %zu of %zu\n", pos, len);
+                errors++;
+            }
+            if (mfu_mem_equal(za, zb, len)) {
+                printf("equal missed byte %zu of %zu\n", pos, len);
+                errors++;
+            }
+            if (mfu_mem_first_diff(za, zb, len) != pos) {
+                printf("first_diff missed byte %zu of %zu\n", pos, len);
+                errors++;
+            }
+            za[pos] = 0;
+        }
+    }
+
+    mfu_free(&b);
+    mfu_free(&a);
+    return errors;
+}
+
+/* report min/max per-core rate across ranks */
+static void report(const char* name, size_t bytes, int iters, double secs)
+{
+    double rate = 0.0;
+    if (secs > 0.0) {
+        rate = ((double) bytes * (double) iters) / secs / 1.0e9;
+    }
+
+    double min, max;
+    MPI_Reduce(&rate, &min, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&rate, &max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (mfu_rank == 0) {
+        printf("%-8s %-8s %10.3f GB/s/core min %10.3f GB/s/core max\n",
+            mfu_mem_simd(), name, min, max);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    mfu_init();
+
+    size_t bytes = 64 * 1024 * 1024;
+    int iters = 20;
+    if (argc > 1) {
+        bytes = (size_t) strtoull(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        iters = atoi(argv[2]);
+    }
+
+    int errors = check_kernels(1024);
+
+    /* zero buffers force a full scan */
+    char* a = (char*) MFU_MEMALIGN(bytes, 4096);
+    char* b = (char*) MFU_MEMALIGN(bytes, 4096);
+    memset(a, 0, bytes);
+    memset(b, 0, bytes);
+
+    int i;
+    int hits = 0;
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    for (i = 0; i < iters; i++) {
+        hits += mfu_mem_is_zero(a, bytes);
+    }
+    report("is_zero", bytes, iters, MPI_Wtime() - start);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    start = MPI_Wtime();
+    for (i = 0; i < iters; i++) {
+        hits += mfu_mem_equal(a, b, bytes);
+    }
+    report("equal", bytes, iters, MPI_Wtime() - start);
+
+    /* place a difference in the last byte to force a full scan */
+    b[bytes - 1] = 1;
+    MPI_Barrier(MPI_COMM_WORLD);
+    start = MPI_Wtime();
+    for (i = 0; i < iters; i++) {
+        hits += (mfu_mem_first_diff(a, b, bytes) == bytes - 1);
+    }
+    report("diff", bytes, iters, MPI_Wtime() - start);
+
+    if (hits != 3 * iters) {
+        printf("timed scans returned wrong result\n");
+        errors++;
+    }
+
+    mfu_free(&b);
+    mfu_free(&a);
+
+    int all_errors;
+    MPI_Allreduce(&errors, &all_errors, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    mfu_finalize();
+    MPI_Finalize();
+
+    return (all_errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   Checks the mfu_mem zero detection and compare kernels and reports
+#   per-core scan rates for every kernel the processor supports.
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+MFU_INSTALL_DIR=${MFU_INSTALL_DIR:-${1}}
+MFU_MPIRUN_BIN=${MFU_MPIRUN_BIN:-${2:-mpirun}}
+MFU_BENCH_NP=${MFU_BENCH_NP:-${3:-1}}
+
+echo "Using MFU install at: $MFU_INSTALL_DIR"
+echo "Using mpirun binary at: $MFU_MPIRUN_BIN"
+
+# build benchmark if not found
+BENCH=${BENCH:-"`dirname $0`/mfu_mem_bench"}
+if [ ! -f "$BENCH" ]; then
+	mpicc -I$MFU_INSTALL_DIR/include `dirname $0`/mfu_mem_bench.c \
+		-L$MFU_INSTALL_DIR/lib -L$MFU_INSTALL_DIR/lib64 \
+		-Wl,-rpath,$MFU_INSTALL_DIR/lib -Wl,-rpath,$MFU_INSTALL_DIR/lib64 \
+		-lmfu -o `dirname $0`/mfu_mem_bench
+	if [[ $? -ne 0 ]]; then
+		echo "Failed to build `dirname $0`/mfu_mem_bench.c"
+		exit 1;
+	fi
+	BENCH=`dirname $0`/mfu_mem_bench
+fi
+
+rc=0
+for simd in generic sse2 avx2 avx512; do
+	MFU_MEM_SIMD=$simd $MFU_MPIRUN_BIN -np $MFU_BENCH_NP $BENCH
+	if [[ $? -ne 0 ]]; then
+		echo "FAIL: kernel check failed for $simd"
+		rc=1
+	fi
+done
+
+exit $rc
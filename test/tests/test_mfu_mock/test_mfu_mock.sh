@@ -0,0 +1,138 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   Runs tools against the in-memory mock file system with faults injected
+#     - dtar creates a real archive from a mock tree despite EINTR, EIO,
+#       and short reads, and tar extracts the same tree from it, the
+#       faults are frequent enough that any call that is not retried
+#       makes the tool fail
+#     - dtar updates a real archive from an unchanged mock tree without
+#       adding entries, and refuses to preserve xattrs from a mock tree
+#     - dtar extracts a real archive into a mock tree without touching disk,
+#       writing all of the file data to the mock despite faults
+#     - dcp fails cleanly when the mock runs out of space
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+MFU_INSTALL_DIR=${MFU_INSTALL_DIR:-${1}}
+MFU_MPIRUN_BIN=${MFU_MPIRUN_BIN:-${2:-mpirun}}
+MFU_TEST_NP=${MFU_TEST_NP:-${3:-3}}
+
+echo "Using MFU install at: $MFU_INSTALL_DIR"
+echo "Using mpirun binary at: $MFU_MPIRUN_BIN"
+
+MFU_TEST_BIN=$MFU_INSTALL_DIR/bin
+mpirun="$MFU_MPIRUN_BIN -np $MFU_TEST_NP"
+
+TEST_DIR=$(mktemp --directory ${TMPDIR:-/tmp}/test_mfu_mock.XXXXX)
+trap "rm -rf $TEST_DIR" EXIT
+
+# build a small tree with a file large enough to be split across ranks
+mkdir -p $TEST_DIR/src/dir1/dir2 $TEST_DIR/out $TEST_DIR/extract
+for i in $(seq 1 50); do
+	echo "file $i" > $TEST_DIR/src/dir1/file$i
+done
+dd if=/dev/urandom of=$TEST_DIR/src/dir1/dir2/big bs=1M count=8 status=none
+ln -s dir1/file1 $TEST_DIR/src/link
+
+rc=0
+
+# check that the mock in log $1 injected both EINTR and EIO faults,
+# which the tool only gets past if mfu_io retries them
+check_faults()
+{
+	local faults=$(sed -n 's/.*Mock faults: \([0-9]*\) EINTR, \([0-9]*\) EIO.*/\1 \2/p' $1)
+	set -- $faults
+	if [[ ${1:-0} -eq 0 || ${2:-0} -eq 0 ]]; then
+		echo "FAIL: mock file system injected ${1:-no} EINTR and ${2:-no} EIO faults, expected some of each"
+		rc=1
+	fi
+}
+
+# create an archive from the mock tree, the archive itself is written to disk,
+# every other call fails with EINTR, so every call must be retried to succeed
+pushd $TEST_DIR >/dev/null
+MFU_MOCK_FS=$TEST_DIR/src MFU_MOCK_LATENCY=10 MFU_MOCK_FAULTS=eintr:2,eio:5,short:3 \
+	$mpirun -x MFU_MOCK_FS -x MFU_MOCK_LATENCY -x MFU_MOCK_FAULTS \
+	$MFU_TEST_BIN/dtar -cf $TEST_DIR/src.tar src > $TEST_DIR/create.log 2>&1
+if [[ $? -ne 0 ]]; then
+	cat $TEST_DIR/create.log
+	echo "FAIL: dtar create from mock file system failed"
+	rc=1
+fi
+check_faults $TEST_DIR/create.log
+popd >/dev/null
+
+tar -xf $TEST_DIR/src.tar -C $TEST_DIR/out
+if ! diff -r --no-dereference $TEST_DIR/src $TEST_DIR/out/src; then
+	echo "FAIL: archive created from mock file system differs from source"
+	rc=1
+fi
+
+# update the archive from the unchanged mock tree, the archive on disk
+# is found even though the items are looked up in the mock
+entries=$(tar -tf $TEST_DIR/src.tar | wc -l)
+pushd $TEST_DIR >/dev/null
+MFU_MOCK_FS=$TEST_DIR/src \
+	$mpirun -x MFU_MOCK_FS \
+	$MFU_TEST_BIN/dtar -uf $TEST_DIR/src.tar src
+if [[ $? -ne 0 ]]; then
+	echo "FAIL: dtar update from mock file system failed"
+	rc=1
+fi
+if [[ $(tar -tf $TEST_DIR/src.tar | wc -l) -ne $entries ]]; then
+	echo "FAIL: dtar update from unchanged mock file system added entries"
+	rc=1
+fi
+
+# libarchive reads xattrs through POSIX calls, which would miss the mock
+MFU_MOCK_FS=$TEST_DIR/src \
+	$mpirun -x MFU_MOCK_FS \
+	$MFU_TEST_BIN/dtar --preserve-xattrs -cf $TEST_DIR/xattrs.tar src
+if [[ $? -eq 0 ]]; then
+	echo "FAIL: dtar preserved xattrs from mock file system"
+	rc=1
+fi
+popd >/dev/null
+
+# extract the archive into an empty mock file system, the archive is read
+# from disk, so the bytes the mock counts are the file data written to it
+MFU_MOCK_FS= MFU_MOCK_FAULTS=eintr:2,eio:3,short:2 \
+	$mpirun -x MFU_MOCK_FS -x MFU_MOCK_FAULTS \
+	$MFU_TEST_BIN/dtar -xf $TEST_DIR/src.tar -C $TEST_DIR/extract > $TEST_DIR/extract.log
+if [[ $? -ne 0 ]]; then
+	echo "FAIL: dtar extract into mock file system failed"
+	rc=1
+fi
+cat $TEST_DIR/extract.log
+check_faults $TEST_DIR/extract.log
+expected=$(find $TEST_DIR/src -type f -printf "%s\n" | awk '{sum += $1} END {print sum}')
+written=$(sed -n 's/.*Mock file system: [0-9]* calls, \([0-9]*\) bytes.*/\1/p' $TEST_DIR/extract.log)
+if [[ "$written" != "$expected" ]]; then
+	echo "FAIL: dtar extract wrote ${written:-no} bytes to mock file system, expected $expected"
+	rc=1
+fi
+if [[ -n "$(ls -A $TEST_DIR/extract)" ]]; then
+	echo "FAIL: dtar extract into mock file system wrote to disk"
+	rc=1
+fi
+
+# copy within the mock file system with room for only part of the data
+MFU_MOCK_FS=$TEST_DIR/src MFU_MOCK_FAULTS=enospc:10MB \
+	$mpirun -x MFU_MOCK_FS -x MFU_MOCK_FAULTS \
+	$MFU_TEST_BIN/dcp $TEST_DIR/src $TEST_DIR/copy
+if [[ $? -eq 0 ]]; then
+	echo "FAIL: dcp succeeded with mock file system out of space"
+	rc=1
+fi
+if [[ -e $TEST_DIR/copy ]]; then
+	echo "FAIL: dcp within mock file system wrote to disk"
+	rc=1
+fi
+
+exit $rc